@@ -0,0 +1,204 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_ASYNC_CONNECTION_HPP__
+#define __DB_PLUS_ASYNC_CONNECTION_HPP__
+
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <dbplus/Database.hpp>
+#include <dbplus/Dbplus.hpp>
+#include <dbplus/Executor.hpp>
+#include <dbplus/Reactor.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+class Result;
+
+/*! \class AsyncConnection
+ *  \brief Awaitable operations over a connection owned by a reactor.
+ *
+ * Every operation returns an object that can be used with co_await in
+ * C++20 coroutines:
+ *
+ *   std::shared_ptr<Result> result = co_await connection.execute(sql);
+ *   while (co_await result->fetchAsync()) { ... }
+ *   co_await connection.commit();
+ *
+ * The operation is sent to the reactor when the coroutine is
+ * suspended and the coroutine is resumed through the executor when the
+ * reactor finishes it.
+ */
+class AsyncConnection
+{
+public:
+	/*! \class Awaitable
+	 *  \brief Asynchronous operation that can be awaited.
+	 */
+	class Awaitable
+	{
+	public:
+		/*! Constructor.
+		 *
+		 * @param submit Function that sends the operation to the reactor
+		 * @param executor Executor used to resume the coroutine
+		 */
+		Awaitable(std::function<void (Database::AsyncCallback)> submit,
+		          Executor &executor) :
+			_submit(submit),
+			_executor(executor)
+		{
+		}
+
+		/*! The operation always needs to wait for the database.
+		 *
+		 * @return Always false
+		 */
+		bool await_ready() const
+		{
+			return false;
+		}
+
+		/*! Send the operation to the reactor. The coroutine handle is
+		 * only used after the operation finishes.
+		 *
+		 * @tparam Handle Coroutine handle type
+		 * @param handle Suspended coroutine
+		 */
+		template<class Handle>
+		void await_suspend(Handle handle)
+		{
+			Awaitable *awaitable = this;
+			_submit([awaitable, handle](std::shared_ptr<Result> result,
+			                            std::exception_ptr error) {
+				awaitable->_result = result;
+				awaitable->_error = error;
+
+				Handle continuation = handle;
+				awaitable->_executor.post([continuation]() mutable {
+					continuation.resume();
+				});
+			});
+		}
+
+		/*! Returns the operation result.
+		 *
+		 * @return Result of the operation, empty for commands
+		 * @throw DatabaseException on error
+		 */
+		std::shared_ptr<Result> await_resume()
+		{
+			if (_error) {
+				std::rethrow_exception(_error);
+			}
+
+			return _result;
+		}
+
+	private:
+		std::function<void (Database::AsyncCallback)> _submit;
+		Executor &_executor;
+		std::shared_ptr<Result> _result;
+		std::exception_ptr _error;
+	};
+
+	/*! Constructor.
+	 *
+	 * @param reactor Reactor that owns the connection
+	 * @param connection Connection used by the operations
+	 * @param executor Executor used to resume the coroutines
+	 */
+	AsyncConnection(Reactor &reactor,
+	                std::shared_ptr<Database> connection,
+	                Executor &executor) :
+		_reactor(reactor),
+		_connection(connection),
+		_executor(executor)
+	{
+	}
+
+	/*! Execute a SQL query.
+	 *
+	 * @param query SQL query
+	 * @return Awaitable that returns the result object
+	 */
+	Awaitable execute(const string &query)
+	{
+		Reactor &reactor = _reactor;
+		std::shared_ptr<Database> connection = _connection;
+
+		return Awaitable([&reactor, connection, query]
+		                 (Database::AsyncCallback callback) {
+			                 reactor.execute(connection, query, callback);
+		                 }, _executor);
+	}
+
+	/*! Persist the current transaction.
+	 *
+	 * @return Awaitable that returns an empty result
+	 */
+	Awaitable commit()
+	{
+		Reactor &reactor = _reactor;
+		std::shared_ptr<Database> connection = _connection;
+
+		return Awaitable([&reactor, connection]
+		                 (Database::AsyncCallback callback) {
+			                 reactor.commit(connection, callback);
+		                 }, _executor);
+	}
+
+	/*! Roll back the current transaction.
+	 *
+	 * @return Awaitable that returns an empty result
+	 */
+	Awaitable rollback()
+	{
+		Reactor &reactor = _reactor;
+		std::shared_ptr<Database> connection = _connection;
+
+		return Awaitable([&reactor, connection]
+		                 (Database::AsyncCallback callback) {
+			                 reactor.rollback(connection, callback);
+		                 }, _executor);
+	}
+
+	/*! Returns the connection used by the operations.
+	 *
+	 * @return Connection owned by the reactor
+	 */
+	std::shared_ptr<Database> getConnection() const
+	{
+		return _connection;
+	}
+
+private:
+	Reactor &_reactor;
+	std::shared_ptr<Database> _connection;
+	Executor &_executor;
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_ASYNC_CONNECTION_HPP__
@@ -0,0 +1,93 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_ASYNC_SET_HPP__
+#define __DB_PLUS_ASYNC_SET_HPP__
+
+#include <vector>
+
+#include <dbplus/Database.hpp>
+#include <dbplus/Dbplus.hpp>
+
+DBPLUS_NS_BEGIN
+
+/*! \class AsyncSet
+ *  \brief Waits for the asynchronous operations of many connections.
+ *
+ * Lighter than the Reactor, the set doesn't own the connections and
+ * is used in the thread that started the operations, like when many
+ * connections are opened at the same time. Results and errors are
+ * delivered to the callbacks given to each operation.
+ */
+class AsyncSet
+{
+public:
+	/*! Add a connection with an operation in progress. Connections
+	 * whose operation is already complete are ignored.
+	 *
+	 * @param database Connection running the operation
+	 * @param status Status returned when the operation was started
+	 */
+	void add(Database &database, const Database::AsyncStatus::Value status);
+
+	/*! Wait until at least one connection is ready and continue its
+	 * operation.
+	 *
+	 * @param timeout Maximum time to wait in milliseconds, -1 waits
+	 * forever
+	 * @return Number of operations that finished
+	 * @throw DatabaseException if the sockets could not be checked
+	 */
+	unsigned int waitOnce(const int timeout = -1);
+
+	/*! Wait until all operations finish.
+	 *
+	 * @param timeout Maximum time to wait in milliseconds, -1 waits
+	 * forever
+	 * @throw DatabaseException on timeout
+	 */
+	void waitAll(const int timeout = -1);
+
+	/*! Returns the number of operations that didn't finish yet.
+	 *
+	 * @return Number of operations in progress
+	 */
+	unsigned int pending() const;
+
+	/*! Check if the operation of a connection didn't finish yet.
+	 *
+	 * @param database Connection added to the set
+	 * @return True if the connection is still waiting
+	 */
+	bool pending(const Database &database) const;
+
+private:
+	/*! Connection waiting for its socket
+	 */
+	struct Entry {
+		Database *database;
+		Database::AsyncStatus::Value status;
+	};
+
+	std::vector<Entry> _entries;
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_ASYNC_SET_HPP__
@@ -0,0 +1,437 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_BATCH_LOADER_HPP__
+#define __DB_PLUS_BATCH_LOADER_HPP__
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/any.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <dbplus/ConnectionPool.hpp>
+#include <dbplus/DatabaseException.hpp>
+#include <dbplus/Dbplus.hpp>
+#include <dbplus/Result.hpp>
+#include <dbplus/SqlDialect.hpp>
+#include <dbplus/StoredResult.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+/*! \class BatchLoader
+ *  \brief Joins lookups by key in one query.
+ *
+ * The keys requested by many callers are collected for a short window,
+ * or until the batch is full, and loaded with only one query, like
+ * SELECT * FROM table WHERE column IN (...). The rows are split by the
+ * value of the key column and each caller receives only the rows of
+ * its key. Keys are compared byte by byte with the text sent by the
+ * server, so they must be written like the database returns them (7
+ * and not 007). Case insensitive collations (the MySQL default) find
+ * rows of keys with another case, like ABC for abc, that don't match
+ * the caller; use the stored spelling, or a binary collation in the
+ * key column. A query without the key column, or keys that can't be
+ * read as text, fail all callers of the batch. Thread safe.
+ *
+ * Usage:
+ *   BatchLoader<MySql> users(pool, "users", "id");
+ *   std::future<std::shared_ptr<Result> > user = users.load("7");
+ */
+template<class Driver>
+class BatchLoader
+{
+public:
+	typedef ConnectionPool<Driver> Pool;
+	typedef std::promise<std::shared_ptr<Result> > Promise;
+
+	/*! Constructor. Starts the thread that sends the batches when the
+	 * window expires.
+	 *
+	 * @param pool Connections used to load the keys
+	 * @param table Table name
+	 * @param column Key column, must be returned by the query
+	 * @param columns Columns that are going to be loaded
+	 * @param maxBatch Maximum number of keys in one query
+	 * @param window Maximum time that a key waits for other keys
+	 */
+	BatchLoader(std::shared_ptr<Pool> pool,
+	            const string &table,
+	            const string &column,
+	            const string &columns = "*",
+	            const unsigned int maxBatch = 100,
+	            const std::chrono::milliseconds window = std::chrono::milliseconds(2)) :
+		_pool(pool),
+		_query("SELECT " + columns + " FROM " + table + " WHERE "),
+		_column(column),
+		_maxBatch(maxBatch == 0 ? 1 : maxBatch),
+		_window(window),
+		_stopped(false),
+		_queries(0),
+		_keys(0)
+	{
+		_thread = std::thread(&BatchLoader::run, this);
+	}
+
+	/*! Destructor. The keys that are waiting are loaded before the
+	 * thread stops.
+	 */
+	~BatchLoader()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			_stopped = true;
+		}
+
+		_changed.notify_all();
+		_thread.join();
+	}
+
+	/*! Load the rows of a key.
+	 *
+	 * @param key Value of the key column
+	 * @return Rows of the key, the result is empty when the key is not
+	 * found. Receives a DatabaseException if the query fails
+	 */
+	std::future<std::shared_ptr<Result> > load(const string &key)
+	{
+		std::shared_ptr<Promise> promise(new Promise());
+		std::future<std::shared_ptr<Result> > future = promise->get_future();
+
+		Batch full;
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+
+			if (_batch.empty()) {
+				_deadline = std::chrono::steady_clock::now() + _window;
+				_changed.notify_all();
+			}
+
+			_batch[key].push_back(promise);
+			_keys++;
+
+			// The caller sends a full batch, so the batches are not
+			// serialized in the thread of the window
+			if (_batch.size() >= _maxBatch) {
+				full.swap(_batch);
+			}
+		}
+
+		if (full.empty() == false) {
+			send(full);
+		}
+
+		return future;
+	}
+
+	/*! Load the rows of a key and wait for them.
+	 *
+	 * @param key Value of the key column
+	 * @return Rows of the key
+	 * @throw DatabaseException if the query fails
+	 */
+	std::shared_ptr<Result> get(const string &key)
+	{
+		return load(key).get();
+	}
+
+	/*! Send the keys that are waiting without waiting for the window.
+	 */
+	void flush()
+	{
+		Batch batch;
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			batch.swap(_batch);
+		}
+
+		if (batch.empty() == false) {
+			send(batch);
+		}
+	}
+
+	/*! Returns the number of queries sent to the database.
+	 *
+	 * @return Number of queries
+	 */
+	unsigned long long getQueries() const
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		return _queries;
+	}
+
+	/*! Returns the number of keys requested by the callers.
+	 *
+	 * @return Number of keys
+	 */
+	unsigned long long getKeys() const
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		return _keys;
+	}
+
+private:
+	/*! Callers waiting for each key
+	 */
+	typedef std::map<string, std::vector<std::shared_ptr<Promise> > > Batch;
+
+	/*! Sends the batches when the window expires
+	 */
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(_lock);
+		while (true) {
+			if (_batch.empty()) {
+				if (_stopped) {
+					break;
+				}
+
+				_changed.wait(lock);
+				continue;
+			}
+
+			if (_stopped == false && std::chrono::steady_clock::now() < _deadline) {
+				_changed.wait_until(lock, _deadline);
+				continue;
+			}
+
+			Batch batch;
+			batch.swap(_batch);
+
+			lock.unlock();
+			send(batch);
+			lock.lock();
+		}
+	}
+
+	void send(Batch &batch)
+	{
+		std::vector<string> keys;
+		keys.reserve(batch.size());
+		for (auto &key : batch) {
+			keys.push_back(key.first);
+		}
+
+		Rows rows;
+		for (auto &key : batch) {
+			rows[key.first].reset(new std::vector<unsigned int>());
+		}
+
+		std::shared_ptr<const StoredResult::Data> data;
+		try {
+			typename Pool::Lease lease = _pool->acquire();
+			std::shared_ptr<Result> result = 
+				lease->execute(_query + SqlDialect<Driver>::in(*lease, _column, keys));
+
+			if (result) {
+				KeyReader reader(*result, _column, rows);
+				data.reset(new StoredResult::Data(reader));
+
+				// Results without column names only know the columns of
+				// the rows
+				if (data->getRows() > 0 && data->getColumn(_column) < 0) {
+					throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR,
+					                         "Column " + _column + " not found in result set");
+				}
+			}
+
+		} catch (...) {
+			std::exception_ptr error = std::current_exception();
+			for (auto &key : batch) {
+				for (auto &promise : key.second) {
+					promise->set_exception(error);
+				}
+			}
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			_queries++;
+		}
+
+		for (auto &key : batch) {
+			std::shared_ptr<Result> result;
+			if (data) {
+				result.reset(new StoredResult(data, rows[key.first]));
+			}
+
+			for (auto &promise : key.second) {
+				promise->set_value(result);
+			}
+		}
+	}
+
+	/*! Indexes of the rows of each key
+	 */
+	typedef std::map<string, std::shared_ptr<std::vector<unsigned int> > > Rows;
+
+	/*! Reads the rows of a result, that are stored by the caller, and
+	 * splits them by the text of the key column
+	 */
+	class KeyReader : public Result
+	{
+	public:
+		KeyReader(Result &result, const string &column, Rows &rows) :
+			_result(result),
+			_name(column),
+			_column(-1),
+			_text(result.hasText()),
+			_rows(rows),
+			_fetched(0)
+		{
+			const std::vector<string> &names = result.getColumnNames();
+			for (unsigned int i = 0; i < names.size(); i++) {
+				if (names[i] == column) {
+					_column = i;
+				}
+			}
+
+			if (_column < 0 && names.empty() == false) {
+				throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR,
+				                         "Column " + column + " not found in result set");
+			}
+		}
+
+		unsigned int size() const
+		{
+			return _result.size();
+		}
+
+		bool fetch()
+		{
+			if (_result.fetch() == false) {
+				return false;
+			}
+
+			// NULL keys don't match any caller
+			string key;
+			if (readKey(key)) {
+				auto rows = _rows.find(key);
+				if (rows != _rows.end()) {
+					rows->second->push_back(_fetched);
+				}
+			}
+
+			_fetched++;
+			return true;
+		}
+
+		boost::any get(const string &key) const
+		{
+			return _result.get(key);
+		}
+
+		const std::map<string, boost::any>& getRow() const
+		{
+			return _result.getRow();
+		}
+
+	private:
+		bool readKey(string &key) const
+		{
+			if (_text && _column >= 0) {
+				const char *value = NULL;
+				unsigned long size = 0;
+				_result.getText(_column, value, size);
+				if (value == NULL) {
+					return false;
+				}
+
+				key.assign(value, size);
+				return true;
+			}
+
+			const std::map<string, boost::any> &row = _result.getRow();
+			auto value = row.find(_name);
+			if (value == row.end() || value->second.empty()) {
+				return false;
+			}
+
+			key = toString(value->second);
+			return true;
+		}
+
+		string toString(const boost::any &value) const
+		{
+			if (value.type() == typeid(string)) {
+				return boost::any_cast<string>(value);
+			} else if (value.type() == typeid(long long)) {
+				return boost::lexical_cast<string>(boost::any_cast<long long>(value));
+			} else if (value.type() == typeid(long)) {
+				return boost::lexical_cast<string>(boost::any_cast<long>(value));
+			} else if (value.type() == typeid(int)) {
+				return boost::lexical_cast<string>(boost::any_cast<int>(value));
+			} else if (value.type() == typeid(uint32_t)) {
+				return boost::lexical_cast<string>(boost::any_cast<uint32_t>(value));
+			} else if (value.type() == typeid(short)) {
+				return boost::lexical_cast<string>(boost::any_cast<short>(value));
+			} else if (value.type() == typeid(uint8_t)) {
+				return boost::lexical_cast<string>(
+					static_cast<unsigned int>(boost::any_cast<uint8_t>(value)));
+			}
+
+			throw DATABASE_EXCEPTION(DatabaseException::CONVERSION_ERROR,
+			                         "Unsupported type in key column " + _name);
+		}
+
+		Result &_result;
+		string _name;
+		int _column;
+		bool _text;
+		Rows &_rows;
+		unsigned int _fetched;
+	};
+
+	std::shared_ptr<Pool> _pool;
+	string _query;
+	string _column;
+	unsigned int _maxBatch;
+	std::chrono::milliseconds _window;
+
+	mutable std::mutex _lock;
+	std::condition_variable _changed;
+	Batch _batch;
+	std::chrono::steady_clock::time_point _deadline;
+	bool _stopped;
+
+	unsigned long long _queries;
+	unsigned long long _keys;
+
+	std::thread _thread;
+
+private:
+	// Don't allow copying the object
+	BatchLoader(const BatchLoader &other);
+	BatchLoader& operator=(const BatchLoader &other);
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_BATCH_LOADER_HPP__
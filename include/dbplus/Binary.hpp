@@ -55,6 +55,13 @@ public:
 	 */
 	Binary(const Binary &binary);
 
+	/*! Move constructor. The data of the other object is taken
+	 * without copying and the other object becomes empty.
+	 *
+	 * @param binary Other Binary object
+	 */
+	Binary(Binary &&binary);
+
 	/*! Destructor. Free internal array.
 	 */
 	~Binary();
@@ -66,6 +73,22 @@ public:
 	 */
 	Binary& operator=(const Binary &binary);
 
+	/*! Move assignment operator. The data of the other object is
+	 * taken without copying and the other object becomes empty.
+	 *
+	 * @param binary Other Binary object
+	 * @return The current Binary object
+	 */
+	Binary& operator=(Binary &&binary);
+
+	/*! Replace the data, reusing the internal array when it's big
+	 * enough.
+	 *
+	 * @param data Binary data
+	 * @param size Binary data size
+	 */
+	void assign(const unsigned char *data, const unsigned long size);
+
 	/*! Compare two Binary objects
 	 *
 	 * @param binary Other Binary object
@@ -88,6 +111,7 @@ public:
 private:
 	unsigned char *_data;
 	unsigned long _size;
+	unsigned long _capacity;
 };
 
 DBPLUS_NS_END
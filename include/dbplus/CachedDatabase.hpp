@@ -0,0 +1,108 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_CACHED_DATABASE_HPP__
+#define __DB_PLUS_CACHED_DATABASE_HPP__
+
+#include <memory>
+#include <set>
+#include <string>
+
+#include <dbplus/DatabaseProxy.hpp>
+#include <dbplus/Dbplus.hpp>
+#include <dbplus/QueryCache.hpp>
+#include <dbplus/StoredResult.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+/*! \class CachedDatabase
+ *  \brief Database that keeps the results of read queries in a cache.
+ *
+ * Only read only queries that reference at least one table, use
+ * STORE_RESULT and run outside of a transaction are cached, because
+ * queries inside a transaction can see data that was not committed.
+ * Any other query is considered a write, and invalidates the results
+ * of the tables it changes, or the whole cache when the tables are not
+ * known. Tables changed in a transaction are invalidated again when
+ * the transaction finishes.
+ *
+ * The cache can be shared by many CachedDatabase objects, like all
+ * connections of a pool. Each CachedDatabase follows the rules of the
+ * database that it wraps and is not thread safe.
+ */
+class CachedDatabase : public DatabaseProxy
+{
+public:
+	/*! Constructor.
+	 *
+	 * @param database Database that executes the queries
+	 * @param cache Cache of results, can be shared
+	 */
+	CachedDatabase(std::shared_ptr<Database> database, 
+	               std::shared_ptr<QueryCache> cache);
+
+	/*! Returns the cache of results.
+	 *
+	 * @return Cache of results
+	 */
+	std::shared_ptr<QueryCache> getCache() const;
+
+	void setTransactionMode(const TransactionMode::Value mode);
+
+	void commit();
+
+	void rollback();
+
+	std::shared_ptr<Result> 
+	execute(const string &query, 
+	        const ResultMode::Value resultMode = ResultMode::STORE_RESULT);
+
+	std::shared_ptr<Result> 
+	execute(const string &query, const std::chrono::milliseconds timeout);
+
+	using Database::executeAsync;
+
+	AsyncStatus::Value executeAsync(const string &query, 
+	                                AsyncCallback callback);
+
+	AsyncStatus::Value commitAsync(AsyncCallback callback);
+
+	AsyncStatus::Value rollbackAsync(AsyncCallback callback);
+
+private:
+	bool isCacheable(const string &query, 
+	                 const ResultMode::Value resultMode, 
+	                 std::set<string> &tables) const;
+	static std::shared_ptr<const StoredResult::Data> 
+	capture(std::shared_ptr<Result> result);
+	void written(const string &query);
+	void finishTransaction();
+
+	std::shared_ptr<QueryCache> _cache;
+
+	// Tables changed in the current transaction
+	std::set<string> _writtenTables;
+	bool _writtenUnknown;
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_CACHED_DATABASE_HPP__
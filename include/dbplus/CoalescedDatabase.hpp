@@ -0,0 +1,74 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_COALESCED_DATABASE_HPP__
+#define __DB_PLUS_COALESCED_DATABASE_HPP__
+
+#include <memory>
+#include <string>
+
+#include <dbplus/DatabaseProxy.hpp>
+#include <dbplus/Dbplus.hpp>
+#include <dbplus/SingleFlight.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+/*! \class CoalescedDatabase
+ *  \brief Database that joins identical reads of many connections.
+ *
+ * Read only queries that use STORE_RESULT and run outside of a
+ * transaction go through a SingleFlight shared by the connections, so
+ * when many threads execute the same query at the same time only one
+ * of them reaches the server. Asynchronous queries are not joined,
+ * because waiting for another connection would block. Can be wrapped
+ * by a CachedDatabase to protect the server when a cached result
+ * expires.
+ */
+class CoalescedDatabase : public DatabaseProxy
+{
+public:
+	/*! Constructor.
+	 *
+	 * @param database Database that executes the queries
+	 * @param flights Queries running in all connections
+	 */
+	CoalescedDatabase(std::shared_ptr<Database> database, 
+	                  std::shared_ptr<SingleFlight> flights);
+
+	/*! Returns the queries running in all connections.
+	 *
+	 * @return Running queries
+	 */
+	std::shared_ptr<SingleFlight> getFlights() const;
+
+	std::shared_ptr<Result> 
+	execute(const string &query, 
+	        const ResultMode::Value resultMode = ResultMode::STORE_RESULT);
+
+	using DatabaseProxy::execute;
+
+private:
+	std::shared_ptr<SingleFlight> _flights;
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_COALESCED_DATABASE_HPP__
@@ -0,0 +1,249 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_CONNECTION_HPP__
+#define __DB_PLUS_CONNECTION_HPP__
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <dbplus/Dbplus.hpp>
+#include <dbplus/MySql.hpp>
+#include <dbplus/MySqlResult.hpp>
+#include <dbplus/PostgresSql.hpp>
+#include <dbplus/PostgresSqlResult.hpp>
+#include <dbplus/Result.hpp>
+#include <dbplus/RowBlock.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+/*! \class MySqlDriver
+ *  \brief Types of the MySQL driver for Connection.
+ */
+class MySqlDriver
+{
+public:
+	typedef MySql DatabaseType;
+	typedef MySqlResult ResultType;
+
+	/*! Execute a query storing the rows in a result of the caller.
+	 *
+	 * @param database Connected database
+	 * @param query SQL query
+	 * @param result Result that receives the rows
+	 * @return False when the query doesn't return rows
+	 * @throw DatabaseException on error
+	 */
+	static bool execute(DatabaseType &database, 
+	                    const string &query, 
+	                    ResultType &result)
+	{
+		// The result is owned by the caller, so it's never deleted
+		std::shared_ptr<Result> reused(&result, [](Result*) {});
+		if (database.execute(query, reused)) {
+			return true;
+		}
+
+		// Queries without rows, like INSERT, don't touch the result
+		result.reset(NULL);
+		return false;
+	}
+};
+
+/*! \class PostgresDriver
+ *  \brief Types of the PostgreSQL driver for Connection.
+ */
+class PostgresDriver
+{
+public:
+	typedef PostgresSql DatabaseType;
+	typedef PostgresSqlResult ResultType;
+
+	/*! Execute a query storing the rows in a result of the caller.
+	 *
+	 * @param database Connected database
+	 * @param query SQL query
+	 * @param result Result that receives the rows
+	 * @return Always true, commands return a result without rows
+	 * @throw DatabaseException on error
+	 */
+	static bool execute(DatabaseType &database, 
+	                    const string &query, 
+	                    ResultType &result)
+	{
+		// The result is owned by the caller, so it's never deleted
+		std::shared_ptr<Result> reused(&result, [](Result*) {});
+		return database.execute(query, reused) != NULL;
+	}
+};
+
+/*! \class Connection
+ *  \brief Connection with the concrete types of a driver.
+ *
+ * Alternative to the Database interface when the driver is known at
+ * compile time. Results are returned by value with their concrete
+ * type (MySqlResult or PostgresSqlResult), so no shared_ptr or
+ * dynamic_pointer_cast is needed and, as the results are final
+ * classes, the calls to fetch and get are not virtual. They are still
+ * out of line: reading and decoding the rows stays in the drivers.
+ *
+ * @tparam Driver MySqlDriver or PostgresDriver
+ */
+template<class Driver>
+class Connection
+{
+public:
+	typedef typename Driver::DatabaseType DatabaseType;
+	typedef typename Driver::ResultType ResultType;
+
+	/*! Constructor.
+	 */
+	Connection() {}
+
+	/*! Connect to the database, with the arguments of the connect
+	 * method of the driver.
+	 *
+	 * @param arguments Database, user, password, server and port
+	 * @throw DatabaseException on error
+	 */
+	template<class... Arguments>
+	void connect(Arguments&&... arguments)
+	{
+		_database.connect(std::forward<Arguments>(arguments)...);
+	}
+
+	/*! Close the connection.
+	 */
+	void disconnect()
+	{
+		_database.disconnect();
+	}
+
+	/*! Execute a query.
+	 *
+	 * @param query SQL query
+	 * @return Result with the rows, empty for queries without rows
+	 * @throw DatabaseException on error
+	 */
+	ResultType execute(const string &query)
+	{
+		ResultType result;
+		Driver::execute(_database, query, result);
+		return result;
+	}
+
+	/*! Execute a query reusing the memory of a previous result.
+	 *
+	 * @param query SQL query
+	 * @param result Result that receives the rows
+	 * @return False when the query doesn't return rows
+	 * @throw DatabaseException on error
+	 */
+	bool execute(const string &query, ResultType &result)
+	{
+		return Driver::execute(_database, query, result);
+	}
+
+	/*! Execute a query and call a function for each row. The function
+	 * receives the result with its concrete type.
+	 *
+	 * @tparam Function Type of the function, called as
+	 * function(const ResultType &row)
+	 * @param query SQL query
+	 * @param function Function called for each row
+	 * @return Number of rows
+	 * @throw DatabaseException on error
+	 */
+	template<class Function>
+	unsigned long long forEach(const string &query, Function function)
+	{
+		Driver::execute(_database, query, _result);
+
+		unsigned long long rows = 0;
+		while (_result.fetch()) {
+			function(static_cast<const ResultType&>(_result));
+			rows++;
+		}
+
+		return rows;
+	}
+
+	/*! Execute a query and read the rows in batches. The callback is
+	 * called once per batch, and the rows are decoded by the driver.
+	 *
+	 * @param query SQL query
+	 * @param callback Function called with each batch
+	 * @param batchSize Maximum number of rows of each batch
+	 * @throw DatabaseException on error
+	 * @see Result::forEachBatch
+	 */
+	void forEachBatch(const string &query, 
+	                  Result::BatchCallback callback,
+	                  const unsigned int batchSize = 1024)
+	{
+		if (Driver::execute(_database, query, _result)) {
+			_result.forEachBatch(callback, batchSize);
+		}
+	}
+
+	/*! Commit the current transaction.
+	 *
+	 * @throw DatabaseException on error
+	 */
+	void commit()
+	{
+		_database.commit();
+	}
+
+	/*! Rollback the current transaction.
+	 *
+	 * @throw DatabaseException on error
+	 */
+	void rollback()
+	{
+		_database.rollback();
+	}
+
+	/*! Returns the driver, for the methods that are not in this class.
+	 *
+	 * @return Database of the driver
+	 */
+	DatabaseType& getDatabase()
+	{
+		return _database;
+	}
+
+private:
+	DatabaseType _database;
+
+	// Reused by forEach and forEachBatch
+	ResultType _result;
+
+private:
+	// Don't allow copying the object
+	Connection(const Connection &other);
+	Connection& operator=(const Connection &other);
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_CONNECTION_HPP__
@@ -0,0 +1,702 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_CONNECTION_POOL_HPP__
+#define __DB_PLUS_CONNECTION_POOL_HPP__
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dbplus/AsyncSet.hpp>
+#include <dbplus/Database.hpp>
+#include <dbplus/DatabaseException.hpp>
+#include <dbplus/Dbplus.hpp>
+#include <dbplus/Result.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+/*! \class ConnectionPool
+ *  \brief Thread safe pool of database connections.
+ *
+ * Keeps between a minimum and a maximum number of connections of the
+ * same driver. Idle connections are stored in as many free lists as
+ * CPU cores, and each thread uses the list chosen by a hash of its
+ * id, so different threads usually take different locks. Threads
+ * whose ids collide share a list, whatever core they run in. A
+ * connection is borrowed with the acquire method and
+ * returned automatically when the Lease object is destroyed.
+ *
+ * @tparam Driver Database driver (MySql or PostgresSql)
+ */
+template<class Driver>
+class ConnectionPool
+{
+private:
+	/*! Connection stored in the pool
+	 */
+	struct Entry {
+		std::unique_ptr<Driver> driver;
+		std::chrono::steady_clock::time_point lastUsed;
+	};
+
+public:
+	/*! \class Lease
+	 *  \brief Connection borrowed from the pool.
+	 *
+	 * The connection returns to the pool when the lease is destroyed or
+	 * released. A lease can be moved but not copied.
+	 */
+	class Lease
+	{
+	public:
+		/*! Creates an empty lease.
+		 */
+		Lease() :
+			_pool(NULL),
+			_entry(NULL)
+		{
+		}
+
+		/*! Move constructor.
+		 *
+		 * @param other Lease that is going to be empty
+		 */
+		Lease(Lease &&other) :
+			_pool(other._pool),
+			_entry(other._entry)
+		{
+			other._pool = NULL;
+			other._entry = NULL;
+		}
+
+		/*! Returns the connection to the pool.
+		 */
+		~Lease()
+		{
+			release();
+		}
+
+		/*! Move assignment.
+		 *
+		 * @param other Lease that is going to be empty
+		 * @return The current lease
+		 */
+		Lease& operator=(Lease &&other)
+		{
+			if (this != &other) {
+				release();
+				_pool = other._pool;
+				_entry = other._entry;
+				other._pool = NULL;
+				other._entry = NULL;
+			}
+
+			return *this;
+		}
+
+		/*! Access the borrowed connection.
+		 *
+		 * @return Borrowed connection
+		 */
+		Driver* operator->() const
+		{
+			return _entry->driver.get();
+		}
+
+		/*! Access the borrowed connection.
+		 *
+		 * @return Borrowed connection
+		 */
+		Driver& operator*() const
+		{
+			return *_entry->driver;
+		}
+
+		/*! Returns the borrowed connection.
+		 *
+		 * @return Borrowed connection or NULL for empty leases
+		 */
+		Driver* get() const
+		{
+			return _entry == NULL ? NULL : _entry->driver.get();
+		}
+
+		/*! Returns the connection to the pool before the lease is
+		 * destroyed.
+		 */
+		void release()
+		{
+			if (_pool != NULL) {
+				_pool->release(_entry);
+				_pool = NULL;
+				_entry = NULL;
+			}
+		}
+
+		/*! Closes the connection instead of returning it to the pool.
+		 * Used when the connection is in an unknown state, like when
+		 * an asynchronous operation could not be finished.
+		 */
+		void discard()
+		{
+			if (_pool != NULL) {
+				_pool->discard(_entry);
+				_pool = NULL;
+				_entry = NULL;
+			}
+		}
+
+	private:
+		friend class ConnectionPool;
+
+		Lease(ConnectionPool *pool, Entry *entry) :
+			_pool(pool),
+			_entry(entry)
+		{
+			_pool->_leased++;
+		}
+
+		ConnectionPool *_pool;
+		Entry *_entry;
+
+	private:
+		// Don't allow copying the object
+		Lease(const Lease &other);
+		Lease& operator=(const Lease &other);
+	};
+
+	/*! Keep a connection borrowed while a result is alive. Needed when
+	 * the result reads from the connection (USE_RESULT mode) or when
+	 * the session must not be reused before the result is processed.
+	 *
+	 * @param result Result of a query executed in the connection
+	 * @param lease Connection borrowed from the pool
+	 * @return Result that releases the lease when destroyed
+	 */
+	static std::shared_ptr<Result> attach(std::shared_ptr<Result> result,
+	                                      std::shared_ptr<Lease> lease)
+	{
+		if (!result) {
+			return result;
+		}
+
+		Keeper keeper;
+		keeper.result = result;
+		keeper.lease = lease;
+
+		return std::shared_ptr<Result>(result.get(), keeper);
+	}
+
+	/*! Constructor. Opens the minimum number of connections at the
+	 * same time.
+	 *
+	 * @param database Name of the database
+	 * @param user Username used for connection
+	 * @param password Username's password
+	 * @param server Hostname or IP address of the database
+	 * @param port Database server's port
+	 * @param minSize Number of connections kept open
+	 * @param maxSize Maximum number of connections
+	 * @param transactionMode Mode of the connections while idle in the
+	 * pool
+	 * @param initStatements Statements executed in every new connection,
+	 * like session settings or queries that warm up the server cache
+	 * @throw DatabaseException on connection error
+	 * @see warmUp
+	 */
+	ConnectionPool(const string &database,
+	               const string &user,
+	               const string &password,
+	               const string &server,
+	               const unsigned int port,
+	               const unsigned int minSize,
+	               const unsigned int maxSize,
+	               const Database::TransactionMode::Value transactionMode =
+	               Database::TransactionMode::AUTO_COMMIT,
+	               const std::vector<string> &initStatements = 
+	               std::vector<string>()) :
+		_database(database),
+		_user(user),
+		_password(password),
+		_server(server),
+		_port(port),
+		_minSize(minSize),
+		_maxSize(maxSize < 1 ? 1 : maxSize),
+		_transactionMode(transactionMode),
+		_initStatements(initStatements),
+		_timeout(std::chrono::milliseconds(5000)),
+		_validationInterval(std::chrono::milliseconds(30000)),
+		_shards(std::max(1u, std::thread::hardware_concurrency())),
+		_size(0),
+		_leased(0),
+		_waiting(0)
+	{
+		// The destructor doesn't run when the constructor throws, so the
+		// connections that were opened are closed here
+		try {
+			warmUp(_minSize);
+		} catch (const DatabaseException &e) {
+			close();
+			throw;
+		}
+	}
+
+	/*! Close all idle connections. All leases must be released before
+	 * the pool is destroyed.
+	 */
+	~ConnectionPool()
+	{
+		close();
+	}
+
+	/*! Borrow a connection, waiting up to the default timeout when all
+	 * connections are in use.
+	 *
+	 * @return Borrowed connection
+	 * @throw DatabaseException on timeout or connection error
+	 * @see setTimeout
+	 */
+	Lease acquire()
+	{
+		return acquire(_timeout);
+	}
+
+	/*! Borrow a connection, waiting up to the given timeout when all
+	 * connections are in use. Connections that were idle for more than
+	 * the validation interval are checked and reconnected if needed.
+	 *
+	 * @param timeout Maximum time to wait for a connection
+	 * @return Borrowed connection
+	 * @throw DatabaseException on timeout or connection error
+	 */
+	Lease acquire(const std::chrono::milliseconds timeout)
+	{
+		std::chrono::steady_clock::time_point deadline =
+			std::chrono::steady_clock::now() + timeout;
+
+		while (true) {
+			Entry *entry = pop();
+
+			if (entry == NULL) {
+				unsigned int size = _size;
+				while (size < _maxSize) {
+					if (_size.compare_exchange_weak(size, size + 1)) {
+						try {
+							entry = create();
+						} catch (const DatabaseException &e) {
+							_size--;
+							notify();
+							throw;
+						}
+						break;
+					}
+				}
+			}
+
+			if (entry != NULL) {
+				validate(entry);
+				return Lease(this, entry);
+			}
+
+			// The free lists are checked again while holding the wait lock,
+			// so a connection returned meanwhile isn't missed
+			std::unique_lock<std::mutex> lock(_waitLock);
+			_waiting++;
+
+			bool expired = false;
+			entry = pop();
+			if (entry == NULL) {
+				expired = (_available.wait_until(lock, deadline) ==
+				           std::cv_status::timeout);
+				entry = pop();
+			}
+
+			_waiting--;
+			lock.unlock();
+
+			if (entry != NULL) {
+				validate(entry);
+				return Lease(this, entry);
+			}
+
+			if (expired) {
+				throw DATABASE_EXCEPTION(DatabaseException::TIMEOUT_ERROR,
+				                         "Timeout waiting for a connection");
+			}
+		}
+	}
+
+	/*! Open new connections at the same time, without exceeding the
+	 * maximum size of the pool. All connections are established in
+	 * parallel, then each init statement runs in all connections in
+	 * parallel, so the connections are ready to be used when the method
+	 * returns. Connections that fail are discarded.
+	 *
+	 * @param connections Number of connections to open
+	 * @return Number of connections opened
+	 * @throw DatabaseException with the first error, after the other
+	 * connections are added to the pool
+	 */
+	unsigned int warmUp(const unsigned int connections)
+	{
+		unsigned int reserved = 0;
+		while (reserved < connections) {
+			unsigned int size = _size;
+			if (size >= _maxSize) {
+				break;
+			}
+
+			if (_size.compare_exchange_weak(size, size + 1)) {
+				reserved++;
+			}
+		}
+
+		std::vector<std::unique_ptr<Entry> > entries(reserved);
+		std::vector<std::exception_ptr> errors(reserved);
+
+		AsyncSet connecting;
+		for (unsigned int i = 0; i < reserved; i++) {
+			std::exception_ptr &error = errors[i];
+			entries[i].reset(new Entry());
+			entries[i]->driver.reset(new Driver());
+
+			try {
+				Driver &driver = *entries[i]->driver;
+				connecting.add(driver, driver.connectAsync(
+					_database, _user, _password, _server, _port,
+					[&error](std::shared_ptr<Result>, std::exception_ptr e) {
+						error = e;
+					}));
+			} catch (const DatabaseException &e) {
+				error = std::current_exception();
+			}
+		}
+
+		connecting.waitAll();
+
+		for (const string &statement : _initStatements) {
+			AsyncSet initializing;
+			for (unsigned int i = 0; i < reserved; i++) {
+				if (errors[i]) {
+					continue;
+				}
+
+				std::exception_ptr &error = errors[i];
+				try {
+					Driver &driver = *entries[i]->driver;
+					initializing.add(driver, driver.executeAsync(
+						statement,
+						[&error](std::shared_ptr<Result>, std::exception_ptr e) {
+							error = e;
+						}));
+				} catch (const DatabaseException &e) {
+					error = std::current_exception();
+				}
+			}
+
+			initializing.waitAll();
+		}
+
+		unsigned int opened = 0;
+		std::exception_ptr firstError;
+
+		for (unsigned int i = 0; i < reserved; i++) {
+			// Changing the transaction mode is a short command, sent after
+			// the init statements so they are not inside a transaction
+			if (!errors[i] && 
+			    _transactionMode != Database::TransactionMode::AUTO_COMMIT) {
+				try {
+					entries[i]->driver->setTransactionMode(_transactionMode);
+				} catch (const DatabaseException &e) {
+					errors[i] = std::current_exception();
+				}
+			}
+
+			if (errors[i]) {
+				if (!firstError) {
+					firstError = errors[i];
+				}
+
+				_size--;
+				continue;
+			}
+
+			entries[i]->lastUsed = std::chrono::steady_clock::now();
+			push(entries[i].release());
+			notify();
+			opened++;
+		}
+
+		if (firstError) {
+			std::rethrow_exception(firstError);
+		}
+
+		return opened;
+	}
+
+	/*! Define the default time to wait for a connection.
+	 *
+	 * @param timeout Maximum time to wait for a connection
+	 */
+	void setTimeout(const std::chrono::milliseconds timeout)
+	{
+		_timeout = timeout;
+	}
+
+	/*! Define how long a connection can be idle before being checked
+	 * with ping when borrowed.
+	 *
+	 * @param interval Idle time before validation
+	 */
+	void setValidationInterval(const std::chrono::milliseconds interval)
+	{
+		_validationInterval = interval;
+	}
+
+	/*! Returns the number of open connections, idle or in use.
+	 *
+	 * @return Number of connections
+	 */
+	unsigned int size() const
+	{
+		return _size;
+	}
+
+	/*! Returns the number of connections in use. Cheaper than the idle
+	 * method, used to balance the load between pools.
+	 *
+	 * @return Number of borrowed connections
+	 */
+	unsigned int leased() const
+	{
+		return _leased;
+	}
+
+	/*! Returns the number of idle connections.
+	 *
+	 * @return Number of idle connections
+	 */
+	unsigned int idle() const
+	{
+		unsigned int idle = 0;
+		for (const Shard &shard : _shards) {
+			std::lock_guard<std::mutex> lock(shard.lock);
+			idle += shard.entries.size();
+		}
+
+		return idle;
+	}
+
+private:
+	/*! Releases the lease after the result, as the result can depend
+	 * on the connection
+	 */
+	struct Keeper {
+		std::shared_ptr<Result> result;
+		std::shared_ptr<Lease> lease;
+
+		void operator()(Result*)
+		{
+			result.reset();
+			lease.reset();
+		}
+	};
+
+	/*! Free list of the threads whose id hashes to it. Padded to
+	 * avoid false sharing between cores.
+	 */
+	struct Shard {
+		mutable std::mutex lock;
+		std::vector<Entry*> entries;
+		char padding[64];
+	};
+
+	Entry* create()
+	{
+		std::unique_ptr<Entry> entry(new Entry());
+		entry->driver.reset(new Driver());
+		entry->driver->connect(_database, _user, _password, _server, _port);
+		initialize(*entry->driver);
+		entry->lastUsed = std::chrono::steady_clock::now();
+		return entry.release();
+	}
+
+	void initialize(Driver &driver)
+	{
+		for (const string &statement : _initStatements) {
+			driver.execute(statement);
+		}
+
+		driver.setTransactionMode(_transactionMode);
+	}
+
+	void validate(Entry *entry)
+	{
+		std::chrono::steady_clock::time_point now =
+			std::chrono::steady_clock::now();
+
+		if (now - entry->lastUsed > _validationInterval &&
+		    entry->driver->ping() == false) {
+			try {
+				entry->driver->connect(_database, _user, _password,
+				                       _server, _port);
+				initialize(*entry->driver);
+			} catch (const DatabaseException &e) {
+				delete entry;
+				_size--;
+				notify();
+				throw;
+			}
+		}
+
+		entry->lastUsed = now;
+	}
+
+	void release(Entry *entry)
+	{
+		_leased--;
+
+		// Uncommitted work is discarded and the connection returns
+		// with the transaction mode of the pool
+		try {
+			Driver &driver = *entry->driver;
+			if (driver.getTransactionMode() ==
+			    Database::TransactionMode::MANUAL_COMMIT) {
+				driver.rollback();
+			}
+
+			if (driver.getTransactionMode() != _transactionMode) {
+				driver.setTransactionMode(_transactionMode);
+			}
+
+		} catch (const DatabaseException &e) {
+			delete entry;
+			_size--;
+			notify();
+			return;
+		}
+
+		entry->lastUsed = std::chrono::steady_clock::now();
+		push(entry);
+		notify();
+	}
+
+	void discard(Entry *entry)
+	{
+		_leased--;
+		delete entry;
+		_size--;
+		notify();
+	}
+
+	void close()
+	{
+		for (Shard &shard : _shards) {
+			for (Entry *entry : shard.entries) {
+				delete entry;
+			}
+			shard.entries.clear();
+		}
+	}
+
+	Shard& home()
+	{
+		std::hash<std::thread::id> hash;
+		return _shards[hash(std::this_thread::get_id()) % _shards.size()];
+	}
+
+	void push(Entry *entry)
+	{
+		Shard &shard = home();
+		std::lock_guard<std::mutex> lock(shard.lock);
+		shard.entries.push_back(entry);
+	}
+
+	Entry* pop()
+	{
+		Shard &shard = home();
+		{
+			std::lock_guard<std::mutex> lock(shard.lock);
+			if (shard.entries.empty() == false) {
+				Entry *entry = shard.entries.back();
+				shard.entries.pop_back();
+				return entry;
+			}
+		}
+
+		// Steal from the lists of other threads
+		for (Shard &other : _shards) {
+			std::lock_guard<std::mutex> lock(other.lock);
+			if (other.entries.empty() == false) {
+				Entry *entry = other.entries.back();
+				other.entries.pop_back();
+				return entry;
+			}
+		}
+
+		return NULL;
+	}
+
+	void notify()
+	{
+		if (_waiting > 0) {
+			std::lock_guard<std::mutex> lock(_waitLock);
+			_available.notify_one();
+		}
+	}
+
+	string _database;
+	string _user;
+	string _password;
+	string _server;
+	unsigned int _port;
+	unsigned int _minSize;
+	unsigned int _maxSize;
+	Database::TransactionMode::Value _transactionMode;
+	std::vector<string> _initStatements;
+	std::chrono::milliseconds _timeout;
+	std::chrono::milliseconds _validationInterval;
+
+	std::vector<Shard> _shards;
+	std::atomic<unsigned int> _size;
+	std::atomic<unsigned int> _leased;
+
+	std::mutex _waitLock;
+	std::condition_variable _available;
+	std::atomic<unsigned int> _waiting;
+
+private:
+	// Don't allow copying the object
+	ConnectionPool(const ConnectionPool &other);
+	ConnectionPool& operator=(const ConnectionPool &other);
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_CONNECTION_POOL_HPP__
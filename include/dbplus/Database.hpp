@@ -20,6 +20,10 @@
 #ifndef __DB_PLUS_DATABASE_HPP__
 #define __DB_PLUS_DATABASE_HPP__
 
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <future>
 #include <memory>
 #include <string>
 
@@ -75,6 +79,37 @@ public:
 		};
 	};
 
+	/*! \class AsyncStatus
+	 *  \brief Possible states of an asynchronous operation
+	 *
+	 * While the operation is not COMPLETE, the caller must wait until
+	 * the connection socket is readable (WAIT_READ) or writable
+	 * (WAIT_WRITE) and call the poll method again.
+	 */
+	class AsyncStatus
+	{
+	public:
+		/*! List all asynchronous states
+		 */
+		enum Value {
+			WAIT_READ,
+			WAIT_WRITE,
+			COMPLETE
+		};
+	};
+
+	/*! Function called when an asynchronous operation finishes. On
+	 * success the error is empty and the result follows the same rules
+	 * of the execute method, on failure the error stores the
+	 * DatabaseException.
+	 */
+	typedef std::function<void (std::shared_ptr<Result> result, 
+	                            std::exception_ptr error)> AsyncCallback;
+
+	/*! Destructor.
+	 */
+	virtual ~Database() {}
+
 	/*! Connect to the database and keeps connected until the disconnect
 	 * method is called.
 	 *
@@ -91,10 +126,42 @@ public:
 	                     const string &server, 
 	                     const unsigned int port = 3306) = 0;
 
-	/*! Disconnect from the database
+	/*! Connect to the database without blocking. The connection is
+	 * finished by the poll method, which calls the callback when the
+	 * connection is ready to be used.
+	 *
+	 * @param database Name of the database
+	 * @param user Username used for connection
+	 * @param password Username's password
+	 * @param server Hostname or IP address of the database
+	 * @param port Database server's port
+	 * @param callback Function called when the connection is ready
+	 * @return What the connection is waiting for
+	 * @see poll
+	 *
+	 * The default implementation connects with the blocking connect
+	 * method and calls the callback before returning COMPLETE.
+	 */
+	virtual AsyncStatus::Value connectAsync(const string &database, 
+	                                        const string &user, 
+	                                        const string &password, 
+	                                        const string &server, 
+	                                        const unsigned int port,
+	                                        AsyncCallback callback);
+
+	/*! Disconnect from the database. An asynchronous operation in
+	 * progress is abandoned and its callback is never called.
 	 */
 	virtual void disconnect() = 0;
 
+	/*! Check if the connection with the database is still alive.
+	 *
+	 * @return True if the database answered, false otherwise
+	 *
+	 * The default implementation executes "SELECT 1".
+	 */
+	virtual bool ping();
+
 	/*! Sets transaction mode. Possible values are defined in
 	 * Database::TransactionMode::Value.
 	 *
@@ -133,6 +200,14 @@ public:
 	 */
 	virtual string escape(const string &value) = 0;
 
+	/*! Escape a value appending it to a buffer, so the same buffer can
+	 * be used to build a whole query without copies.
+	 *
+	 * @param value String to be escaped
+	 * @param buffer Where the escaped value is appended
+	 */
+	virtual void escape(const string &value, string &buffer);
+
 	/*! Execute a SQL query.
 	 *
 	 * @param query SQL query
@@ -143,6 +218,132 @@ public:
 	execute(const string &query, 
 	        const ResultMode::Value resultMode = ResultMode::STORE_RESULT) = 0;
 
+	/*! Execute a SQL query with a deadline. The query runs
+	 * asynchronously and, when the deadline expires, it is cancelled
+	 * in the server. The method waits up to the same timeout for the
+	 * server to abort the query, so the connection can be used again;
+	 * if it doesn't, the connection is closed. The result is always
+	 * stored in client side.
+	 *
+	 * @param query SQL query
+	 * @param timeout Maximum time to wait for the result
+	 * @return Result object with all the dataset
+	 * @throw DatabaseException with TIMEOUT_ERROR code when the
+	 * deadline expired, even if the query finished before the cancel
+	 * request, or with the query error. The connection must be opened
+	 * again after errors waiting for the socket or when the query
+	 * didn't stop
+	 * @see cancel
+	 */
+	virtual std::shared_ptr<Result> 
+	execute(const string &query, const std::chrono::milliseconds timeout);
+
+	/*! Execute a SQL query reusing a result of a previous query of the
+	 * same connection, so the object and the memory of its values are
+	 * not allocated again. The previous rows of the result are
+	 * discarded. Drivers that can't reuse the result return a new one.
+	 *
+	 * @param query SQL query
+	 * @param result Result that is going to be reused, can be empty
+	 * @return Result object with all the dataset, that is the reused
+	 * result when possible
+	 * @throw DatabaseException on error
+	 */
+	virtual std::shared_ptr<Result> 
+	execute(const string &query, std::shared_ptr<Result> result);
+
+	/*! Ask the server to stop the query running in the connection. The
+	 * query finishes with an error. Can be called from another thread
+	 * while the connection is waiting for the query.
+	 *
+	 * @throw DatabaseException if the request could not be sent, or
+	 * always in the default implementation, that can't cancel queries
+	 */
+	virtual void cancel();
+
+	/*! Send a SQL query without waiting for the answer. The query is
+	 * processed by the poll method and the result is always stored in
+	 * client side. Only one asynchronous operation can run at a time
+	 * in the same connection.
+	 *
+	 * @param query SQL query
+	 * @param callback Function called when the query finishes
+	 * @return What the connection is waiting for
+	 * @see poll
+	 *
+	 * The default implementation executes the query with the blocking
+	 * execute method and calls the callback before returning COMPLETE.
+	 */
+	virtual AsyncStatus::Value executeAsync(const string &query, 
+	                                        AsyncCallback callback);
+
+	/*! Send a SQL query without waiting for the answer. The future
+	 * is ready after the poll method completes the operation.
+	 *
+	 * @param query SQL query
+	 * @return Future with the result object
+	 * @see poll
+	 */
+	std::future<std::shared_ptr<Result> > executeAsync(const string &query)
+	{
+		std::shared_ptr<std::promise<std::shared_ptr<Result> > > promise(
+			new std::promise<std::shared_ptr<Result> >());
+		std::future<std::shared_ptr<Result> > future = promise->get_future();
+
+		executeAsync(query, [promise](std::shared_ptr<Result> result, 
+		                              std::exception_ptr error) {
+			if (error) {
+				promise->set_exception(error);
+			} else {
+				promise->set_value(result);
+			}
+		});
+
+		return future;
+	}
+
+	/*! Asynchronous version of the commit method. The result given to
+	 * the callback is always empty.
+	 *
+	 * @param callback Function called when the commit finishes
+	 * @return What the connection is waiting for
+	 * @see commit
+	 * @see poll
+	 *
+	 * The default implementation calls the blocking commit method.
+	 */
+	virtual AsyncStatus::Value commitAsync(AsyncCallback callback);
+
+	/*! Asynchronous version of the rollback method. The result given
+	 * to the callback is always empty.
+	 *
+	 * @param callback Function called when the rollback finishes
+	 * @return What the connection is waiting for
+	 * @see rollback
+	 * @see poll
+	 *
+	 * The default implementation calls the blocking rollback method.
+	 */
+	virtual AsyncStatus::Value rollbackAsync(AsyncCallback callback);
+
+	/*! Continue the current asynchronous operation without
+	 * blocking. Should be called when the connection socket is ready
+	 * for the last returned status. When the operation finishes the
+	 * callback is called and COMPLETE is returned.
+	 *
+	 * @return What the connection is waiting for. Always COMPLETE in
+	 * the default implementation, where the operations block
+	 */
+	virtual AsyncStatus::Value poll();
+
+	/*! Returns the socket of the connection, used to wait for
+	 * asynchronous operations with select, poll or epoll.
+	 *
+	 * @return Socket file descriptor, -1 in the default
+	 * implementation, where the operations never wait for the socket
+	 */
+	virtual int getSocket() const;
+
 	/*! Returns the number of rows effected by the last query.
 	 *
 	 * @return Number of rows effected
@@ -154,6 +355,16 @@ public:
 	 * @return Last inserted id
 	 */
 	virtual unsigned long long lastInsertedId() = 0;
+
+private:
+	/*! Runs a blocking operation for the default asynchronous methods.
+	 *
+	 * @param operation Operation to run
+	 * @param callback Function called with the result or the error
+	 * @return Always COMPLETE
+	 */
+	AsyncStatus::Value runBlocking(std::function<std::shared_ptr<Result> ()> operation,
+	                               AsyncCallback callback);
 };
 
 DBPLUS_NS_END
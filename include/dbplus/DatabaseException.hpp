@@ -48,6 +48,7 @@ public:
 		EXECUTION_ERROR,
 		RESULT_ERROR,
 		STATE_CHANGE_ERROR,
+		TIMEOUT_ERROR,
 		TRANSACTION_ERROR,
 		UNKNOW_KEY_ERROR
 	};
@@ -76,7 +77,14 @@ public:
 	 */
 	const char* what() const throw();
 
+	/*! Returns error code.
+	 *
+	 * @return Error code
+	 */
+	Code getCode() const throw();
+
 private:
+	Code _code;
 	string _message;
 };
 
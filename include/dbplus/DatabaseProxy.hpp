@@ -0,0 +1,120 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_DATABASE_PROXY_HPP__
+#define __DB_PLUS_DATABASE_PROXY_HPP__
+
+#include <memory>
+#include <string>
+
+#include <dbplus/Database.hpp>
+#include <dbplus/Dbplus.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+/*! \class DatabaseProxy
+ *  \brief Database that forwards all operations to another database.
+ *
+ * Base class of the layers that add behavior to a database, like
+ * caching. Derived classes override only the methods they change.
+ */
+class DatabaseProxy : public Database
+{
+public:
+	/*! Constructor.
+	 *
+	 * @param database Database that receives the operations
+	 */
+	explicit DatabaseProxy(std::shared_ptr<Database> database);
+
+	/*! Returns the database that receives the operations.
+	 *
+	 * @return Wrapped database
+	 */
+	std::shared_ptr<Database> getDatabase() const;
+
+	void connect(const string &database, 
+	             const string &user, 
+	             const string &password, 
+	             const string &server, 
+	             const unsigned int port = 3306);
+
+	AsyncStatus::Value connectAsync(const string &database, 
+	                                const string &user, 
+	                                const string &password, 
+	                                const string &server, 
+	                                const unsigned int port,
+	                                AsyncCallback callback);
+
+	void disconnect();
+
+	bool ping();
+
+	void setTransactionMode(const TransactionMode::Value mode);
+
+	TransactionMode::Value getTransactionMode() const;
+
+	void commit();
+
+	void rollback();
+
+	string escape(const string &value);
+
+	void escape(const string &value, string &buffer);
+
+	std::shared_ptr<Result> 
+	execute(const string &query, 
+	        const ResultMode::Value resultMode = ResultMode::STORE_RESULT);
+
+	std::shared_ptr<Result> 
+	execute(const string &query, const std::chrono::milliseconds timeout);
+
+	void cancel();
+
+	using Database::executeAsync;
+
+	AsyncStatus::Value executeAsync(const string &query, 
+	                                AsyncCallback callback);
+
+	AsyncStatus::Value commitAsync(AsyncCallback callback);
+
+	AsyncStatus::Value rollbackAsync(AsyncCallback callback);
+
+	AsyncStatus::Value poll();
+
+	int getSocket() const;
+
+	unsigned long long affectedRows();
+
+	unsigned long long lastInsertedId();
+
+protected:
+	std::shared_ptr<Database> _database;
+
+private:
+	// Don't allow copying the object
+	DatabaseProxy(const DatabaseProxy &other);
+	DatabaseProxy& operator=(const DatabaseProxy &other);
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_DATABASE_PROXY_HPP__
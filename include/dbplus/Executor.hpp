@@ -0,0 +1,70 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_EXECUTOR_HPP__
+#define __DB_PLUS_EXECUTOR_HPP__
+
+#include <functional>
+
+#include <dbplus/Dbplus.hpp>
+
+DBPLUS_NS_BEGIN
+
+/*! \class Executor
+ *  \brief Runs the continuation of asynchronous operations (interface).
+ *
+ * Used to decide in which thread a coroutine is resumed after an
+ * asynchronous operation finishes.
+ */
+class Executor
+{
+public:
+	/*! Destructor.
+	 */
+	virtual ~Executor() {}
+
+	/*! Schedule a task to be executed.
+	 *
+	 * @param task Function to be executed
+	 */
+	virtual void post(std::function<void ()> task) = 0;
+};
+
+/*! \class InlineExecutor
+ *  \brief Runs the task immediately in the caller's thread.
+ *
+ * When used with the reactor, coroutines are resumed in the thread
+ * that is running the loop.
+ */
+class InlineExecutor : public Executor
+{
+public:
+	/*! Execute the task immediately.
+	 *
+	 * @param task Function to be executed
+	 */
+	void post(std::function<void ()> task)
+	{
+		task();
+	}
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_EXECUTOR_HPP__
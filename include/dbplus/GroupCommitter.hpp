@@ -0,0 +1,350 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_GROUP_COMMITTER_HPP__
+#define __DB_PLUS_GROUP_COMMITTER_HPP__
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <dbplus/ConnectionPool.hpp>
+#include <dbplus/Database.hpp>
+#include <dbplus/DatabaseException.hpp>
+#include <dbplus/Dbplus.hpp>
+
+DBPLUS_NS_BEGIN
+
+/*! \class GroupCommitter
+ *  \brief Commits the small transactions of many threads together.
+ *
+ * Threads submit units of work, and a coordinator thread runs the
+ * units that are waiting in one transaction of one connection, with
+ * only one commit. While a group is committed the next units wait, so
+ * the groups get bigger when commits are slow. Each unit runs inside a
+ * savepoint: a unit that fails is rolled back to its savepoint without
+ * affecting the others, and is retried alone in its own transaction.
+ * If the commit of the group fails, every unit is retried alone.
+ *
+ * A unit must not commit, rollback or change the transaction mode of
+ * the connection, and can run more than once. Thread safe.
+ */
+template<class Driver>
+class GroupCommitter
+{
+public:
+	typedef ConnectionPool<Driver> Pool;
+
+	/*! Work executed inside a transaction. Errors are reported by
+	 * throwing exceptions
+	 */
+	typedef std::function<void (Driver &database)> Unit;
+
+	/*! Constructor. Starts the coordinator thread.
+	 *
+	 * @param pool Connections used to run the units
+	 * @param maxUnits Maximum number of units in one transaction
+	 * @param window Time that the coordinator waits for more units
+	 * before starting a group, zero starts with the units that are
+	 * already waiting
+	 */
+	GroupCommitter(std::shared_ptr<Pool> pool,
+	               const unsigned int maxUnits = 64,
+	               const std::chrono::milliseconds window = std::chrono::milliseconds(0)) :
+		_pool(pool),
+		_maxUnits(maxUnits == 0 ? 1 : maxUnits),
+		_window(window),
+		_stopped(false),
+		_commits(0),
+		_units(0),
+		_retries(0)
+	{
+		_thread = std::thread(&GroupCommitter::run, this);
+	}
+
+	/*! Destructor. The units that are waiting are committed before the
+	 * thread stops.
+	 */
+	~GroupCommitter()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			_stopped = true;
+		}
+
+		_changed.notify_all();
+		_thread.join();
+	}
+
+	/*! Submit a unit of work.
+	 *
+	 * @param unit Work executed inside a transaction
+	 * @return Ready when the unit is committed. Receives the exception
+	 * of the unit if it fails when running alone
+	 */
+	std::future<void> submit(Unit unit)
+	{
+		Task task;
+		task.unit = unit;
+		task.promise.reset(new std::promise<void>());
+		std::future<void> future = task.promise->get_future();
+
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			_tasks.push_back(task);
+			_units++;
+		}
+
+		_changed.notify_all();
+		return future;
+	}
+
+	/*! Submit a unit of work and wait for the commit.
+	 *
+	 * @param unit Work executed inside a transaction
+	 * @throw Exception of the unit if it fails when running alone
+	 */
+	void execute(Unit unit)
+	{
+		submit(unit).get();
+	}
+
+	/*! Returns the number of transactions committed.
+	 *
+	 * @return Number of commits
+	 */
+	unsigned long long getCommits() const
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		return _commits;
+	}
+
+	/*! Returns the number of units submitted.
+	 *
+	 * @return Number of units
+	 */
+	unsigned long long getUnits() const
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		return _units;
+	}
+
+	/*! Returns the number of units that were retried alone.
+	 *
+	 * @return Number of retries
+	 */
+	unsigned long long getRetries() const
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		return _retries;
+	}
+
+private:
+	/*! Unit waiting to be committed
+	 */
+	struct Task {
+		Unit unit;
+		std::shared_ptr<std::promise<void> > promise;
+	};
+
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(_lock);
+		while (true) {
+			if (_tasks.empty()) {
+				if (_stopped) {
+					break;
+				}
+
+				// The connection is not kept while there's nothing to do
+				if (_lease.get() != NULL) {
+					lock.unlock();
+					_lease.release();
+					lock.lock();
+					continue;
+				}
+
+				_changed.wait(lock);
+				continue;
+			}
+
+			if (_window.count() > 0) {
+				std::chrono::steady_clock::time_point deadline = 
+					std::chrono::steady_clock::now() + _window;
+				_changed.wait_until(lock, deadline, [this]() {
+					return _stopped || _tasks.size() >= _maxUnits;
+				});
+			}
+
+			std::vector<Task> tasks;
+			while (_tasks.empty() == false && tasks.size() < _maxUnits) {
+				tasks.push_back(_tasks.front());
+				_tasks.pop_front();
+			}
+
+			lock.unlock();
+			commitGroup(tasks);
+			lock.lock();
+		}
+	}
+
+	void commitGroup(std::vector<Task> &tasks)
+	{
+		if (tasks.size() == 1) {
+			commitAlone(tasks[0], false);
+			return;
+		}
+
+		std::vector<Task*> committed;
+		std::vector<Task*> failed;
+
+		try {
+			Driver &database = connection();
+
+			for (Task &task : tasks) {
+				database.execute("SAVEPOINT dbplus_unit");
+
+				bool succeeded = true;
+				try {
+					task.unit(database);
+				} catch (...) {
+					succeeded = false;
+				}
+
+				if (succeeded) {
+					database.execute("RELEASE SAVEPOINT dbplus_unit");
+					committed.push_back(&task);
+				} else {
+					database.execute("ROLLBACK TO SAVEPOINT dbplus_unit");
+					database.execute("RELEASE SAVEPOINT dbplus_unit");
+					failed.push_back(&task);
+				}
+			}
+
+			database.commit();
+
+		} catch (...) {
+			// The connection or the commit failed, so nothing was
+			// committed and every unit runs again alone
+			_lease = typename Pool::Lease();
+			for (Task &task : tasks) {
+				commitAlone(task, true);
+			}
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			_commits++;
+		}
+
+		for (Task *task : committed) {
+			task->promise->set_value();
+		}
+
+		for (Task *task : failed) {
+			commitAlone(*task, true);
+		}
+	}
+
+	void commitAlone(Task &task, const bool retry)
+	{
+		if (retry) {
+			std::lock_guard<std::mutex> lock(_lock);
+			_retries++;
+		}
+
+		std::exception_ptr error;
+		try {
+			Driver &database = connection();
+			try {
+				task.unit(database);
+				database.commit();
+			} catch (...) {
+				error = std::current_exception();
+				database.rollback();
+			}
+
+		} catch (...) {
+			// The connection is broken
+			if (!error) {
+				error = std::current_exception();
+			}
+			_lease = typename Pool::Lease();
+		}
+
+		if (error) {
+			task.promise->set_exception(error);
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			_commits++;
+		}
+
+		task.promise->set_value();
+	}
+
+	Driver& connection()
+	{
+		if (_lease.get() == NULL) {
+			_lease = _pool->acquire();
+		}
+
+		if (_lease->getTransactionMode() != Database::TransactionMode::MANUAL_COMMIT) {
+			_lease->setTransactionMode(Database::TransactionMode::MANUAL_COMMIT);
+		}
+
+		return *_lease;
+	}
+
+	std::shared_ptr<Pool> _pool;
+	unsigned int _maxUnits;
+	std::chrono::milliseconds _window;
+
+	mutable std::mutex _lock;
+	std::condition_variable _changed;
+	std::deque<Task> _tasks;
+	bool _stopped;
+
+	unsigned long long _commits;
+	unsigned long long _units;
+	unsigned long long _retries;
+
+	// Used only by the coordinator thread
+	typename Pool::Lease _lease;
+	std::thread _thread;
+
+private:
+	// Don't allow copying the object
+	GroupCommitter(const GroupCommitter &other);
+	GroupCommitter& operator=(const GroupCommitter &other);
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_GROUP_COMMITTER_HPP__
@@ -0,0 +1,268 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_INSERT_BUILDER_HPP__
+#define __DB_PLUS_INSERT_BUILDER_HPP__
+
+#include <string>
+#include <vector>
+
+#include <boost/any.hpp>
+
+#include <dbplus/Dbplus.hpp>
+#include <dbplus/SqlDialect.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+/*! \class InsertBuilder
+ *  \brief Builds and executes multi-row INSERT statements.
+ *
+ * The rows are written straight into one buffer, that is reused by
+ * all statements. When the next row would make the statement bigger
+ * than the limit, the statement is executed and a new one starts with
+ * the row. The limit is the biggest statement accepted by the server
+ * (max_allowed_packet in MySQL) or a configured size. Optionally the
+ * statements update the rows that already exist (ON DUPLICATE KEY
+ * UPDATE in MySQL or ON CONFLICT in PostgreSQL).
+ *
+ * Usage:
+ *   InsertBuilder<MySql> insert(mysql, "users", columns);
+ *   insert.add(row);
+ *   unsigned long long rows = insert.execute();
+ */
+template<class Driver>
+class InsertBuilder
+{
+public:
+	/*! Values of a row, in the order of the columns. Empty values are
+	 * written as NULL
+	 */
+	typedef std::vector<boost::any> Row;
+
+	/*! Constructor.
+	 *
+	 * @param database Connection that executes the statements
+	 * @param table Table name
+	 * @param columns Columns of the rows
+	 * @param maxBytes Maximum size of a statement, zero uses the limit
+	 * of the server
+	 */
+	InsertBuilder(Driver &database,
+	              const string &table,
+	              const std::vector<string> &columns,
+	              const unsigned long maxBytes = 0) :
+		_database(database),
+		_table(table),
+		_columns(columns),
+		_maxBytes(maxBytes),
+		_rows(0),
+		_statements(0),
+		_affectedRows(0)
+	{
+		buildPrefix();
+	}
+
+	/*! Update the rows that already exist instead of failing.
+	 *
+	 * @param keys Columns that identify the rows
+	 */
+	void setUpsert(const std::vector<string> &keys)
+	{
+		_suffix = SqlDialect<Driver>::upsert(_columns, keys);
+	}
+
+	/*! Add a row to the statement, executing the current statement
+	 * first if the row doesn't fit.
+	 *
+	 * @param row Values of the row, in the order of the columns
+	 * @throw DatabaseException if a value could not be written or the
+	 * statement fails
+	 */
+	void add(const Row &row)
+	{
+		if (row.size() != _columns.size()) {
+			throw DATABASE_EXCEPTION(DatabaseException::CONVERSION_ERROR,
+			                         "Row doesn't have the same number of columns");
+		}
+
+		append([this, &row](string &buffer) {
+			for (unsigned int i = 0; i < row.size(); i++) {
+				if (i > 0) {
+					buffer += ", ";
+				}
+				SqlDialect<Driver>::appendValue(_database, row[i], buffer);
+			}
+		});
+	}
+
+	/*! Add a row whose values are written by a function, so values
+	 * with a type known at compile time are not boxed in boost::any.
+	 * The current statement is executed first if the row doesn't fit.
+	 *
+	 * @param writer Function that receives the buffer and appends the
+	 * SQL literals of the row separated by commas, in the order of the
+	 * columns
+	 * @throw DatabaseException if a value could not be written or the
+	 * statement fails
+	 */
+	template<class Writer>
+	void append(Writer writer)
+	{
+		if (_maxBytes == 0) {
+			_maxBytes = SqlDialect<Driver>::maxStatementSize(_database);
+		}
+
+		string::size_type start = _buffer.size();
+
+		try {
+			_buffer += (_rows == 0 ? "(" : ", (");
+			writer(_buffer);
+			_buffer += ")";
+		} catch (...) {
+			_buffer.resize(start);
+			throw;
+		}
+
+		// The packet also has the command byte
+		if (_rows == 0 || _buffer.size() + _suffix.size() < _maxBytes) {
+			_rows++;
+			return;
+		}
+
+		// The row starts the next statement. It was written after a
+		// separator, that the first row doesn't have
+		_row.assign(_buffer, start + 2, string::npos);
+		_buffer.resize(start);
+
+		try {
+			flush();
+		} catch (...) {
+			_buffer += _row;
+			_rows = 1;
+			throw;
+		}
+
+		_buffer += _row;
+		_rows = 1;
+	}
+
+	/*! Execute the rows that were not executed yet.
+	 *
+	 * @return Number of rows affected by all statements since the last
+	 * call, as reported by the server
+	 * @throw DatabaseException if the statement fails
+	 */
+	unsigned long long execute()
+	{
+		if (_rows > 0) {
+			flush();
+		}
+
+		unsigned long long affectedRows = _affectedRows;
+		_affectedRows = 0;
+		return affectedRows;
+	}
+
+	/*! Returns the number of rows waiting to be executed.
+	 *
+	 * @return Number of rows
+	 */
+	unsigned int size() const
+	{
+		return _rows;
+	}
+
+	/*! Returns the number of statements executed.
+	 *
+	 * @return Number of statements
+	 */
+	unsigned long long getStatements() const
+	{
+		return _statements;
+	}
+
+	/*! Returns the connection that executes the statements.
+	 *
+	 * @return Connection
+	 */
+	Driver& getDatabase() const
+	{
+		return _database;
+	}
+
+private:
+	void buildPrefix()
+	{
+		_buffer = "INSERT INTO " + _table + " (";
+		for (unsigned int i = 0; i < _columns.size(); i++) {
+			if (i > 0) {
+				_buffer += ", ";
+			}
+			_buffer += _columns[i];
+		}
+		_buffer += ") VALUES ";
+
+		_prefixSize = _buffer.size();
+	}
+
+	void flush()
+	{
+		_buffer += _suffix;
+
+		// The buffer is ready for the next statement even on errors
+		try {
+			_database.execute(_buffer);
+		} catch (...) {
+			_buffer.resize(_prefixSize);
+			_rows = 0;
+			throw;
+		}
+
+		_affectedRows += _database.affectedRows();
+		_statements++;
+
+		_buffer.resize(_prefixSize);
+		_rows = 0;
+	}
+
+	Driver &_database;
+	string _table;
+	std::vector<string> _columns;
+	unsigned long _maxBytes;
+
+	string _buffer;
+	string::size_type _prefixSize;
+	string _suffix;
+	string _row;
+	unsigned int _rows;
+
+	unsigned long long _statements;
+	unsigned long long _affectedRows;
+
+private:
+	// Don't allow copying the object
+	InsertBuilder(const InsertBuilder &other);
+	InsertBuilder& operator=(const InsertBuilder &other);
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_INSERT_BUILDER_HPP__
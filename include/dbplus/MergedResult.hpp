@@ -0,0 +1,129 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_MERGED_RESULT_HPP__
+#define __DB_PLUS_MERGED_RESULT_HPP__
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/any.hpp>
+
+#include <dbplus/Dbplus.hpp>
+#include <dbplus/Result.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+/*! \class MergedResult
+ *  \brief Joins the results of the same query executed in many
+ *  databases.
+ *
+ * Without a comparison function the rows of each result are returned
+ * after the rows of the previous one. With a comparison function the
+ * results must already be sorted by it (ORDER BY in each database),
+ * and the rows are merged keeping the order.
+ */
+class MergedResult : public Result
+{
+public:
+	/*! Compare the current rows of two results, returning true when
+	 * the row of the first result comes before.
+	 */
+	typedef std::function<bool (const Result &first, 
+	                            const Result &second)> Less;
+
+	/*! Constructor.
+	 *
+	 * @param results Results that are going to be joined, empty results
+	 * are ignored
+	 * @param less Comparison function used for sorted merges, when empty
+	 * the results are concatenated
+	 */
+	explicit MergedResult(const std::vector<std::shared_ptr<Result> > &results,
+	                      Less less = Less());
+
+	/*! Creates a comparison function for a column.
+	 *
+	 * @tparam T Type of the column in C++
+	 * @param column Column name
+	 * @param descending When true, bigger values come first
+	 * @return Comparison function
+	 */
+	template<class T>
+	static Less byColumn(const string &column, const bool descending = false)
+	{
+		return [column, descending](const Result &first, const Result &second) {
+			if (descending) {
+				return second.get<T>(column) < first.get<T>(column);
+			}
+
+			return first.get<T>(column) < second.get<T>(column);
+		};
+	}
+
+	/*! Returns the number of rows of all results.
+	 *
+	 * @return Number of rows in result
+	 */
+	unsigned int size() const;
+
+	/*! Move to the next row.
+	 *
+	 * @return True if there's a next row, false otherwise
+	 */
+	bool fetch();
+
+	using Result::get;
+
+	/*! Returns the value of a given column name.
+	 *
+	 * @param key Column name
+	 * @return column Value in the current row
+	 * @throw DatabaseException if there's no current row
+	 */
+	boost::any get(const string &key) const;
+
+	/*! Returns all columns of the current row.
+	 *
+	 * @return Column values indexed by the column name
+	 */
+	const std::map<string, boost::any>& getRow() const;
+
+private:
+	bool fetchNext();
+	bool fetchSorted();
+
+	std::vector<std::shared_ptr<Result> > _results;
+	Less _less;
+
+	// Results with a current row, used by sorted merges
+	std::vector<Result*> _heads;
+	bool _started;
+	Result *_current;
+	unsigned int _next;
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_MERGED_RESULT_HPP__
@@ -24,7 +24,12 @@ extern "C" {
 #include <mysql/mysql.h>
 }
 
+#include <memory>
+#include <vector>
+
 #include <dbplus/Dbplus.hpp>
+#include <dbplus/ParameterColumn.hpp>
+#include <dbplus/RowStore.hpp>
 
 #include "Database.hpp"
 
@@ -63,10 +68,44 @@ public:
 	             const string &server, 
 	             const unsigned int port = 3306);
 	
+	/*! Connect to the database without blocking, using the
+	 * non-blocking client API. The connection is finished by the poll
+	 * method.
+	 *
+	 * @param database Name of the database
+	 * @param user Username used for connection
+	 * @param password Username's password
+	 * @param server Hostname or IP address of the database
+	 * @param port Database server's port
+	 * @param callback Function called when the connection is ready
+	 * @return What the connection is waiting for
+	 * @throw DatabaseException if the connection could not be started
+	 * @see poll
+	 */
+	AsyncStatus::Value connectAsync(const string &database, 
+	                                const string &user, 
+	                                const string &password, 
+	                                const string &server, 
+	                                const unsigned int port,
+	                                AsyncCallback callback);
+
 	/*! Disconnect from the database
 	 */
 	void disconnect();
 
+	/*! Check if the connection with the database is still alive.
+	 *
+	 * @return True if the database answered, false otherwise
+	 */
+	bool ping();
+
+	/*! Stop the query running in the connection with KILL QUERY,
+	 * sent by a second connection opened with the same parameters.
+	 *
+	 * @throw DatabaseException if the request could not be sent
+	 */
+	void cancel();
+
 	/*! Sets transaction mode. Possible values are defined in
 	 * Database::TransactionMode::Value.
 	 *
@@ -101,13 +140,27 @@ public:
 	void rollback();
 
 	/*! To avoid SQL injection over database queries, this method
-	 * removes all dangerous characters.
+	 * removes all dangerous characters. The value must be written
+	 * between single quotes.
 	 *
 	 * @param value String to be escaped
 	 * @return Value escaped
+	 * @throw DatabaseException if the client library can't escape it
 	 */
 	string escape(const string &value);
 
+	/*! Escape a value appending it to a buffer. The parts of the value
+	 * without special characters are copied directly, and the client
+	 * library is only used when needed. The value must be written
+	 * between single quotes, the only quote escaped when the server
+	 * uses NO_BACKSLASH_ESCAPES.
+	 *
+	 * @param value String to be escaped
+	 * @param buffer Where the escaped value is appended
+	 * @throw DatabaseException if the client library can't escape it
+	 */
+	void escape(const string &value, string &buffer);
+
 	/*! Execute a SQL query.
 	 *
 	 * @param query SQL query
@@ -119,6 +172,145 @@ public:
 	execute(const string &query, 
 	        const ResultMode::Value resultMode = ResultMode::STORE_RESULT);
 
+	/*! Execute a SQL query reusing the values of a previous result,
+	 * that is filled with the new rows when it's a MySQL result.
+	 *
+	 * @param query SQL query
+	 * @param result Result that is going to be reused, can be empty
+	 * @return Result object with all the dataset, or an empty pointer
+	 * when the query doesn't return rows
+	 * @throw DatabaseException on error
+	 */
+	std::shared_ptr<Result>
+	execute(const string &query, std::shared_ptr<Result> result);
+
+	using Database::execute;
+
+	/*! Execute a statement once for each row of parameters, like an
+	 * UPDATE or INSERT with placeholders (?). The values are read
+	 * directly from the columns, without boost::any.
+	 *
+	 * By default the statement is prepared in the server and executed
+	 * once per row, one round trip each. With grouped executions no
+	 * statement is prepared: the values are escaped in the client and
+	 * written into the SQL text, and groups of up to 1000 executions
+	 * (or 1 MB) joined by semicolons are sent in one round trip each,
+	 * with multi-statements enabled during the call. The safety of the
+	 * grouped executions depends on the escape method, so they are
+	 * refused when the server has NO_BACKSLASH_ESCAPES. In both
+	 * cases the executions stop at the first failure, and in
+	 * AUTO_COMMIT mode the previous ones stay executed.
+	 *
+	 * @param statement SQL statement with one placeholder per column
+	 * @param parameters Values of each placeholder, all with the same
+	 * size
+	 * @param grouped Send groups of executions as text instead of
+	 * executing a prepared statement per row
+	 * @return Number of rows affected by all executions
+	 * @throw DatabaseException on error, or for grouped executions
+	 * with NO_BACKSLASH_ESCAPES
+	 */
+	unsigned long long 
+	executeBulk(const string &statement, 
+	            const std::vector<ParameterColumn> &parameters,
+	            const bool grouped = false);
+
+	/*! Execute a batch of SQL statements separated by semicolons in a
+	 * single round trip. Each statement (or each result set returned by
+	 * a stored procedure) produces one entry in the returned list, in
+	 * the same order they were sent. Statements that don't return rows
+	 * produce an empty pointer, like the execute method. All result
+	 * sets are stored in client side.
+	 *
+	 * @param query SQL statements separated by semicolons
+	 * @return One result for each statement
+	 * @throw DatabaseException on error
+	 * @see setMultiStatements
+	 */
+	std::vector<std::shared_ptr<Result> > executeMulti(const string &query);
+
+	/*! Enables the execution of many statements in the same query
+	 * (CLIENT_MULTI_STATEMENTS and CLIENT_MULTI_RESULTS client
+	 * flags). Must be called before the connect method. Disabled by
+	 * default.
+	 *
+	 * @param multiStatements True to enable multi-statements
+	 * @see executeMulti
+	 */
+	void setMultiStatements(const bool multiStatements);
+
+	/*! Returns if the execution of many statements in the same query is
+	 * enabled.
+	 *
+	 * @return True if multi-statements are enabled
+	 */
+	bool getMultiStatements() const;
+
+	/*! Limits the memory used by each result in STORE_RESULT mode.
+	 * When the limit, or the global limit of RowStore, is set, the rows
+	 * are read by DBplus instead of the client library and the rows
+	 * that don't fit are moved to a temporary file. Multi-statement and
+	 * asynchronous queries are not limited.
+	 *
+	 * @param bytes Maximum number of bytes of each result, zero only
+	 * applies the global limit
+	 * @see RowStore
+	 */
+	void setMemoryLimit(const unsigned long bytes);
+
+	/*! Returns the memory limit of each result.
+	 *
+	 * @return Maximum number of bytes, zero means no limit
+	 */
+	unsigned long getMemoryLimit() const;
+
+	using Database::executeAsync;
+
+	/*! Send a SQL query without waiting for the answer, using the
+	 * non-blocking client API (MySQL 8.0.16 or later is required). The
+	 * result is always stored in client side.
+	 *
+	 * @param query SQL query
+	 * @param callback Function called when the query finishes
+	 * @return What the connection is waiting for
+	 * @throw DatabaseException if the query could not be sent
+	 * @see poll
+	 */
+	AsyncStatus::Value executeAsync(const string &query, 
+	                                AsyncCallback callback);
+
+	/*! Asynchronous version of the commit method.
+	 *
+	 * @param callback Function called when the commit finishes
+	 * @return What the connection is waiting for
+	 * @throw DatabaseException if the commit could not be sent
+	 */
+	AsyncStatus::Value commitAsync(AsyncCallback callback);
+
+	/*! Asynchronous version of the rollback method.
+	 *
+	 * @param callback Function called when the rollback finishes
+	 * @return What the connection is waiting for
+	 * @throw DatabaseException if the rollback could not be sent
+	 */
+	AsyncStatus::Value rollbackAsync(AsyncCallback callback);
+
+	/*! Continue the current asynchronous operation without
+	 * blocking. The MySQL client API doesn't tell which socket event
+	 * it is waiting for, so WAIT_WRITE is returned while the send
+	 * buffer of the socket is full, like when a big query is being
+	 * sent, and WAIT_READ otherwise.
+	 *
+	 * @return What the connection is waiting for
+	 */
+	AsyncStatus::Value poll();
+
+	/*! Returns the socket of the connection.
+	 *
+	 * @return Socket file descriptor
+	 */
+	int getSocket() const;
+
 	/*! Returns the number of rows effected by the last query.
 	 *
 	 * @return Number of rows effected
@@ -132,8 +324,59 @@ public:
 	unsigned long long lastInsertedId();
 
 private:
+	/*! Steps of an asynchronous operation
+	 */
+	enum AsyncState {
+		ASYNC_IDLE,
+		ASYNC_CONNECT,
+		ASYNC_QUERY,
+		ASYNC_STORE,
+		ASYNC_NEXT_RESULT,
+		ASYNC_DISCARD
+	};
+
+	void initialize(const string &database, 
+	                const string &user, 
+	                const string &password, 
+	                const string &server, 
+	                const unsigned int port);
+	unsigned long clientFlags() const;
+	unsigned long long executePrepared(const string &statement, 
+	                                   const std::vector<ParameterColumn> &parameters,
+	                                   const unsigned int rows);
+	unsigned long long executeGrouped(const string &statement, 
+	                                  const std::vector<ParameterColumn> &parameters,
+	                                  const unsigned int rows);
+	static std::vector<string> splitPlaceholders(const string &statement);
+	void appendExecution(const std::vector<string> &parts,
+	                     const std::vector<ParameterColumn> &parameters,
+	                     const unsigned int row,
+	                     string &query);
+	unsigned long long executeGroup(const string &query);
+	bool sendQuery(const string &query);
+	bool limitsMemory() const;
+	std::shared_ptr<RowStore> readRows(MYSQL_RES *result);
+	MYSQL_RES* storeResult(const ResultMode::Value resultMode);
+	void discardResults();
+	bool sendBlocked() const;
+	AsyncStatus::Value finishAsync(std::shared_ptr<Result> result, 
+	                               std::exception_ptr error);
+
 	MYSQL _mysql;
+	string _database;
+	string _user;
+	string _password;
+	string _server;
+	unsigned int _port;
 	TransactionMode::Value _transactionMode;
+	bool _initialized;
+	bool _multiStatements;
+	unsigned long _memoryLimit;
+
+	AsyncState _asyncState;
+	string _asyncQuery;
+	AsyncCallback _asyncCallback;
+	std::shared_ptr<Result> _asyncResult;
 
 private:
 	// Don't allow copying the object
@@ -24,9 +24,13 @@ extern "C" {
 #include <mysql/mysql.h>
 }
 
+#include <memory>
+#include <vector>
+
 #include <boost/lexical_cast.hpp>
 
 #include <dbplus/Dbplus.hpp>
+#include <dbplus/RowStore.hpp>
 
 #include "Result.hpp"
 
@@ -37,18 +41,44 @@ DBPLUS_NS_BEGIN
  *
  * Base class to store results of a database query.
  */
-class MySqlResult : public Result
+class MySqlResult final : public Result
 {
 public:
 	/*! Constructor receives the raw MySQL structure already containing
 	 * the result.
+	 *
+	 * @param result Raw MySQL structure, NULL for a result without
+	 * rows that is going to be filled later with reset
+	 */
+	explicit MySqlResult(MYSQL_RES *result = NULL);
+
+	/*! Constructor for rows read in advance from a result in
+	 * USE_RESULT mode, that only provides the columns.
+	 *
+	 * @param result Raw MySQL structure with the columns
+	 * @param rows Values of the rows
+	 */
+	MySqlResult(MYSQL_RES *result, std::shared_ptr<RowStore> rows);
+
+	/*! Move constructor.
+	 *
+	 * @param other Result that is moved, left without rows
 	 */
-	explicit MySqlResult(MYSQL_RES *result);
+	MySqlResult(MySqlResult &&other);
 
 	/*! Release memory from raw MySQL structures.
 	 */
 	~MySqlResult();
 
+	/*! Replace the rows by the rows of another query. The memory of
+	 * the values is reused by the new rows.
+	 *
+	 * @param result Raw MySQL structure containing the result
+	 * @param rows Values of the rows, when they were read in advance
+	 */
+	void reset(MYSQL_RES *result, 
+	           std::shared_ptr<RowStore> rows = std::shared_ptr<RowStore>());
+
 	/*! Returns the number of rows found in result.
 	 *
 	 * @return Number of rows in result
@@ -62,6 +92,51 @@ public:
 	 */
 	bool fetch();
 	
+	/*! Read the remaining rows in batches, decoding the values
+	 * straight into the block.
+	 *
+	 * @param callback Function called with each batch
+	 * @param batchSize Maximum number of rows of each batch
+	 */
+	void forEachBatch(BatchCallback callback, 
+	                  const unsigned int batchSize = 1024);
+
+	/*! Returns true, the rows keep the text sent by the server.
+	 *
+	 * @return Always true
+	 */
+	bool hasText() const;
+
+	/*! Returns true when the text of a column is a number.
+	 *
+	 * @param column Index of the column
+	 * @return True for numeric columns
+	 */
+	bool isNumber(const unsigned int column) const;
+
+	/*! Move to the next row without converting the values.
+	 *
+	 * @param values Text of each column, NULL for NULL values
+	 * @param sizes Number of bytes of each value
+	 * @return True if there's a next row, false otherwise
+	 */
+	bool fetchText(std::vector<const char*> &values,
+	               std::vector<unsigned long> &sizes);
+
+	/*! Returns the text sent by the server for a column of the
+	 * current row.
+	 *
+	 * @param column Index of the column
+	 * @param value Text of the value, NULL for NULL values
+	 * @param size Number of bytes of the value
+	 * @throw DatabaseException if there's no current row
+	 */
+	void getText(const unsigned int column, 
+	             const char *&value, 
+	             unsigned long &size) const;
+
+	using Result::get;
+
 	/*! Returns the value of a given column name.
 	 *
 	 * @param key Column name
@@ -71,7 +146,24 @@ public:
 	boost::any get(const string &key) const;
 
 private:
+	bool nextRow(const char * const *&row, const unsigned long *&lengths);
+
+	template<class Target>
+	void decodeRow(const char * const *row, 
+	               const unsigned long *lengths,
+	               Target &target);
+
 	MYSQL_RES *_result;
+	std::vector<MYSQL_FIELD*> _fields;
+
+	std::shared_ptr<RowStore> _rows;
+	unsigned int _currentRow;
+	std::vector<const char*> _values;
+	std::vector<unsigned long> _lengths;
+
+	// Text of the current row, owned by the MySQL result or the rows
+	const char * const *_current;
+	const unsigned long *_currentLengths;
 };
 
 DBPLUS_NS_END
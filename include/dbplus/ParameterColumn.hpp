@@ -0,0 +1,139 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_PARAMETER_COLUMN_HPP__
+#define __DB_PLUS_PARAMETER_COLUMN_HPP__
+
+#include <string>
+#include <vector>
+
+#include <dbplus/Dbplus.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+/*! \class ParameterColumn
+ *  \brief Values of one parameter of a statement executed many times.
+ *
+ * The column only points to the vector of the caller, that must not
+ * change while the statement is executed, so no value is copied. Only
+ * the NULL flags, one bit per value, are copied.
+ */
+class ParameterColumn
+{
+public:
+	/*! \class Type
+	 *  \brief Possible types of the values
+	 */
+	class Type
+	{
+	public:
+		/*! List all types
+		 */
+		enum Value {
+			INTEGER,
+			DOUBLE,
+			TEXT
+		};
+	};
+
+	/*! Constructor for integer values.
+	 *
+	 * @param values One value for each execution
+	 */
+	explicit ParameterColumn(const std::vector<long long> &values);
+
+	/*! Constructor for floating point values.
+	 *
+	 * @param values One value for each execution
+	 */
+	explicit ParameterColumn(const std::vector<double> &values);
+
+	/*! Constructor for text values.
+	 *
+	 * @param values One value for each execution
+	 */
+	explicit ParameterColumn(const std::vector<string> &values);
+
+	/*! Sets which values are NULL. The flags are copied.
+	 *
+	 * @param nulls True for each execution where the value is NULL, must
+	 * have the same size of the values
+	 * @throw DatabaseException if the sizes are different
+	 */
+	void setNulls(const std::vector<bool> &nulls);
+
+	/*! Returns the type of the values.
+	 *
+	 * @return Type of the values
+	 */
+	Type::Value getType() const;
+
+	/*! Returns the number of values.
+	 *
+	 * @return Number of values
+	 */
+	unsigned int size() const;
+
+	/*! Check if a value is NULL.
+	 *
+	 * @param row Index of the value
+	 * @return True if the value is NULL
+	 */
+	bool isNull(const unsigned int row) const;
+
+	/*! Returns the integer values.
+	 *
+	 * @return First value, only valid for INTEGER columns
+	 */
+	const long long* getIntegers() const;
+
+	/*! Returns the floating point values.
+	 *
+	 * @return First value, only valid for DOUBLE columns
+	 */
+	const double* getDoubles() const;
+
+	/*! Returns the text values.
+	 *
+	 * @return First value, only valid for TEXT columns
+	 */
+	const string* getTexts() const;
+
+	/*! Returns the number of executions of a statement, checking that
+	 * all columns have the same size.
+	 *
+	 * @param columns Parameters of the statement
+	 * @return Number of values of each column, or one for statements
+	 * without parameters, that are executed once
+	 * @throw DatabaseException if the columns have different sizes
+	 */
+	static unsigned int rows(const std::vector<ParameterColumn> &columns);
+
+private:
+	Type::Value _type;
+	unsigned int _size;
+	const void *_values;
+	std::vector<bool> _nulls;
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_PARAMETER_COLUMN_HPP__
@@ -25,8 +25,12 @@ extern "C" {
 }
 
 #include <map>
+#include <memory>
+#include <vector>
 
 #include <dbplus/Dbplus.hpp>
+#include <dbplus/ParameterColumn.hpp>
+#include <dbplus/RowStore.hpp>
 
 #include "Database.hpp"
 
@@ -65,10 +69,45 @@ public:
 	             const string &server, 
 	             const unsigned int port = 5432);
 
+	/*! Connect to the database without blocking. The connection is
+	 * finished by the poll method. When the types of the database were
+	 * not downloaded yet by other connection, they are downloaded
+	 * before the callback is called.
+	 *
+	 * @param database Name of the database
+	 * @param user Username used for connection
+	 * @param password Username's password
+	 * @param server Hostname or IP address of the database
+	 * @param port Database server's port
+	 * @param callback Function called when the connection is ready
+	 * @return What the connection is waiting for
+	 * @throw DatabaseException if the connection could not be started
+	 * @see poll
+	 */
+	AsyncStatus::Value connectAsync(const string &database, 
+	                                const string &user, 
+	                                const string &password, 
+	                                const string &server, 
+	                                const unsigned int port,
+	                                AsyncCallback callback);
+
 	/*! Disconnect from the database
 	 */
 	void disconnect();
 
+	/*! Check if the connection with the database is still alive.
+	 *
+	 * @return True if the database answered, false otherwise
+	 */
+	bool ping();
+
+	/*! Stop the query running in the connection with a cancel
+	 * request (PQcancel).
+	 *
+	 * @throw DatabaseException if the request could not be sent
+	 */
+	void cancel();
+
 	/*! Sets transaction mode. Possible values are defined in
 	 * Database::TransactionMode::Value.
 	 *
@@ -110,6 +149,15 @@ public:
 	 */
 	string escape(const string &value);
 
+	/*! Escape a value appending it to a buffer. The parts of the value
+	 * without special characters are copied directly, and the client
+	 * library is only used when needed.
+	 *
+	 * @param value String to be escaped
+	 * @param buffer Where the escaped value is appended
+	 */
+	void escape(const string &value, string &buffer);
+
 	/*! Execute a SQL query.
 	 *
 	 * @param query SQL query
@@ -121,6 +169,111 @@ public:
 	execute(const string &query, 
 	        const ResultMode::Value resultMode = ResultMode::STORE_RESULT);
 
+	/*! Execute a SQL query reusing the values of a previous result,
+	 * that is filled with the new rows when it's a PostgreSQL result.
+	 *
+	 * @param query SQL query
+	 * @param result Result that is going to be reused, can be empty
+	 * @return Result object with all the dataset
+	 * @throw DatabaseException on error
+	 */
+	std::shared_ptr<Result>
+	execute(const string &query, std::shared_ptr<Result> result);
+
+	using Database::execute;
+
+	/*! Execute a prepared statement once for each row of parameters,
+	 * like an UPDATE or INSERT with placeholders ($1, $2, ...). When
+	 * libpq supports pipeline mode the executions are sent without
+	 * waiting for the answer of each one, so there is only one round
+	 * trip for many rows.
+	 *
+	 * @param statement SQL statement with one placeholder per column
+	 * @param parameters Values of each placeholder, all with the same
+	 * size
+	 * @return Number of rows effected by all executions
+	 * @throw DatabaseException on error
+	 */
+	unsigned long long 
+	executeBulk(const string &statement, 
+	            const std::vector<ParameterColumn> &parameters);
+
+	/*! Load rows in a table with COPY FROM STDIN, that is much faster
+	 * than INSERT for many rows.
+	 *
+	 * @param table Table name
+	 * @param columns Columns of the rows
+	 * @param rows Rows in the COPY text format, one per line with the
+	 * values separated by tabs
+	 * @return Number of rows loaded
+	 * @throw DatabaseException on error
+	 */
+	unsigned long long copy(const string &table, 
+	                        const std::vector<string> &columns,
+	                        const string &rows);
+
+	/*! Limits the memory used by each result. When the limit, or the
+	 * global limit of RowStore, is set, the rows are received one by
+	 * one (single row mode) and the rows that don't fit are moved to a
+	 * temporary file. Asynchronous queries are not limited.
+	 *
+	 * @param bytes Maximum number of bytes of each result, zero only
+	 * applies the global limit
+	 * @see RowStore
+	 */
+	void setMemoryLimit(const unsigned long bytes);
+
+	/*! Returns the memory limit of each result.
+	 *
+	 * @return Maximum number of bytes, zero means no limit
+	 */
+	unsigned long getMemoryLimit() const;
+
+	using Database::executeAsync;
+
+	/*! Send a SQL query without waiting for the answer. The types
+	 * cache is loaded in a blocking way on the first query of the
+	 * connection.
+	 *
+	 * @param query SQL query
+	 * @param callback Function called when the query finishes
+	 * @return What the connection is waiting for
+	 * @throw DatabaseException if the query could not be sent
+	 * @see poll
+	 */
+	AsyncStatus::Value executeAsync(const string &query, 
+	                                AsyncCallback callback);
+
+	/*! Asynchronous version of the commit method.
+	 *
+	 * @param callback Function called when the commit finishes
+	 * @return What the connection is waiting for
+	 * @throw DatabaseException if the commit could not be sent
+	 */
+	AsyncStatus::Value commitAsync(AsyncCallback callback);
+
+	/*! Asynchronous version of the rollback method.
+	 *
+	 * @param callback Function called when the rollback finishes
+	 * @return What the connection is waiting for
+	 * @throw DatabaseException if the rollback could not be sent
+	 */
+	AsyncStatus::Value rollbackAsync(AsyncCallback callback);
+
+	/*! Continue the current asynchronous operation without
+	 * blocking. When a query has many statements, only the result of
+	 * the last one is returned.
+	 *
+	 * @return What the connection is waiting for
+	 */
+	AsyncStatus::Value poll();
+
+	/*! Returns the socket of the connection.
+	 *
+	 * @return Socket file descriptor
+	 */
+	int getSocket() const;
+
 	/*! Returns the number of rows effected by the last query.
 	 *
 	 * @return Number of rows effected
@@ -135,13 +288,46 @@ public:
 	unsigned long long lastInsertedId();
 
 private:
+	/*! Steps of an asynchronous operation
+	 */
+	enum AsyncState {
+		ASYNC_IDLE,
+		ASYNC_CONNECT,
+		ASYNC_FLUSH,
+		ASYNC_READ
+	};
+
+	string initialize(const string &database, 
+	                  const string &user, 
+	                  const string &password, 
+	                  const string &server, 
+	                  const unsigned int port);
+	bool sendAsync(const string &query);
+	AsyncStatus::Value connected();
 	void buildTypesCache();
+	bool limitsMemory() const;
+	std::shared_ptr<Result> storeRows(const string &query, 
+	                                  std::shared_ptr<Result> reused);
+	void storeTypes(PGresult *result);
+	std::shared_ptr<Result> buildResult(PGresult *result,
+	                                    std::shared_ptr<Result> reused = 
+	                                    std::shared_ptr<Result>());
+	AsyncStatus::Value finishAsync(std::shared_ptr<Result> result, 
+	                               std::exception_ptr error);
 	static void noticeReceiver(void *arg, const PGresult *result);
 
 	PGconn *_postgres;
+	string _connectionKey;
 	TransactionMode::Value _transactionMode;
 	unsigned int _affectedRows;
-	std::map<Oid, string> _types;
+	unsigned long _memoryLimit;
+	std::shared_ptr<const std::map<Oid, string> > _types;
+
+	AsyncState _asyncState;
+	AsyncCallback _asyncCallback;
+	PGresult *_asyncResult;
+	bool _asyncTypes;
+	bool _asyncDiscardResult;
 
 private:
 	// Don't allow copying the object
@@ -25,10 +25,13 @@ extern "C" {
 }
 
 #include <map>
+#include <memory>
+#include <vector>
 
 #include <boost/lexical_cast.hpp>
 
 #include <dbplus/Dbplus.hpp>
+#include <dbplus/RowStore.hpp>
 
 #include "Result.hpp"
 
@@ -39,22 +42,54 @@ DBPLUS_NS_BEGIN
  *
  * Base class to store results of a database query.
  */
-class PostgresSqlResult : public Result
+class PostgresSqlResult final : public Result
 {
 public:
+	/*! Constructor for a result without rows, that is going to be
+	 * filled later with reset.
+	 */
+	PostgresSqlResult();
+
 	/*! Constructor receives the raw postgreSQL structure already
 	 * containing the result.
 	 *
 	 * @param result Result set with the raw data
-	 * @param types List of know types
+	 * @param types List of know types, shared with the connection
 	 */
 	explicit PostgresSqlResult(PGresult *result,
-	                           const std::map<Oid, string> &types);
+	                           std::shared_ptr<const std::map<Oid, string> > types);
+
+	/*! Constructor for rows read in advance in single row mode.
+	 *
+	 * @param result Result set with the columns
+	 * @param types List of know types, shared with the connection
+	 * @param rows Values of the rows
+	 */
+	PostgresSqlResult(PGresult *result,
+	                  std::shared_ptr<const std::map<Oid, string> > types,
+	                  std::shared_ptr<RowStore> rows);
+
+	/*! Move constructor.
+	 *
+	 * @param other Result that is moved, left without rows
+	 */
+	PostgresSqlResult(PostgresSqlResult &&other);
 
 	/*! Release memory from raw PostgreSQL structures.
 	 */
 	~PostgresSqlResult();
 
+	/*! Replace the rows by the rows of another query. The memory of
+	 * the values is reused by the new rows.
+	 *
+	 * @param result Result set with the raw data
+	 * @param types List of know types, shared with the connection
+	 * @param rows Values of the rows, when they were read in advance
+	 */
+	void reset(PGresult *result,
+	           std::shared_ptr<const std::map<Oid, string> > types,
+	           std::shared_ptr<RowStore> rows = std::shared_ptr<RowStore>());
+
 	/*! Returns the number of rows found in result.
 	 *
 	 * @return Number of rows in result
@@ -68,6 +103,51 @@ public:
 	 */
 	bool fetch();
 	
+	/*! Read the remaining rows in batches, decoding the values
+	 * straight into the block.
+	 *
+	 * @param callback Function called with each batch
+	 * @param batchSize Maximum number of rows of each batch
+	 */
+	void forEachBatch(BatchCallback callback, 
+	                  const unsigned int batchSize = 1024);
+
+	/*! Returns true, the rows keep the text sent by the server.
+	 *
+	 * @return Always true
+	 */
+	bool hasText() const;
+
+	/*! Returns true when the text of a column is a number.
+	 *
+	 * @param column Index of the column
+	 * @return True for numeric columns
+	 */
+	bool isNumber(const unsigned int column) const;
+
+	/*! Move to the next row without converting the values.
+	 *
+	 * @param values Text of each column, NULL for NULL values
+	 * @param sizes Number of bytes of each value
+	 * @return True if there's a next row, false otherwise
+	 */
+	bool fetchText(std::vector<const char*> &values,
+	               std::vector<unsigned long> &sizes);
+
+	/*! Returns the text sent by the server for a column of the
+	 * current row.
+	 *
+	 * @param column Index of the column
+	 * @param value Text of the value, NULL for NULL values
+	 * @param size Number of bytes of the value
+	 * @throw DatabaseException if there's no current row
+	 */
+	void getText(const unsigned int column, 
+	             const char *&value, 
+	             unsigned long &size) const;
+
+	using Result::get;
+
 	/*! Returns the value of a given column name.
 	 *
 	 * @param key Column name
@@ -77,9 +157,29 @@ public:
 	boost::any get(const string &key) const;
 	
 private:
+	/*! How the values of a column are converted
+	 */
+	enum ColumnType {
+		COLUMN_UNKNOWN,
+		COLUMN_VARCHAR,
+		COLUMN_INT4,
+		COLUMN_INT8,
+		COLUMN_TIMESTAMP
+	};
+
+	bool nextRow();
+
+	template<class Target>
+	void decodeRow(Target &target);
+
 	PGresult *_result;
 	int _currentRow;
-	std::map<Oid, string> _types;
+	std::shared_ptr<const std::map<Oid, string> > _types;
+	std::vector<ColumnType> _columnTypes;
+
+	std::shared_ptr<RowStore> _rows;
+	std::vector<const char*> _values;
+	std::vector<unsigned long> _lengths;
 };
 
 DBPLUS_NS_END
@@ -0,0 +1,149 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_PREFETCH_RESULT_HPP__
+#define __DB_PLUS_PREFETCH_RESULT_HPP__
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/any.hpp>
+
+#include <dbplus/Dbplus.hpp>
+#include <dbplus/Result.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+/*! \class PrefetchResult
+ *  \brief Fetches and decodes the rows of another result in a
+ *  background thread.
+ *
+ * While the caller processes a batch of rows, a background thread
+ * reads the next batches from the result it wraps, so the time waiting
+ * for the network (like in USE_RESULT mode) and decoding the values
+ * overlaps with the work of the caller. The batches are exchanged in a
+ * ring with one producer and one consumer, where only the positions
+ * are atomic. A thread only sleeps when the ring is full or empty.
+ *
+ * The wrapped result, and the connection that created it, must not be
+ * used by other threads until this object is destroyed.
+ */
+class PrefetchResult : public Result
+{
+public:
+	/*! Constructor. Starts the background thread.
+	 *
+	 * @param result Result that is going to be read
+	 * @param batchSize Number of rows of each batch
+	 * @param batches Number of batches in the ring, at least two
+	 */
+	explicit PrefetchResult(std::shared_ptr<Result> result,
+	                        const unsigned int batchSize = 256,
+	                        const unsigned int batches = 4);
+
+	/*! Destructor. Stops the background thread, the rows that were not
+	 * fetched are discarded.
+	 */
+	~PrefetchResult();
+
+	/*! Returns the number of rows of the wrapped result when it was
+	 * created.
+	 *
+	 * @return Number of rows in result
+	 */
+	unsigned int size() const;
+
+	/*! Move to the next row, waiting for the background thread when
+	 * the next batch is not ready.
+	 *
+	 * @return True if there's a next row, false otherwise
+	 * @throw DatabaseException when the wrapped result failed
+	 */
+	bool fetch();
+
+	using Result::get;
+
+	/*! Returns the value of a given column name.
+	 *
+	 * @param key Column name
+	 * @return column Value in the current row
+	 * @throw DatabaseException if the column doesn't exist
+	 */
+	boost::any get(const string &key) const;
+
+	/*! Returns all columns of the current row.
+	 *
+	 * @return Column values indexed by the column name
+	 */
+	const std::map<string, boost::any>& getRow() const;
+
+private:
+	/*! Rows exchanged between the threads. The maps are reused by the
+	 * next batches in the same slot
+	 */
+	struct Batch {
+		std::vector<std::map<string, boost::any> > rows;
+		unsigned int count;
+		bool last;
+		std::exception_ptr error;
+	};
+
+	void run();
+	void wait(const bool producer);
+	void notify();
+
+	std::shared_ptr<Result> _result;
+	unsigned int _size;
+	unsigned int _batchSize;
+	std::vector<Batch> _batches;
+
+	std::atomic<unsigned long long> _produced;
+	std::atomic<unsigned long long> _consumed;
+	std::atomic<bool> _stopped;
+
+	// Only used when a thread must sleep
+	std::mutex _lock;
+	std::condition_variable _wake;
+	std::atomic<unsigned int> _waiting;
+
+	// Used only by the consumer
+	Batch *_current;
+	unsigned int _position;
+	bool _finished;
+
+	std::thread _thread;
+
+private:
+	// Don't allow copying the object
+	PrefetchResult(const PrefetchResult &other);
+	PrefetchResult& operator=(const PrefetchResult &other);
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_PREFETCH_RESULT_HPP__
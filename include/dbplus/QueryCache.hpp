@@ -0,0 +1,197 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_QUERY_CACHE_HPP__
+#define __DB_PLUS_QUERY_CACHE_HPP__
+
+#include <chrono>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+#include <dbplus/Dbplus.hpp>
+#include <dbplus/StoredResult.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+/*! \class QueryCache
+ *  \brief Thread safe cache of query results.
+ *
+ * Results are indexed by the SQL text and expire after a time to
+ * live. When the memory used by the results is above the limit, the
+ * least recently used results are removed. Each result also knows the
+ * tables that it reads, so a write can invalidate only the results of
+ * the tables that were changed.
+ *
+ * A result that was read while a write was running could be stale, so
+ * every read gets a ticket before executing the query, and the result
+ * is ignored if one of its tables was invalidated after the ticket.
+ */
+class QueryCache
+{
+public:
+	/*! Constructor.
+	 *
+	 * @param maxMemory Maximum memory used by the results in bytes
+	 * @param ttl Default time to live of the results
+	 */
+	QueryCache(const unsigned long maxMemory, 
+	           const std::chrono::milliseconds ttl);
+
+	/*! Returns the result of a query if it is in the cache and didn't
+	 * expire.
+	 *
+	 * @param query SQL query
+	 * @return Rows of the result or NULL if it's not in the cache
+	 */
+	std::shared_ptr<const StoredResult::Data> get(const string &query);
+
+	/*! Returns the ticket that must be given to the put method. Must be
+	 * called before executing the query.
+	 *
+	 * @return Current ticket
+	 */
+	unsigned long long ticket();
+
+	/*! Store the result of a query using the default time to live.
+	 *
+	 * @param query SQL query
+	 * @param data Rows of the result
+	 * @param tables Tables read by the query
+	 * @param ticket Ticket taken before executing the query
+	 * @return True if the result was stored, false if one of the tables
+	 * was invalidated after the ticket or the result is too big
+	 */
+	bool put(const string &query, 
+	         std::shared_ptr<const StoredResult::Data> data,
+	         const std::set<string> &tables,
+	         const unsigned long long ticket);
+
+	/*! Store the result of a query.
+	 *
+	 * @param query SQL query
+	 * @param data Rows of the result
+	 * @param tables Tables read by the query
+	 * @param ticket Ticket taken before executing the query
+	 * @param ttl Time to live of the result
+	 * @return True if the result was stored, false if one of the tables
+	 * was invalidated after the ticket or the result is too big
+	 */
+	bool put(const string &query, 
+	         std::shared_ptr<const StoredResult::Data> data,
+	         const std::set<string> &tables,
+	         const unsigned long long ticket,
+	         const std::chrono::milliseconds ttl);
+
+	/*! Remove all results that read a table.
+	 *
+	 * @param table Table name in lower case
+	 */
+	void invalidate(const string &table);
+
+	/*! Remove all results that read any of the tables.
+	 *
+	 * @param tables Table names in lower case
+	 */
+	void invalidate(const std::set<string> &tables);
+
+	/*! Remove all results.
+	 */
+	void clear();
+
+	/*! Returns the number of results in the cache.
+	 *
+	 * @return Number of results
+	 */
+	unsigned int size() const;
+
+	/*! Returns the memory used by the results.
+	 *
+	 * @return Memory in bytes
+	 */
+	unsigned long getMemory() const;
+
+	/*! Returns the maximum memory used by the results.
+	 *
+	 * @return Memory in bytes
+	 */
+	unsigned long getMaxMemory() const;
+
+	/*! Returns the number of get calls that found the result.
+	 *
+	 * @return Number of hits
+	 */
+	unsigned long long getHits() const;
+
+	/*! Returns the number of get calls that didn't find the result.
+	 *
+	 * @return Number of misses
+	 */
+	unsigned long long getMisses() const;
+
+private:
+	/*! Result stored in the cache
+	 */
+	struct Entry {
+		string query;
+		std::shared_ptr<const StoredResult::Data> data;
+		std::set<string> tables;
+		std::chrono::steady_clock::time_point expiration;
+		unsigned long memory;
+	};
+
+	typedef std::list<Entry>::iterator Position;
+
+	void invalidateLocked(const string &table);
+	void remove(Position position);
+
+	mutable std::mutex _lock;
+
+	// The most recently used results are in the front of the list
+	std::list<Entry> _entries;
+	std::unordered_map<string, Position> _queries;
+	std::map<string, std::set<string> > _tables;
+
+	// Ticket of the last invalidation of each table
+	std::map<string, unsigned long long> _invalidated;
+	unsigned long long _cleared;
+	unsigned long long _ticket;
+
+	unsigned long _memory;
+	unsigned long _maxMemory;
+	std::chrono::milliseconds _ttl;
+
+	unsigned long long _hits;
+	unsigned long long _misses;
+
+private:
+	// Don't allow copying the object
+	QueryCache(const QueryCache &other);
+	QueryCache& operator=(const QueryCache &other);
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_QUERY_CACHE_HPP__
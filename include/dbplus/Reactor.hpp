@@ -0,0 +1,203 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_REACTOR_HPP__
+#define __DB_PLUS_REACTOR_HPP__
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <dbplus/Database.hpp>
+#include <dbplus/Dbplus.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+class ReactorBackend;
+
+/*! \class Reactor
+ *  \brief Event loop that multiplexes many connections in one thread.
+ *
+ * The reactor owns a set of connections, waits for their sockets with
+ * epoll (or io_uring when compiled with DBPLUS_IO_URING) and drives
+ * the asynchronous operations of each one. Queries can be submitted
+ * from any thread, but the callbacks are always called from the
+ * thread that is running the loop.
+ */
+class Reactor
+{
+public:
+	/*! \class Backend
+	 *  \brief Possible mechanisms to wait for the sockets
+	 */
+	class Backend
+	{
+	public:
+		/*! List all backends
+		 */
+		enum Value {
+			EPOLL,
+			IO_URING
+		};
+	};
+
+	/*! Constructor.
+	 *
+	 * @param backend Mechanism used to wait for the sockets
+	 * @throw DatabaseException if the backend could not be created
+	 */
+	explicit Reactor(const Backend::Value backend = Backend::EPOLL);
+
+	/*! Destructor. Pending queries are not executed.
+	 */
+	~Reactor();
+
+	/*! Add a connected database to the reactor. The connection must not
+	 * be used by other threads while the reactor owns it. Must be
+	 * called before running the loop or from the loop thread.
+	 *
+	 * @param connection Connected database
+	 */
+	void addConnection(std::shared_ptr<Database> connection);
+
+	/*! Execute a query in the first idle connection. Thread safe.
+	 *
+	 * @param query SQL query
+	 * @param callback Function called in the loop thread when the
+	 * query finishes
+	 */
+	void execute(const string &query, Database::AsyncCallback callback);
+
+	/*! Execute a query in a specific connection, after the other
+	 * queries sent to this connection. Used when many queries must run
+	 * in the same session, like in transactions. Thread safe.
+	 *
+	 * @param connection Connection owned by the reactor
+	 * @param query SQL query
+	 * @param callback Function called in the loop thread when the
+	 * query finishes. Receives a DatabaseException if the connection
+	 * is not in the reactor
+	 */
+	void execute(std::shared_ptr<Database> connection,
+	             const string &query,
+	             Database::AsyncCallback callback);
+
+	/*! Commit the transaction of a specific connection, after the
+	 * other queries sent to this connection. Thread safe.
+	 *
+	 * @param connection Connection owned by the reactor
+	 * @param callback Function called in the loop thread when the
+	 * commit finishes
+	 * @see Database::commitAsync
+	 */
+	void commit(std::shared_ptr<Database> connection,
+	            Database::AsyncCallback callback);
+
+	/*! Rollback the transaction of a specific connection, after the
+	 * other queries sent to this connection. Thread safe.
+	 *
+	 * @param connection Connection owned by the reactor
+	 * @param callback Function called in the loop thread when the
+	 * rollback finishes
+	 * @see Database::rollbackAsync
+	 */
+	void rollback(std::shared_ptr<Database> connection,
+	              Database::AsyncCallback callback);
+
+	/*! Run one iteration of the loop, waiting for sockets events.
+	 *
+	 * @param timeout Maximum time to wait in milliseconds, -1 waits
+	 * forever
+	 * @return Number of queries that finished in this iteration
+	 */
+	unsigned int runOnce(const int timeout = -1);
+
+	/*! Run the loop until the stop method is called.
+	 */
+	void run();
+
+	/*! Stop the loop started by the run method. Thread safe.
+	 */
+	void stop();
+
+	/*! Returns the number of queries that were submitted and didn't
+	 * finish yet.
+	 *
+	 * @return Number of pending queries
+	 */
+	unsigned int pending() const;
+
+private:
+	/*! Starts an asynchronous operation in a connection
+	 */
+	typedef std::function<Database::AsyncStatus::Value 
+	                      (Database &database, 
+	                       Database::AsyncCallback callback)> Operation;
+
+	/*! Operation waiting for a connection
+	 */
+	struct Task {
+		Database *connection;
+		Operation operation;
+		Database::AsyncCallback callback;
+	};
+
+	/*! Connection owned by the reactor
+	 */
+	struct Connection {
+		std::shared_ptr<Database> database;
+		std::deque<Task> tasks;
+		bool busy;
+		bool registered;
+	};
+
+	void submit(Database *connection, 
+	            Operation operation, 
+	            Database::AsyncCallback callback);
+	void dispatch();
+	bool start(Connection &connection, Task &task);
+	void wait(Connection &connection, const Database::AsyncStatus::Value status);
+	void wakeUp();
+
+	std::unique_ptr<ReactorBackend> _backend;
+	int _wakeUp;
+
+	std::vector<std::shared_ptr<Connection> > _connections;
+	std::deque<Task> _tasks;
+	unsigned int _completed;
+
+	mutable std::mutex _submittedLock;
+	std::deque<Task> _submitted;
+	std::atomic<unsigned int> _pending;
+	std::atomic<bool> _running;
+
+private:
+	// Don't allow copying the object
+	Reactor(const Reactor &other);
+	Reactor& operator=(const Reactor &other);
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_REACTOR_HPP__
@@ -0,0 +1,771 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_REPLICATED_DATABASE_HPP__
+#define __DB_PLUS_REPLICATED_DATABASE_HPP__
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <dbplus/AsyncSet.hpp>
+#include <dbplus/ConnectionPool.hpp>
+#include <dbplus/Database.hpp>
+#include <dbplus/DatabaseException.hpp>
+#include <dbplus/Dbplus.hpp>
+#include <dbplus/Result.hpp>
+#include <dbplus/SqlInspector.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+/*! \class ReplicatedDatabase
+ *  \brief Splits reads and writes between a primary and its replicas.
+ *
+ * Read-only queries (SELECT, SHOW, EXPLAIN and DESCRIBE without
+ * locking clauses) in AUTO_COMMIT mode are sent to the replica pool
+ * with less connections in use. Everything else, and all queries of a
+ * MANUAL_COMMIT transaction, go to the primary. Connections are
+ * borrowed from the pools for each query and returned when the result
+ * is destroyed.
+ *
+ * Optionally, reads are hedged: when a replica takes longer than a
+ * percentile of the recent reads, the same query is sent to a second
+ * replica, the first answer is used and the other query is cancelled.
+ *
+ * Like the drivers, an object must not be used by many threads at the
+ * same time (except for the cancel method). Create one object per
+ * thread over the same pools.
+ *
+ * @tparam Driver Database driver (MySql or PostgresSql)
+ */
+template<class Driver>
+class ReplicatedDatabase : public Database
+{
+public:
+	typedef ConnectionPool<Driver> Pool;
+
+	/*! Constructor.
+	 *
+	 * @param primary Pool of connections to the primary server
+	 * @param replicas Pools of connections to the replicas
+	 */
+	explicit ReplicatedDatabase(std::shared_ptr<Pool> primary,
+	                            const std::vector<std::shared_ptr<Pool> > &replicas =
+	                            std::vector<std::shared_ptr<Pool> >()) :
+		_primary(primary),
+		_replicas(replicas),
+		_next(0),
+		_transactionMode(TransactionMode::AUTO_COMMIT),
+		_readYourWrites(0),
+		_affectedRows(0),
+		_hedgePercentile(0),
+		_latencyIndex(0),
+		_asyncDone(false),
+		_asyncStatus(AsyncStatus::COMPLETE)
+	{
+	}
+
+	/*! Returns the connections to the pools. Uncommitted work is rolled
+	 * back.
+	 */
+	~ReplicatedDatabase()
+	{
+		disconnect();
+	}
+
+	/*! Add a replica to the read rotation.
+	 *
+	 * @param replica Pool of connections to the replica
+	 */
+	void addReplica(std::shared_ptr<Pool> replica)
+	{
+		_replicas.push_back(replica);
+	}
+
+	/*! Send reads to the primary for some time after a write made by
+	 * this object, so the replication lag doesn't hide the written
+	 * data. Disabled by default.
+	 *
+	 * @param window Time after a write that reads stay in the primary,
+	 * zero disables it
+	 */
+	void setReadYourWrites(const std::chrono::milliseconds window)
+	{
+		_readYourWrites = window;
+	}
+
+	/*! Send reads to a second replica when the first one doesn't answer
+	 * in the given percentile of the latency of recent reads. Hedging
+	 * starts after some reads are measured and needs at least two
+	 * replicas. Disabled by default.
+	 *
+	 * @param percentile Percentile of the latency (like 95) used as the
+	 * delay before the second read, zero disables it
+	 */
+	void setHedging(const double percentile)
+	{
+		_hedgePercentile = percentile;
+	}
+
+	/*! Connections are opened by the pools.
+	 *
+	 * @throw DatabaseException always
+	 */
+	void connect(const string &database,
+	             const string &user,
+	             const string &password,
+	             const string &server,
+	             const unsigned int port = 3306)
+	{
+		throw DATABASE_EXCEPTION(DatabaseException::CONNECTION_ERROR,
+		                         "Connections are managed by the pools");
+	}
+
+	/*! Connections are opened by the pools.
+	 *
+	 * @throw DatabaseException always
+	 */
+	AsyncStatus::Value connectAsync(const string &database,
+	                                const string &user,
+	                                const string &password,
+	                                const string &server,
+	                                const unsigned int port,
+	                                AsyncCallback callback)
+	{
+		throw DATABASE_EXCEPTION(DatabaseException::CONNECTION_ERROR,
+		                         "Connections are managed by the pools");
+	}
+
+	/*! Return all borrowed connections to the pools. An open
+	 * transaction is rolled back.
+	 */
+	void disconnect()
+	{
+		drain(true);
+		_lastWrite.reset();
+		_transaction.reset();
+		_transactionMode = TransactionMode::AUTO_COMMIT;
+	}
+
+	/*! Check if the primary is alive.
+	 *
+	 * @return True if the primary answered, false otherwise
+	 */
+	bool ping()
+	{
+		try {
+			if (_transaction) {
+				return (*_transaction)->ping();
+			}
+
+			return _primary->acquire()->ping();
+		} catch (const DatabaseException &e) {
+			return false;
+		}
+	}
+
+	/*! In MANUAL_COMMIT mode a primary connection is borrowed and used
+	 * by all queries until the mode changes back to AUTO_COMMIT.
+	 *
+	 * @param mode Transaction mode
+	 * @throw DatabaseException if the connection could not be borrowed
+	 */
+	void setTransactionMode(const TransactionMode::Value mode)
+	{
+		if (mode == TransactionMode::MANUAL_COMMIT && !_transaction) {
+			std::shared_ptr<typename Pool::Lease> transaction(
+				new typename Pool::Lease(_primary->acquire()));
+			(*transaction)->setTransactionMode(mode);
+
+			_lastWrite.reset();
+			_transaction = transaction;
+
+		} else if (mode == TransactionMode::AUTO_COMMIT && _transaction) {
+			// The driver persists the open transaction when leaving the
+			// MANUAL_COMMIT mode
+			(*_transaction)->setTransactionMode(mode);
+			_transaction.reset();
+			written();
+		}
+
+		_transactionMode = mode;
+	}
+
+	TransactionMode::Value getTransactionMode() const
+	{
+		return _transactionMode;
+	}
+
+	void commit()
+	{
+		if (_transaction) {
+			(*_transaction)->commit();
+			written();
+		}
+	}
+
+	void rollback()
+	{
+		if (_transaction) {
+			(*_transaction)->rollback();
+		}
+	}
+
+	using Database::escape;
+
+	string escape(const string &value)
+	{
+		if (_transaction) {
+			return (*_transaction)->escape(value);
+		}
+
+		return _primary->acquire()->escape(value);
+	}
+
+	/*! Execute a SQL query in the primary or in a replica. The result
+	 * keeps the connection borrowed until it is destroyed.
+	 *
+	 * @param query SQL query
+	 * @param resultMode Define where the result is going to be stored
+	 * @return Result object with all the dataset
+	 * @throw DatabaseException on connection or execution error
+	 */
+	std::shared_ptr<Result>
+	execute(const string &query,
+	        const ResultMode::Value resultMode = ResultMode::STORE_RESULT)
+	{
+		int replica = -1;
+		SharedLease lease = route(query, &replica);
+
+		if (replica >= 0 && _hedgePercentile > 0 &&
+		    resultMode == ResultMode::STORE_RESULT) {
+			return hedge(query, lease, replica);
+		}
+
+		running(lease->get());
+		std::shared_ptr<Result> result;
+		try {
+			result = (*lease)->execute(query, resultMode);
+		} catch (const DatabaseException &e) {
+			running(NULL);
+			throw;
+		}
+
+		running(NULL);
+		_affectedRows = (*lease)->affectedRows();
+		return Pool::attach(result, lease);
+	}
+
+	using Database::execute;
+
+	/*! Stop the query running in the connection used by this object.
+	 * Can be called from another thread.
+	 *
+	 * @throw DatabaseException if the request could not be sent
+	 */
+	void cancel()
+	{
+		std::lock_guard<std::mutex> lock(_runningLock);
+		for (Driver *driver : _running) {
+			driver->cancel();
+		}
+	}
+
+	using Database::executeAsync;
+
+	/*! Asynchronous version of the execute method. The connection is
+	 * borrowed until the query finishes, or until the result is
+	 * destroyed.
+	 *
+	 * @param query SQL query
+	 * @param callback Function called when the query finishes
+	 * @return What the connection is waiting for
+	 * @throw DatabaseException on connection error
+	 */
+	AsyncStatus::Value executeAsync(const string &query, AsyncCallback callback)
+	{
+		checkAsync();
+		return startAsync(route(query),
+		                  [query](Driver &driver, AsyncCallback callback) {
+			                  return driver.executeAsync(query, callback);
+		                  },
+		                  callback);
+	}
+
+	AsyncStatus::Value commitAsync(AsyncCallback callback)
+	{
+		checkAsync();
+		if (!_transaction) {
+			callback(std::shared_ptr<Result>(), std::exception_ptr());
+			return AsyncStatus::COMPLETE;
+		}
+
+		written();
+		return startAsync(_transaction,
+		                  [](Driver &driver, AsyncCallback callback) {
+			                  return driver.commitAsync(callback);
+		                  },
+		                  callback);
+	}
+
+	AsyncStatus::Value rollbackAsync(AsyncCallback callback)
+	{
+		checkAsync();
+		if (!_transaction) {
+			callback(std::shared_ptr<Result>(), std::exception_ptr());
+			return AsyncStatus::COMPLETE;
+		}
+
+		return startAsync(_transaction,
+		                  [](Driver &driver, AsyncCallback callback) {
+			                  return driver.rollbackAsync(callback);
+		                  },
+		                  callback);
+	}
+
+	AsyncStatus::Value poll()
+	{
+		if (!_async) {
+			return AsyncStatus::COMPLETE;
+		}
+
+		_asyncStatus = (*_async)->poll();
+		return finishAsync();
+	}
+
+	/*! Returns the socket of the connection running the asynchronous
+	 * operation.
+	 *
+	 * @return Socket file descriptor or -1 when there's no operation
+	 */
+	int getSocket() const
+	{
+		return _async ? (*_async)->getSocket() : -1;
+	}
+
+	unsigned long long affectedRows()
+	{
+		return _affectedRows;
+	}
+
+	/*! Returns the last inserted id. The primary connection of the
+	 * last write stays borrowed until the next query, so the id can be
+	 * retrieved from the same session.
+	 *
+	 * @return Last inserted id
+	 */
+	unsigned long long lastInsertedId()
+	{
+		if (_transaction) {
+			return (*_transaction)->lastInsertedId();
+		}
+
+		return _lastWrite ? (*_lastWrite)->lastInsertedId() : 0;
+	}
+
+	/*! Check if a query can be answered by a replica.
+	 *
+	 * @param query SQL query
+	 * @return True for queries that don't change data
+	 * @see SqlInspector::isReadOnly
+	 */
+	static bool isReadOnly(const string &query)
+	{
+		return SqlInspector::isReadOnly(query);
+	}
+
+private:
+	typedef std::shared_ptr<typename Pool::Lease> SharedLease;
+
+	/*! Starts an asynchronous operation in a borrowed connection
+	 */
+	typedef std::function<AsyncStatus::Value
+	                      (Driver &driver, AsyncCallback callback)> Operation;
+
+	/*! Read sent to a replica by the hedging
+	 */
+	struct Attempt {
+		SharedLease lease;
+		std::shared_ptr<Result> result;
+		std::exception_ptr error;
+		bool done;
+	};
+
+	SharedLease route(const string &query, int *replica = NULL)
+	{
+		drain(false);
+
+		if (_transaction) {
+			return _transaction;
+		}
+
+		// The session of the last write is kept only until the next query
+		_lastWrite.reset();
+
+		bool readOnly = isReadOnly(query);
+		if (readOnly && _replicas.empty() == false && recentlyWritten() == false) {
+			unsigned int chosen = choose(-1);
+			try {
+				SharedLease lease(new typename Pool::Lease(_replicas[chosen]->acquire()));
+				if (replica != NULL) {
+					*replica = chosen;
+				}
+
+				return lease;
+			} catch (const DatabaseException &e) {
+				// An unavailable replica doesn't stop the reads, the primary
+				// answers them
+			}
+		}
+
+		SharedLease lease(new typename Pool::Lease(_primary->acquire()));
+		if (readOnly == false) {
+			_lastWrite = lease;
+			written();
+		}
+
+		return lease;
+	}
+
+	unsigned int choose(const int excluded)
+	{
+		// Least outstanding requests, starting from a different replica
+		// each time so ties are balanced
+		unsigned int start = _next++ % _replicas.size();
+		int chosen = -1;
+		unsigned int leased = 0;
+
+		for (unsigned int i = 0; i < _replicas.size(); i++) {
+			int current = (start + i) % _replicas.size();
+			if (current == excluded) {
+				continue;
+			}
+
+			unsigned int currentLeased = _replicas[current]->leased();
+			if (chosen < 0 || currentLeased < leased) {
+				chosen = current;
+				leased = currentLeased;
+			}
+
+			if (leased == 0) {
+				break;
+			}
+		}
+
+		return chosen;
+	}
+
+	std::shared_ptr<Result> hedge(const string &query,
+	                              SharedLease lease,
+	                              const unsigned int replica)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		int delay = hedgeDelay();
+
+		std::vector<std::shared_ptr<Attempt> > attempts;
+		attempts.push_back(std::shared_ptr<Attempt>(new Attempt()));
+		attempts[0]->lease = lease;
+
+		AsyncSet set;
+		send(query, *attempts[0], set);
+
+		if (attempts[0]->done == false && delay >= 0 && _replicas.size() > 1) {
+			try {
+				set.waitAll(delay);
+			} catch (const DatabaseException &e) {
+				if (e.getCode() != DatabaseException::TIMEOUT_ERROR) {
+					throw;
+				}
+			}
+
+			if (attempts[0]->done == false) {
+				try {
+					unsigned int other = choose(replica);
+					std::shared_ptr<Attempt> attempt(new Attempt());
+					attempt->lease.reset(new typename Pool::Lease(_replicas[other]->acquire()));
+					attempts.push_back(attempt);
+					send(query, *attempt, set);
+				} catch (const DatabaseException &e) {
+					// Without a second replica the first one is awaited
+				}
+			}
+		}
+
+		std::shared_ptr<Attempt> winner;
+		while (!winner) {
+			for (auto attempt : attempts) {
+				if (attempt->done) {
+					winner = attempt;
+					break;
+				}
+			}
+
+			if (!winner) {
+				set.waitOnce();
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_runningLock);
+			_running.clear();
+		}
+
+		// The slower read is cancelled and its connection is drained in
+		// the next calls, so the answer isn't delayed
+		for (auto attempt : attempts) {
+			if (attempt != winner && attempt->done == false) {
+				try {
+					(*attempt->lease)->cancel();
+				} catch (const DatabaseException &e) {
+					// The query will finish by itself
+				}
+
+				_losers.push_back(attempt);
+			}
+		}
+
+		measure(std::chrono::steady_clock::now() - start);
+
+		if (winner->error) {
+			std::rethrow_exception(winner->error);
+		}
+
+		_affectedRows = (*winner->lease)->affectedRows();
+		return Pool::attach(winner->result, winner->lease);
+	}
+
+	void send(const string &query, Attempt &attempt, AsyncSet &set)
+	{
+		attempt.done = false;
+
+		Driver &driver = **attempt.lease;
+		{
+			std::lock_guard<std::mutex> lock(_runningLock);
+			_running.push_back(&driver);
+		}
+
+		try {
+			set.add(driver, driver.executeAsync(
+				query,
+				[&attempt](std::shared_ptr<Result> result, std::exception_ptr error) {
+					attempt.result = result;
+					attempt.error = error;
+					attempt.done = true;
+				}));
+		} catch (const DatabaseException &e) {
+			attempt.error = std::current_exception();
+			attempt.done = true;
+		}
+	}
+
+	void drain(const bool wait)
+	{
+		if (_losers.empty()) {
+			return;
+		}
+
+		AsyncSet set;
+		std::vector<std::shared_ptr<Attempt> > losers;
+
+		for (auto loser : _losers) {
+			AsyncStatus::Value status = (*loser->lease)->poll();
+			if (status != AsyncStatus::COMPLETE) {
+				set.add(**loser->lease, status);
+				losers.push_back(loser);
+			}
+		}
+
+		// The cancelled reads are waited for as long as the hedging
+		// delay, the ones still running are closed instead of returning
+		// to the pool with a query in flight
+		if (wait) {
+			try {
+				set.waitAll(std::max(hedgeDelay(), 1));
+			} catch (const DatabaseException &e) {
+				// Handled below with the pending reads
+			}
+
+			for (auto loser : losers) {
+				if (set.pending(**loser->lease)) {
+					loser->lease->discard();
+				}
+			}
+
+			losers.clear();
+		}
+
+		_losers.swap(losers);
+	}
+
+	void measure(const std::chrono::steady_clock::duration latency)
+	{
+		long microseconds = std::chrono::duration_cast<std::chrono::microseconds>
+			(latency).count();
+
+		if (_latencies.size() < LATENCY_SAMPLES) {
+			_latencies.push_back(microseconds);
+		} else {
+			_latencies[_latencyIndex] = microseconds;
+			_latencyIndex = (_latencyIndex + 1) % LATENCY_SAMPLES;
+		}
+	}
+
+	int hedgeDelay() const
+	{
+		if (_latencies.size() < MIN_LATENCY_SAMPLES) {
+			return -1;
+		}
+
+		std::vector<long> latencies(_latencies);
+		unsigned int position = std::min<unsigned int>(
+			latencies.size() * std::min(_hedgePercentile, 100.0) / 100,
+			latencies.size() - 1);
+		std::nth_element(latencies.begin(), latencies.begin() + position, latencies.end());
+
+		// Rounded up, as poll works with milliseconds
+		return (latencies[position] + 999) / 1000;
+	}
+
+	void running(Driver *driver)
+	{
+		std::lock_guard<std::mutex> lock(_runningLock);
+		_running.clear();
+		if (driver != NULL) {
+			_running.push_back(driver);
+		}
+	}
+
+	void written()
+	{
+		_lastWriteTime = std::chrono::steady_clock::now();
+	}
+
+	bool recentlyWritten() const
+	{
+		return _readYourWrites.count() > 0 &&
+			std::chrono::steady_clock::now() - _lastWriteTime < _readYourWrites;
+	}
+
+	void checkAsync() const
+	{
+		if (_async) {
+			throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR,
+			                         "Asynchronous operation already in progress");
+		}
+	}
+
+	AsyncStatus::Value startAsync(SharedLease lease,
+	                              Operation operation,
+	                              AsyncCallback callback)
+	{
+		_async = lease;
+		_asyncCallback = callback;
+		_asyncDone = false;
+		running(lease->get());
+
+		try {
+			Driver &driver = **lease;
+			_asyncStatus = operation(driver,
+			  [this, &driver](std::shared_ptr<Result> result, std::exception_ptr error) {
+				  _asyncResult = result;
+				  _asyncError = error;
+				  _asyncDone = true;
+				  _affectedRows = driver.affectedRows();
+			  });
+		} catch (const DatabaseException &e) {
+			running(NULL);
+			_async.reset();
+			_asyncCallback = AsyncCallback();
+			throw;
+		}
+
+		return finishAsync();
+	}
+
+	AsyncStatus::Value finishAsync()
+	{
+		if (_asyncDone == false) {
+			return _asyncStatus;
+		}
+
+		// The connection only returns to the pool after the driver left
+		// the poll method
+		std::shared_ptr<Result> result = Pool::attach(_asyncResult, _async);
+		std::exception_ptr error = _asyncError;
+		AsyncCallback callback = _asyncCallback;
+
+		running(NULL);
+		_async.reset();
+		_asyncResult.reset();
+		_asyncError = std::exception_ptr();
+		_asyncCallback = AsyncCallback();
+		_asyncDone = false;
+
+		if (callback) {
+			callback(result, error);
+		}
+
+		// The callback can start a new operation
+		return _async ? _asyncStatus : AsyncStatus::COMPLETE;
+	}
+
+	static const unsigned int LATENCY_SAMPLES = 256;
+	static const unsigned int MIN_LATENCY_SAMPLES = 16;
+
+	std::shared_ptr<Pool> _primary;
+	std::vector<std::shared_ptr<Pool> > _replicas;
+	unsigned int _next;
+
+	TransactionMode::Value _transactionMode;
+	SharedLease _transaction;
+	SharedLease _lastWrite;
+	std::chrono::milliseconds _readYourWrites;
+	std::chrono::steady_clock::time_point _lastWriteTime;
+	unsigned long long _affectedRows;
+
+	double _hedgePercentile;
+	std::vector<long> _latencies;
+	unsigned int _latencyIndex;
+	std::vector<std::shared_ptr<Attempt> > _losers;
+
+	std::mutex _runningLock;
+	std::vector<Driver*> _running;
+
+	SharedLease _async;
+	AsyncCallback _asyncCallback;
+	std::shared_ptr<Result> _asyncResult;
+	std::exception_ptr _asyncError;
+	bool _asyncDone;
+	AsyncStatus::Value _asyncStatus;
+
+private:
+	// Don't allow copying the object
+	ReplicatedDatabase(const ReplicatedDatabase &other);
+	ReplicatedDatabase& operator=(const ReplicatedDatabase &other);
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_REPLICATED_DATABASE_HPP__
@@ -20,14 +20,17 @@
 #ifndef __DB_PLUS_RESULT_HPP__
 #define __DB_PLUS_RESULT_HPP__
 
+#include <functional>
 #include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <boost/any.hpp>
 
 #include <dbplus/DatabaseException.hpp>
 #include <dbplus/Dbplus.hpp>
+#include <dbplus/RowBlock.hpp>
 
 using std::string;
 
@@ -41,6 +44,14 @@ DBPLUS_NS_BEGIN
 class Result
 {
 public:
+	/*! Constructor.
+	 */
+	Result() {}
+
+	/*! Destructor.
+	 */
+	virtual ~Result() {}
+
 	/*! Returns the number of rows found in result.
 	 *
 	 * @return Number of rows in result
@@ -53,6 +64,61 @@ public:
 	 */
 	virtual bool fetch() = 0;
 
+	/*! \class FetchAwaitable
+	 *  \brief Awaitable version of the fetch method.
+	 *
+	 * Results of asynchronous queries are stored in client side, so
+	 * moving to the next row never waits for the database.
+	 */
+	class FetchAwaitable
+	{
+	public:
+		/*! Constructor.
+		 *
+		 * @param result Result that is going to be fetched
+		 */
+		explicit FetchAwaitable(Result &result) : _result(result) {}
+
+		/*! The row is always available.
+		 *
+		 * @return Always true
+		 */
+		bool await_ready() const
+		{
+			return true;
+		}
+
+		/*! Never called, as the row is always available.
+		 *
+		 * @tparam Handle Coroutine handle type
+		 */
+		template<class Handle>
+		void await_suspend(Handle) const
+		{
+		}
+
+		/*! Move to the next row.
+		 *
+		 * @return True if there's a next row, false otherwise
+		 */
+		bool await_resume()
+		{
+			return _result.fetch();
+		}
+
+	private:
+		Result &_result;
+	};
+
+	/*! Move to the next row inside a coroutine (co_await).
+	 *
+	 * @return Awaitable that returns true if there's a next row
+	 */
+	FetchAwaitable fetchAsync()
+	{
+		return FetchAwaitable(*this);
+	}
+
 	/*! Returns the value of a given column name.
 	 *
 	 * @param key Column name
@@ -60,6 +126,81 @@ public:
 	 */
 	virtual boost::any get(const string &key) const = 0;
 
+	/*! Returns all columns of the current row.
+	 *
+	 * @return Column values indexed by the column name
+	 */
+	virtual const std::map<string, boost::any>& getRow() const
+	{
+		return _row;
+	}
+
+	/*! Returns the column names, in the order of the query. Empty for
+	 * results that only know the columns of each row.
+	 *
+	 * @return Column names
+	 */
+	const std::vector<string>& getColumnNames() const;
+
+	/*! Returns true when the rows are kept as the text sent by the
+	 * server, so they can be read with fetchText.
+	 *
+	 * @return True if fetchText is supported
+	 */
+	virtual bool hasText() const;
+
+	/*! Returns true when the text of a column is a number, that can be
+	 * written without quotes.
+	 *
+	 * @param column Index of the column in getColumnNames
+	 * @return True for numeric columns
+	 */
+	virtual bool isNumber(const unsigned int column) const;
+
+	/*! Move to the next row without converting the values. The text
+	 * points to the memory of the driver and is only valid until the
+	 * next row. The values of get are not available for these rows.
+	 *
+	 * @param values Text of each column, NULL for NULL values
+	 * @param sizes Number of bytes of each value
+	 * @return True if there's a next row, false otherwise
+	 * @throw DatabaseException if the result doesn't keep the text
+	 */
+	virtual bool fetchText(std::vector<const char*> &values,
+	                       std::vector<unsigned long> &sizes);
+
+	/*! Returns the text sent by the server for a column of the row
+	 * read by the last fetch.
+	 *
+	 * @param column Index of the column in getColumnNames
+	 * @param value Text of the value, NULL for NULL values. Only valid
+	 * until the next row
+	 * @param size Number of bytes of the value
+	 * @throw DatabaseException if the result doesn't keep the text or
+	 * there's no current row
+	 */
+	virtual void getText(const unsigned int column, 
+	                     const char *&value, 
+	                     unsigned long &size) const;
+
+	/*! Receives each batch of rows of forEachBatch
+	 */
+	typedef std::function<void (const RowBlock &block)> BatchCallback;
+
+	/*! Read the remaining rows in batches. The rows are decoded into
+	 * one block, that is reused by all batches, and the callback is
+	 * called once per batch instead of calling fetch and get for each
+	 * row and column. Results of the drivers decode the values straight
+	 * into the block.
+	 *
+	 * @param callback Function called with each batch, the block is
+	 * only valid during the call
+	 * @param batchSize Maximum number of rows of each batch
+	 * @throw DatabaseException on error
+	 */
+	virtual void forEachBatch(BatchCallback callback, 
+	                          const unsigned int batchSize = 1024);
+
 	/*! Find and convert the column data into some type.
 	 *
 	 * @tparam T Type of the data that is going to be returned
@@ -91,7 +232,7 @@ public:
 	template<class T> 
 	T get(T (*converter)(std::map<string, boost::any>)) const
 	{
-		return converter(_row);
+		return converter(getRow());
 	}
 
 	/*! Converts all rows into a list of objects.
@@ -114,7 +255,89 @@ public:
 	}
 
 protected:
+	/*! Move constructor, for results returned by value. The values of
+	 * the row keep their addresses, so the column slots stay valid.
+	 *
+	 * @param other Result that is moved, left without rows
+	 */
+	Result(Result &&other) :
+		_row(std::move(other._row)),
+		_columnNames(std::move(other._columnNames)),
+		_columnValues(std::move(other._columnValues)),
+		_recycled(std::move(other._recycled))
+	{
+	}
+
+	/*! Sets the columns of the rows that are going to be stored with
+	 * the store methods. The values of the current row are kept to be
+	 * reused by the next rows.
+	 *
+	 * @param names Column names, in the order of the result
+	 */
+	void setColumns(const std::vector<string> &names);
+
+	/*! Stores a value in the current row. The value of the column in
+	 * the previous row is overwritten when it has the same type, so no
+	 * memory is allocated.
+	 *
+	 * @tparam T Type of the value
+	 * @param column Index of the column
+	 * @param value Value of the column
+	 */
+	template<class T>
+	void storeValue(const unsigned int column, const T &value)
+	{
+		boost::any &slot = columnValue(column);
+
+		T *current = boost::any_cast<T>(&slot);
+		if (current != NULL) {
+			*current = value;
+		} else {
+			slot = value;
+		}
+	}
+
+	/*! Stores a text in the current row, reusing the memory of the
+	 * text of the previous row.
+	 *
+	 * @param column Index of the column
+	 * @param data Text
+	 * @param size Number of bytes of the text
+	 */
+	void storeString(const unsigned int column, 
+	                 const char *data, 
+	                 const unsigned long size);
+
+	/*! Stores binary data in the current row, reusing the memory of
+	 * the data of the previous row.
+	 *
+	 * @param column Index of the column
+	 * @param data Binary data
+	 * @param size Number of bytes of the data
+	 */
+	void storeBinary(const unsigned int column, 
+	                 const unsigned char *data, 
+	                 const unsigned long size);
+
+	/*! Removes a column from the current row, like NULL values.
+	 *
+	 * @param column Index of the column
+	 */
+	void storeNull(const unsigned int column);
+
+	/*! Empties the current row after the last one. The values are kept
+	 * to be reused when the object is filled again.
+	 */
+	void clearRow();
+
 	std::map<string, boost::any> _row;
+
+private:
+	boost::any& columnValue(const unsigned int column);
+
+	std::vector<string> _columnNames;
+	std::vector<boost::any*> _columnValues;
+	std::map<string, boost::any> _recycled;
 };
 
 DBPLUS_NS_END
@@ -0,0 +1,153 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_RESULT_EXPORTER_HPP__
+#define __DB_PLUS_RESULT_EXPORTER_HPP__
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <dbplus/Dbplus.hpp>
+#include <dbplus/Result.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+/*! \class ResultExporter
+ *  \brief Writes results as CSV or JSON Lines.
+ *
+ * Results that keep the text sent by the server (MySQL and
+ * PostgreSQL) are written from the memory of the driver, without
+ * converting the values: each value is scanned 16 bytes at a time for
+ * the characters that must be escaped and the values that don't need
+ * escaping are copied as they are. Big values are not copied at all,
+ * they are sent with writev together with the buffered text. The
+ * buffer is written every 64 KB, so with USE_RESULT or a memory limit
+ * the export runs in constant memory.
+ *
+ * Other results are converted with SqlValue::appendPlain.
+ */
+class ResultExporter
+{
+public:
+	/*! \class Format
+	 *  \brief Possible output formats
+	 */
+	class Format
+	{
+	public:
+		/*! List all formats
+		 */
+		enum Value {
+			CSV,
+			JSON_LINES
+		};
+	};
+
+	/*! Receives the exported text, in pieces
+	 */
+	typedef std::function<void (const char *data, 
+	                            const unsigned long size)> Sink;
+
+	/*! Constructor for a file descriptor.
+	 *
+	 * @param descriptor Open file descriptor, that is not closed by
+	 * the exporter
+	 * @param format Output format
+	 */
+	ResultExporter(const int descriptor, const Format::Value format);
+
+	/*! Constructor for a function that receives the text.
+	 *
+	 * @param sink Function called with each piece of text
+	 * @param format Output format
+	 */
+	ResultExporter(Sink sink, const Format::Value format);
+
+	/*! Defines if the CSV output starts with the column names. The
+	 * default is true.
+	 *
+	 * @param header True to write the column names
+	 */
+	void setHeader(const bool header);
+
+	/*! Write the remaining rows of a result. In CSV, NULL values are
+	 * empty fields and empty texts are "". In JSON Lines each row is an
+	 * object, with numbers without quotes and NULL values as null.
+	 * Binary values are written as received.
+	 *
+	 * @param result Result that is going to be written, it's fetched
+	 * until the end
+	 * @return Number of rows written
+	 * @throw DatabaseException if the output could not be written or a
+	 * type is not supported
+	 */
+	unsigned long long write(Result &result);
+
+	/*! Size of the buffer that is written at once
+	 */
+	static const unsigned long BUFFER_SIZE = 65536;
+
+	/*! Values with this size or bigger are sent from the memory of the
+	 * driver instead of being copied to the buffer
+	 */
+	static const unsigned long BORROW_SIZE = 4096;
+
+private:
+	/*! Part of the output, in the buffer (data is NULL) or in the
+	 * memory of the driver
+	 */
+	struct Piece {
+		const char *data;
+		unsigned long offset;
+		unsigned long size;
+	};
+
+	void writeRow(const std::vector<const char*> &values,
+	              const std::vector<unsigned long> &sizes,
+	              const std::vector<bool> &numbers,
+	              const bool borrow);
+	void writeCsv(const char *value, const unsigned long size, const bool borrow);
+	void writeJson(const char *value, const unsigned long size, const bool borrow);
+	void appendValue(const char *value, const unsigned long size, const bool borrow);
+	void endRow();
+	void flush();
+	void send(const std::vector<Piece> &pieces);
+
+	int _descriptor;
+	Sink _sink;
+	Format::Value _format;
+	bool _header;
+
+	std::vector<string> _keys;
+	string _buffer;
+	unsigned long _bufferStart;
+	std::vector<Piece> _pieces;
+
+private:
+	// Don't allow copying the object
+	ResultExporter(const ResultExporter &other);
+	ResultExporter& operator=(const ResultExporter &other);
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_RESULT_EXPORTER_HPP__
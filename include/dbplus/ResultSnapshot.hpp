@@ -0,0 +1,142 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_RESULT_SNAPSHOT_HPP__
+#define __DB_PLUS_RESULT_SNAPSHOT_HPP__
+
+#include <cstdint>
+#include <string>
+
+#include <boost/any.hpp>
+
+#include <dbplus/Dbplus.hpp>
+#include <dbplus/Result.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+/*! \class ResultSnapshot
+ *  \brief Writes results in a columnar file that can be mapped in
+ *  memory.
+ *
+ * The file has a header, one descriptor per column and, for each
+ * column, a bitmap of NULL values and the values. Fixed size values
+ * are stored in one array and strings and binary values in a heap,
+ * with an array of offsets. All sections are aligned to 8 bytes and
+ * the numbers use the byte order of the machine, so the file is read
+ * by SnapshotResult straight from the mapping.
+ *
+ * Columns keep the C++ type returned by the driver. Columns that are
+ * missing in some rows, like NULL values in MySQL, are stored as NULL.
+ */
+class ResultSnapshot
+{
+public:
+	/*! \class Type
+	 *  \brief Types of the columns
+	 */
+	class Type
+	{
+	public:
+		/*! List all types
+		 */
+		enum Value {
+			UINT8 = 1,
+			SHORT,
+			INT,
+			UNSIGNED_INT,
+			LONG,
+			LONG_LONG,
+			FLOAT,
+			DOUBLE,
+			BOOL,
+			STRING,
+			BINARY,
+			DATE,
+			TIMESTAMP
+		};
+	};
+
+	/*! Beginning of the file
+	 */
+	struct FileHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t columns;
+		uint64_t rows;
+	};
+
+	/*! Describes a column and where its sections are in the file. The
+	 * values section has the offsets in the heap for strings and
+	 * binary values, one more than the number of rows
+	 */
+	struct ColumnHeader {
+		uint32_t type;
+		uint32_t nameSize;
+		uint64_t nameOffset;
+		uint64_t nullsOffset;
+		uint64_t valuesOffset;
+		uint64_t valuesSize;
+		uint64_t heapOffset;
+		uint64_t heapSize;
+	};
+
+	/*! Write the remaining rows of a result in a file. The file is
+	 * written with another name and renamed at the end, so readers
+	 * never see a partial file.
+	 *
+	 * @param result Result that is going to be written, it's fetched
+	 * until the end
+	 * @param path File name
+	 * @return Number of rows written
+	 * @throw DatabaseException if a type is not supported, a column has
+	 * values of different types or the file could not be written
+	 */
+	static unsigned long long write(Result &result, const string &path);
+
+	/*! Returns the size of the values of a type in the values section.
+	 *
+	 * @param type Column type
+	 * @return Size in bytes, zero for strings and binary values, that
+	 * are stored in the heap
+	 */
+	static unsigned int getWidth(const Type::Value type);
+
+	/*! First bytes of the file
+	 */
+	static const char MAGIC[8];
+
+	/*! Version of the format
+	 */
+	static const uint32_t VERSION = 1;
+
+private:
+	struct Column;
+
+	static Column newColumn(const string &name);
+	static Type::Value getType(const boost::any &value);
+	static void setType(Column &column, const Type::Value type);
+	static void append(Column &column, const boost::any &value);
+	static void appendNull(Column &column);
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_RESULT_SNAPSHOT_HPP__
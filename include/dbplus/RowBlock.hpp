@@ -0,0 +1,209 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_ROW_BLOCK_HPP__
+#define __DB_PLUS_ROW_BLOCK_HPP__
+
+#include <string>
+#include <vector>
+
+#include <boost/any.hpp>
+
+#include <dbplus/DatabaseException.hpp>
+#include <dbplus/Dbplus.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+/*! \class RowBlock
+ *  \brief Decoded values of a batch of rows, stored by column.
+ *
+ * Filled by the results in Result::forEachBatch. Each column has one
+ * vector of values and one vector of NULL flags, and the values stay
+ * in the block between batches, so values of the same type overwrite
+ * the previous ones without allocating memory.
+ */
+class RowBlock
+{
+public:
+	/*! Constructor.
+	 */
+	RowBlock();
+
+	/*! Returns the number of rows in the block.
+	 *
+	 * @return Number of rows
+	 */
+	unsigned int size() const
+	{
+		return _size;
+	}
+
+	/*! Returns the column names.
+	 *
+	 * @return Column names, in the order of the column indexes
+	 */
+	const std::vector<string>& getColumnNames() const;
+
+	/*! Returns the index of a column.
+	 *
+	 * @param name Column name
+	 * @return Column index or -1 if the column doesn't exist
+	 */
+	int getColumn(const string &name) const;
+
+	/*! Returns true if a value is NULL.
+	 *
+	 * @param row Row index
+	 * @param column Column index
+	 * @return True for NULL values
+	 */
+	bool isNull(const unsigned int row, const unsigned int column) const
+	{
+		return _nulls[column][row] != 0;
+	}
+
+	/*! Returns a value, that is meaningless for NULL values.
+	 *
+	 * @param row Row index
+	 * @param column Column index
+	 * @return Value
+	 */
+	const boost::any& get(const unsigned int row, const unsigned int column) const
+	{
+		return _values[column][row];
+	}
+
+	/*! Returns a value in its type.
+	 *
+	 * @tparam T Type of the value
+	 * @param row Row index
+	 * @param column Column index
+	 * @return Value
+	 * @throw DatabaseException if the value is NULL or has other type
+	 */
+	template<class T>
+	const T& get(const unsigned int row, const unsigned int column) const
+	{
+		const T *value = NULL;
+		if (isNull(row, column) == false) {
+			value = boost::any_cast<T>(&_values[column][row]);
+		}
+
+		if (value == NULL) {
+			throw DATABASE_EXCEPTION(DatabaseException::CONVERSION_ERROR, 
+			                         "Conversion error. "
+			                         "Data is NULL or in a different format");
+		}
+
+		return *value;
+	}
+
+	// Methods used by the results to fill the block
+
+	/*! Sets the columns and removes the rows.
+	 *
+	 * @param names Column names
+	 */
+	void reset(const std::vector<string> &names);
+
+	/*! Add a column, that is NULL in the rows already in the block.
+	 *
+	 * @param name Column name
+	 * @return Column index
+	 */
+	unsigned int addColumn(const string &name);
+
+	/*! Removes the rows, keeping the values to be reused.
+	 */
+	void clear();
+
+	/*! Add a row where all columns are NULL. The store methods write
+	 * in this row.
+	 */
+	void addRow();
+
+	/*! Stores a value in the last row.
+	 *
+	 * @tparam T Type of the value
+	 * @param column Column index
+	 * @param value Value of the column
+	 */
+	template<class T>
+	void storeValue(const unsigned int column, const T &value)
+	{
+		boost::any &slot = _values[column][_size - 1];
+
+		T *current = boost::any_cast<T>(&slot);
+		if (current != NULL) {
+			*current = value;
+		} else {
+			slot = value;
+		}
+
+		_nulls[column][_size - 1] = 0;
+	}
+
+	/*! Stores a value of any type in the last row.
+	 *
+	 * @param column Column index
+	 * @param value Value of the column, empty for NULL
+	 */
+	void storeValue(const unsigned int column, const boost::any &value);
+
+	/*! Stores a text in the last row.
+	 *
+	 * @param column Column index
+	 * @param data Text
+	 * @param size Number of bytes of the text
+	 */
+	void storeString(const unsigned int column, 
+	                 const char *data, 
+	                 const unsigned long size);
+
+	/*! Stores binary data in the last row.
+	 *
+	 * @param column Column index
+	 * @param data Binary data
+	 * @param size Number of bytes of the data
+	 */
+	void storeBinary(const unsigned int column, 
+	                 const unsigned char *data, 
+	                 const unsigned long size);
+
+	/*! Stores a NULL value in the last row.
+	 *
+	 * @param column Column index
+	 */
+	void storeNull(const unsigned int column)
+	{
+		_nulls[column][_size - 1] = 1;
+	}
+
+private:
+	std::vector<string> _names;
+	std::vector<std::vector<boost::any> > _values;
+	std::vector<std::vector<char> > _nulls;
+	unsigned int _size;
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_ROW_BLOCK_HPP__
@@ -0,0 +1,161 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_ROW_STORE_HPP__
+#define __DB_PLUS_ROW_STORE_HPP__
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <dbplus/Dbplus.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+/*! \class RowStore
+ *  \brief Raw values of the rows of a stored result, with a memory
+ *  limit.
+ *
+ * The values are stored as received from the server, each one with
+ * its size, in one buffer. When the buffer would pass the limit of the
+ * store or the global limit of all stores, the rows are moved to a
+ * temporary file (already removed from the directory) and the next
+ * rows are appended to it. After the last row the file is mapped in
+ * memory, so the rows are read in the same way from both places. Only
+ * the position of each row is always kept in memory.
+ */
+class RowStore
+{
+public:
+	/*! Constructor.
+	 *
+	 * @param memoryLimit Maximum number of bytes kept in memory by this
+	 * store, zero only applies the global limit
+	 */
+	explicit RowStore(const unsigned long memoryLimit = 0);
+
+	/*! Destructor. Releases the memory and the temporary file.
+	 */
+	~RowStore();
+
+	/*! Add a row. Must not be called after finish.
+	 *
+	 * @param values Values of the columns, NULL for NULL values
+	 * @param sizes Number of bytes of each value
+	 * @param columns Number of columns
+	 * @throw DatabaseException if the temporary file could not be
+	 * written
+	 */
+	void add(const char * const *values, 
+	         const unsigned long *sizes, 
+	         const unsigned int columns);
+
+	/*! Prepare the rows to be read, mapping the temporary file when the
+	 * rows were spilled.
+	 *
+	 * @throw DatabaseException if the file could not be mapped
+	 */
+	void finish();
+
+	/*! Returns the number of rows.
+	 *
+	 * @return Number of rows
+	 */
+	unsigned int size() const;
+
+	/*! Read the values of a row. Only valid after finish.
+	 *
+	 * @param row Index of the row
+	 * @param values Where the values are stored, NULL for NULL values.
+	 * They end with a zero and are valid while the store exists
+	 * @param sizes Where the sizes of the values are stored
+	 */
+	void get(const unsigned int row, 
+	         std::vector<const char*> &values, 
+	         std::vector<unsigned long> &sizes) const;
+
+	/*! Check if the rows were moved to a temporary file.
+	 *
+	 * @return True if the rows are in a file
+	 */
+	bool isSpilled() const;
+
+	/*! Returns the number of bytes of this store kept in memory.
+	 *
+	 * @return Bytes in memory
+	 */
+	unsigned long getMemory() const;
+
+	/*! Sets the maximum number of bytes kept in memory by all stores
+	 * together. Zero means no limit. Thread safe.
+	 *
+	 * @param limit Maximum number of bytes
+	 */
+	static void setGlobalLimit(const unsigned long limit);
+
+	/*! Returns the maximum number of bytes kept in memory by all
+	 * stores together. Thread safe.
+	 *
+	 * @return Maximum number of bytes, zero means no limit
+	 */
+	static unsigned long getGlobalLimit();
+
+	/*! Returns the number of bytes kept in memory by all live stores,
+	 * to be used as a metric. Thread safe.
+	 *
+	 * @return Bytes in memory
+	 */
+	static unsigned long getGlobalMemory();
+
+	/*! Size of the buffer used to write the temporary file
+	 */
+	static const unsigned long WRITE_BUFFER_SIZE = 64 * 1024;
+
+private:
+	bool reserve(const unsigned long bytes);
+	void release();
+	void spill();
+	void write();
+
+	unsigned long _memoryLimit;
+	unsigned long _memory;
+
+	string _buffer;
+	std::vector<unsigned long long> _offsets;
+	unsigned int _columns;
+
+	int _file;
+	unsigned long long _fileSize;
+	void *_mapping;
+	const char *_data;
+
+	static std::atomic<unsigned long> _globalLimit;
+	static std::atomic<unsigned long> _globalMemory;
+
+private:
+	// Don't allow copying the object
+	RowStore(const RowStore &other);
+	RowStore& operator=(const RowStore &other);
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_ROW_STORE_HPP__
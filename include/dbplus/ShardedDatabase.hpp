@@ -0,0 +1,659 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_SHARDED_DATABASE_HPP__
+#define __DB_PLUS_SHARDED_DATABASE_HPP__
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+
+#include <dbplus/AsyncSet.hpp>
+#include <dbplus/ConnectionPool.hpp>
+#include <dbplus/Database.hpp>
+#include <dbplus/DatabaseException.hpp>
+#include <dbplus/Dbplus.hpp>
+#include <dbplus/MergedResult.hpp>
+#include <dbplus/Result.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+/*! \class ShardedDatabase
+ *  \brief Database split across many servers (shards).
+ *
+ * Queries with a key are sent to the shard selected by the shard
+ * function. Queries without a key are sent to all shards at the same
+ * time, and the results are joined in a MergedResult, so the latency
+ * is the one of the slowest shard instead of the sum of all shards.
+ *
+ * Like the drivers, an object must not be used by many threads at the
+ * same time. Create one object per thread over the same pools.
+ *
+ * @tparam Driver Database driver (MySql or PostgresSql)
+ */
+template<class Driver>
+class ShardedDatabase : public Database
+{
+public:
+	typedef ConnectionPool<Driver> Pool;
+
+	/*! Select the shard of a key.
+	 *
+	 * @param key Shard key
+	 * @param shards Number of shards
+	 * @return Shard index, between zero and the number of shards
+	 */
+	typedef std::function<unsigned int (const string &key,
+	                                    const unsigned int shards)> ShardFunction;
+
+	/*! Constructor.
+	 *
+	 * @param shards Pool of connections of each shard
+	 * @param shardFunction Select the shard of a key, by default a
+	 * hash of the key
+	 */
+	explicit ShardedDatabase(const std::vector<std::shared_ptr<Pool> > &shards,
+	                         ShardFunction shardFunction = hash) :
+		_shards(shards),
+		_shardFunction(shardFunction),
+		_transactionMode(TransactionMode::AUTO_COMMIT),
+		_affectedRows(0)
+	{
+		if (_shards.empty()) {
+			throw DATABASE_EXCEPTION(DatabaseException::CONNECTION_ERROR,
+			                         "At least one shard is necessary");
+		}
+	}
+
+	/*! Returns the connections to the pools. Uncommitted work is rolled
+	 * back.
+	 */
+	~ShardedDatabase()
+	{
+		disconnect();
+	}
+
+	/*! Shard function that distributes the keys uniformly (FNV-1a
+	 * hash).
+	 *
+	 * @param key Shard key
+	 * @param shards Number of shards
+	 * @return Shard index
+	 */
+	static unsigned int hash(const string &key, const unsigned int shards)
+	{
+		uint64_t hash = 14695981039346656037ULL;
+		for (string::size_type i = 0; i < key.size(); i++) {
+			hash ^= static_cast<unsigned char>(key[i]);
+			hash *= 1099511628211ULL;
+		}
+
+		return hash % shards;
+	}
+
+	/*! Creates a shard function for numeric keys split in ranges. Keys
+	 * lower than the first bound go to the first shard, keys lower than
+	 * the second bound go to the second shard and so on. Bigger keys go
+	 * to the last shard.
+	 *
+	 * @param bounds Upper bound (exclusive) of each shard but the last,
+	 * in ascending order
+	 * @return Shard function
+	 */
+	static ShardFunction range(const std::vector<long long> &bounds)
+	{
+		return [bounds](const string &key, const unsigned int shards) {
+			long long value = 0;
+			try {
+				value = boost::lexical_cast<long long>(key);
+			} catch (const boost::bad_lexical_cast &e) {
+				throw DATABASE_EXCEPTION(DatabaseException::CONVERSION_ERROR,
+				                         "Shard key is not a number");
+			}
+
+			unsigned int shard = std::upper_bound(bounds.begin(), bounds.end(), value) -
+				bounds.begin();
+			return std::min(shard, shards - 1);
+		};
+	}
+
+	/*! Returns the number of shards.
+	 *
+	 * @return Number of shards
+	 */
+	unsigned int shards() const
+	{
+		return _shards.size();
+	}
+
+	/*! Returns the shard of a key.
+	 *
+	 * @param key Shard key
+	 * @return Shard index
+	 */
+	unsigned int shardOf(const string &key) const
+	{
+		unsigned int shard = _shardFunction(key, _shards.size());
+		if (shard >= _shards.size()) {
+			throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR,
+			                         "Shard function returned an invalid shard");
+		}
+
+		return shard;
+	}
+
+	/*! Connections are opened by the pools.
+	 *
+	 * @throw DatabaseException always
+	 */
+	void connect(const string &database,
+	             const string &user,
+	             const string &password,
+	             const string &server,
+	             const unsigned int port = 3306)
+	{
+		throw DATABASE_EXCEPTION(DatabaseException::CONNECTION_ERROR,
+		                         "Connections are managed by the pools");
+	}
+
+	/*! Connections are opened by the pools.
+	 *
+	 * @throw DatabaseException always
+	 */
+	AsyncStatus::Value connectAsync(const string &database,
+	                                const string &user,
+	                                const string &password,
+	                                const string &server,
+	                                const unsigned int port,
+	                                AsyncCallback callback)
+	{
+		throw DATABASE_EXCEPTION(DatabaseException::CONNECTION_ERROR,
+		                         "Connections are managed by the pools");
+	}
+
+	/*! Return all borrowed connections to the pools. An open
+	 * transaction is rolled back.
+	 */
+	void disconnect()
+	{
+		_transactions.clear();
+		_transactionMode = TransactionMode::AUTO_COMMIT;
+	}
+
+	/*! Check if all shards are alive.
+	 *
+	 * @return True if all shards answered, false otherwise
+	 */
+	bool ping()
+	{
+		try {
+			for (unsigned int i = 0; i < _shards.size(); i++) {
+				if ((*lease(i))->ping() == false) {
+					return false;
+				}
+			}
+		} catch (const DatabaseException &e) {
+			return false;
+		}
+
+		return true;
+	}
+
+	/*! In MANUAL_COMMIT mode one connection of each shard is borrowed
+	 * and used until the mode changes back to AUTO_COMMIT. Each shard
+	 * has its own transaction: a commit is not atomic across shards.
+	 *
+	 * @param mode Transaction mode
+	 * @throw DatabaseException if the connections could not be borrowed
+	 */
+	void setTransactionMode(const TransactionMode::Value mode)
+	{
+		if (mode == TransactionMode::MANUAL_COMMIT && _transactions.empty()) {
+			std::vector<SharedLease> transactions;
+			for (auto shard : _shards) {
+				transactions.push_back(SharedLease(new typename Pool::Lease(shard->acquire())));
+				(*transactions.back())->setTransactionMode(mode);
+			}
+
+			_transactions.swap(transactions);
+
+		} else if (mode == TransactionMode::AUTO_COMMIT && _transactions.empty() == false) {
+			for (auto transaction : _transactions) {
+				(*transaction)->setTransactionMode(mode);
+			}
+
+			_transactions.clear();
+		}
+
+		_transactionMode = mode;
+	}
+
+	TransactionMode::Value getTransactionMode() const
+	{
+		return _transactionMode;
+	}
+
+	void commit()
+	{
+		for (auto transaction : _transactions) {
+			(*transaction)->commit();
+		}
+	}
+
+	void rollback()
+	{
+		for (auto transaction : _transactions) {
+			(*transaction)->rollback();
+		}
+	}
+
+	using Database::escape;
+
+	string escape(const string &value)
+	{
+		return (*lease(0))->escape(value);
+	}
+
+	/*! Execute a SQL query in all shards at the same time. The rows are
+	 * concatenated in the order of the shards.
+	 *
+	 * @param query SQL query
+	 * @param resultMode Ignored, results are always stored in client
+	 * side
+	 * @return Result object with the rows of all shards, or an empty
+	 * pointer if no shard returned rows
+	 * @throw DatabaseException on connection or execution error
+	 */
+	std::shared_ptr<Result>
+	execute(const string &query,
+	        const ResultMode::Value resultMode = ResultMode::STORE_RESULT)
+	{
+		return executeAll(query);
+	}
+
+	/*! Execute a SQL query in all shards with a deadline. When the
+	 * deadline expires the queries are cancelled in all shards.
+	 *
+	 * @param query SQL query
+	 * @param timeout Maximum time to wait for all shards
+	 * @return Result object with the rows of all shards
+	 * @throw DatabaseException with TIMEOUT_ERROR code when the queries
+	 * were cancelled
+	 */
+	std::shared_ptr<Result> execute(const string &query, 
+	                                const std::chrono::milliseconds timeout)
+	{
+		return executeAll(query, MergedResult::Less(), timeout);
+	}
+
+	/*! Stop the queries running in all shards. Can be called from
+	 * another thread while executeAll is waiting.
+	 *
+	 * @throw DatabaseException with the first request that could not
+	 * be sent, after trying all shards
+	 */
+	void cancel()
+	{
+		std::exception_ptr failure;
+		{
+			std::lock_guard<std::mutex> lock(_runningLock);
+			for (Driver *driver : _running) {
+				try {
+					driver->cancel();
+				} catch (const DatabaseException &e) {
+					if (!failure) {
+						failure = std::current_exception();
+					}
+				}
+			}
+		}
+
+		if (failure) {
+			std::rethrow_exception(failure);
+		}
+	}
+
+	/*! Execute a SQL query in all shards at the same time.
+	 *
+	 * @param query SQL query
+	 * @param less When defined, each shard result must be sorted by this
+	 * function (ORDER BY) and the rows are merged keeping the order
+	 * @param timeout Maximum time to wait for all shards, negative
+	 * values wait forever
+	 * @return Result object with the rows of all shards, or an empty
+	 * pointer if no shard returned rows
+	 * @throw DatabaseException with the first error, after all shards
+	 * finished, or with TIMEOUT_ERROR code when the deadline expired.
+	 * On failure the running shards are cancelled and given the same
+	 * timeout to finish, the ones that don't are closed. In
+	 * MANUAL_COMMIT mode closing a shard rolls back the transactions
+	 * of all shards and changes the mode to AUTO_COMMIT
+	 * @see MergedResult::byColumn
+	 */
+	std::shared_ptr<Result> executeAll(const string &query,
+	                                   MergedResult::Less less = MergedResult::Less(),
+	                                   const std::chrono::milliseconds timeout = 
+	                                   std::chrono::milliseconds(-1))
+	{
+		std::vector<SharedLease> leases;
+		for (unsigned int i = 0; i < _shards.size(); i++) {
+			leases.push_back(lease(i));
+		}
+
+		std::vector<std::shared_ptr<Result> > results(_shards.size());
+		std::vector<std::exception_ptr> errors(_shards.size());
+		std::vector<unsigned long long> affectedRows(_shards.size(), 0);
+
+		AsyncSet set;
+		for (unsigned int i = 0; i < _shards.size(); i++) {
+			Driver &driver = **leases[i];
+			std::shared_ptr<Result> &result = results[i];
+			std::exception_ptr &error = errors[i];
+			unsigned long long &affected = affectedRows[i];
+
+			try {
+				set.add(driver, driver.executeAsync(
+					query,
+					[&driver, &result, &error, &affected]
+					(std::shared_ptr<Result> r, std::exception_ptr e) {
+						result = r;
+						error = e;
+						affected = driver.affectedRows();
+					}));
+			} catch (const DatabaseException &e) {
+				error = std::current_exception();
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_runningLock);
+			for (auto lease : leases) {
+				_running.push_back(lease->get());
+			}
+		}
+
+		// All shards must finish before the connections return to the
+		// pools, even when one of them failed or was cancelled
+		bool cancelled = false;
+		std::exception_ptr failure;
+		try {
+			set.waitAll(timeout.count() < 0 ? -1 : timeout.count());
+		} catch (const DatabaseException &e) {
+			if (e.getCode() == DatabaseException::TIMEOUT_ERROR) {
+				cancelled = true;
+			} else {
+				failure = std::current_exception();
+			}
+
+			drain(set, timeout);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_runningLock);
+			_running.clear();
+		}
+
+		// The callbacks of the shards still running write to this
+		// frame, so their connections are closed instead of reused
+		bool discarded = false;
+		for (auto lease : leases) {
+			if (set.pending(**lease)) {
+				lease->discard();
+				discarded = true;
+			}
+		}
+
+		// A closed connection loses its transaction, so the transactions
+		// of the other shards are rolled back when they return to the
+		// pools and the connection continues in AUTO_COMMIT mode
+		if (discarded && _transactions.empty() == false) {
+			_transactions.clear();
+			_transactionMode = TransactionMode::AUTO_COMMIT;
+		}
+
+		if (failure) {
+			std::rethrow_exception(failure);
+		}
+
+		if (cancelled) {
+			throw DATABASE_EXCEPTION(DatabaseException::TIMEOUT_ERROR,
+			                         "Queries cancelled after the deadline");
+		}
+
+		_affectedRows = 0;
+		bool empty = true;
+
+		for (unsigned int i = 0; i < _shards.size(); i++) {
+			if (errors[i]) {
+				std::rethrow_exception(errors[i]);
+			}
+
+			_affectedRows += affectedRows[i];
+			if (results[i]) {
+				results[i] = Pool::attach(results[i], leases[i]);
+				empty = false;
+			}
+		}
+
+		if (empty) {
+			return std::shared_ptr<Result>();
+		}
+
+		return std::shared_ptr<Result>(new MergedResult(results, less));
+	}
+
+	/*! Execute a SQL query in the shard of a key.
+	 *
+	 * @param key Shard key
+	 * @param query SQL query
+	 * @param resultMode Define where the result is going to be stored
+	 * @return Result object with all the dataset
+	 * @throw DatabaseException on connection or execution error
+	 */
+	std::shared_ptr<Result>
+	executeByKey(const string &key,
+	             const string &query,
+	             const ResultMode::Value resultMode = ResultMode::STORE_RESULT)
+	{
+		return executeInShard(shardOf(key), query, resultMode);
+	}
+
+	/*! Execute a SQL query in a specific shard.
+	 *
+	 * @param shard Shard index
+	 * @param query SQL query
+	 * @param resultMode Define where the result is going to be stored
+	 * @return Result object with all the dataset
+	 * @throw DatabaseException on connection or execution error
+	 */
+	std::shared_ptr<Result>
+	executeInShard(const unsigned int shard,
+	               const string &query,
+	               const ResultMode::Value resultMode = ResultMode::STORE_RESULT)
+	{
+		SharedLease connection = lease(shard);
+		std::shared_ptr<Result> result = (*connection)->execute(query, resultMode);
+		_affectedRows = (*connection)->affectedRows();
+		_lastInsertedId = connection;
+		return Pool::attach(result, connection);
+	}
+
+	using Database::executeAsync;
+
+	/*! Runs the query in all shards like the execute method. The
+	 * shards are queried in parallel, but the method only returns when
+	 * all of them finished.
+	 *
+	 * @param query SQL query
+	 * @param callback Function called before the method returns
+	 * @return Always COMPLETE
+	 */
+	AsyncStatus::Value executeAsync(const string &query, AsyncCallback callback)
+	{
+		std::shared_ptr<Result> result;
+		try {
+			result = executeAll(query);
+		} catch (const DatabaseException &e) {
+			callback(std::shared_ptr<Result>(), std::current_exception());
+			return AsyncStatus::COMPLETE;
+		}
+
+		callback(result, std::exception_ptr());
+		return AsyncStatus::COMPLETE;
+	}
+
+	/*! Commit all shards before returning.
+	 *
+	 * @param callback Function called before the method returns
+	 * @return Always COMPLETE
+	 */
+	AsyncStatus::Value commitAsync(AsyncCallback callback)
+	{
+		return finishTransaction(true, callback);
+	}
+
+	/*! Rollback all shards before returning.
+	 *
+	 * @param callback Function called before the method returns
+	 * @return Always COMPLETE
+	 */
+	AsyncStatus::Value rollbackAsync(AsyncCallback callback)
+	{
+		return finishTransaction(false, callback);
+	}
+
+	/*! Operations always finish before returning.
+	 *
+	 * @return Always COMPLETE
+	 */
+	AsyncStatus::Value poll()
+	{
+		return AsyncStatus::COMPLETE;
+	}
+
+	/*! There's no single socket for all shards.
+	 *
+	 * @return Always -1
+	 */
+	int getSocket() const
+	{
+		return -1;
+	}
+
+	/*! Returns the number of rows effected by the last query, in all
+	 * shards.
+	 *
+	 * @return Number of rows effected
+	 */
+	unsigned long long affectedRows()
+	{
+		return _affectedRows;
+	}
+
+	/*! Returns the last inserted id of the last query executed in a
+	 * single shard. That connection stays borrowed until the next
+	 * query.
+	 *
+	 * @return Last inserted id
+	 */
+	unsigned long long lastInsertedId()
+	{
+		return _lastInsertedId ? (*_lastInsertedId)->lastInsertedId() : 0;
+	}
+
+private:
+	typedef std::shared_ptr<typename Pool::Lease> SharedLease;
+
+	/*! Stop the shards still running after a failure and wait for
+	 * them. Errors are ignored, the shards that don't finish in time
+	 * stay pending in the set.
+	 */
+	void drain(AsyncSet &set, const std::chrono::milliseconds timeout)
+	{
+		try {
+			cancel();
+		} catch (const DatabaseException &e) {
+			// The shards are still waited for
+		}
+
+		try {
+			set.waitAll(timeout.count() < 0 ? -1 : timeout.count());
+		} catch (const DatabaseException &e) {
+			// Pending shards are discarded by the caller
+		}
+	}
+
+	SharedLease lease(const unsigned int shard)
+	{
+		// The session of the last insert is kept only until the next query
+		_lastInsertedId.reset();
+
+		if (_transactions.empty() == false) {
+			return _transactions[shard];
+		}
+
+		return SharedLease(new typename Pool::Lease(_shards[shard]->acquire()));
+	}
+
+	AsyncStatus::Value finishTransaction(const bool persist, AsyncCallback callback)
+	{
+		try {
+			if (persist) {
+				commit();
+			} else {
+				rollback();
+			}
+		} catch (const DatabaseException &e) {
+			callback(std::shared_ptr<Result>(), std::current_exception());
+			return AsyncStatus::COMPLETE;
+		}
+
+		callback(std::shared_ptr<Result>(), std::exception_ptr());
+		return AsyncStatus::COMPLETE;
+	}
+
+	std::vector<std::shared_ptr<Pool> > _shards;
+	ShardFunction _shardFunction;
+
+	TransactionMode::Value _transactionMode;
+	std::vector<SharedLease> _transactions;
+	SharedLease _lastInsertedId;
+	unsigned long long _affectedRows;
+
+	std::mutex _runningLock;
+	std::vector<Driver*> _running;
+
+private:
+	// Don't allow copying the object
+	ShardedDatabase(const ShardedDatabase &other);
+	ShardedDatabase& operator=(const ShardedDatabase &other);
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_SHARDED_DATABASE_HPP__
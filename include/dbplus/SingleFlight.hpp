@@ -0,0 +1,95 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_SINGLE_FLIGHT_HPP__
+#define __DB_PLUS_SINGLE_FLIGHT_HPP__
+
+#include <atomic>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <dbplus/Database.hpp>
+#include <dbplus/Dbplus.hpp>
+#include <dbplus/StoredResult.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+/*! \class SingleFlight
+ *  \brief Joins identical queries that are running at the same time.
+ *
+ * The first thread that executes a query runs it in its own
+ * connection, and the threads that execute the same query before it
+ * finishes wait and receive the same rows, without using their
+ * connections. The query is forgotten when it finishes, so the next
+ * execution reads fresh data. Thread safe, usually shared by all
+ * connections of a pool.
+ */
+class SingleFlight
+{
+public:
+	/*! Constructor.
+	 */
+	SingleFlight();
+
+	/*! Execute a query or wait for the same query that is already
+	 * running.
+	 *
+	 * @param database Connection used if the query is not running
+	 * @param query SQL query
+	 * @return Rows of the result, shared by all callers. NULL when the
+	 * query doesn't return rows
+	 * @throw DatabaseException on query errors, given to all callers
+	 */
+	std::shared_ptr<const StoredResult::Data> execute(Database &database, 
+	                                                  const string &query);
+
+	/*! Returns the number of queries that are running.
+	 *
+	 * @return Number of queries
+	 */
+	unsigned int running() const;
+
+	/*! Returns the number of executions that received the rows of a
+	 * query started by another caller.
+	 *
+	 * @return Number of joined executions
+	 */
+	unsigned long long getJoined() const;
+
+private:
+	typedef std::shared_future<std::shared_ptr<const StoredResult::Data> > Flight;
+
+	mutable std::mutex _lock;
+	std::map<string, Flight> _flights;
+	std::atomic<unsigned long long> _joined;
+
+private:
+	// Don't allow copying the object
+	SingleFlight(const SingleFlight &other);
+	SingleFlight& operator=(const SingleFlight &other);
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_SINGLE_FLIGHT_HPP__
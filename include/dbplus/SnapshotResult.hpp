@@ -0,0 +1,128 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_SNAPSHOT_RESULT_HPP__
+#define __DB_PLUS_SNAPSHOT_RESULT_HPP__
+
+#include <string>
+
+#include <boost/any.hpp>
+
+#include <dbplus/Dbplus.hpp>
+#include <dbplus/Result.hpp>
+#include <dbplus/ResultSnapshot.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+/*! \class SnapshotResult
+ *  \brief Reads a file written by ResultSnapshot.
+ *
+ * The file is mapped in memory and the values are decoded only for
+ * the current row, so opening a big snapshot is cheap and the pages
+ * are shared by all processes that read the same file. The arrays of
+ * a column can also be read straight from the mapping.
+ */
+class SnapshotResult : public Result
+{
+public:
+	/*! Constructor.
+	 *
+	 * @param path File written by ResultSnapshot::write
+	 * @throw DatabaseException if the file could not be mapped or is
+	 * not a valid snapshot
+	 */
+	explicit SnapshotResult(const string &path);
+
+	/*! Destructor. Unmaps the file.
+	 */
+	~SnapshotResult();
+
+	/*! Returns the number of rows found in result.
+	 *
+	 * @return Number of rows in result
+	 */
+	unsigned int size() const;
+
+	/*! Move to the next row.
+	 *
+	 * @return True if there's a next row, false otherwise
+	 * @throw DatabaseException if the offsets of a value are invalid
+	 */
+	bool fetch();
+
+	/*! Move back to before the first row.
+	 */
+	void rewind();
+
+	using Result::get;
+
+	/*! Returns the value of a given column name.
+	 *
+	 * @param key Column name
+	 * @return column Value in the current row
+	 * @throw DatabaseException if the column doesn't exist or is NULL
+	 */
+	boost::any get(const string &key) const;
+
+	/*! Returns the type of a column.
+	 *
+	 * @param key Column name
+	 * @return Column type
+	 * @throw DatabaseException if the column doesn't exist
+	 */
+	ResultSnapshot::Type::Value getType(const string &key) const;
+
+	/*! Returns the arrays of a column in the mapping, to scan all rows
+	 * without decoding them. Fixed size values are stored with the
+	 * width given by ResultSnapshot::getWidth, dates as the day number
+	 * and timestamps as microseconds since 1970. For strings and
+	 * binary values the array has the offsets in the heap.
+	 *
+	 * @param key Column name
+	 * @param nulls Bitmap of NULL values, one bit per row
+	 * @param heap Strings and binary values of the column
+	 * @return Values of the column
+	 * @throw DatabaseException if the column doesn't exist
+	 */
+	const void* getValues(const string &key, 
+	                      const unsigned char *&nulls,
+	                      const char *&heap) const;
+
+private:
+	const ResultSnapshot::ColumnHeader& findColumn(const string &key) const;
+	void validate(const string &path) const;
+
+	void *_mapping;
+	unsigned long _size;
+	const char *_data;
+	const ResultSnapshot::FileHeader *_header;
+	const ResultSnapshot::ColumnHeader *_columns;
+	long long _currentRow;
+
+private:
+	// Don't allow copying the object
+	SnapshotResult(const SnapshotResult &other);
+	SnapshotResult& operator=(const SnapshotResult &other);
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_SNAPSHOT_RESULT_HPP__
@@ -0,0 +1,354 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_SQL_DIALECT_HPP__
+#define __DB_PLUS_SQL_DIALECT_HPP__
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/any.hpp>
+#include <boost/optional.hpp>
+
+#include <dbplus/Binary.hpp>
+#include <dbplus/Database.hpp>
+#include <dbplus/DatabaseException.hpp>
+#include <dbplus/Dbplus.hpp>
+#include <dbplus/Result.hpp>
+#include <dbplus/SqlValue.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+class MySql;
+class PostgresSql;
+
+/*! \class SqlDialect
+ *  \brief SQL fragments that are written differently by each database.
+ *
+ * Only the drivers of the library have a dialect.
+ */
+template<class Driver>
+class SqlDialect;
+
+/*! \class SqlDialect<MySql>
+ *  \brief SQL fragments written for MySQL.
+ */
+template<>
+class SqlDialect<MySql>
+{
+public:
+	/*! Builds a condition that matches any of the values.
+	 *
+	 * @param database Connection used to escape the values
+	 * @param column Column name
+	 * @param values Values that are going to be matched
+	 * @return Condition in the format column IN ('a', 'b')
+	 */
+	static string in(Database &database, 
+	                 const string &column, 
+	                 const std::vector<string> &values)
+	{
+		string condition = column + " IN (";
+		for (unsigned int i = 0; i < values.size(); i++) {
+			if (i > 0) {
+				condition += ", ";
+			}
+
+			condition += '\'';
+			database.escape(values[i], condition);
+			condition += '\'';
+		}
+
+		return condition + ")";
+	}
+
+	/*! Append a value as a SQL literal. Binary values are written in
+	 * hexadecimal, like X'00ff'.
+	 *
+	 * @param database Connection used to escape the strings
+	 * @param value Value that is going to be written
+	 * @param buffer Where the literal is appended
+	 * @throw DatabaseException if the type is not supported
+	 */
+	static void appendValue(Database &database, 
+	                        const boost::any &value, 
+	                        string &buffer)
+	{
+		if (value.type() == typeid(Binary)) {
+			appendValue(database, boost::any_cast<const Binary&>(value), buffer);
+		} else {
+			SqlValue::appendLiteral(database, value, buffer);
+		}
+	}
+
+	/*! Append a binary value as a SQL literal.
+	 *
+	 * @param database Connection of the statement
+	 * @param value Value that is going to be written
+	 * @param buffer Where the literal is appended
+	 */
+	static void appendValue(Database &database, 
+	                        const Binary &value, 
+	                        string &buffer)
+	{
+		buffer += "X'";
+		SqlValue::appendHex(value, buffer);
+		buffer += "'";
+	}
+
+	/*! Append a value with a type known at compile time as a SQL
+	 * literal, without boxing it in boost::any.
+	 *
+	 * @param database Connection used to escape the strings
+	 * @param value Value that is going to be written
+	 * @param buffer Where the literal is appended
+	 */
+	template<class Value>
+	static void appendValue(Database &database, 
+	                        const Value &value, 
+	                        string &buffer)
+	{
+		SqlValue::appendLiteral(database, value, buffer);
+	}
+
+	/*! Append an optional value as a SQL literal, or NULL when it's
+	 * not set.
+	 *
+	 * @param database Connection used to escape the strings
+	 * @param value Value that is going to be written
+	 * @param buffer Where the literal is appended
+	 */
+	template<class Value>
+	static void appendValue(Database &database, 
+	                        const boost::optional<Value> &value, 
+	                        string &buffer)
+	{
+		if (value) {
+			appendValue(database, *value, buffer);
+		} else {
+			buffer += "NULL";
+		}
+	}
+
+	/*! Builds the clause that turns an INSERT into an update of the
+	 * rows that already exist. MySQL finds the existing rows by any
+	 * unique index, so the keys are only excluded from the update.
+	 *
+	 * @param columns Columns of the INSERT
+	 * @param keys Columns that identify the rows
+	 * @return Clause in the format ON DUPLICATE KEY UPDATE c = VALUES(c)
+	 */
+	static string upsert(const std::vector<string> &columns, 
+	                     const std::vector<string> &keys)
+	{
+		string clause;
+		for (const string &column : columns) {
+			if (std::find(keys.begin(), keys.end(), column) != keys.end()) {
+				continue;
+			}
+
+			clause += clause.empty() ? " ON DUPLICATE KEY UPDATE " : ", ";
+			clause += column + " = VALUES(" + column + ")";
+		}
+
+		// Only keys, so the existing rows are kept
+		if (clause.empty() && columns.empty() == false) {
+			clause = " ON DUPLICATE KEY UPDATE " + columns[0] + " = " + columns[0];
+		}
+
+		return clause;
+	}
+
+	/*! Returns the size of the biggest statement accepted by the
+	 * server, that is the max_allowed_packet variable.
+	 *
+	 * @param database Connection to the server
+	 * @return Size in bytes
+	 * @throw DatabaseException on error
+	 */
+	static unsigned long maxStatementSize(Database &database)
+	{
+		std::shared_ptr<Result> result = 
+			database.execute("SELECT @@max_allowed_packet AS size");
+		if (!result || result->fetch() == false) {
+			throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR,
+			                         "Could not read max_allowed_packet");
+		}
+
+		return result->get<long long>("size");
+	}
+};
+
+/*! \class SqlDialect<PostgresSql>
+ *  \brief SQL fragments written for PostgreSQL.
+ */
+template<>
+class SqlDialect<PostgresSql>
+{
+public:
+	/*! Builds a condition that matches any of the values. The values
+	 * are sent as one array, so the query text is the same for any
+	 * number of values.
+	 *
+	 * @param database Connection used to escape the values
+	 * @param column Column name
+	 * @param values Values that are going to be matched
+	 * @return Condition in the format column = ANY('{"a","b"}')
+	 */
+	static string in(Database &database, 
+	                 const string &column, 
+	                 const std::vector<string> &values)
+	{
+		string array = "{";
+		for (unsigned int i = 0; i < values.size(); i++) {
+			if (i > 0) {
+				array += ",";
+			}
+
+			array += "\"";
+			for (char c : values[i]) {
+				if (c == '"' || c == '\\') {
+					array += '\\';
+				}
+				array += c;
+			}
+			array += "\"";
+		}
+		array += "}";
+
+		return column + " = ANY('" + database.escape(array) + "')";
+	}
+
+	/*! Append a value as a SQL literal. Binary values are written in
+	 * the hexadecimal format of bytea, like E'\\x00ff'::bytea.
+	 *
+	 * @param database Connection used to escape the strings
+	 * @param value Value that is going to be written
+	 * @param buffer Where the literal is appended
+	 * @throw DatabaseException if the type is not supported
+	 */
+	static void appendValue(Database &database, 
+	                        const boost::any &value, 
+	                        string &buffer)
+	{
+		if (value.type() == typeid(Binary)) {
+			appendValue(database, boost::any_cast<const Binary&>(value), buffer);
+		} else {
+			SqlValue::appendLiteral(database, value, buffer);
+		}
+	}
+
+	/*! Append a binary value as a SQL literal.
+	 *
+	 * @param database Connection of the statement
+	 * @param value Value that is going to be written
+	 * @param buffer Where the literal is appended
+	 */
+	static void appendValue(Database &database, 
+	                        const Binary &value, 
+	                        string &buffer)
+	{
+		buffer += "E'\\\\x";
+		SqlValue::appendHex(value, buffer);
+		buffer += "'::bytea";
+	}
+
+	/*! Append a value with a type known at compile time as a SQL
+	 * literal, without boxing it in boost::any.
+	 *
+	 * @param database Connection used to escape the strings
+	 * @param value Value that is going to be written
+	 * @param buffer Where the literal is appended
+	 */
+	template<class Value>
+	static void appendValue(Database &database, 
+	                        const Value &value, 
+	                        string &buffer)
+	{
+		SqlValue::appendLiteral(database, value, buffer);
+	}
+
+	/*! Append an optional value as a SQL literal, or NULL when it's
+	 * not set.
+	 *
+	 * @param database Connection used to escape the strings
+	 * @param value Value that is going to be written
+	 * @param buffer Where the literal is appended
+	 */
+	template<class Value>
+	static void appendValue(Database &database, 
+	                        const boost::optional<Value> &value, 
+	                        string &buffer)
+	{
+		if (value) {
+			appendValue(database, *value, buffer);
+		} else {
+			buffer += "NULL";
+		}
+	}
+
+	/*! Builds the clause that turns an INSERT into an update of the
+	 * rows that already exist.
+	 *
+	 * @param columns Columns of the INSERT
+	 * @param keys Columns of the unique constraint
+	 * @return Clause in the format ON CONFLICT (k) DO UPDATE SET c =
+	 * EXCLUDED.c
+	 */
+	static string upsert(const std::vector<string> &columns, 
+	                     const std::vector<string> &keys)
+	{
+		string clause = " ON CONFLICT (";
+		for (unsigned int i = 0; i < keys.size(); i++) {
+			clause += (i > 0 ? ", " : "") + keys[i];
+		}
+		clause += ")";
+
+		string updates;
+		for (const string &column : columns) {
+			if (std::find(keys.begin(), keys.end(), column) != keys.end()) {
+				continue;
+			}
+
+			updates += updates.empty() ? " DO UPDATE SET " : ", ";
+			updates += column + " = EXCLUDED." + column;
+		}
+
+		return clause + (updates.empty() ? " DO NOTHING" : updates);
+	}
+
+	/*! Returns the size of the biggest statement accepted by the
+	 * server. PostgreSQL only limits the size of the protocol messages.
+	 *
+	 * @param database Connection to the server
+	 * @return Size in bytes
+	 */
+	static unsigned long maxStatementSize(Database &database)
+	{
+		return 0x3fffffff;
+	}
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_SQL_DIALECT_HPP__
@@ -0,0 +1,68 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_SQL_INSPECTOR_HPP__
+#define __DB_PLUS_SQL_INSPECTOR_HPP__
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <dbplus/Dbplus.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+/*! \class SqlInspector
+ *  \brief Extracts information from SQL queries without a full parser.
+ *
+ * Used by the layers that route or cache queries. The inspection is
+ * lexical, so the answers are conservative: when in doubt, a query is
+ * considered a write.
+ */
+class SqlInspector
+{
+public:
+	/*! Check if a query doesn't change data. Only SELECT, SHOW, EXPLAIN
+	 * and DESCRIBE queries without locking or INTO clauses, and with a
+	 * single statement, are read-only.
+	 *
+	 * @param query SQL query
+	 * @return True for queries that don't change data
+	 */
+	static bool isReadOnly(const string &query);
+
+	/*! Returns the tables referenced by a query, after FROM, JOIN,
+	 * UPDATE, INTO, TABLE and TRUNCATE. Names are lower case, without
+	 * quotes and without the schema.
+	 *
+	 * @param query SQL query
+	 * @return Referenced tables, empty when none could be found
+	 */
+	static std::set<string> tables(const string &query);
+
+private:
+	static std::vector<string> tokenize(const string &query);
+	static string normalize(const string &token);
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_SQL_INSPECTOR_HPP__
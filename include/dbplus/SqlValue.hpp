@@ -0,0 +1,190 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_SQL_VALUE_HPP__
+#define __DB_PLUS_SQL_VALUE_HPP__
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include <boost/any.hpp>
+#include <boost/date_time/gregorian/gregorian_types.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/optional.hpp>
+
+#include <dbplus/Binary.hpp>
+#include <dbplus/Database.hpp>
+#include <dbplus/Dbplus.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+/*! \class SqlValue
+ *  \brief Writes values as text to send them to the database.
+ *
+ * Accepts the types returned by the drivers (see doc/features.txt),
+ * plus bool, const char*, unsigned types and empty values, that are
+ * written as NULL. Binary values are written by each SqlDialect.
+ *
+ * Besides boost::any, there are overloads for each type, used when
+ * the type is known at compile time, like in the TableDescriptor
+ * columns.
+ */
+class SqlValue
+{
+public:
+	/*! Append a value as a SQL literal, like 'text', 10 or NULL.
+	 *
+	 * @param database Connection used to escape the strings
+	 * @param value Value that is going to be written
+	 * @param buffer Where the literal is appended
+	 * @throw DatabaseException if the type is not supported
+	 */
+	static void appendLiteral(Database &database, 
+	                          const boost::any &value, 
+	                          string &buffer);
+
+	// Overloads for values with a type known at compile time
+
+	static void appendLiteral(Database &database, 
+	                          const string &value, 
+	                          string &buffer);
+
+	static void appendLiteral(Database &database, 
+	                          const char *value, 
+	                          string &buffer);
+
+	static void appendLiteral(Database &database, 
+	                          const bool value, 
+	                          string &buffer);
+
+	static void appendLiteral(Database &database, 
+	                          const boost::gregorian::date &value, 
+	                          string &buffer);
+
+	static void appendLiteral(Database &database, 
+	                          const boost::posix_time::ptime &value, 
+	                          string &buffer);
+
+	template<class Value>
+	static typename std::enable_if<std::is_arithmetic<Value>::value>::type
+	appendLiteral(Database &database, const Value value, string &buffer)
+	{
+		appendNumber(value, buffer);
+	}
+
+	/*! Append a value in the text format of the PostgreSQL COPY
+	 * command, where NULL is \\N and tabs, new lines and backslashes
+	 * are escaped.
+	 *
+	 * @param value Value that is going to be written
+	 * @param buffer Where the value is appended
+	 * @throw DatabaseException if the type is not supported
+	 */
+	static void appendCopy(const boost::any &value, string &buffer);
+
+	// Overloads for values with a type known at compile time
+
+	static void appendCopy(const string &value, string &buffer);
+
+	static void appendCopy(const char *value, string &buffer);
+
+	static void appendCopy(const bool value, string &buffer);
+
+	static void appendCopy(const Binary &value, string &buffer);
+
+	static void appendCopy(const boost::gregorian::date &value, 
+	                       string &buffer);
+
+	static void appendCopy(const boost::posix_time::ptime &value, 
+	                       string &buffer);
+
+	template<class Value>
+	static typename std::enable_if<std::is_arithmetic<Value>::value>::type
+	appendCopy(const Value value, string &buffer)
+	{
+		appendNumber(value, buffer);
+	}
+
+	template<class Value>
+	static void appendCopy(const boost::optional<Value> &value, 
+	                       string &buffer)
+	{
+		if (value) {
+			appendCopy(*value, buffer);
+		} else {
+			buffer += "\\N";
+		}
+	}
+
+	/*! Append a value as plain text, like the text sent by the
+	 * servers, without quotes or escaping. The bytes of binary values
+	 * are appended as they are.
+	 *
+	 * @param value Value that is going to be written, not empty
+	 * @param buffer Where the value is appended
+	 * @throw DatabaseException if the type is not supported
+	 */
+	static void appendPlain(const boost::any &value, string &buffer);
+
+	/*! Append the bytes of a binary value in hexadecimal.
+	 *
+	 * @param value Binary value
+	 * @param buffer Where the digits are appended
+	 */
+	static void appendHex(const Binary &value, string &buffer);
+
+private:
+	static bool appendText(const boost::any &value, string &buffer);
+	static void appendText(const boost::gregorian::date &value, 
+	                       string &buffer);
+	static void appendText(const boost::posix_time::ptime &value, 
+	                       string &buffer);
+	static void appendCopyText(const char *value, 
+	                           const unsigned long size, 
+	                           string &buffer);
+
+	template<class Value>
+	static void appendNumber(const Value value, string &buffer)
+	{
+		buffer += boost::lexical_cast<string>(value);
+	}
+
+	static void appendNumber(const uint8_t value, string &buffer)
+	{
+		buffer += boost::lexical_cast<string>(static_cast<unsigned int>(value));
+	}
+
+	static void appendNumber(const char value, string &buffer)
+	{
+		buffer += boost::lexical_cast<string>(static_cast<int>(value));
+	}
+
+	static void appendNumber(const int8_t value, string &buffer)
+	{
+		buffer += boost::lexical_cast<string>(static_cast<int>(value));
+	}
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_SQL_VALUE_HPP__
@@ -0,0 +1,163 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_STORED_RESULT_HPP__
+#define __DB_PLUS_STORED_RESULT_HPP__
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/any.hpp>
+
+#include <dbplus/Dbplus.hpp>
+#include <dbplus/Result.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+/*! \class StoredResult
+ *  \brief Replays rows that were already decoded.
+ *
+ * The rows are stored once in an immutable Data object, that can be
+ * shared by many StoredResult objects and by many threads. Each
+ * StoredResult only keeps its current position, so creating one is
+ * cheap.
+ */
+class StoredResult : public Result
+{
+public:
+	/*! \class Data
+	 *  \brief Immutable rows of a result.
+	 */
+	class Data
+	{
+	public:
+		/*! Read all rows of a result.
+		 *
+		 * @param result Result that is going to be consumed
+		 */
+		explicit Data(Result &result);
+
+		/*! Returns the column names.
+		 *
+		 * @return Column names
+		 */
+		const std::vector<string>& getColumns() const;
+
+		/*! Returns the number of rows.
+		 *
+		 * @return Number of rows
+		 */
+		unsigned int getRows() const;
+
+		/*! Returns a value.
+		 *
+		 * @param row Row index
+		 * @param column Column index
+		 * @return Value
+		 */
+		const boost::any& getValue(const unsigned int row, 
+		                           const unsigned int column) const;
+
+		/*! Returns the index of a column.
+		 *
+		 * @param column Column name
+		 * @return Column index or -1 if the column doesn't exist
+		 */
+		int getColumn(const string &column) const;
+
+		/*! Returns an estimate of the memory used by the rows.
+		 *
+		 * @return Memory in bytes
+		 */
+		unsigned long getMemory() const;
+
+	private:
+		std::vector<string> _columns;
+		std::vector<boost::any> _values;
+		unsigned int _rows;
+		unsigned long _memory;
+	};
+
+	/*! Constructor.
+	 *
+	 * @param data Rows that are going to be replayed
+	 */
+	explicit StoredResult(std::shared_ptr<const Data> data);
+
+	/*! Constructor that replays only some rows.
+	 *
+	 * @param data Rows of the result
+	 * @param rows Indexes of the rows that are going to be replayed
+	 */
+	StoredResult(std::shared_ptr<const Data> data,
+	             std::shared_ptr<const std::vector<unsigned int> > rows);
+
+	/*! Returns the rows that are replayed.
+	 *
+	 * @return Rows of the result
+	 */
+	std::shared_ptr<const Data> getData() const;
+
+	/*! Returns the number of rows found in result.
+	 *
+	 * @return Number of rows in result
+	 */
+	unsigned int size() const;
+
+	/*! Move to the next row.
+	 *
+	 * @return True if there's a next row, false otherwise
+	 */
+	bool fetch();
+
+	using Result::get;
+
+	/*! Returns the value of a given column name.
+	 *
+	 * @param key Column name
+	 * @return column Value in the current row
+	 * @throw DatabaseException if the column doesn't exist
+	 */
+	boost::any get(const string &key) const;
+
+	/*! Returns all columns of the current row. The row is only built
+	 * when this method is called.
+	 *
+	 * @return Column values indexed by the column name
+	 */
+	const std::map<string, boost::any>& getRow() const;
+
+private:
+	int dataRow() const;
+
+	std::shared_ptr<const Data> _data;
+	std::shared_ptr<const std::vector<unsigned int> > _rows;
+	int _currentRow;
+
+	mutable std::map<string, boost::any> _currentValues;
+	mutable int _builtRow;
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_STORED_RESULT_HPP__
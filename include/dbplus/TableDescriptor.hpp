@@ -0,0 +1,191 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_TABLE_DESCRIPTOR_HPP__
+#define __DB_PLUS_TABLE_DESCRIPTOR_HPP__
+
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include <dbplus/Dbplus.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+/*! \class TableColumn
+ *  \brief Maps a member of a class to a column of a table.
+ */
+template<class Object, class Value>
+class TableColumn
+{
+public:
+	/*! Type of the member
+	 */
+	typedef Value Type;
+
+	/*! Constructor.
+	 *
+	 * @param name Column name
+	 * @param member Member of the class stored in the column
+	 */
+	TableColumn(const string &name, Value Object::*member) :
+		_name(name),
+		_member(member)
+	{
+	}
+
+	/*! Returns the column name.
+	 *
+	 * @return Column name
+	 */
+	const string& getName() const
+	{
+		return _name;
+	}
+
+	/*! Returns the value of the column in an object.
+	 *
+	 * @param object Object that has the value
+	 * @return Value of the member
+	 */
+	const Value& get(const Object &object) const
+	{
+		return object.*_member;
+	}
+
+private:
+	string _name;
+	Value Object::*_member;
+};
+
+/*! \class TableDescriptor
+ *  \brief Describes how the objects of a class are stored in a table.
+ *
+ * The columns are known at compile time, so visiting the values of
+ * an object calls the visitor with the real type of each member,
+ * without boxing them in boost::any. The descriptors are built with
+ * describeTable:
+ *
+ *   auto users = describeTable("users",
+ *                              tableColumn("id", &User::id),
+ *                              tableColumn("name", &User::name));
+ */
+template<class Object, class... Columns>
+class TableDescriptor
+{
+public:
+	/*! Constructor.
+	 *
+	 * @param table Table name
+	 * @param columns Columns of the table
+	 */
+	TableDescriptor(const string &table, const Columns&... columns) :
+		_table(table),
+		_names({columns.getName()...}),
+		_columns(columns...)
+	{
+	}
+
+	/*! Returns the table name.
+	 *
+	 * @return Table name
+	 */
+	const string& getTable() const
+	{
+		return _table;
+	}
+
+	/*! Returns the column names, in the order of the descriptor.
+	 *
+	 * @return Column names
+	 */
+	const std::vector<string>& getColumns() const
+	{
+		return _names;
+	}
+
+	/*! Call the visitor with each value of an object, in the order of
+	 * the columns.
+	 *
+	 * @param object Object that is visited
+	 * @param visitor Object with an operator()(unsigned int index,
+	 * const Value &value) for the types of all columns
+	 */
+	template<class Visitor>
+	void visit(const Object &object, Visitor &visitor) const
+	{
+		visitColumns<0>(object, visitor);
+	}
+
+private:
+	template<unsigned int Index, class Visitor>
+	typename std::enable_if<Index == sizeof...(Columns)>::type
+	visitColumns(const Object &object, Visitor &visitor) const
+	{
+	}
+
+	template<unsigned int Index, class Visitor>
+	typename std::enable_if<(Index < sizeof...(Columns))>::type
+	visitColumns(const Object &object, Visitor &visitor) const
+	{
+		visitor(Index, std::get<Index>(_columns).get(object));
+		visitColumns<Index + 1>(object, visitor);
+	}
+
+	string _table;
+	std::vector<string> _names;
+	std::tuple<Columns...> _columns;
+};
+
+/*! Builds the mapping of a member to a column.
+ *
+ * @param name Column name
+ * @param member Member of the class stored in the column
+ * @return Column of a TableDescriptor
+ */
+template<class Object, class Value>
+TableColumn<Object, Value> tableColumn(const string &name, 
+                                       Value Object::*member)
+{
+	return TableColumn<Object, Value>(name, member);
+}
+
+/*! Builds the descriptor of a table, deducing the types of the
+ * columns.
+ *
+ * @param table Table name
+ * @param columns Columns built with tableColumn, all from the same
+ * class
+ * @return Table descriptor
+ */
+template<class Object, class... Values>
+TableDescriptor<Object, TableColumn<Object, Values>...>
+describeTable(const string &table, 
+              const TableColumn<Object, Values>&... columns)
+{
+	return TableDescriptor<Object, TableColumn<Object, Values>...>(table, 
+	                                                               columns...);
+}
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_TABLE_DESCRIPTOR_HPP__
@@ -0,0 +1,209 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_TABLE_WRITER_HPP__
+#define __DB_PLUS_TABLE_WRITER_HPP__
+
+#include <string>
+#include <vector>
+
+#include <dbplus/Database.hpp>
+#include <dbplus/Dbplus.hpp>
+#include <dbplus/InsertBuilder.hpp>
+#include <dbplus/MySql.hpp>
+#include <dbplus/PostgresSql.hpp>
+#include <dbplus/SqlDialect.hpp>
+#include <dbplus/SqlValue.hpp>
+#include <dbplus/TableDescriptor.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+/*! \class TableWriter
+ *  \brief Writes vectors of objects to the table of a TableDescriptor.
+ *
+ * The values are encoded straight from the members of the objects,
+ * with the overloads of their types, so nothing is boxed in
+ * boost::any. PostgreSQL loads the rows with COPY FROM STDIN and MySQL
+ * with multi-row INSERT statements, split at max_allowed_packet.
+ * Upserts always use multi-row statements (ON DUPLICATE KEY UPDATE or
+ * ON CONFLICT), that are generated once for all rows.
+ *
+ * Usage:
+ *   TableWriter::write(postgres, users, objects);
+ */
+class TableWriter
+{
+public:
+	/*! Insert the objects with multi-row INSERT statements.
+	 *
+	 * @param database Connection to the database
+	 * @param table Descriptor of the table
+	 * @param objects Objects that are going to be inserted
+	 * @return Number of rows inserted
+	 * @throw DatabaseException on error
+	 */
+	template<class Object, class... Columns>
+	static unsigned long long 
+	write(MySql &database,
+	      const TableDescriptor<Object, Columns...> &table,
+	      const std::vector<Object> &objects)
+	{
+		return insert(database, table, std::vector<string>(), objects);
+	}
+
+	/*! Load the objects with COPY FROM STDIN. The rows are sent in
+	 * blocks of COPY_BUFFER_SIZE bytes, each one in a COPY command, so
+	 * they are only loaded atomically inside a transaction.
+	 *
+	 * @param database Connection to the database
+	 * @param table Descriptor of the table
+	 * @param objects Objects that are going to be inserted
+	 * @return Number of rows inserted
+	 * @throw DatabaseException on error
+	 */
+	template<class Object, class... Columns>
+	static unsigned long long 
+	write(PostgresSql &database,
+	      const TableDescriptor<Object, Columns...> &table,
+	      const std::vector<Object> &objects)
+	{
+		unsigned long long rows = 0;
+
+		string buffer;
+		CopyVisitor visitor(buffer);
+
+		for (const Object &object : objects) {
+			table.visit(object, visitor);
+			buffer += '\n';
+
+			if (buffer.size() >= COPY_BUFFER_SIZE) {
+				rows += database.copy(table.getTable(), table.getColumns(), buffer);
+				buffer.clear();
+			}
+		}
+
+		if (buffer.empty() == false) {
+			rows += database.copy(table.getTable(), table.getColumns(), buffer);
+		}
+
+		return rows;
+	}
+
+	/*! Insert the objects, updating the rows that already exist.
+	 *
+	 * @param database Connection to the database
+	 * @param table Descriptor of the table
+	 * @param keys Columns that identify the rows
+	 * @param objects Objects that are going to be written
+	 * @return Number of rows affected, as reported by the server
+	 * @throw DatabaseException on error
+	 */
+	template<class Driver, class Object, class... Columns>
+	static unsigned long long 
+	upsert(Driver &database,
+	       const TableDescriptor<Object, Columns...> &table,
+	       const std::vector<string> &keys,
+	       const std::vector<Object> &objects)
+	{
+		return insert(database, table, keys, objects);
+	}
+
+	/*! Size of the text sent in each COPY command
+	 */
+	static const unsigned long COPY_BUFFER_SIZE = 8 * 1024 * 1024;
+
+private:
+	/*! Writes the values as SQL literals separated by commas
+	 */
+	template<class Driver>
+	class LiteralVisitor
+	{
+	public:
+		LiteralVisitor(Driver &database, string &buffer) :
+			_database(database),
+			_buffer(buffer)
+		{
+		}
+
+		template<class Value>
+		void operator()(const unsigned int index, const Value &value)
+		{
+			if (index > 0) {
+				_buffer += ", ";
+			}
+			SqlDialect<Driver>::appendValue(_database, value, _buffer);
+		}
+
+	private:
+		Driver &_database;
+		string &_buffer;
+	};
+
+	/*! Writes the values in the COPY text format separated by tabs
+	 */
+	class CopyVisitor
+	{
+	public:
+		explicit CopyVisitor(string &buffer) :
+			_buffer(buffer)
+		{
+		}
+
+		template<class Value>
+		void operator()(const unsigned int index, const Value &value)
+		{
+			if (index > 0) {
+				_buffer += '\t';
+			}
+			SqlValue::appendCopy(value, _buffer);
+		}
+
+	private:
+		string &_buffer;
+	};
+
+	template<class Driver, class Object, class... Columns>
+	static unsigned long long 
+	insert(Driver &database,
+	       const TableDescriptor<Object, Columns...> &table,
+	       const std::vector<string> &keys,
+	       const std::vector<Object> &objects)
+	{
+		InsertBuilder<Driver> builder(database, table.getTable(), 
+		                              table.getColumns());
+		if (keys.empty() == false) {
+			builder.setUpsert(keys);
+		}
+
+		for (const Object &object : objects) {
+			builder.append([&database, &table, &object](string &buffer) {
+				LiteralVisitor<Driver> visitor(database, buffer);
+				table.visit(object, visitor);
+			});
+		}
+
+		return builder.execute();
+	}
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_TABLE_WRITER_HPP__
@@ -0,0 +1,60 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_TEXT_SCAN_HPP__
+#define __DB_PLUS_TEXT_SCAN_HPP__
+
+#include <string>
+
+#include <dbplus/Dbplus.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+/*! \class TextScan
+ *  \brief Finds characters in text, 16 bytes at a time with SSE2.
+ *
+ * Used by the escape methods and by the exporters to copy the parts of
+ * a value that don't need escaping without looking at each byte.
+ */
+class TextScan
+{
+public:
+	/*! Returns the position of the first byte that is one of the
+	 * characters.
+	 *
+	 * @param data Text that is going to be scanned
+	 * @param size Number of bytes of the text
+	 * @param characters Bytes that are searched, at most 8
+	 * @param highBit Also stop at bytes with the high bit set, that
+	 * can be part of a multibyte character
+	 * @param control Also stop at control bytes, below 0x20
+	 * @return Position of the byte or size when there's none
+	 */
+	static unsigned long find(const char *data, 
+	                          const unsigned long size,
+	                          const string &characters,
+	                          const bool highBit = false,
+	                          const bool control = false);
+};
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_TEXT_SCAN_HPP__
@@ -0,0 +1,503 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DB_PLUS_WRITE_BEHIND_BUFFER_HPP__
+#define __DB_PLUS_WRITE_BEHIND_BUFFER_HPP__
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/any.hpp>
+
+#include <dbplus/ConnectionPool.hpp>
+#include <dbplus/Database.hpp>
+#include <dbplus/Dbplus.hpp>
+#include <dbplus/InsertBuilder.hpp>
+#include <dbplus/MySql.hpp>
+#include <dbplus/PostgresSql.hpp>
+#include <dbplus/SqlValue.hpp>
+
+using std::string;
+
+DBPLUS_NS_BEGIN
+
+/*! \class WriteBehindBuffer
+ *  \brief Inserts rows in the background, in batches.
+ *
+ * Rows are pushed by many threads into a lock free queue and a
+ * background thread writes them with multi-row INSERT statements
+ * (MySQL) or one COPY (PostgreSQL) per batch, each batch in one
+ * transaction. The size of the batches follows the
+ * time spent writing them: it grows while the writes are faster than
+ * the target latency and shrinks when they are slower. The queue has
+ * a maximum number of rows, and push blocks while it is full. All
+ * rows are written before the buffer is destroyed.
+ *
+ * There's no acknowledgement per row: rows that could not be written,
+ * even after a retry in a new connection, are reported to the error
+ * handler and discarded.
+ */
+template<class Driver>
+class WriteBehindBuffer
+{
+public:
+	typedef ConnectionPool<Driver> Pool;
+
+	/*! Values of a row, in the order of the columns. Empty values are
+	 * written as NULL
+	 */
+	typedef std::vector<boost::any> Row;
+
+	/*! Function called in the background thread when a batch could not
+	 * be written, with the error and the number of discarded rows
+	 */
+	typedef std::function<void (std::exception_ptr error, 
+	                            unsigned int rows)> ErrorHandler;
+
+	/*! Smallest batch size used by the adaptive batches
+	 */
+	static const unsigned int MIN_BATCH_SIZE = 64;
+
+	/*! Constructor. Starts the background thread.
+	 *
+	 * @param pool Connections used to write the rows
+	 * @param table Table name
+	 * @param columns Columns of the rows
+	 * @param capacity Maximum number of rows waiting in the queue
+	 * @param maxBatch Maximum number of rows written at once
+	 * @param targetLatency Desired time to write one batch
+	 * @param interval Maximum time that a row waits in the queue
+	 */
+	WriteBehindBuffer(std::shared_ptr<Pool> pool,
+	                  const string &table,
+	                  const std::vector<string> &columns,
+	                  const unsigned int capacity = 100000,
+	                  const unsigned int maxBatch = 10000,
+	                  const std::chrono::milliseconds targetLatency = 
+	                    std::chrono::milliseconds(50),
+	                  const std::chrono::milliseconds interval = 
+	                    std::chrono::milliseconds(100)) :
+		_pool(pool),
+		_table(table),
+		_columns(columns),
+		_capacity(capacity == 0 ? 1 : capacity),
+		_maxBatch(std::max(maxBatch, MIN_BATCH_SIZE)),
+		_targetLatency(targetLatency),
+		_interval(interval),
+		_head(&_stub),
+		_tail(&_stub),
+		_size(0),
+		_batchSize(MIN_BATCH_SIZE),
+		_pushed(0),
+		_done(0),
+		_flushing(0),
+		_stopped(false),
+		_written(0),
+		_dropped(0)
+	{
+		_stub.next = NULL;
+		_thread = std::thread(&WriteBehindBuffer::run, this);
+	}
+
+	/*! Destructor. Waits until all rows are written.
+	 */
+	~WriteBehindBuffer()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			_stopped = true;
+		}
+
+		_wake.notify_all();
+		_thread.join();
+	}
+
+	/*! Add a row to the queue, waiting while the queue is full. Thread
+	 * safe.
+	 *
+	 * @param row Values of the row
+	 */
+	void push(const Row &row)
+	{
+		while (reserve() == false) {
+			std::unique_lock<std::mutex> lock(_lock);
+			_space.wait(lock, [this]() { return _size < _capacity; });
+		}
+
+		enqueue(row);
+	}
+
+	/*! Add a row to the queue if it's not full. Thread safe.
+	 *
+	 * @param row Values of the row
+	 * @return False if the queue is full
+	 */
+	bool tryPush(const Row &row)
+	{
+		if (reserve() == false) {
+			return false;
+		}
+
+		enqueue(row);
+		return true;
+	}
+
+	/*! Write the rows that are in the queue and wait until they are
+	 * written or discarded. Thread safe.
+	 */
+	void flush()
+	{
+		unsigned long long target = _pushed;
+
+		std::unique_lock<std::mutex> lock(_lock);
+		_flushing = std::max(_flushing, target);
+		_wake.notify_all();
+		_flushed.wait(lock, [this, target]() { return _done >= target; });
+	}
+
+	/*! Sets the function called when a batch could not be written. Must
+	 * be called before pushing rows.
+	 *
+	 * @param handler Function called in the background thread
+	 */
+	void setErrorHandler(ErrorHandler handler)
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		_errorHandler = handler;
+	}
+
+	/*! Returns the number of rows in the queue.
+	 *
+	 * @return Number of rows
+	 */
+	unsigned int size() const
+	{
+		return _size;
+	}
+
+	/*! Returns the current number of rows written at once.
+	 *
+	 * @return Batch size
+	 */
+	unsigned int getBatchSize() const
+	{
+		return _batchSize;
+	}
+
+	/*! Returns the number of rows written in the database.
+	 *
+	 * @return Number of rows
+	 */
+	unsigned long long getWritten() const
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		return _written;
+	}
+
+	/*! Returns the number of rows discarded because of errors.
+	 *
+	 * @return Number of rows
+	 */
+	unsigned long long getDropped() const
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		return _dropped;
+	}
+
+private:
+	/*! Row in the queue
+	 */
+	struct Node {
+		std::atomic<Node*> next;
+		Row row;
+	};
+
+	/*! Takes a place in the queue
+	 */
+	bool reserve()
+	{
+		unsigned int size = _size;
+		while (size < _capacity) {
+			if (_size.compare_exchange_weak(size, size + 1)) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void enqueue(const Row &row)
+	{
+		Node *node = new Node();
+		node->next = NULL;
+		node->row = row;
+		link(node);
+
+		_pushed++;
+
+		// The writer is awaken only when a batch is ready, otherwise
+		// it writes the rows after the interval
+		if (_size == _batchSize) {
+			_wake.notify_all();
+		}
+	}
+
+	/*! Multiple producers part of the queue: the new node becomes the
+	 * head and is linked to the previous head
+	 */
+	void link(Node *node)
+	{
+		Node *previous = _head.exchange(node);
+		previous->next = node;
+	}
+
+	/*! Single consumer part of the queue, used only by the writer
+	 * thread. Returns NULL when the queue is empty or when a producer
+	 * didn't finish linking its node
+	 */
+	Node* unlink()
+	{
+		Node *tail = _tail;
+		Node *next = tail->next;
+
+		if (tail == &_stub) {
+			if (next == NULL) {
+				return NULL;
+			}
+
+			_tail = next;
+			tail = next;
+			next = next->next;
+		}
+
+		if (next != NULL) {
+			_tail = next;
+			return tail;
+		}
+
+		if (tail != _head) {
+			return NULL;
+		}
+
+		// The last node can only be removed with the stub after it
+		_stub.next = NULL;
+		link(&_stub);
+
+		next = tail->next;
+		if (next != NULL) {
+			_tail = next;
+			return tail;
+		}
+
+		return NULL;
+	}
+
+	void run()
+	{
+		std::vector<Row> rows;
+
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(_lock);
+				_wake.wait_for(lock, _interval, [this]() {
+					return _stopped || _flushing > _done || _size >= _batchSize;
+				});
+
+				if (_stopped && _size == 0) {
+					break;
+				}
+			}
+
+			// Write everything that is in the queue now
+			while (true) {
+				rows.clear();
+
+				Node *node = NULL;
+				while (rows.size() < _batchSize && (node = unlink()) != NULL) {
+					rows.push_back(std::move(node->row));
+					delete node;
+				}
+
+				if (rows.empty()) {
+					break;
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(_lock);
+					_size -= rows.size();
+				}
+				_space.notify_all();
+
+				write(rows);
+			}
+		}
+
+		_inserter.reset();
+		_lease.release();
+	}
+
+	void write(std::vector<Row> &rows)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		// The connection is kept between batches, and a new one is
+		// tried once when the write fails. Each batch is one transaction,
+		// as MySQL can split it in many statements, so a failed batch
+		// is rolled back when the lease returns to the pool and the
+		// retry doesn't duplicate rows
+		std::exception_ptr error;
+		for (int attempt = 0; attempt < 2; attempt++) {
+			try {
+				if (_lease.get() == NULL) {
+					_lease = _pool->acquire();
+					_lease->setTransactionMode(Database::TransactionMode::MANUAL_COMMIT);
+				}
+
+				write(*_lease, rows);
+				_lease->commit();
+
+				error = std::exception_ptr();
+				break;
+
+			} catch (...) {
+				error = std::current_exception();
+				_inserter.reset();
+				_lease = typename Pool::Lease();
+			}
+		}
+
+		adapt(rows.size(), std::chrono::steady_clock::now() - start);
+
+		ErrorHandler handler;
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			_done += rows.size();
+			if (error) {
+				_dropped += rows.size();
+				handler = _errorHandler;
+			} else {
+				_written += rows.size();
+			}
+		}
+		_flushed.notify_all();
+
+		if (error && handler) {
+			handler(error, rows.size());
+		}
+	}
+
+	/*! Doubles the batch when it's fast and halves it when it's slow
+	 */
+	void adapt(const unsigned int rows, const std::chrono::steady_clock::duration elapsed)
+	{
+		if (elapsed > _targetLatency) {
+			_batchSize = std::max(_batchSize / 2, MIN_BATCH_SIZE);
+		} else if (rows == _batchSize && elapsed < _targetLatency / 2) {
+			_batchSize = std::min(_batchSize * 2, _maxBatch);
+		}
+	}
+
+	void write(MySql &database, const std::vector<Row> &rows)
+	{
+		// The statements are split at the max_allowed_packet of the
+		// server, so a batch can be written in more than one statement
+		if (!_inserter) {
+			_inserter.reset(new InsertBuilder<MySql>(database, _table, _columns));
+		}
+
+		for (const Row &row : rows) {
+			_inserter->add(row);
+		}
+
+		_inserter->execute();
+	}
+
+	void write(PostgresSql &database, const std::vector<Row> &rows)
+	{
+		_buffer.clear();
+		for (const Row &row : rows) {
+			for (unsigned int i = 0; i < row.size(); i++) {
+				if (i > 0) {
+					_buffer += '\t';
+				}
+				SqlValue::appendCopy(row[i], _buffer);
+			}
+			_buffer += '\n';
+		}
+
+		database.copy(_table, _columns, _buffer);
+	}
+
+	std::shared_ptr<Pool> _pool;
+	string _table;
+	std::vector<string> _columns;
+	unsigned int _capacity;
+	unsigned int _maxBatch;
+	std::chrono::milliseconds _targetLatency;
+	std::chrono::milliseconds _interval;
+
+	// Lock free queue, the producers add nodes in the head and the
+	// writer removes them from the tail
+	Node _stub;
+	std::atomic<Node*> _head;
+	Node *_tail;
+	std::atomic<unsigned int> _size;
+	std::atomic<unsigned int> _batchSize;
+	std::atomic<unsigned long long> _pushed;
+
+	mutable std::mutex _lock;
+	std::condition_variable _wake;
+	std::condition_variable _space;
+	std::condition_variable _flushed;
+	unsigned long long _done;
+	unsigned long long _flushing;
+	bool _stopped;
+	ErrorHandler _errorHandler;
+
+	unsigned long long _written;
+	unsigned long long _dropped;
+
+	// Used only by the writer thread. The insert builder uses the
+	// connection of the lease
+	typename Pool::Lease _lease;
+	std::unique_ptr<InsertBuilder<MySql> > _inserter;
+	string _buffer;
+	std::thread _thread;
+
+private:
+	// Don't allow copying the object
+	WriteBehindBuffer(const WriteBehindBuffer &other);
+	WriteBehindBuffer& operator=(const WriteBehindBuffer &other);
+};
+
+template<class Driver>
+const unsigned int WriteBehindBuffer<Driver>::MIN_BATCH_SIZE;
+
+DBPLUS_NS_END
+
+#endif // __DB_PLUS_WRITE_BEHIND_BUFFER_HPP__
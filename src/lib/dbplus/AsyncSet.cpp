@@ -0,0 +1,127 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+extern "C" {
+#include <poll.h>
+}
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include <dbplus/AsyncSet.hpp>
+#include <dbplus/DatabaseException.hpp>
+
+DBPLUS_NS_BEGIN
+
+void AsyncSet::add(Database &database, const Database::AsyncStatus::Value status)
+{
+	if (status == Database::AsyncStatus::COMPLETE) {
+		return;
+	}
+
+	Entry entry;
+	entry.database = &database;
+	entry.status = status;
+	_entries.push_back(entry);
+}
+
+unsigned int AsyncSet::waitOnce(const int timeout)
+{
+	if (_entries.empty()) {
+		return 0;
+	}
+
+	std::vector<struct pollfd> sockets(_entries.size());
+	for (unsigned int i = 0; i < _entries.size(); i++) {
+		sockets[i].fd = _entries[i].database->getSocket();
+		sockets[i].events = 
+			(_entries[i].status == Database::AsyncStatus::WAIT_READ ? POLLIN : POLLOUT);
+		sockets[i].revents = 0;
+	}
+
+	int ready = ::poll(&sockets[0], sockets.size(), timeout);
+	if (ready < 0) {
+		if (errno == EINTR) {
+			return 0;
+		}
+
+		throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR,
+		                         strerror(errno));
+	}
+
+	unsigned int completed = 0;
+	std::vector<Entry> entries;
+
+	for (unsigned int i = 0; i < _entries.size(); i++) {
+		Entry entry = _entries[i];
+
+		// Errors and hang ups are reported by the driver
+		if (sockets[i].revents != 0) {
+			entry.status = entry.database->poll();
+			if (entry.status == Database::AsyncStatus::COMPLETE) {
+				completed++;
+				continue;
+			}
+		}
+
+		entries.push_back(entry);
+	}
+
+	_entries.swap(entries);
+	return completed;
+}
+
+void AsyncSet::waitAll(const int timeout)
+{
+	std::chrono::steady_clock::time_point deadline =
+		std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+
+	while (_entries.empty() == false) {
+		int remaining = -1;
+		if (timeout >= 0) {
+			remaining = std::chrono::duration_cast<std::chrono::milliseconds>
+				(deadline - std::chrono::steady_clock::now()).count();
+			if (remaining <= 0) {
+				throw DATABASE_EXCEPTION(DatabaseException::TIMEOUT_ERROR,
+				                         "Timeout waiting for asynchronous operations");
+			}
+		}
+
+		waitOnce(remaining);
+	}
+}
+
+unsigned int AsyncSet::pending() const
+{
+	return _entries.size();
+}
+
+bool AsyncSet::pending(const Database &database) const
+{
+	for (const Entry &entry : _entries) {
+		if (entry.database == &database) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+DBPLUS_NS_END
@@ -25,27 +25,38 @@ DBPLUS_NS_BEGIN
 
 Binary::Binary(const unsigned char *data, const unsigned long size) :
 	_data(0),
-	_size(size)
+	_size(0),
+	_capacity(0)
 {
-	_data = new unsigned char[_size];
-	memcpy(_data, data, size);
+	assign(data, size);
 }
 
 Binary::Binary(const string &data) :
 	_data(0),
-	_size(data.size())
+	_size(0),
+	_capacity(0)
 {
-	_data = new unsigned char[_size];
-	memcpy(_data, data.c_str(), data.size());
+	assign(reinterpret_cast<const unsigned char*>(data.c_str()), data.size());
 }
 
 Binary::Binary(const Binary &binary) :
 	_data(0),
-	_size(0)
+	_size(0),
+	_capacity(0)
 {
 	*this = binary;
 }
 
+Binary::Binary(Binary &&binary) :
+	_data(binary._data),
+	_size(binary._size),
+	_capacity(binary._capacity)
+{
+	binary._data = 0;
+	binary._size = 0;
+	binary._capacity = 0;
+}
+
 Binary::~Binary()
 {
 	delete[] _data;
@@ -53,15 +64,44 @@ Binary::~Binary()
 
 Binary& Binary::operator=(const Binary &binary)
 {
-	delete[] _data;
+	if (this != &binary) {
+		assign(binary._data, binary._size);
+	}
+
+	return *this;
+}
+
+Binary& Binary::operator=(Binary &&binary)
+{
+	if (this != &binary) {
+		delete[] _data;
+
+		_data = binary._data;
+		_size = binary._size;
+		_capacity = binary._capacity;
 
-	_size = binary._size;
-	_data = new unsigned char[_size];
-	memcpy(_data, binary._data, binary._size);
+		binary._data = 0;
+		binary._size = 0;
+		binary._capacity = 0;
+	}
 
 	return *this;
 }
 
+void Binary::assign(const unsigned char *data, const unsigned long size)
+{
+	if (size > _capacity || _data == 0) {
+		delete[] _data;
+		_data = new unsigned char[size];
+		_capacity = size;
+	}
+
+	if (size > 0) {
+		memcpy(_data, data, size);
+	}
+	_size = size;
+}
+
 bool Binary::operator==(const Binary &binary) const
 {
 	if (_size != binary._size) {
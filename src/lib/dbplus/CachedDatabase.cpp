@@ -0,0 +1,222 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <dbplus/CachedDatabase.hpp>
+#include <dbplus/SqlInspector.hpp>
+#include <dbplus/StoredResult.hpp>
+
+DBPLUS_NS_BEGIN
+
+CachedDatabase::CachedDatabase(std::shared_ptr<Database> database, 
+                               std::shared_ptr<QueryCache> cache) :
+	DatabaseProxy(database),
+	_cache(cache),
+	_writtenUnknown(false)
+{
+}
+
+std::shared_ptr<QueryCache> CachedDatabase::getCache() const
+{
+	return _cache;
+}
+
+void CachedDatabase::setTransactionMode(const TransactionMode::Value mode)
+{
+	DatabaseProxy::setTransactionMode(mode);
+	if (mode == TransactionMode::AUTO_COMMIT) {
+		finishTransaction();
+	}
+}
+
+void CachedDatabase::commit()
+{
+	DatabaseProxy::commit();
+	finishTransaction();
+}
+
+void CachedDatabase::rollback()
+{
+	DatabaseProxy::rollback();
+	finishTransaction();
+}
+
+std::shared_ptr<Result> CachedDatabase::execute(const string &query, 
+                                                const ResultMode::Value resultMode)
+{
+	std::set<string> tables;
+	if (isCacheable(query, resultMode, tables) == false) {
+		try {
+			std::shared_ptr<Result> result = DatabaseProxy::execute(query, resultMode);
+			written(query);
+			return result;
+		} catch (...) {
+			// The write could have changed something before failing
+			written(query);
+			throw;
+		}
+	}
+
+	std::shared_ptr<const StoredResult::Data> data = _cache->get(query);
+	if (data) {
+		return std::shared_ptr<Result>(new StoredResult(data));
+	}
+
+	unsigned long long ticket = _cache->ticket();
+	std::shared_ptr<Result> result = DatabaseProxy::execute(query, resultMode);
+	if (!result) {
+		return result;
+	}
+
+	data = capture(result);
+	_cache->put(query, data, tables, ticket);
+
+	return std::shared_ptr<Result>(new StoredResult(data));
+}
+
+std::shared_ptr<Result> 
+CachedDatabase::execute(const string &query, const std::chrono::milliseconds timeout)
+{
+	// The deadline is implemented with executeAsync, that uses the cache
+	return Database::execute(query, timeout);
+}
+
+CachedDatabase::AsyncStatus::Value 
+CachedDatabase::executeAsync(const string &query, AsyncCallback callback)
+{
+	std::set<string> tables;
+	if (isCacheable(query, ResultMode::STORE_RESULT, tables) == false) {
+		return DatabaseProxy::executeAsync(query, 
+		  [this, query, callback](std::shared_ptr<Result> result, 
+		                          std::exception_ptr error) {
+			  written(query);
+			  callback(result, error);
+		  });
+	}
+
+	std::shared_ptr<const StoredResult::Data> data = _cache->get(query);
+	if (data) {
+		callback(std::shared_ptr<Result>(new StoredResult(data)), 
+		         std::exception_ptr());
+		return AsyncStatus::COMPLETE;
+	}
+
+	std::shared_ptr<QueryCache> cache = _cache;
+	unsigned long long ticket = _cache->ticket();
+
+	return DatabaseProxy::executeAsync(query, 
+	  [cache, query, tables, ticket, callback](std::shared_ptr<Result> result, 
+	                                           std::exception_ptr error) {
+		  if (error || !result) {
+			  callback(result, error);
+			  return;
+		  }
+
+		  std::shared_ptr<const StoredResult::Data> data;
+		  try {
+			  data = capture(result);
+		  } catch (...) {
+			  callback(std::shared_ptr<Result>(), std::current_exception());
+			  return;
+		  }
+
+		  cache->put(query, data, tables, ticket);
+		  callback(std::shared_ptr<Result>(new StoredResult(data)), 
+		           std::exception_ptr());
+	  });
+}
+
+CachedDatabase::AsyncStatus::Value CachedDatabase::commitAsync(AsyncCallback callback)
+{
+	return DatabaseProxy::commitAsync(
+	  [this, callback](std::shared_ptr<Result> result, std::exception_ptr error) {
+		  finishTransaction();
+		  callback(result, error);
+	  });
+}
+
+CachedDatabase::AsyncStatus::Value CachedDatabase::rollbackAsync(AsyncCallback callback)
+{
+	return DatabaseProxy::rollbackAsync(
+	  [this, callback](std::shared_ptr<Result> result, std::exception_ptr error) {
+		  finishTransaction();
+		  callback(result, error);
+	  });
+}
+
+std::shared_ptr<const StoredResult::Data> 
+CachedDatabase::capture(std::shared_ptr<Result> result)
+{
+	// Rows already stored, like the ones of a CoalescedDatabase, are
+	// shared instead of copied
+	std::shared_ptr<StoredResult> stored = std::dynamic_pointer_cast<StoredResult>(result);
+	if (stored) {
+		return stored->getData();
+	}
+
+	return std::shared_ptr<const StoredResult::Data>(new StoredResult::Data(*result));
+}
+
+bool CachedDatabase::isCacheable(const string &query, 
+                                 const ResultMode::Value resultMode,
+                                 std::set<string> &tables) const
+{
+	if (resultMode != ResultMode::STORE_RESULT ||
+	    getTransactionMode() != TransactionMode::AUTO_COMMIT ||
+	    SqlInspector::isReadOnly(query) == false) {
+		return false;
+	}
+
+	// Queries without tables, like SELECT NOW(), can't be invalidated
+	tables = SqlInspector::tables(query);
+	return tables.empty() == false;
+}
+
+void CachedDatabase::written(const string &query)
+{
+	if (SqlInspector::isReadOnly(query)) {
+		return;
+	}
+
+	std::set<string> tables = SqlInspector::tables(query);
+	if (tables.empty()) {
+		_cache->clear();
+	} else {
+		_cache->invalidate(tables);
+	}
+
+	// Other connections could cache the old rows until the commit
+	if (getTransactionMode() == TransactionMode::MANUAL_COMMIT) {
+		_writtenTables.insert(tables.begin(), tables.end());
+		_writtenUnknown = _writtenUnknown || tables.empty();
+	}
+}
+
+void CachedDatabase::finishTransaction()
+{
+	if (_writtenUnknown) {
+		_cache->clear();
+	} else if (_writtenTables.empty() == false) {
+		_cache->invalidate(_writtenTables);
+	}
+
+	_writtenTables.clear();
+	_writtenUnknown = false;
+}
+
+DBPLUS_NS_END
@@ -0,0 +1,55 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <dbplus/CoalescedDatabase.hpp>
+#include <dbplus/SqlInspector.hpp>
+
+DBPLUS_NS_BEGIN
+
+CoalescedDatabase::CoalescedDatabase(std::shared_ptr<Database> database, 
+                                     std::shared_ptr<SingleFlight> flights) :
+	DatabaseProxy(database),
+	_flights(flights)
+{
+}
+
+std::shared_ptr<SingleFlight> CoalescedDatabase::getFlights() const
+{
+	return _flights;
+}
+
+std::shared_ptr<Result> CoalescedDatabase::execute(const string &query, 
+                                                   const ResultMode::Value resultMode)
+{
+	// Queries in a transaction can see data that was not committed
+	if (resultMode != ResultMode::STORE_RESULT ||
+	    getTransactionMode() != TransactionMode::AUTO_COMMIT ||
+	    SqlInspector::isReadOnly(query) == false) {
+		return DatabaseProxy::execute(query, resultMode);
+	}
+
+	std::shared_ptr<const StoredResult::Data> data = _flights->execute(*_database, query);
+	if (!data) {
+		return std::shared_ptr<Result>();
+	}
+
+	return std::shared_ptr<Result>(new StoredResult(data));
+}
+
+DBPLUS_NS_END
@@ -0,0 +1,209 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+extern "C" {
+#include <poll.h>
+}
+
+#include <cerrno>
+#include <cstring>
+
+#include <dbplus/Database.hpp>
+#include <dbplus/DatabaseException.hpp>
+
+DBPLUS_NS_BEGIN
+
+void Database::escape(const string &value, string &buffer)
+{
+	buffer += escape(value);
+}
+
+std::shared_ptr<Result> Database::execute(const string &query, 
+                                          const std::chrono::milliseconds timeout)
+{
+	// The callback can outlive this frame when the connection is
+	// closed by the caller later, so it only references shared state
+	struct Outcome {
+		std::shared_ptr<Result> result;
+		std::exception_ptr error;
+	};
+
+	std::shared_ptr<Outcome> outcome(new Outcome());
+
+	AsyncStatus::Value status = 
+		executeAsync(query, [outcome](std::shared_ptr<Result> r,
+		                              std::exception_ptr e) {
+			outcome->result = r;
+			outcome->error = e;
+		});
+
+	std::chrono::steady_clock::time_point deadline =
+		std::chrono::steady_clock::now() + timeout;
+	bool cancelled = false;
+
+	while (status != AsyncStatus::COMPLETE) {
+		int remaining = std::chrono::duration_cast<std::chrono::milliseconds>
+			(deadline - std::chrono::steady_clock::now()).count();
+		if (remaining <= 0) {
+			if (cancelled) {
+				// The server didn't abort the query, so the connection
+				// is out of sync and the operation is abandoned
+				disconnect();
+				throw DATABASE_EXCEPTION(DatabaseException::TIMEOUT_ERROR,
+				                         "Query didn't stop after the deadline, "
+				                         "connection closed");
+			}
+
+			// After the cancel request the server answers with an error,
+			// that must be read to keep the connection synchronized. If
+			// the request fails the query is still waited for
+			try {
+				cancel();
+			} catch (const DatabaseException &e) {
+			}
+
+			cancelled = true;
+			deadline = std::chrono::steady_clock::now() + timeout;
+			continue;
+		}
+
+		struct pollfd descriptor;
+		descriptor.fd = getSocket();
+		descriptor.events = (status == AsyncStatus::WAIT_READ ? POLLIN : POLLOUT);
+		descriptor.revents = 0;
+
+		int ready = ::poll(&descriptor, 1, remaining);
+		if (ready < 0 && errno != EINTR) {
+			string message = strerror(errno);
+			disconnect();
+			throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR, message);
+		}
+
+		if (ready > 0) {
+			status = poll();
+		}
+	}
+
+	// Some queries are interrupted without errors, like MySQL SLEEP,
+	// so the timeout is reported even when the query succeeded
+	if (cancelled) {
+		throw DATABASE_EXCEPTION(DatabaseException::TIMEOUT_ERROR,
+		                         "Query cancelled after the deadline");
+	}
+
+	if (outcome->error) {
+		std::rethrow_exception(outcome->error);
+	}
+
+	return outcome->result;
+}
+
+std::shared_ptr<Result> Database::execute(const string &query, 
+                                          std::shared_ptr<Result> result)
+{
+	return execute(query);
+}
+
+Database::AsyncStatus::Value Database::connectAsync(const string &database, 
+                                                   const string &user, 
+                                                   const string &password, 
+                                                   const string &server, 
+                                                   const unsigned int port,
+                                                   AsyncCallback callback)
+{
+	return runBlocking([&]() {
+		connect(database, user, password, server, port);
+		return std::shared_ptr<Result>();
+	}, callback);
+}
+
+bool Database::ping()
+{
+	try {
+		execute("SELECT 1");
+	} catch (const DatabaseException &e) {
+		return false;
+	}
+
+	return true;
+}
+
+void Database::cancel()
+{
+	throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR,
+	                         "Cancel is not supported by this driver");
+}
+
+Database::AsyncStatus::Value Database::executeAsync(const string &query, 
+                                                   AsyncCallback callback)
+{
+	return runBlocking([&]() {
+		return execute(query);
+	}, callback);
+}
+
+Database::AsyncStatus::Value Database::commitAsync(AsyncCallback callback)
+{
+	return runBlocking([&]() {
+		commit();
+		return std::shared_ptr<Result>();
+	}, callback);
+}
+
+Database::AsyncStatus::Value Database::rollbackAsync(AsyncCallback callback)
+{
+	return runBlocking([&]() {
+		rollback();
+		return std::shared_ptr<Result>();
+	}, callback);
+}
+
+Database::AsyncStatus::Value Database::poll()
+{
+	return AsyncStatus::COMPLETE;
+}
+
+int Database::getSocket() const
+{
+	return -1;
+}
+
+Database::AsyncStatus::Value 
+Database::runBlocking(std::function<std::shared_ptr<Result> ()> operation,
+                      AsyncCallback callback)
+{
+	std::shared_ptr<Result> result;
+	std::exception_ptr error;
+
+	// Only errors of the operation are given to the callback, errors
+	// of the callback go to the caller
+	try {
+		result = operation();
+	} catch (const DatabaseException &e) {
+		error = std::current_exception();
+	}
+
+	if (callback) {
+		callback(result, error);
+	}
+
+	return AsyncStatus::COMPLETE;
+}
+
+DBPLUS_NS_END
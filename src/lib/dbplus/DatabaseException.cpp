@@ -27,7 +27,8 @@ DatabaseException::DatabaseException(const Code code,
                                      const string &file,
                                      const string &function,
                                      const int line,
-                                     const string &message) throw()
+                                     const string &message) throw() :
+	_code(code)
 {
 	_message = "[DatabaseException] In file " + file + " "
 		"at line " + boost::lexical_cast<string>(line) + ": "
@@ -43,4 +44,9 @@ const char* DatabaseException::what() const throw()
 	return _message.c_str();
 }
 
+DatabaseException::Code DatabaseException::getCode() const throw()
+{
+	return _code;
+}
+
 DBPLUS_NS_END
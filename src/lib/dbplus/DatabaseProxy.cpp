@@ -0,0 +1,147 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <dbplus/DatabaseProxy.hpp>
+
+DBPLUS_NS_BEGIN
+
+DatabaseProxy::DatabaseProxy(std::shared_ptr<Database> database) :
+	_database(database)
+{
+}
+
+std::shared_ptr<Database> DatabaseProxy::getDatabase() const
+{
+	return _database;
+}
+
+void DatabaseProxy::connect(const string &database,
+                            const string &user,
+                            const string &password,
+                            const string &server,
+                            const unsigned int port)
+{
+	_database->connect(database, user, password, server, port);
+}
+
+DatabaseProxy::AsyncStatus::Value 
+DatabaseProxy::connectAsync(const string &database,
+                            const string &user,
+                            const string &password,
+                            const string &server,
+                            const unsigned int port,
+                            AsyncCallback callback)
+{
+	return _database->connectAsync(database, user, password, server, port, callback);
+}
+
+void DatabaseProxy::disconnect()
+{
+	_database->disconnect();
+}
+
+bool DatabaseProxy::ping()
+{
+	return _database->ping();
+}
+
+void DatabaseProxy::setTransactionMode(const TransactionMode::Value mode)
+{
+	_database->setTransactionMode(mode);
+}
+
+DatabaseProxy::TransactionMode::Value DatabaseProxy::getTransactionMode() const
+{
+	return _database->getTransactionMode();
+}
+
+void DatabaseProxy::commit()
+{
+	_database->commit();
+}
+
+void DatabaseProxy::rollback()
+{
+	_database->rollback();
+}
+
+string DatabaseProxy::escape(const string &value)
+{
+	return _database->escape(value);
+}
+
+void DatabaseProxy::escape(const string &value, string &buffer)
+{
+	_database->escape(value, buffer);
+}
+
+std::shared_ptr<Result> DatabaseProxy::execute(const string &query, 
+                                               const ResultMode::Value resultMode)
+{
+	return _database->execute(query, resultMode);
+}
+
+std::shared_ptr<Result> DatabaseProxy::execute(const string &query, 
+                                               const std::chrono::milliseconds timeout)
+{
+	return _database->execute(query, timeout);
+}
+
+void DatabaseProxy::cancel()
+{
+	_database->cancel();
+}
+
+DatabaseProxy::AsyncStatus::Value 
+DatabaseProxy::executeAsync(const string &query, AsyncCallback callback)
+{
+	return _database->executeAsync(query, callback);
+}
+
+DatabaseProxy::AsyncStatus::Value DatabaseProxy::commitAsync(AsyncCallback callback)
+{
+	return _database->commitAsync(callback);
+}
+
+DatabaseProxy::AsyncStatus::Value DatabaseProxy::rollbackAsync(AsyncCallback callback)
+{
+	return _database->rollbackAsync(callback);
+}
+
+DatabaseProxy::AsyncStatus::Value DatabaseProxy::poll()
+{
+	return _database->poll();
+}
+
+int DatabaseProxy::getSocket() const
+{
+	return _database->getSocket();
+}
+
+unsigned long long DatabaseProxy::affectedRows()
+{
+	return _database->affectedRows();
+}
+
+unsigned long long DatabaseProxy::lastInsertedId()
+{
+	return _database->lastInsertedId();
+}
+
+DBPLUS_NS_END
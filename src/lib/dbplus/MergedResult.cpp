@@ -0,0 +1,124 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <dbplus/DatabaseException.hpp>
+#include <dbplus/MergedResult.hpp>
+
+DBPLUS_NS_BEGIN
+
+MergedResult::MergedResult(const std::vector<std::shared_ptr<Result> > &results,
+                           Less less) :
+	_less(less),
+	_started(false),
+	_current(NULL),
+	_next(0)
+{
+	for (auto result : results) {
+		if (result) {
+			_results.push_back(result);
+		}
+	}
+}
+
+unsigned int MergedResult::size() const
+{
+	unsigned int size = 0;
+	for (auto result : _results) {
+		size += result->size();
+	}
+
+	return size;
+}
+
+bool MergedResult::fetch()
+{
+	if (_less) {
+		return fetchSorted();
+	}
+
+	return fetchNext();
+}
+
+boost::any MergedResult::get(const string &key) const
+{
+	if (_current == NULL) {
+		throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR,
+		                         "There's no current row");
+	}
+
+	return _current->get(key);
+}
+
+const std::map<string, boost::any>& MergedResult::getRow() const
+{
+	if (_current == NULL) {
+		return _row;
+	}
+
+	return _current->getRow();
+}
+
+bool MergedResult::fetchNext()
+{
+	while (_next < _results.size()) {
+		if (_results[_next]->fetch()) {
+			_current = _results[_next].get();
+			return true;
+		}
+
+		_next++;
+	}
+
+	_current = NULL;
+	return false;
+}
+
+bool MergedResult::fetchSorted()
+{
+	if (_started == false) {
+		_started = true;
+		for (auto result : _results) {
+			if (result->fetch()) {
+				_heads.push_back(result.get());
+			}
+		}
+
+	} else if (_current != NULL && _current->fetch() == false) {
+		// The result that gave the last row is over
+		for (auto head = _heads.begin(); head != _heads.end(); head++) {
+			if (*head == _current) {
+				_heads.erase(head);
+				break;
+			}
+		}
+	}
+
+	// There are few results (one per database), so a linear search is
+	// as fast as a heap
+	_current = NULL;
+	for (Result *head : _heads) {
+		if (_current == NULL || _less(*head, *_current)) {
+			_current = head;
+		}
+	}
+
+	return _current != NULL;
+}
+
+DBPLUS_NS_END
@@ -17,14 +17,31 @@
   along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+extern "C" {
+#include <poll.h>
+}
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include <boost/lexical_cast.hpp>
+
 #include <dbplus/DatabaseException.hpp>
 #include <dbplus/MySql.hpp>
 #include <dbplus/MySqlResult.hpp>
+#include <dbplus/SqlValue.hpp>
+#include <dbplus/TextScan.hpp>
 
 DBPLUS_NS_BEGIN
 
 MySql::MySql() :
-	_transactionMode(TransactionMode::AUTO_COMMIT)
+	_port(0),
+	_transactionMode(TransactionMode::AUTO_COMMIT),
+	_initialized(false),
+	_multiStatements(false),
+	_memoryLimit(0),
+	_asyncState(ASYNC_IDLE)
 {
 }
 
@@ -39,17 +56,14 @@ void MySql::connect(const string &database,
                     const string &server,
                     const unsigned int port)
 {
-	if (mysql_init(&_mysql) == NULL) {
-		throw DATABASE_EXCEPTION(DatabaseException::CONNECTION_ERROR, 
-		                         mysql_error(&_mysql));
-	}
+	initialize(database, user, password, server, port);
 
 	if (mysql_real_connect(&_mysql,
-	                       server.c_str(), 
-	                       user.c_str(), 
-	                       password.c_str(), 
-	                       database.c_str(), 
-	                       port, NULL, 0) != &_mysql) {
+	                       _server.c_str(), 
+	                       _user.c_str(), 
+	                       _password.c_str(), 
+	                       _database.c_str(), 
+	                       _port, NULL, clientFlags()) != &_mysql) {
 		throw DATABASE_EXCEPTION(DatabaseException::CONNECTION_ERROR, 
 		                         mysql_error(&_mysql));
 	}
@@ -57,9 +71,72 @@ void MySql::connect(const string &database,
 	setTransactionMode(_transactionMode);
 }
 
+MySql::AsyncStatus::Value MySql::connectAsync(const string &database,
+                                              const string &user,
+                                              const string &password,
+                                              const string &server,
+                                              const unsigned int port,
+                                              AsyncCallback callback)
+{
+	if (_asyncState != ASYNC_IDLE) {
+		throw DATABASE_EXCEPTION(DatabaseException::CONNECTION_ERROR, 
+		                         "Asynchronous operation already in progress");
+	}
+
+	initialize(database, user, password, server, port);
+
+	_asyncState = ASYNC_CONNECT;
+	_asyncCallback = callback;
+	_asyncResult.reset();
+
+	return poll();
+}
+
 void MySql::disconnect()
 {
-	mysql_close(&_mysql);
+	// An operation in progress is abandoned without calling its
+	// callback
+	_asyncState = ASYNC_IDLE;
+	_asyncQuery.clear();
+	_asyncCallback = AsyncCallback();
+	_asyncResult.reset();
+
+	if (_initialized) {
+		mysql_close(&_mysql);
+		_initialized = false;
+	}
+}
+
+bool MySql::ping()
+{
+	return _initialized && mysql_ping(&_mysql) == 0;
+}
+
+void MySql::cancel()
+{
+	if (_initialized == false) {
+		return;
+	}
+
+	string query = "KILL QUERY " + 
+		boost::lexical_cast<string>(mysql_thread_id(&_mysql));
+
+	MYSQL killer;
+	mysql_init(&killer);
+
+	if (mysql_real_connect(&killer,
+	                       _server.c_str(), 
+	                       _user.c_str(), 
+	                       _password.c_str(), 
+	                       NULL,
+	                       _port, NULL, 0) != &killer ||
+	    mysql_real_query(&killer, query.c_str(), query.size()) != 0) {
+		string message = mysql_error(&killer);
+		mysql_close(&killer);
+		throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR, message);
+	}
+
+	mysql_close(&killer);
 }
 
 void MySql::setTransactionMode(const TransactionMode::Value mode)
@@ -105,23 +182,725 @@ void MySql::rollback()
 
 string MySql::escape(const string &value)
 {
-	char escapedValue[value.size() + 1];
-	mysql_real_escape_string(&_mysql, escapedValue, value.c_str(), value.size());
-	return static_cast<string>(escapedValue);
+	string escapedValue;
+	escape(value, escapedValue);
+	return escapedValue;
+}
+
+void MySql::escape(const string &value, string &buffer)
+{
+	// Characters escaped by mysql_real_escape_string
+	static const string special("\0\n\r\\'\"\032", 7);
+
+	const char *data = value.data();
+	unsigned long size = value.size();
+
+	// In these character sets a byte of a multibyte character is
+	// never a special character, and without NO_BACKSLASH_ESCAPES the
+	// special characters are always escaped with a backslash
+	const char *charset = mysql_character_set_name(&_mysql);
+	bool simple = (_mysql.server_status & SERVER_STATUS_NO_BACKSLASH_ESCAPES) == 0 &&
+		charset != NULL &&
+		(strncmp(charset, "utf8", 4) == 0 || strcmp(charset, "latin1") == 0 ||
+		 strcmp(charset, "ascii") == 0 || strcmp(charset, "binary") == 0);
+
+	unsigned long position = 0;
+	while (position < size) {
+		unsigned long run = TextScan::find(data + position, size - position, 
+		                                   special, simple == false);
+		buffer.append(data + position, run);
+		position += run;
+
+		if (position == size) {
+			break;
+		}
+
+		if (simple == false) {
+			// The client library escapes the rest, that can have
+			// multibyte characters. It writes at most 2n+1 bytes. With
+			// NO_BACKSLASH_ESCAPES only the quote of the literal can be
+			// escaped, so the values must be written between single
+			// quotes
+			string::size_type start = buffer.size();
+			buffer.resize(start + 2 * (size - position) + 1);
+			unsigned long length = 
+				mysql_real_escape_string_quote(&_mysql, &buffer[start], 
+				                               data + position, 
+				                               size - position, '\'');
+			if (length == static_cast<unsigned long>(-1)) {
+				buffer.resize(start);
+				throw DATABASE_EXCEPTION(DatabaseException::CONVERSION_ERROR, 
+				                         "Value could not be escaped");
+			}
+
+			buffer.resize(start + length);
+			break;
+		}
+
+		buffer += '\\';
+		switch (data[position]) {
+		case '\0':
+			buffer += '0';
+			break;
+		case '\n':
+			buffer += 'n';
+			break;
+		case '\r':
+			buffer += 'r';
+			break;
+		case '\032':
+			buffer += 'Z';
+			break;
+		default:
+			buffer += data[position];
+		}
+
+		position++;
+	}
 }
 
 std::shared_ptr<Result> MySql::execute(const string &query, 
                                        const ResultMode::Value resultMode)
+{
+	if (sendQuery(query) == false) {
+		return std::shared_ptr<Result>();
+	}
+
+	if (resultMode == ResultMode::STORE_RESULT && limitsMemory()) {
+		MYSQL_RES *columns = storeResult(ResultMode::USE_RESULT);
+		std::shared_ptr<Result> result(new MySqlResult(columns, readRows(columns)));
+		discardResults();
+		return result;
+	}
+
+	std::shared_ptr<Result> result(new MySqlResult(storeResult(resultMode)));
+
+	// With multi-statements the other results must be consumed to keep
+	// the connection synchronized. In USE_RESULT mode this is only
+	// possible after the current result is released, so it's done in
+	// the next execution
+	if (resultMode == ResultMode::STORE_RESULT) {
+		discardResults();
+	}
+
+	return result;
+}
+
+unsigned long long 
+MySql::executeBulk(const string &statement, 
+                   const std::vector<ParameterColumn> &parameters,
+                   const bool grouped)
+{
+	unsigned int rows = ParameterColumn::rows(parameters);
+
+	discardResults();
+
+	if (grouped) {
+		return executeGrouped(statement, parameters, rows);
+	}
+
+	return executePrepared(statement, parameters, rows);
+}
+
+unsigned long long 
+MySql::executePrepared(const string &statement, 
+                       const std::vector<ParameterColumn> &parameters,
+                       const unsigned int rows)
+{
+	MYSQL_STMT *prepared = mysql_stmt_init(&_mysql);
+	if (prepared == NULL) {
+		throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR, 
+		                         mysql_error(&_mysql));
+	}
+
+	unsigned long long affectedRows = 0;
+
+	try {
+		if (mysql_stmt_prepare(prepared, statement.c_str(), 
+		                       statement.size()) != 0) {
+			throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR, 
+			                         mysql_stmt_error(prepared));
+		}
+
+		if (mysql_stmt_param_count(prepared) != parameters.size()) {
+			throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR, 
+			                         "Wrong number of parameter columns");
+		}
+
+		std::vector<MYSQL_BIND> binds(parameters.size());
+		std::vector<unsigned long> lengths(parameters.size());
+		memset(binds.data(), 0, binds.size() * sizeof(MYSQL_BIND));
+
+		for (unsigned int i = 0; i < parameters.size(); i++) {
+			MYSQL_BIND &bind = binds[i];
+			bind.is_null = &bind.is_null_value;
+
+			switch (parameters[i].getType()) {
+			case ParameterColumn::Type::INTEGER:
+				bind.buffer_type = MYSQL_TYPE_LONGLONG;
+				break;
+			case ParameterColumn::Type::DOUBLE:
+				bind.buffer_type = MYSQL_TYPE_DOUBLE;
+				break;
+			case ParameterColumn::Type::TEXT:
+				bind.buffer_type = MYSQL_TYPE_STRING;
+				bind.length = &lengths[i];
+				break;
+			}
+		}
+
+		// The MySQL client copies the bindings, so they are bound again
+		// after pointing to the values of the next row
+		for (unsigned int row = 0; row < rows; row++) {
+			for (unsigned int i = 0; i < parameters.size(); i++) {
+				const ParameterColumn &column = parameters[i];
+				MYSQL_BIND &bind = binds[i];
+				bind.is_null_value = column.isNull(row);
+
+				switch (column.getType()) {
+				case ParameterColumn::Type::INTEGER:
+					bind.buffer = const_cast<long long*>(column.getIntegers() + row);
+					break;
+				case ParameterColumn::Type::DOUBLE:
+					bind.buffer = const_cast<double*>(column.getDoubles() + row);
+					break;
+				case ParameterColumn::Type::TEXT: {
+					const string &text = column.getTexts()[row];
+					bind.buffer = const_cast<char*>(text.data());
+					bind.buffer_length = text.size();
+					lengths[i] = text.size();
+					break;
+				}
+				}
+			}
+
+			if (mysql_stmt_bind_param(prepared, binds.data()) != 0 ||
+			    mysql_stmt_execute(prepared) != 0) {
+				throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR, 
+				                         mysql_stmt_error(prepared));
+			}
+
+			affectedRows += mysql_stmt_affected_rows(prepared);
+		}
+
+	} catch (const DatabaseException &e) {
+		mysql_stmt_close(prepared);
+		throw;
+	}
+
+	mysql_stmt_close(prepared);
+	return affectedRows;
+}
+
+unsigned long long 
+MySql::executeGrouped(const string &statement, 
+                      const std::vector<ParameterColumn> &parameters,
+                      const unsigned int rows)
+{
+	// Without backslash escapes the quoted text of the statement can't
+	// be split safely
+	if (_mysql.server_status & SERVER_STATUS_NO_BACKSLASH_ESCAPES) {
+		throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR, 
+		                         "Grouped executions need backslash escapes");
+	}
+
+	std::vector<string> parts = splitPlaceholders(statement);
+	if (parts.size() != parameters.size() + 1) {
+		throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR, 
+		                         "Wrong number of parameter columns");
+	}
+
+	// The prepared statements of MySQL can't be pipelined, so the
+	// executions are written as text and sent in groups of statements,
+	// one round trip per group. Multi-statements are enabled only
+	// during the execution when the connection doesn't use them
+	if (_multiStatements == false &&
+	    mysql_set_server_option(&_mysql, MYSQL_OPTION_MULTI_STATEMENTS_ON) != 0) {
+		throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR, 
+		                         mysql_error(&_mysql));
+	}
+
+	const unsigned int BLOCK_SIZE = 1000;
+	const unsigned long BLOCK_BYTES = 1024 * 1024;
+
+	unsigned long long affectedRows = 0;
+	string query;
+
+	try {
+		unsigned int row = 0;
+		while (row < rows) {
+			query.clear();
+
+			unsigned int first = row;
+			while (row < rows && row - first < BLOCK_SIZE && 
+			       (row == first || query.size() < BLOCK_BYTES)) {
+				if (row > first) {
+					query += ';';
+				}
+
+				appendExecution(parts, parameters, row, query);
+				row++;
+			}
+
+			affectedRows += executeGroup(query);
+		}
+
+	} catch (const DatabaseException &e) {
+		if (_multiStatements == false) {
+			mysql_set_server_option(&_mysql, MYSQL_OPTION_MULTI_STATEMENTS_OFF);
+		}
+		throw;
+	}
+
+	if (_multiStatements == false &&
+	    mysql_set_server_option(&_mysql, MYSQL_OPTION_MULTI_STATEMENTS_OFF) != 0) {
+		throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR, 
+		                         mysql_error(&_mysql));
+	}
+
+	return affectedRows;
+}
+
+std::shared_ptr<Result> MySql::execute(const string &query, 
+                                       std::shared_ptr<Result> result)
+{
+	if (sendQuery(query) == false) {
+		return std::shared_ptr<Result>();
+	}
+
+	MYSQL_RES *stored = NULL;
+	std::shared_ptr<RowStore> rows;
+	if (limitsMemory()) {
+		stored = storeResult(ResultMode::USE_RESULT);
+		rows = readRows(stored);
+	} else {
+		stored = storeResult(ResultMode::STORE_RESULT);
+	}
+
+	MySqlResult *reused = dynamic_cast<MySqlResult*>(result.get());
+	if (reused != NULL) {
+		reused->reset(stored, rows);
+	} else {
+		result.reset(new MySqlResult(stored, rows));
+	}
+
+	discardResults();
+	return result;
+}
+
+std::vector<std::shared_ptr<Result> > MySql::executeMulti(const string &query)
+{
+	discardResults();
+
+	if (mysql_real_query(&_mysql, query.c_str(), query.size()) != 0) {
+		throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR, 
+		                         mysql_error(&_mysql));
+	}
+
+	std::vector<std::shared_ptr<Result> > results;
+
+	while (true) {
+		if (mysql_field_count(&_mysql) == 0) {
+			results.push_back(std::shared_ptr<Result>());
+		} else {
+			MYSQL_RES *result = storeResult(ResultMode::STORE_RESULT);
+			results.push_back(std::shared_ptr<Result>(new MySqlResult(result)));
+		}
+
+		int status = mysql_next_result(&_mysql);
+		if (status < 0) {
+			break;
+		} else if (status > 0) {
+			throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR, 
+			                         mysql_error(&_mysql));
+		}
+	}
+
+	return results;
+}
+
+void MySql::setMultiStatements(const bool multiStatements)
+{
+	_multiStatements = multiStatements;
+}
+
+bool MySql::getMultiStatements() const
+{
+	return _multiStatements;
+}
+
+void MySql::setMemoryLimit(const unsigned long bytes)
+{
+	_memoryLimit = bytes;
+}
+
+unsigned long MySql::getMemoryLimit() const
+{
+	return _memoryLimit;
+}
+
+MySql::AsyncStatus::Value MySql::executeAsync(const string &query, 
+                                              AsyncCallback callback)
+{
+	if (_asyncState != ASYNC_IDLE) {
+		throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR, 
+		                         "Asynchronous operation already in progress");
+	}
+
+	discardResults();
+
+	_asyncState = ASYNC_QUERY;
+	_asyncQuery = query;
+	_asyncCallback = callback;
+	_asyncResult.reset();
+
+	return poll();
+}
+
+MySql::AsyncStatus::Value MySql::commitAsync(AsyncCallback callback)
+{
+	return executeAsync("COMMIT", callback);
+}
+
+MySql::AsyncStatus::Value MySql::rollbackAsync(AsyncCallback callback)
+{
+	return executeAsync("ROLLBACK", callback);
+}
+
+MySql::AsyncStatus::Value MySql::poll()
+{
+	bool retried = false;
+
+	while (_asyncState != ASYNC_IDLE) {
+		net_async_status status = NET_ASYNC_COMPLETE;
+
+		switch (_asyncState) {
+		case ASYNC_IDLE:
+			break;
+
+		case ASYNC_CONNECT:
+			status = mysql_real_connect_nonblocking(&_mysql,
+			                                        _server.c_str(), 
+			                                        _user.c_str(), 
+			                                        _password.c_str(), 
+			                                        _database.c_str(), 
+			                                        _port, NULL, clientFlags());
+			if (status == NET_ASYNC_COMPLETE) {
+				// The server starts in autocommit mode, so only the manual
+				// mode needs to be sent
+				if (_transactionMode == TransactionMode::AUTO_COMMIT) {
+					return finishAsync(std::shared_ptr<Result>(), 
+					                   std::exception_ptr());
+				}
+
+				_asyncState = ASYNC_QUERY;
+				_asyncQuery = "SET autocommit=0";
+			}
+			break;
+
+		case ASYNC_QUERY:
+			status = mysql_real_query_nonblocking(&_mysql, 
+			                                      _asyncQuery.c_str(), 
+			                                      _asyncQuery.size());
+			if (status == NET_ASYNC_COMPLETE) {
+				_asyncState = mysql_field_count(&_mysql) == 0 ? 
+					ASYNC_NEXT_RESULT : ASYNC_STORE;
+			}
+			break;
+
+		case ASYNC_STORE:
+		case ASYNC_DISCARD: {
+			MYSQL_RES *result = NULL;
+			status = mysql_store_result_nonblocking(&_mysql, &result);
+			if (status != NET_ASYNC_COMPLETE) {
+				break;
+			}
+
+			if (result == NULL && mysql_field_count(&_mysql) != 0) {
+				status = NET_ASYNC_ERROR;
+			} else if (_asyncState == ASYNC_STORE) {
+				_asyncResult.reset(new MySqlResult(result));
+			} else if (result != NULL) {
+				mysql_free_result(result);
+			}
+
+			_asyncState = ASYNC_NEXT_RESULT;
+		} break;
+
+		case ASYNC_NEXT_RESULT:
+			// Other results of a multi-statement query are discarded,
+			// like in the execute method
+			if (mysql_more_results(&_mysql) == false) {
+				return finishAsync(_asyncResult, std::exception_ptr());
+			}
+
+			status = mysql_next_result_nonblocking(&_mysql);
+			if (status == NET_ASYNC_COMPLETE) {
+				_asyncState = ASYNC_DISCARD;
+			} else if (status == NET_ASYNC_COMPLETE_NO_MORE_RESULTS) {
+				return finishAsync(_asyncResult, std::exception_ptr());
+			}
+			break;
+		}
+
+		if (status == NET_ASYNC_NOT_READY) {
+			// The server answers only after the whole query, so waiting
+			// to read while the client is still sending never finishes
+			if ((_asyncState == ASYNC_CONNECT || _asyncState == ASYNC_QUERY) && 
+			    sendBlocked()) {
+				return AsyncStatus::WAIT_WRITE;
+			}
+
+			// The buffer can be emptied after the client stopped
+			// sending, so the operation is tried again once before
+			// waiting to read
+			if (retried == false) {
+				retried = true;
+				continue;
+			}
+
+			return AsyncStatus::WAIT_READ;
+		}
+
+		if (status == NET_ASYNC_ERROR) {
+			DatabaseException error = 
+				DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR, 
+				                   mysql_error(&_mysql));
+			return finishAsync(std::shared_ptr<Result>(), std::make_exception_ptr(error));
+		}
+	}
+
+	return AsyncStatus::COMPLETE;
+}
+
+bool MySql::sendBlocked() const
+{
+	struct pollfd descriptor;
+	descriptor.fd = _mysql.net.fd;
+	descriptor.events = POLLOUT;
+	descriptor.revents = 0;
+
+	return ::poll(&descriptor, 1, 0) == 0;
+}
+
+int MySql::getSocket() const
+{
+	return _mysql.net.fd;
+}
+
+unsigned long long MySql::affectedRows()
+{
+	return mysql_affected_rows(&_mysql);
+}
+
+unsigned long long MySql::lastInsertedId()
+{
+	return mysql_insert_id(&_mysql);
+}
+
+void MySql::initialize(const string &database,
+                       const string &user,
+                       const string &password,
+                       const string &server,
+                       const unsigned int port)
+{
+	disconnect();
+
+	if (mysql_init(&_mysql) == NULL) {
+		throw DATABASE_EXCEPTION(DatabaseException::CONNECTION_ERROR, 
+		                         mysql_error(&_mysql));
+	}
+
+	_initialized = true;
+
+	// The non-blocking API must receive the same arguments in every
+	// call, so they are stored in the object
+	_database = database;
+	_user = user;
+	_password = password;
+	_server = server;
+	_port = port;
+}
+
+std::vector<string> MySql::splitPlaceholders(const string &statement)
+{
+	std::vector<string> parts(1);
+
+	// The executions are joined with semicolons, so the last one of
+	// the statement is removed
+	unsigned int size = statement.size();
+	while (size > 0 && (statement[size - 1] == ';' || 
+	                    isspace(static_cast<unsigned char>(statement[size - 1])))) {
+		size--;
+	}
+
+	unsigned int i = 0;
+	while (i < size) {
+		char current = statement[i];
+
+		if (current == '?') {
+			parts.push_back(string());
+			i++;
+			continue;
+		}
+
+		// Quoted text and comments are copied without looking for
+		// placeholders
+		unsigned int end = i + 1;
+		if (current == '\'' || current == '"' || current == '`') {
+			while (end < size && statement[end] != current) {
+				if (statement[end] == '\\' && current != '`') {
+					end++;
+				}
+				end++;
+			}
+			end = std::min(end + 1, size);
+		} else if (current == '#' || 
+		           (current == '-' && statement.compare(i, 3, "-- ") == 0)) {
+			// A comment at the end would hide the next execution
+			string::size_type line = statement.find('\n', i);
+			if (line == string::npos || line >= size) {
+				parts.back().append(statement, i, size - i);
+				parts.back() += '\n';
+				break;
+			}
+			end = line;
+		} else if (current == '/' && statement.compare(i, 2, "/*") == 0) {
+			string::size_type close = statement.find("*/", i + 2);
+			end = (close == string::npos || close + 2 > size ? size : close + 2);
+		}
+
+		parts.back().append(statement, i, end - i);
+		i = end;
+	}
+
+	return parts;
+}
+
+void MySql::appendExecution(const std::vector<string> &parts,
+                            const std::vector<ParameterColumn> &parameters,
+                            const unsigned int row,
+                            string &query)
+{
+	query += parts[0];
+
+	for (unsigned int i = 0; i < parameters.size(); i++) {
+		const ParameterColumn &column = parameters[i];
+
+		if (column.isNull(row)) {
+			query += "NULL";
+		} else {
+			switch (column.getType()) {
+			case ParameterColumn::Type::INTEGER:
+				SqlValue::appendLiteral(*this, column.getIntegers()[row], query);
+				break;
+			case ParameterColumn::Type::DOUBLE:
+				SqlValue::appendLiteral(*this, column.getDoubles()[row], query);
+				break;
+			case ParameterColumn::Type::TEXT:
+				SqlValue::appendLiteral(*this, column.getTexts()[row], query);
+				break;
+			}
+		}
+
+		query += parts[i + 1];
+	}
+}
+
+unsigned long long MySql::executeGroup(const string &query)
 {
 	if (mysql_real_query(&_mysql, query.c_str(), query.size()) != 0) {
 		throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR, 
 		                         mysql_error(&_mysql));
 	}
 
+	// The server stops at the first statement that fails
+	unsigned long long affectedRows = 0;
+	while (true) {
+		if (mysql_field_count(&_mysql) == 0) {
+			affectedRows += mysql_affected_rows(&_mysql);
+		} else {
+			MYSQL_RES *result = mysql_store_result(&_mysql);
+			if (result != NULL) {
+				mysql_free_result(result);
+			}
+		}
+
+		int status = mysql_next_result(&_mysql);
+		if (status < 0) {
+			break;
+		} else if (status > 0) {
+			throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR, 
+			                         mysql_error(&_mysql));
+		}
+	}
+
+	return affectedRows;
+}
+
+unsigned long MySql::clientFlags() const
+{
+	unsigned long flags = 0;
+	if (_multiStatements) {
+		flags |= CLIENT_MULTI_STATEMENTS | CLIENT_MULTI_RESULTS;
+	}
+
+	return flags;
+}
+
+bool MySql::sendQuery(const string &query)
+{
+	discardResults();
+
+	if (mysql_real_query(&_mysql, query.c_str(), query.size()) != 0) {
+		throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR, 
+		                         mysql_error(&_mysql));
+	}
+
 	if (mysql_field_count(&_mysql) == 0) {
-		return std::shared_ptr<Result>();
+		discardResults();
+		return false;
+	}
+
+	return true;
+}
+
+bool MySql::limitsMemory() const
+{
+	return _memoryLimit > 0 || RowStore::getGlobalLimit() > 0;
+}
+
+std::shared_ptr<RowStore> MySql::readRows(MYSQL_RES *result)
+{
+	std::shared_ptr<RowStore> rows(new RowStore(_memoryLimit));
+
+	try {
+		unsigned int columns = mysql_num_fields(result);
+
+		MYSQL_ROW row;
+		while ((row = mysql_fetch_row(result)) != NULL) {
+			rows->add(row, mysql_fetch_lengths(result), columns);
+		}
+
+		if (mysql_errno(&_mysql) != 0) {
+			throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR, 
+			                         mysql_error(&_mysql));
+		}
+
+		rows->finish();
+
+	} catch (const DatabaseException &e) {
+		// The rest of the rows must be read to use the connection again
+		while (mysql_fetch_row(result) != NULL) {}
+		mysql_free_result(result);
+		throw;
 	}
 
+	return rows;
+}
+
+MYSQL_RES* MySql::storeResult(const ResultMode::Value resultMode)
+{
 	MYSQL_RES *result = NULL;
 	
 	switch(resultMode) {
@@ -138,17 +917,49 @@ std::shared_ptr<Result> MySql::execute(const string &query,
 		                         mysql_error(&_mysql));
 	}
 
-	return std::shared_ptr<Result>(new MySqlResult(result));
+	return result;
 }
 
-unsigned long long MySql::affectedRows()
+void MySql::discardResults()
 {
-	return mysql_affected_rows(&_mysql);
+	if (_multiStatements == false) {
+		return;
+	}
+
+	while (mysql_more_results(&_mysql)) {
+		int status = mysql_next_result(&_mysql);
+		if (status < 0) {
+			break;
+		} else if (status > 0) {
+			throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR, 
+			                         mysql_error(&_mysql));
+		}
+
+		MYSQL_RES *result = mysql_store_result(&_mysql);
+		if (result != NULL) {
+			mysql_free_result(result);
+		}
+	}
 }
 
-unsigned long long MySql::lastInsertedId()
+MySql::AsyncStatus::Value MySql::finishAsync(std::shared_ptr<Result> result, 
+                                             std::exception_ptr error)
 {
-	return mysql_insert_id(&_mysql);
+	// The state is cleaned before calling the callback, so it can
+	// start another operation in the same connection
+	AsyncCallback callback = _asyncCallback;
+
+	_asyncState = ASYNC_IDLE;
+	_asyncQuery.clear();
+	_asyncCallback = AsyncCallback();
+	_asyncResult.reset();
+
+	if (callback) {
+		callback(result, error);
+	}
+
+	// The callback can start a new operation
+	return _asyncState == ASYNC_IDLE ? AsyncStatus::COMPLETE : poll();
 }
 
 DBPLUS_NS_END
@@ -29,124 +29,306 @@
 DBPLUS_NS_BEGIN
 
 MySqlResult::MySqlResult(MYSQL_RES *result) :
-	_result(result)
+	_result(NULL),
+	_currentRow(0),
+	_current(NULL),
+	_currentLengths(NULL)
 {
+	reset(result);
+}
+
+MySqlResult::MySqlResult(MYSQL_RES *result, std::shared_ptr<RowStore> rows) :
+	_result(NULL),
+	_currentRow(0),
+	_current(NULL),
+	_currentLengths(NULL)
+{
+	reset(result, rows);
+}
+
+MySqlResult::MySqlResult(MySqlResult &&other) :
+	Result(std::move(other)),
+	_result(other._result),
+	_fields(std::move(other._fields)),
+	_rows(std::move(other._rows)),
+	_currentRow(other._currentRow),
+	_values(std::move(other._values)),
+	_lengths(std::move(other._lengths)),
+	_current(other._current),
+	_currentLengths(other._currentLengths)
+{
+	other._result = NULL;
+	other._current = NULL;
+	other._currentLengths = NULL;
 }
 
 MySqlResult::~MySqlResult()
 {
-	mysql_free_result(_result);
+	if (_result != NULL) {
+		mysql_free_result(_result);
+	}
+}
+
+void MySqlResult::reset(MYSQL_RES *result, std::shared_ptr<RowStore> rows)
+{
+	if (_result != NULL) {
+		mysql_free_result(_result);
+	}
+
+	_result = result;
+	_fields.clear();
+	_rows = rows;
+	_currentRow = 0;
+	_current = NULL;
+	_currentLengths = NULL;
+
+	std::vector<string> names;
+	if (_result != NULL) {
+		unsigned int numberOfFields = mysql_num_fields(_result);
+		for (unsigned int i = 0; i < numberOfFields; i++) {
+			MYSQL_FIELD *field = mysql_fetch_field_direct(_result, i);
+			_fields.push_back(field);
+			names.push_back(field->name);
+		}
+	}
+
+	setColumns(names);
 }
 
 unsigned int MySqlResult::size() const
 {
+	if (_rows) {
+		return _rows->size();
+	}
+
+	if (_result == NULL) {
+		return 0;
+	}
+
 	return mysql_num_rows(_result);
 }
 
 bool MySqlResult::fetch()
 {
-	_row.clear();
+	const char * const *row = NULL;
+	const unsigned long *lengths = NULL;
+
+	if (nextRow(row, lengths) == false) {
+		clearRow();
+		return false;
+	}
+
+	decodeRow(row, lengths, *this);
+	return true;
+}
+
+void MySqlResult::forEachBatch(BatchCallback callback, const unsigned int batchSize)
+{
+	const unsigned int size = batchSize > 0 ? batchSize : 1;
+
+	clearRow();
+
+	RowBlock block;
+	block.reset(getColumnNames());
+
+	const char * const *row = NULL;
+	const unsigned long *lengths = NULL;
+
+	bool fetched = nextRow(row, lengths);
+	while (fetched) {
+		block.clear();
+
+		// The values of the row are decoded before reading the next
+		// one, that can overwrite them in USE_RESULT mode
+		while (fetched && block.size() < size) {
+			block.addRow();
+			decodeRow(row, lengths, block);
+			fetched = nextRow(row, lengths);
+		}
+
+		callback(block);
+	}
+}
+
+bool MySqlResult::nextRow(const char * const *&row, const unsigned long *&lengths)
+{
+	_current = NULL;
+	_currentLengths = NULL;
+
+	if (_rows) {
+		if (_currentRow >= _rows->size()) {
+			return false;
+		}
+
+		_rows->get(_currentRow++, _values, _lengths);
+		row = _values.data();
+		lengths = _lengths.data();
+		_current = row;
+		_currentLengths = lengths;
+		return true;
+	}
+
+	if (_result == NULL) {
+		return false;
+	}
 
-	MYSQL_ROW row = mysql_fetch_row(_result);
-	if (row == NULL) {
+	MYSQL_ROW current = mysql_fetch_row(_result);
+	if (current == NULL) {
 		return false;
 	}
 
-	unsigned int numberOfFields = mysql_num_fields(_result);
-	unsigned long *lengths = mysql_fetch_lengths(_result);
+	row = current;
+	lengths = mysql_fetch_lengths(_result);
+	_current = row;
+	_currentLengths = lengths;
+	return true;
+}
 
-	for (unsigned int i = 0; i < numberOfFields; i++) {
+template<class Target>
+void MySqlResult::decodeRow(const char * const *row, 
+                            const unsigned long *lengths,
+                            Target &target)
+{
+	for (unsigned int i = 0; i < _fields.size(); i++) {
 		if (row[i] == NULL) {
+			target.storeNull(i);
 			continue;
 		}
 
-		MYSQL_FIELD *field = mysql_fetch_field_direct(_result, i);
-
-		switch (field->type) {
+		switch (_fields[i]->type) {
 		case MYSQL_TYPE_TINY:
-			_row[field->name] = (uint8_t) boost::lexical_cast<int>(row[i]);
+			target.storeValue(i, (uint8_t) boost::lexical_cast<int>(row[i]));
 			break;
 		case MYSQL_TYPE_SHORT:
-			_row[field->name] = boost::lexical_cast<short>(row[i]);
+			target.storeValue(i, boost::lexical_cast<short>(row[i]));
 			break;
 		case MYSQL_TYPE_LONG:
-			_row[field->name] = boost::lexical_cast<long>(row[i]);
+			target.storeValue(i, boost::lexical_cast<long>(row[i]));
 			break;
 		case MYSQL_TYPE_INT24:
-			_row[field->name] = (uint32_t) boost::lexical_cast<int>(row[i]);
+			target.storeValue(i, (uint32_t) boost::lexical_cast<int>(row[i]));
 			break;
 		case MYSQL_TYPE_LONGLONG:
-			_row[field->name] = boost::lexical_cast<long long>(row[i]);
+			target.storeValue(i, boost::lexical_cast<long long>(row[i]));
 			break;
 		case MYSQL_TYPE_DECIMAL:
 			// TODO
+			target.storeNull(i);
 			break;
 		case MYSQL_TYPE_NEWDECIMAL:
 			// TODO
+			target.storeNull(i);
 			break;
 		case MYSQL_TYPE_FLOAT:
-			_row[field->name] = boost::lexical_cast<float>(row[i]);
+			target.storeValue(i, boost::lexical_cast<float>(row[i]));
 			break;
 		case MYSQL_TYPE_DOUBLE:
-			_row[field->name] = boost::lexical_cast<double>(row[i]);
+			target.storeValue(i, boost::lexical_cast<double>(row[i]));
 			break;
 		case MYSQL_TYPE_BIT:
 			// TODO
+			target.storeNull(i);
 			break;
 		case MYSQL_TYPE_TIMESTAMP:
 			// TODO
+			target.storeNull(i);
 			break;
 		case MYSQL_TYPE_DATE:
-			try {
-				_row[field->name] = boost::gregorian::from_string(row[i]);
-			} catch (const boost::exception &e) {}
-			break;
 		case MYSQL_TYPE_NEWDATE:
 			try {
-				_row[field->name] = boost::gregorian::from_string(row[i]);
-			} catch (const boost::exception &e) {}
+				target.storeValue(i, boost::gregorian::from_string(row[i]));
+			} catch (const boost::exception &e) {
+				target.storeNull(i);
+			}
 			break;
 		case MYSQL_TYPE_TIME:
 			// TODO
+			target.storeNull(i);
 			break;
 		case MYSQL_TYPE_DATETIME:
 			try {
-				_row[field->name] = boost::posix_time::time_from_string(row[i]);
-			} catch (const boost::exception &e) {}
+				target.storeValue(i, boost::posix_time::time_from_string(row[i]));
+			} catch (const boost::exception &e) {
+				target.storeNull(i);
+			}
 			break;
 		case MYSQL_TYPE_YEAR:
-			_row[field->name] = boost::lexical_cast<int>(row[i]);
+			target.storeValue(i, boost::lexical_cast<int>(row[i]));
 			break;
 		case MYSQL_TYPE_STRING:
 		case MYSQL_TYPE_VAR_STRING:
 		case MYSQL_TYPE_VARCHAR:
-			_row[field->name] = static_cast<string>(row[i]);
+			target.storeString(i, row[i], lengths[i]);
 			break;
 		case MYSQL_TYPE_TINY_BLOB:
 		case MYSQL_TYPE_MEDIUM_BLOB:
 		case MYSQL_TYPE_LONG_BLOB:
 		case MYSQL_TYPE_BLOB:
-			_row[field->name] =
-				Binary(reinterpret_cast<unsigned char*>(row[i]), lengths[i]);;
-			break;
-		case MYSQL_TYPE_SET:
-			// TODO
-			break;
-		case MYSQL_TYPE_ENUM:
-			// TODO
+			target.storeBinary(i, reinterpret_cast<const unsigned char*>(row[i]), 
+			            lengths[i]);
 			break;
-		case MYSQL_TYPE_GEOMETRY:
-			// TODO
-			break;
-		case MYSQL_TYPE_NULL:
-			// TODO
+		default:
+			// TODO: SET, ENUM, GEOMETRY and NULL
+			target.storeNull(i);
 			break;
 		}
 	}
+}
+
+bool MySqlResult::hasText() const
+{
+	return true;
+}
+
+bool MySqlResult::isNumber(const unsigned int column) const
+{
+	switch (_fields[column]->type) {
+	case MYSQL_TYPE_TINY:
+	case MYSQL_TYPE_SHORT:
+	case MYSQL_TYPE_LONG:
+	case MYSQL_TYPE_INT24:
+	case MYSQL_TYPE_LONGLONG:
+	case MYSQL_TYPE_FLOAT:
+	case MYSQL_TYPE_DOUBLE:
+	case MYSQL_TYPE_DECIMAL:
+	case MYSQL_TYPE_NEWDECIMAL:
+	case MYSQL_TYPE_YEAR:
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool MySqlResult::fetchText(std::vector<const char*> &values,
+                            std::vector<unsigned long> &sizes)
+{
+	clearRow();
+
+	const char * const *row = NULL;
+	const unsigned long *lengths = NULL;
+
+	if (nextRow(row, lengths) == false) {
+		return false;
+	}
 
+	values.assign(row, row + _fields.size());
+	sizes.assign(lengths, lengths + _fields.size());
 	return true;
 }
 
+void MySqlResult::getText(const unsigned int column, 
+                          const char *&value, 
+                          unsigned long &size) const
+{
+	if (_current == NULL || column >= _fields.size()) {
+		throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR,
+		                         "No value in the current row");
+	}
+
+	value = _current[column];
+	size = value != NULL ? _currentLengths[column] : 0;
+}
+
 boost::any MySqlResult::get(const string &key) const
 {
 	auto result = _row.find(key);
@@ -0,0 +1,102 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <dbplus/DatabaseException.hpp>
+#include <dbplus/ParameterColumn.hpp>
+
+DBPLUS_NS_BEGIN
+
+ParameterColumn::ParameterColumn(const std::vector<long long> &values) :
+	_type(Type::INTEGER),
+	_size(values.size()),
+	_values(values.data())
+{
+}
+
+ParameterColumn::ParameterColumn(const std::vector<double> &values) :
+	_type(Type::DOUBLE),
+	_size(values.size()),
+	_values(values.data())
+{
+}
+
+ParameterColumn::ParameterColumn(const std::vector<string> &values) :
+	_type(Type::TEXT),
+	_size(values.size()),
+	_values(values.data())
+{
+}
+
+void ParameterColumn::setNulls(const std::vector<bool> &nulls)
+{
+	if (nulls.size() != _size) {
+		throw DATABASE_EXCEPTION(DatabaseException::CONVERSION_ERROR,
+		                         "NULL flags must have the size of the values");
+	}
+
+	_nulls = nulls;
+}
+
+ParameterColumn::Type::Value ParameterColumn::getType() const
+{
+	return _type;
+}
+
+unsigned int ParameterColumn::size() const
+{
+	return _size;
+}
+
+bool ParameterColumn::isNull(const unsigned int row) const
+{
+	return _nulls.empty() == false && _nulls[row];
+}
+
+const long long* ParameterColumn::getIntegers() const
+{
+	return static_cast<const long long*>(_values);
+}
+
+const double* ParameterColumn::getDoubles() const
+{
+	return static_cast<const double*>(_values);
+}
+
+const string* ParameterColumn::getTexts() const
+{
+	return static_cast<const string*>(_values);
+}
+
+unsigned int ParameterColumn::rows(const std::vector<ParameterColumn> &columns)
+{
+	if (columns.empty()) {
+		return 1;
+	}
+
+	for (auto &column : columns) {
+		if (column.size() != columns[0].size()) {
+			throw DATABASE_EXCEPTION(DatabaseException::CONVERSION_ERROR,
+			                         "Parameter columns must have the same size");
+		}
+	}
+
+	return columns[0].size();
+}
+
+DBPLUS_NS_END
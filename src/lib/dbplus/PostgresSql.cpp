@@ -17,11 +17,16 @@
   along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+
 #include <boost/lexical_cast.hpp>
 
 #include <dbplus/DatabaseException.hpp>
 #include <dbplus/PostgresSql.hpp>
 #include <dbplus/PostgresSqlResult.hpp>
+#include <dbplus/TextScan.hpp>
 
 //#define SHOW_NOTICES
 #ifdef SHOW_NOTICES
@@ -30,9 +35,24 @@
 
 DBPLUS_NS_BEGIN
 
+namespace {
+
+// Types are the same for all connections to the same database, so they
+// are downloaded only once per process
+std::mutex typesCacheLock;
+std::map<string, std::shared_ptr<const std::map<Oid, string> > > typesCache;
+
+}
+
 PostgresSql::PostgresSql() :
+	_postgres(NULL),
 	_transactionMode(TransactionMode::AUTO_COMMIT),
-	_affectedRows(0)
+	_affectedRows(0),
+	_memoryLimit(0),
+	_asyncState(ASYNC_IDLE),
+	_asyncResult(NULL),
+	_asyncTypes(false),
+	_asyncDiscardResult(false)
 {
 }
 
@@ -47,13 +67,8 @@ void PostgresSql::connect(const string &database,
                           const string &server,
                           const unsigned int port)
 {
-	string connection = "host='" + server + "' "
-		"port='" + boost::lexical_cast<string>(port) + "' "
-		"dbname='" + database + "' "
-		"user='" + user + "' "
-		"password='" + password + "'";
-
-	_postgres = PQconnectdb(connection.c_str());
+	_postgres = PQconnectdb(initialize(database, user, password, 
+	                                   server, port).c_str());
 	if (_postgres == NULL) {
 		throw DATABASE_EXCEPTION(DatabaseException::CONNECTION_ERROR,
 		                         "Could not allocate memory for "
@@ -70,9 +85,97 @@ void PostgresSql::connect(const string &database,
 	setTransactionMode(_transactionMode);
 }
 
+PostgresSql::AsyncStatus::Value 
+PostgresSql::connectAsync(const string &database,
+                          const string &user,
+                          const string &password,
+                          const string &server,
+                          const unsigned int port,
+                          AsyncCallback callback)
+{
+	if (_asyncState != ASYNC_IDLE) {
+		throw DATABASE_EXCEPTION(DatabaseException::CONNECTION_ERROR,
+		                         "Asynchronous operation already in progress");
+	}
+
+	_postgres = PQconnectStart(initialize(database, user, password, 
+	                                      server, port).c_str());
+	if (_postgres == NULL) {
+		throw DATABASE_EXCEPTION(DatabaseException::CONNECTION_ERROR,
+		                         "Could not allocate memory for "
+		                         "database connection");
+	}
+
+	if (PQstatus(_postgres) == CONNECTION_BAD) {
+		throw DATABASE_EXCEPTION(DatabaseException::CONNECTION_ERROR,
+		                         PQerrorMessage(_postgres));
+	}
+
+	PQsetNoticeReceiver(_postgres, noticeReceiver, NULL);
+
+	_asyncState = ASYNC_CONNECT;
+	_asyncCallback = callback;
+	_asyncDiscardResult = true;
+
+	return poll();
+}
+
 void PostgresSql::disconnect()
 {
-	PQfinish(_postgres);
+	// An operation in progress is abandoned without calling its
+	// callback
+	_asyncState = ASYNC_IDLE;
+	_asyncCallback = AsyncCallback();
+	_asyncTypes = false;
+	_asyncDiscardResult = false;
+
+	if (_asyncResult != NULL) {
+		PQclear(_asyncResult);
+		_asyncResult = NULL;
+	}
+
+	if (_postgres != NULL) {
+		PQfinish(_postgres);
+		_postgres = NULL;
+	}
+}
+
+bool PostgresSql::ping()
+{
+	if (_postgres == NULL || PQstatus(_postgres) != CONNECTION_OK) {
+		return false;
+	}
+
+	// An empty query is the cheapest round trip to the server
+	PGresult *result = PQexec(_postgres, "");
+	if (result == NULL) {
+		return false;
+	}
+
+	bool alive = (PQresultStatus(result) == PGRES_EMPTY_QUERY);
+	PQclear(result);
+	return alive;
+}
+
+void PostgresSql::cancel()
+{
+	if (_postgres == NULL) {
+		return;
+	}
+
+	PGcancel *request = PQgetCancel(_postgres);
+	if (request == NULL) {
+		throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR,
+		                         "Could not create cancel request");
+	}
+
+	char error[256];
+	int sent = PQcancel(request, error, sizeof(error));
+	PQfreeCancel(request);
+
+	if (sent == 0) {
+		throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR, error);
+	}
 }
 
 void PostgresSql::setTransactionMode(const TransactionMode::Value mode)
@@ -114,10 +217,30 @@ void PostgresSql::rollback()
 
 string PostgresSql::escape(const string &value)
 {
-	char escapedValue[value.size() + 1];
-	PQescapeStringConn(_postgres, escapedValue, 
-	                   value.c_str(), value.size(), NULL);
-	return static_cast<string>(escapedValue);
+	string escapedValue;
+	escape(value, escapedValue);
+	return escapedValue;
+}
+
+void PostgresSql::escape(const string &value, string &buffer)
+{
+	static const string special("'\\");
+
+	// Bytes until the first special or non ASCII character are copied,
+	// because the client library must check the multibyte characters
+	unsigned long run = TextScan::find(value.data(), value.size(), special, true);
+	buffer.append(value.data(), run);
+
+	if (run == value.size()) {
+		return;
+	}
+
+	// The client library writes at most 2n+1 bytes
+	string::size_type start = buffer.size();
+	buffer.resize(start + 2 * (value.size() - run) + 1);
+	size_t length = PQescapeStringConn(_postgres, &buffer[start], 
+	                                   value.data() + run, value.size() - run, NULL);
+	buffer.resize(start + length);
 }
 
 std::shared_ptr<Result> PostgresSql::execute(const string &query,
@@ -125,33 +248,422 @@ std::shared_ptr<Result> PostgresSql::execute(const string &query,
 {
 	buildTypesCache();
 
+	if (limitsMemory()) {
+		return storeRows(query, std::shared_ptr<Result>());
+	}
+
 	PGresult *result = PQexec(_postgres, query.c_str());
 	if (result == NULL) {
 		throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR,
 		                         PQerrorMessage(_postgres));
 	}
 
-	if (PQresultStatus(result) != PGRES_TUPLES_OK &&
-	    PQresultStatus(result) != PGRES_COMMAND_OK) {
+	// TODO: Result mode. We can use cursor, but we neede to do it in a
+	// transaction and we must close the cursor after usage. How we are
+	// going to know where we close the cursor?
+	//
+	// http://www.postgresql.org/docs/8.0/static/libpq-example.html
+
+	return buildResult(result);
+}
+
+std::shared_ptr<Result> PostgresSql::execute(const string &query,
+                                             std::shared_ptr<Result> result)
+{
+	buildTypesCache();
+
+	if (limitsMemory()) {
+		return storeRows(query, result);
+	}
+
+	PGresult *rows = PQexec(_postgres, query.c_str());
+	if (rows == NULL) {
+		throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR,
+		                         PQerrorMessage(_postgres));
+	}
+
+	return buildResult(rows, result);
+}
+
+unsigned long long 
+PostgresSql::executeBulk(const string &statement, 
+                         const std::vector<ParameterColumn> &parameters)
+{
+	unsigned int rows = ParameterColumn::rows(parameters);
+
+	// The unnamed statement is replaced by the next one, so it doesn't
+	// need to be deallocated
+	PGresult *result = PQprepare(_postgres, "", statement.c_str(), 
+	                             parameters.size(), NULL);
+	if (result == NULL) {
+		throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR,
+		                         PQerrorMessage(_postgres));
+	}
+
+	if (PQresultStatus(result) != PGRES_COMMAND_OK) {
+		string message = PQresultErrorMessage(result);
 		PQclear(result);
+		throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR, message);
+	}
+	PQclear(result);
+
+	// Numbers are sent in the text format, so the server converts them
+	// to the type of each placeholder
+	std::vector<const char*> values(parameters.size());
+	std::vector<std::vector<char> > numbers(parameters.size(), 
+	                                        std::vector<char>(32));
+
+	auto bind = [&](const unsigned int row) {
+		for (unsigned int i = 0; i < parameters.size(); i++) {
+			const ParameterColumn &column = parameters[i];
+			if (column.isNull(row)) {
+				values[i] = NULL;
+				continue;
+			}
+
+			switch (column.getType()) {
+			case ParameterColumn::Type::INTEGER:
+				snprintf(numbers[i].data(), numbers[i].size(), "%lld", 
+				         column.getIntegers()[row]);
+				values[i] = numbers[i].data();
+				break;
+			case ParameterColumn::Type::DOUBLE:
+				snprintf(numbers[i].data(), numbers[i].size(), "%.17g", 
+				         column.getDoubles()[row]);
+				values[i] = numbers[i].data();
+				break;
+			case ParameterColumn::Type::TEXT:
+				values[i] = column.getTexts()[row].c_str();
+				break;
+			}
+		}
+	};
+
+	unsigned long long affectedRows = 0;
+	string message;
+
+#ifdef LIBPQ_HAS_PIPELINING
+	// Executions are sent in blocks that end with a sync point, where
+	// the answers are read. Each block runs in one implicit transaction
+	// when the connection is in auto commit mode
+	const unsigned int BLOCK_SIZE = 1000;
+
+	if (PQenterPipelineMode(_postgres) != 1) {
 		throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR,
-		                         PQresultErrorMessage(result));
+		                         PQerrorMessage(_postgres));
 	}
 
-	string affectedRows = PQcmdTuples(result);
-	if (affectedRows.empty()) {
-		_affectedRows = 0;
+	for (unsigned int first = 0; first < rows && message.empty(); 
+	     first += BLOCK_SIZE) {
+		unsigned int last = std::min(first + BLOCK_SIZE, rows);
+		for (unsigned int row = first; row < last; row++) {
+			bind(row);
+			if (PQsendQueryPrepared(_postgres, "", values.size(), 
+			                        values.data(), NULL, NULL, 0) != 1) {
+				message = PQerrorMessage(_postgres);
+				break;
+			}
+		}
+
+		if (PQpipelineSync(_postgres) != 1) {
+			message = PQerrorMessage(_postgres);
+			break;
+		}
+
+		// Each execution returns its results followed by NULL, and the
+		// block finishes with the result of the sync point
+		while (true) {
+			result = PQgetResult(_postgres);
+			if (result == NULL) {
+				if (PQstatus(_postgres) != CONNECTION_OK) {
+					message = PQerrorMessage(_postgres);
+					break;
+				}
+				continue;
+			}
+
+			ExecStatusType status = PQresultStatus(result);
+			if (status == PGRES_PIPELINE_SYNC) {
+				PQclear(result);
+				break;
+			}
+
+			if (status == PGRES_COMMAND_OK || status == PGRES_TUPLES_OK) {
+				string tuples = PQcmdTuples(result);
+				if (tuples.empty() == false) {
+					affectedRows += boost::lexical_cast<unsigned long long>(tuples);
+				}
+			} else if (status != PGRES_PIPELINE_ABORTED && message.empty()) {
+				message = PQresultErrorMessage(result);
+			}
+
+			PQclear(result);
+		}
+	}
+
+	PQexitPipelineMode(_postgres);
+#else
+	for (unsigned int row = 0; row < rows && message.empty(); row++) {
+		bind(row);
+		result = PQexecPrepared(_postgres, "", values.size(), 
+		                        values.data(), NULL, NULL, 0);
+		if (result == NULL) {
+			message = PQerrorMessage(_postgres);
+			break;
+		}
+
+		ExecStatusType status = PQresultStatus(result);
+		if (status == PGRES_COMMAND_OK || status == PGRES_TUPLES_OK) {
+			string tuples = PQcmdTuples(result);
+			if (tuples.empty() == false) {
+				affectedRows += boost::lexical_cast<unsigned long long>(tuples);
+			}
+		} else {
+			message = PQresultErrorMessage(result);
+		}
+
+		PQclear(result);
+	}
+#endif
+
+	if (message.empty() == false) {
+		throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR, message);
+	}
+
+	_affectedRows = affectedRows;
+	return affectedRows;
+}
+
+unsigned long long PostgresSql::copy(const string &table, 
+                                     const std::vector<string> &columns,
+                                     const string &rows)
+{
+	string query = "COPY " + table + " (";
+	for (unsigned int i = 0; i < columns.size(); i++) {
+		if (i > 0) {
+			query += ", ";
+		}
+		query += columns[i];
+	}
+	query += ") FROM STDIN";
+
+	PGresult *result = PQexec(_postgres, query.c_str());
+	if (result == NULL) {
+		throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR,
+		                         PQerrorMessage(_postgres));
+	}
+
+	if (PQresultStatus(result) != PGRES_COPY_IN) {
+		string message = PQresultErrorMessage(result);
+		PQclear(result);
+		throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR, message);
+	}
+	PQclear(result);
+
+	if (PQputCopyData(_postgres, rows.data(), rows.size()) != 1) {
+		PQputCopyEnd(_postgres, PQerrorMessage(_postgres));
 	} else {
-		_affectedRows = boost::lexical_cast<unsigned int>(affectedRows);
+		PQputCopyEnd(_postgres, NULL);
 	}
 
-	// TODO: Result mode. We can use cursor, but we neede to do it in a
-	// transaction and we must close the cursor after usage. How we are
-	// going to know where we close the cursor?
-	//
-	// http://www.postgresql.org/docs/8.0/static/libpq-example.html
+	// The COPY returns only one result, but we must read until NULL
+	// to use the connection again
+	string message;
+	while ((result = PQgetResult(_postgres)) != NULL) {
+		if (PQresultStatus(result) != PGRES_COMMAND_OK) {
+			message = PQresultErrorMessage(result);
+		} else {
+			string affectedRows = PQcmdTuples(result);
+			_affectedRows = affectedRows.empty() ? 0 :
+				boost::lexical_cast<unsigned int>(affectedRows);
+		}
+		PQclear(result);
+	}
 
-	return std::shared_ptr<Result>(new PostgresSqlResult(result, _types));
+	if (message.empty() == false) {
+		throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR, message);
+	}
+
+	return _affectedRows;
+}
+
+void PostgresSql::setMemoryLimit(const unsigned long bytes)
+{
+	_memoryLimit = bytes;
+}
+
+unsigned long PostgresSql::getMemoryLimit() const
+{
+	return _memoryLimit;
+}
+
+PostgresSql::AsyncStatus::Value 
+PostgresSql::executeAsync(const string &query, AsyncCallback callback)
+{
+	if (_asyncState != ASYNC_IDLE) {
+		throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR,
+		                         "Asynchronous operation already in progress");
+	}
+
+	buildTypesCache();
+
+	if (sendAsync(query) == false) {
+		throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR,
+		                         PQerrorMessage(_postgres));
+	}
+
+	_asyncCallback = callback;
+
+	return poll();
+}
+
+PostgresSql::AsyncStatus::Value PostgresSql::commitAsync(AsyncCallback callback)
+{
+	// Both statements are sent in the same query, like the commit
+	// method does with two queries
+	string query = "COMMIT";
+	if (_transactionMode == TransactionMode::MANUAL_COMMIT) {
+		query += "; BEGIN";
+	}
+
+	AsyncStatus::Value status = executeAsync(query, callback);
+	_asyncDiscardResult = (_asyncState != ASYNC_IDLE);
+	return status;
+}
+
+PostgresSql::AsyncStatus::Value PostgresSql::rollbackAsync(AsyncCallback callback)
+{
+	string query = "ROLLBACK";
+	if (_transactionMode == TransactionMode::MANUAL_COMMIT) {
+		query += "; BEGIN";
+	}
+
+	AsyncStatus::Value status = executeAsync(query, callback);
+	_asyncDiscardResult = (_asyncState != ASYNC_IDLE);
+	return status;
+}
+
+PostgresSql::AsyncStatus::Value PostgresSql::poll()
+{
+	if (_asyncState == ASYNC_CONNECT) {
+		switch (PQconnectPoll(_postgres)) {
+		case PGRES_POLLING_READING:
+			return AsyncStatus::WAIT_READ;
+		case PGRES_POLLING_WRITING:
+			return AsyncStatus::WAIT_WRITE;
+		case PGRES_POLLING_OK:
+			break;
+		case PGRES_POLLING_FAILED:
+		default: {
+			DatabaseException error = 
+				DATABASE_EXCEPTION(DatabaseException::CONNECTION_ERROR,
+				                   PQerrorMessage(_postgres));
+			return finishAsync(std::shared_ptr<Result>(), std::make_exception_ptr(error));
+		}
+		}
+
+		// Types are downloaded now, so the first query doesn't need to
+		// wait for them
+		{
+			std::lock_guard<std::mutex> lock(typesCacheLock);
+			auto types = typesCache.find(_connectionKey);
+			if (types != typesCache.end()) {
+				_types = types->second;
+			}
+		}
+
+		if (_types) {
+			return connected();
+		}
+
+		if (sendAsync("SELECT typelem, typname FROM pg_type") == false) {
+			DatabaseException error = 
+				DATABASE_EXCEPTION(DatabaseException::CONNECTION_ERROR,
+				                   PQerrorMessage(_postgres));
+			return finishAsync(std::shared_ptr<Result>(), std::make_exception_ptr(error));
+		}
+
+		_asyncTypes = true;
+	}
+
+	if (_asyncState == ASYNC_FLUSH) {
+		int status = PQflush(_postgres);
+		if (status == 1) {
+			return AsyncStatus::WAIT_WRITE;
+		} else if (status < 0) {
+			DatabaseException error = 
+				DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR,
+				                   PQerrorMessage(_postgres));
+			return finishAsync(std::shared_ptr<Result>(), std::make_exception_ptr(error));
+		}
+
+		_asyncState = ASYNC_READ;
+	}
+
+	if (_asyncState == ASYNC_READ) {
+		if (PQconsumeInput(_postgres) == 0) {
+			DatabaseException error = 
+				DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR,
+				                   PQerrorMessage(_postgres));
+			return finishAsync(std::shared_ptr<Result>(), std::make_exception_ptr(error));
+		}
+
+		while (PQisBusy(_postgres) == 0) {
+			PGresult *result = PQgetResult(_postgres);
+			if (result == NULL) {
+				std::shared_ptr<Result> asyncResult;
+				std::exception_ptr error;
+
+				try {
+					PGresult *lastResult = _asyncResult;
+					_asyncResult = NULL;
+
+					if (lastResult == NULL) {
+						throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR,
+						                         PQerrorMessage(_postgres));
+					}
+
+					if (_asyncTypes) {
+						_asyncTypes = false;
+						storeTypes(lastResult);
+						return connected();
+					}
+
+					asyncResult = buildResult(lastResult);
+				} catch (const DatabaseException &e) {
+					error = std::current_exception();
+				}
+
+				if (_asyncDiscardResult) {
+					asyncResult.reset();
+				}
+
+				return finishAsync(asyncResult, error);
+			}
+
+			// Keep the first error or the last result of the query
+			if (_asyncResult != NULL) {
+				ExecStatusType status = PQresultStatus(_asyncResult);
+				if (status != PGRES_TUPLES_OK && status != PGRES_COMMAND_OK) {
+					PQclear(result);
+					continue;
+				}
+
+				PQclear(_asyncResult);
+			}
+
+			_asyncResult = result;
+		}
+
+		return AsyncStatus::WAIT_READ;
+	}
+
+	return AsyncStatus::COMPLETE;
+}
+
+int PostgresSql::getSocket() const
+{
+	return PQsocket(_postgres);
 }
 
 unsigned long long PostgresSql::affectedRows()
@@ -171,12 +683,68 @@ unsigned long long PostgresSql::lastInsertedId()
 	return boost::any_cast<long long>(result->get("lastval"));
 }
 
+string PostgresSql::initialize(const string &database,
+                               const string &user,
+                               const string &password,
+                               const string &server,
+                               const unsigned int port)
+{
+	disconnect();
+
+	_connectionKey = "host='" + server + "' "
+		"port='" + boost::lexical_cast<string>(port) + "' "
+		"dbname='" + database + "'";
+
+	return _connectionKey + " "
+		"user='" + user + "' "
+		"password='" + password + "'";
+}
+
+bool PostgresSql::sendAsync(const string &query)
+{
+	// Blocking functions like PQexec ignore the non-blocking mode
+	if (PQsetnonblocking(_postgres, 1) != 0 ||
+	    PQsendQuery(_postgres, query.c_str()) == 0) {
+		return false;
+	}
+
+	_asyncState = ASYNC_FLUSH;
+	return true;
+}
+
+PostgresSql::AsyncStatus::Value PostgresSql::connected()
+{
+	// The transaction mode is applied like in the connect method. In
+	// AUTO_COMMIT mode there's nothing to send
+	if (_transactionMode == TransactionMode::MANUAL_COMMIT) {
+		if (sendAsync("BEGIN") == false) {
+			DatabaseException error = 
+				DATABASE_EXCEPTION(DatabaseException::CONNECTION_ERROR,
+				                   PQerrorMessage(_postgres));
+			return finishAsync(std::shared_ptr<Result>(), std::make_exception_ptr(error));
+		}
+
+		return poll();
+	}
+
+	return finishAsync(std::shared_ptr<Result>(), std::exception_ptr());
+}
+
 void PostgresSql::buildTypesCache()
 {
-	if (_types.empty() == false) {
+	if (_types) {
 		return;
 	}
 
+	{
+		std::lock_guard<std::mutex> lock(typesCacheLock);
+		auto types = typesCache.find(_connectionKey);
+		if (types != typesCache.end()) {
+			_types = types->second;
+			return;
+		}
+	}
+
 	string query = "SELECT typelem, typname FROM pg_type";
 
 	PGresult *result = PQexec(_postgres, query.c_str());
@@ -185,20 +753,179 @@ void PostgresSql::buildTypesCache()
 		                         PQerrorMessage(_postgres));
 	}
 
+	storeTypes(result);
+}
+
+void PostgresSql::storeTypes(PGresult *result)
+{
 	if (PQresultStatus(result) != PGRES_TUPLES_OK) {
+		string message = PQresultErrorMessage(result);
 		PQclear(result);
-		throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR,
-		                         PQresultErrorMessage(result));
+		throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR, message);
 	}
 
+	std::shared_ptr<std::map<Oid, string> > types(new std::map<Oid, string>());
+
 	for (int i = 0; i < PQntuples(result); i++) {
 		Oid oid = boost::lexical_cast<Oid>(PQgetvalue(result, i, 0));
 		string type = PQgetvalue(result, i, 1);
 
-		_types[oid] = type;
+		(*types)[oid] = type;
 	}
 
 	PQclear(result);
+
+	_types = types;
+
+	std::lock_guard<std::mutex> lock(typesCacheLock);
+	typesCache[_connectionKey] = _types;
+}
+
+bool PostgresSql::limitsMemory() const
+{
+	return _memoryLimit > 0 || RowStore::getGlobalLimit() > 0;
+}
+
+std::shared_ptr<Result> PostgresSql::storeRows(const string &query, 
+                                               std::shared_ptr<Result> reused)
+{
+	if (PQsendQuery(_postgres, query.c_str()) != 1) {
+		throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR,
+		                         PQerrorMessage(_postgres));
+	}
+	PQsetSingleRowMode(_postgres);
+
+	std::shared_ptr<RowStore> rows(new RowStore(_memoryLimit));
+	std::vector<const char*> values;
+	std::vector<unsigned long> sizes;
+
+	// Each row comes in its own result. The first one is kept to
+	// describe the columns
+	PGresult *columns = NULL;
+	string message;
+
+	PGresult *result = NULL;
+	while ((result = PQgetResult(_postgres)) != NULL) {
+		ExecStatusType status = PQresultStatus(result);
+
+		if (status == PGRES_SINGLE_TUPLE && message.empty()) {
+			unsigned int numberOfFields = PQnfields(result);
+			values.resize(numberOfFields);
+			sizes.resize(numberOfFields);
+			for (unsigned int i = 0; i < numberOfFields; i++) {
+				if (PQgetisnull(result, 0, i)) {
+					values[i] = NULL;
+					sizes[i] = 0;
+				} else {
+					values[i] = PQgetvalue(result, 0, i);
+					sizes[i] = PQgetlength(result, 0, i);
+				}
+			}
+
+			try {
+				rows->add(values.data(), sizes.data(), numberOfFields);
+			} catch (const DatabaseException &e) {
+				message = e.what();
+			}
+
+		} else if (status != PGRES_SINGLE_TUPLE &&
+		           status != PGRES_TUPLES_OK &&
+		           status != PGRES_COMMAND_OK &&
+		           message.empty()) {
+			message = PQresultErrorMessage(result);
+		}
+
+		if (columns == NULL && message.empty()) {
+			columns = result;
+		} else {
+			PQclear(result);
+		}
+	}
+
+	if (message.empty() == false) {
+		PQclear(columns);
+		throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR, message);
+	}
+
+	if (columns == NULL) {
+		throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR,
+		                         PQerrorMessage(_postgres));
+	}
+
+	if (PQresultStatus(columns) == PGRES_COMMAND_OK) {
+		return buildResult(columns, reused);
+	}
+
+	try {
+		rows->finish();
+	} catch (const DatabaseException &e) {
+		PQclear(columns);
+		throw;
+	}
+
+	_affectedRows = rows->size();
+
+	PostgresSqlResult *postgresResult = 
+		dynamic_cast<PostgresSqlResult*>(reused.get());
+	if (postgresResult != NULL) {
+		postgresResult->reset(columns, _types, rows);
+		return reused;
+	}
+
+	return std::shared_ptr<Result>(new PostgresSqlResult(columns, _types, rows));
+}
+
+std::shared_ptr<Result> PostgresSql::buildResult(PGresult *result,
+                                                 std::shared_ptr<Result> reused)
+{
+	if (PQresultStatus(result) != PGRES_TUPLES_OK &&
+	    PQresultStatus(result) != PGRES_COMMAND_OK) {
+		string message = PQresultErrorMessage(result);
+		PQclear(result);
+		throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR, message);
+	}
+
+	string affectedRows = PQcmdTuples(result);
+	if (affectedRows.empty()) {
+		_affectedRows = 0;
+	} else {
+		_affectedRows = boost::lexical_cast<unsigned int>(affectedRows);
+	}
+
+	PostgresSqlResult *postgresResult = 
+		dynamic_cast<PostgresSqlResult*>(reused.get());
+	if (postgresResult != NULL) {
+		postgresResult->reset(result, _types);
+		return reused;
+	}
+
+	return std::shared_ptr<Result>(new PostgresSqlResult(result, _types));
+}
+
+PostgresSql::AsyncStatus::Value 
+PostgresSql::finishAsync(std::shared_ptr<Result> result, 
+                         std::exception_ptr error)
+{
+	// The state is cleaned before calling the callback, so it can
+	// start another operation in the same connection
+	AsyncCallback callback = _asyncCallback;
+
+	_asyncState = ASYNC_IDLE;
+	_asyncCallback = AsyncCallback();
+	_asyncTypes = false;
+	_asyncDiscardResult = false;
+
+	if (_asyncResult != NULL) {
+		PQclear(_asyncResult);
+		_asyncResult = NULL;
+	}
+
+	if (callback) {
+		callback(result, error);
+	}
+
+	// The callback can start a new operation
+	return _asyncState == ASYNC_IDLE ? AsyncStatus::COMPLETE : poll();
 }
 
 void PostgresSql::noticeReceiver(void *arg, const PGresult *result)
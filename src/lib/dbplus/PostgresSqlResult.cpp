@@ -24,12 +24,40 @@
 
 DBPLUS_NS_BEGIN
 
+PostgresSqlResult::PostgresSqlResult() :
+	_result(NULL),
+	_currentRow(-1)
+{
+}
+
+PostgresSqlResult::PostgresSqlResult(PGresult *result,
+                                     std::shared_ptr<const std::map<Oid, string> > types) :
+	_result(NULL),
+	_currentRow(-1)
+{
+	reset(result, types);
+}
+
 PostgresSqlResult::PostgresSqlResult(PGresult *result,
-                                     const std::map<Oid, string> &types) :
-	_result(result),
-	_currentRow(-1),
-	_types(types)
+                                     std::shared_ptr<const std::map<Oid, string> > types,
+                                     std::shared_ptr<RowStore> rows) :
+	_result(NULL),
+	_currentRow(-1)
+{
+	reset(result, types, rows);
+}
+
+PostgresSqlResult::PostgresSqlResult(PostgresSqlResult &&other) :
+	Result(std::move(other)),
+	_result(other._result),
+	_currentRow(other._currentRow),
+	_types(std::move(other._types)),
+	_columnTypes(std::move(other._columnTypes)),
+	_rows(std::move(other._rows)),
+	_values(std::move(other._values)),
+	_lengths(std::move(other._lengths))
 {
+	other._result = NULL;
 }
 
 PostgresSqlResult::~PostgresSqlResult()
@@ -37,8 +65,49 @@ PostgresSqlResult::~PostgresSqlResult()
 	PQclear(_result);
 }
 
+void PostgresSqlResult::reset(PGresult *result,
+                              std::shared_ptr<const std::map<Oid, string> > types,
+                              std::shared_ptr<RowStore> rows)
+{
+	PQclear(_result);
+
+	_result = result;
+	_currentRow = -1;
+	_types = types;
+	_columnTypes.clear();
+	_rows = rows;
+
+	// The type of each column is found once, instead of in every row
+	std::vector<string> names;
+	unsigned int numberOfFields = PQnfields(_result);
+	for (unsigned int i = 0; i < numberOfFields; i++) {
+		names.push_back(PQfname(_result, i));
+
+		ColumnType columnType = COLUMN_UNKNOWN;
+		auto type = _types->find(PQftype(_result, i));
+		if (type == _types->end()) {
+			columnType = COLUMN_UNKNOWN;
+		} else if (type->second == "_varchar") {
+			columnType = COLUMN_VARCHAR;
+		} else if (type->second == "_int4") {
+			columnType = COLUMN_INT4;
+		} else if (type->second == "_int8") {
+			columnType = COLUMN_INT8;
+		} else if (type->second == "_timestamp") {
+			columnType = COLUMN_TIMESTAMP;
+		}
+		_columnTypes.push_back(columnType);
+	}
+
+	setColumns(names);
+}
+
 unsigned int PostgresSqlResult::size() const
 {
+	if (_rows) {
+		return _rows->size();
+	}
+
 	string size = PQcmdTuples(_result);
 	if (size.empty()) {
 		return 0;
@@ -49,40 +118,161 @@ unsigned int PostgresSqlResult::size() const
 
 bool PostgresSqlResult::fetch()
 {
-	_row.clear();
+	if (nextRow() == false) {
+		clearRow();
+		return false;
+	}
+
+	decodeRow(*this);
+	return true;
+}
+
+void PostgresSqlResult::forEachBatch(BatchCallback callback, 
+                                     const unsigned int batchSize)
+{
+	const unsigned int size = batchSize > 0 ? batchSize : 1;
+
+	clearRow();
+
+	RowBlock block;
+	block.reset(getColumnNames());
+
+	bool fetched = nextRow();
+	while (fetched) {
+		block.clear();
+
+		while (fetched && block.size() < size) {
+			block.addRow();
+			decodeRow(block);
+			fetched = nextRow();
+		}
+
+		callback(block);
+	}
+}
+
+bool PostgresSqlResult::nextRow()
+{
 	_currentRow++;
 
 	if (static_cast<unsigned int>(_currentRow) >= size()) {
 		return false;
 	}
 
-	unsigned int numberOfFields = PQnfields(_result);
-	for (unsigned int i = 0; i < numberOfFields; i++) {
-		Oid oid = PQftype(_result, i);
-		string value = static_cast<string>(PQgetvalue(_result, _currentRow, i));
-
-		if (_types[oid] == "_varchar") {
-			_row[PQfname(_result, i)] = value;
+	if (_rows) {
+		_rows->get(_currentRow, _values, _lengths);
+	} else {
+		_values.resize(_columnTypes.size());
+		_lengths.resize(_columnTypes.size());
+		for (unsigned int i = 0; i < _columnTypes.size(); i++) {
+			_values[i] = PQgetvalue(_result, _currentRow, i);
+			_lengths[i] = PQgetlength(_result, _currentRow, i);
+		}
+	}
 
-		} else if (_types[oid] == "_int4") {
-			_row[PQfname(_result, i)] = boost::lexical_cast<long>(value);
+	return true;
+}
 
-		} else if (_types[oid] == "_int8") {
-			_row[PQfname(_result, i)] = boost::lexical_cast<long long>(value);
+template<class Target>
+void PostgresSqlResult::decodeRow(Target &target)
+{
+	for (unsigned int i = 0; i < _columnTypes.size(); i++) {
+		// NULL values read in advance are decoded as empty text, like
+		// the values returned by PQgetvalue
+		const char *value = _values[i] != NULL ? _values[i] : "";
 
-		} else if (_types[oid] == "_timestamp") {
+		switch (_columnTypes[i]) {
+		case COLUMN_VARCHAR:
+			target.storeString(i, value, _lengths[i]);
+			break;
+		case COLUMN_INT4:
+			target.storeValue(i, boost::lexical_cast<long>(value));
+			break;
+		case COLUMN_INT8:
+			target.storeValue(i, boost::lexical_cast<long long>(value));
+			break;
+		case COLUMN_TIMESTAMP:
 			try {
-				_row[PQfname(_result, i)] = boost::posix_time::time_from_string(value);
-			} catch (const boost::gregorian::bad_day_of_month &e) {}
-
-		} else {
+				target.storeValue(i, boost::posix_time::time_from_string(value));
+			} catch (const boost::gregorian::bad_day_of_month &e) {
+				target.storeNull(i);
+			}
+			break;
+		default:
 			// TODO
+			target.storeNull(i);
+			break;
+		}
+	}
+}
+
+bool PostgresSqlResult::hasText() const
+{
+	return true;
+}
+
+bool PostgresSqlResult::isNumber(const unsigned int column) const
+{
+	// Object identifiers of the built-in numeric types, that never
+	// change between servers
+	switch (PQftype(_result, column)) {
+	case 20:   // int8
+	case 21:   // int2
+	case 23:   // int4
+	case 26:   // oid
+	case 700:  // float4
+	case 701:  // float8
+	case 1700: // numeric
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool PostgresSqlResult::fetchText(std::vector<const char*> &values,
+                                  std::vector<unsigned long> &sizes)
+{
+	clearRow();
+
+	if (nextRow() == false) {
+		return false;
+	}
+
+	values = _values;
+	sizes = _lengths;
+
+	// Rows read in advance already have the NULL values
+	for (unsigned int i = 0; _rows == NULL && i < _columnTypes.size(); i++) {
+		if (PQgetisnull(_result, _currentRow, i)) {
+			values[i] = NULL;
+			sizes[i] = 0;
 		}
 	}
 
 	return true;
 }
 
+void PostgresSqlResult::getText(const unsigned int column, 
+                                const char *&value, 
+                                unsigned long &size) const
+{
+	if (_currentRow < 0 || static_cast<unsigned int>(_currentRow) >= this->size() ||
+	    column >= _values.size()) {
+		throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR,
+		                         "No value in the current row");
+	}
+
+	// Rows read in advance already have the NULL values
+	if (_rows == NULL && PQgetisnull(_result, _currentRow, column)) {
+		value = NULL;
+		size = 0;
+		return;
+	}
+
+	value = _values[column];
+	size = _lengths[column];
+}
+
 boost::any PostgresSqlResult::get(const string &key) const
 {
 	auto result = _row.find(key);
@@ -0,0 +1,203 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <dbplus/DatabaseException.hpp>
+#include <dbplus/PrefetchResult.hpp>
+
+DBPLUS_NS_BEGIN
+
+PrefetchResult::PrefetchResult(std::shared_ptr<Result> result,
+                               const unsigned int batchSize,
+                               const unsigned int batches) :
+	_result(result),
+	_size(result->size()),
+	_batchSize(batchSize == 0 ? 1 : batchSize),
+	_batches(batches < 2 ? 2 : batches),
+	_produced(0),
+	_consumed(0),
+	_stopped(false),
+	_waiting(0),
+	_current(NULL),
+	_position(0),
+	_finished(false)
+{
+	for (Batch &batch : _batches) {
+		batch.count = 0;
+		batch.last = false;
+	}
+
+	_thread = std::thread(&PrefetchResult::run, this);
+}
+
+PrefetchResult::~PrefetchResult()
+{
+	_stopped = true;
+	notify();
+	_thread.join();
+}
+
+unsigned int PrefetchResult::size() const
+{
+	return _size;
+}
+
+bool PrefetchResult::fetch()
+{
+	if (_current != NULL && ++_position < _current->count) {
+		return true;
+	}
+
+	while (true) {
+		if (_current != NULL) {
+			bool last = _current->last;
+			std::exception_ptr error = _current->error;
+
+			// The slot can be filled again after this point
+			_current = NULL;
+			_consumed++;
+			notify();
+
+			if (error) {
+				_finished = true;
+				std::rethrow_exception(error);
+			}
+
+			if (last) {
+				_finished = true;
+			}
+		}
+
+		if (_finished) {
+			return false;
+		}
+
+		if (_consumed == _produced) {
+			wait(false);
+		}
+
+		_current = &_batches[_consumed % _batches.size()];
+		_position = 0;
+
+		if (_current->count > 0) {
+			return true;
+		}
+	}
+}
+
+boost::any PrefetchResult::get(const string &key) const
+{
+	const std::map<string, boost::any> &row = getRow();
+
+	auto result = row.find(key);
+	if (result == row.end()) {
+		throw DATABASE_EXCEPTION(DatabaseException::UNKNOW_KEY_ERROR, 
+		                         "Column " + key + " not found in result set");
+	}
+
+	return result->second;
+}
+
+const std::map<string, boost::any>& PrefetchResult::getRow() const
+{
+	if (_current == NULL) {
+		return _row;
+	}
+
+	return _current->rows[_position];
+}
+
+void PrefetchResult::run()
+{
+	while (_stopped == false) {
+		if (_produced - _consumed >= _batches.size()) {
+			wait(true);
+		}
+
+		if (_stopped) {
+			break;
+		}
+
+		Batch &batch = _batches[_produced % _batches.size()];
+		batch.count = 0;
+		batch.last = false;
+		batch.error = std::exception_ptr();
+
+		try {
+			while (batch.count < _batchSize && _stopped == false) {
+				if (_result->fetch() == false) {
+					batch.last = true;
+					break;
+				}
+
+				// The maps of the slot are reused, so the nodes of the
+				// previous batch are overwritten instead of allocated
+				if (batch.rows.size() <= batch.count) {
+					batch.rows.resize(batch.count + 1);
+				}
+				batch.rows[batch.count++] = _result->getRow();
+			}
+		} catch (...) {
+			batch.error = std::current_exception();
+			batch.last = true;
+		}
+
+		_produced++;
+		notify();
+
+		if (batch.last) {
+			break;
+		}
+	}
+}
+
+void PrefetchResult::wait(const bool producer)
+{
+	auto ready = [this, producer]() {
+		if (producer) {
+			return _stopped || _produced - _consumed < _batches.size();
+		}
+		return _consumed < _produced;
+	};
+
+	// The other thread is usually about to finish a batch, so it's
+	// cheaper to try again a few times before sleeping
+	for (unsigned int i = 0; i < 64; i++) {
+		if (ready()) {
+			return;
+		}
+		std::this_thread::yield();
+	}
+
+	std::unique_lock<std::mutex> lock(_lock);
+	_waiting++;
+	_wake.wait(lock, ready);
+	_waiting--;
+}
+
+void PrefetchResult::notify()
+{
+	// A thread that is going to sleep increments the counter before
+	// checking the positions, holding the lock, so it can't miss this
+	if (_waiting > 0) {
+		std::lock_guard<std::mutex> lock(_lock);
+		_wake.notify_all();
+	}
+}
+
+DBPLUS_NS_END
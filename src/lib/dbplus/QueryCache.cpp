@@ -0,0 +1,219 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <dbplus/QueryCache.hpp>
+
+DBPLUS_NS_BEGIN
+
+QueryCache::QueryCache(const unsigned long maxMemory, 
+                       const std::chrono::milliseconds ttl) :
+	_cleared(0),
+	_ticket(0),
+	_memory(0),
+	_maxMemory(maxMemory),
+	_ttl(ttl),
+	_hits(0),
+	_misses(0)
+{
+}
+
+std::shared_ptr<const StoredResult::Data> QueryCache::get(const string &query)
+{
+	std::lock_guard<std::mutex> lock(_lock);
+
+	auto entry = _queries.find(query);
+	if (entry == _queries.end()) {
+		_misses++;
+		return std::shared_ptr<const StoredResult::Data>();
+	}
+
+	Position position = entry->second;
+	if (position->expiration <= std::chrono::steady_clock::now()) {
+		remove(position);
+		_misses++;
+		return std::shared_ptr<const StoredResult::Data>();
+	}
+
+	_entries.splice(_entries.begin(), _entries, position);
+	_hits++;
+
+	return position->data;
+}
+
+unsigned long long QueryCache::ticket()
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	return _ticket;
+}
+
+bool QueryCache::put(const string &query, 
+                     std::shared_ptr<const StoredResult::Data> data,
+                     const std::set<string> &tables,
+                     const unsigned long long ticket)
+{
+	return put(query, data, tables, ticket, _ttl);
+}
+
+bool QueryCache::put(const string &query, 
+                     std::shared_ptr<const StoredResult::Data> data,
+                     const std::set<string> &tables,
+                     const unsigned long long ticket,
+                     const std::chrono::milliseconds ttl)
+{
+	unsigned long memory = data->getMemory() + query.size();
+	for (const string &table : tables) {
+		memory += table.size();
+	}
+
+	std::lock_guard<std::mutex> lock(_lock);
+
+	if (memory > _maxMemory || _cleared > ticket) {
+		return false;
+	}
+
+	for (const string &table : tables) {
+		auto invalidated = _invalidated.find(table);
+		if (invalidated != _invalidated.end() && invalidated->second > ticket) {
+			return false;
+		}
+	}
+
+	auto existing = _queries.find(query);
+	if (existing != _queries.end()) {
+		remove(existing->second);
+	}
+
+	while (_memory + memory > _maxMemory && _entries.empty() == false) {
+		remove(--_entries.end());
+	}
+
+	Entry entry;
+	entry.query = query;
+	entry.data = data;
+	entry.tables = tables;
+	entry.expiration = std::chrono::steady_clock::now() + ttl;
+	entry.memory = memory;
+
+	_entries.push_front(entry);
+	_queries[query] = _entries.begin();
+	for (const string &table : tables) {
+		_tables[table].insert(query);
+	}
+
+	_memory += memory;
+	return true;
+}
+
+void QueryCache::invalidate(const string &table)
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	_ticket++;
+	invalidateLocked(table);
+}
+
+void QueryCache::invalidate(const std::set<string> &tables)
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	_ticket++;
+	for (const string &table : tables) {
+		invalidateLocked(table);
+	}
+}
+
+void QueryCache::clear()
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	_ticket++;
+	_cleared = _ticket;
+
+	// The last invalidation of each table is older than the clear now
+	_invalidated.clear();
+
+	_entries.clear();
+	_queries.clear();
+	_tables.clear();
+	_memory = 0;
+}
+
+unsigned int QueryCache::size() const
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	return _queries.size();
+}
+
+unsigned long QueryCache::getMemory() const
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	return _memory;
+}
+
+unsigned long QueryCache::getMaxMemory() const
+{
+	return _maxMemory;
+}
+
+unsigned long long QueryCache::getHits() const
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	return _hits;
+}
+
+unsigned long long QueryCache::getMisses() const
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	return _misses;
+}
+
+void QueryCache::invalidateLocked(const string &table)
+{
+	_invalidated[table] = _ticket;
+
+	auto index = _tables.find(table);
+	if (index == _tables.end()) {
+		return;
+	}
+
+	// Removing an entry changes the table index, so we copy the queries
+	std::set<string> queries = index->second;
+	for (const string &query : queries) {
+		auto entry = _queries.find(query);
+		if (entry != _queries.end()) {
+			remove(entry->second);
+		}
+	}
+}
+
+void QueryCache::remove(Position position)
+{
+	for (const string &table : position->tables) {
+		auto index = _tables.find(table);
+		if (index != _tables.end()) {
+			index->second.erase(position->query);
+			if (index->second.empty()) {
+				_tables.erase(index);
+			}
+		}
+	}
+
+	_memory -= position->memory;
+	_queries.erase(position->query);
+	_entries.erase(position);
+}
+
+DBPLUS_NS_END
@@ -0,0 +1,451 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+extern "C" {
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#ifdef DBPLUS_IO_URING
+#include <liburing.h>
+#endif
+}
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include <dbplus/DatabaseException.hpp>
+#include <dbplus/Reactor.hpp>
+
+DBPLUS_NS_BEGIN
+
+/*! \class ReactorBackend
+ *  \brief Mechanism used by the reactor to wait for sockets.
+ *
+ * Every registration is one-shot: after the socket is reported as
+ * ready it must be registered again.
+ */
+class ReactorBackend
+{
+public:
+	virtual ~ReactorBackend() {}
+
+	/*! Wait for the socket to be readable or writable.
+	 */
+	virtual void add(const int socket, const bool read, void *data) = 0;
+
+	/*! Wait for events and store the data of the ready sockets.
+	 */
+	virtual void wait(const int timeout, std::vector<void*> &ready) = 0;
+};
+
+/*! \class EpollBackend
+ *  \brief Wait for sockets using epoll.
+ */
+class EpollBackend : public ReactorBackend
+{
+public:
+	EpollBackend() :
+		_epoll(epoll_create1(EPOLL_CLOEXEC)),
+		_events(64)
+	{
+		if (_epoll < 0) {
+			throw DATABASE_EXCEPTION(DatabaseException::CONNECTION_ERROR,
+			                         strerror(errno));
+		}
+	}
+
+	~EpollBackend()
+	{
+		close(_epoll);
+	}
+
+	void add(const int socket, const bool read, void *data)
+	{
+		struct epoll_event event;
+		memset(&event, 0, sizeof(event));
+		event.events = (read ? EPOLLIN : EPOLLOUT) | EPOLLONESHOT;
+		event.data.ptr = data;
+
+		// A socket disabled by EPOLLONESHOT is still in the epoll set
+		if (epoll_ctl(_epoll, EPOLL_CTL_MOD, socket, &event) != 0 &&
+		    (errno != ENOENT ||
+		     epoll_ctl(_epoll, EPOLL_CTL_ADD, socket, &event) != 0)) {
+			throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR,
+			                         strerror(errno));
+		}
+	}
+
+	void wait(const int timeout, std::vector<void*> &ready)
+	{
+		int events = epoll_wait(_epoll, &_events[0], _events.size(), timeout);
+		for (int i = 0; i < events; i++) {
+			ready.push_back(_events[i].data.ptr);
+		}
+
+		if (events == static_cast<int>(_events.size())) {
+			_events.resize(_events.size() * 2);
+		}
+	}
+
+private:
+	int _epoll;
+	std::vector<struct epoll_event> _events;
+};
+
+#ifdef DBPLUS_IO_URING
+/*! \class IoUringBackend
+ *  \brief Wait for sockets using io_uring poll requests.
+ */
+class IoUringBackend : public ReactorBackend
+{
+public:
+	IoUringBackend()
+	{
+		int error = io_uring_queue_init(1024, &_ring, 0);
+		if (error < 0) {
+			throw DATABASE_EXCEPTION(DatabaseException::CONNECTION_ERROR,
+			                         strerror(-error));
+		}
+	}
+
+	~IoUringBackend()
+	{
+		io_uring_queue_exit(&_ring);
+	}
+
+	void add(const int socket, const bool read, void *data)
+	{
+		struct io_uring_sqe *request = io_uring_get_sqe(&_ring);
+		if (request == NULL) {
+			// Submission queue is full, flush it and try again
+			io_uring_submit(&_ring);
+			request = io_uring_get_sqe(&_ring);
+		}
+
+		if (request == NULL) {
+			throw DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR,
+			                         "io_uring submission queue is full");
+		}
+
+		io_uring_prep_poll_add(request, socket, read ? POLLIN : POLLOUT);
+		io_uring_sqe_set_data(request, data);
+	}
+
+	void wait(const int timeout, std::vector<void*> &ready)
+	{
+		io_uring_submit(&_ring);
+
+		struct io_uring_cqe *completion = NULL;
+		int error = 0;
+
+		if (timeout < 0) {
+			error = io_uring_wait_cqe_timeout(&_ring, &completion, NULL);
+		} else {
+			struct __kernel_timespec time;
+			time.tv_sec = timeout / 1000;
+			time.tv_nsec = (timeout % 1000) * 1000000LL;
+			error = io_uring_wait_cqe_timeout(&_ring, &completion, &time);
+		}
+
+		while (error == 0 && completion != NULL) {
+			ready.push_back(io_uring_cqe_get_data(completion));
+			io_uring_cqe_seen(&_ring, completion);
+
+			completion = NULL;
+			error = io_uring_peek_cqe(&_ring, &completion);
+		}
+	}
+
+private:
+	struct io_uring _ring;
+};
+#endif
+
+Reactor::Reactor(const Backend::Value backend) :
+	_wakeUp(-1),
+	_completed(0),
+	_pending(0),
+	_running(false)
+{
+	switch (backend) {
+	case Backend::EPOLL:
+		_backend.reset(new EpollBackend());
+		break;
+	case Backend::IO_URING:
+#ifdef DBPLUS_IO_URING
+		_backend.reset(new IoUringBackend());
+		break;
+#else
+		throw DATABASE_EXCEPTION(DatabaseException::CONNECTION_ERROR,
+		                         "DBplus was compiled without io_uring");
+#endif
+	}
+
+	_wakeUp = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (_wakeUp < 0) {
+		throw DATABASE_EXCEPTION(DatabaseException::CONNECTION_ERROR,
+		                         strerror(errno));
+	}
+
+	// The wake up descriptor is identified by an empty data
+	_backend->add(_wakeUp, true, NULL);
+}
+
+Reactor::~Reactor()
+{
+	_backend.reset();
+	close(_wakeUp);
+}
+
+void Reactor::addConnection(std::shared_ptr<Database> database)
+{
+	std::shared_ptr<Connection> connection(new Connection());
+	connection->database = database;
+	connection->busy = false;
+	connection->registered = false;
+
+	_connections.push_back(connection);
+}
+
+void Reactor::execute(const string &query, Database::AsyncCallback callback)
+{
+	submit(NULL, 
+	       [query](Database &database, Database::AsyncCallback callback) {
+		       return database.executeAsync(query, callback);
+	       },
+	       callback);
+}
+
+void Reactor::execute(std::shared_ptr<Database> connection,
+                      const string &query,
+                      Database::AsyncCallback callback)
+{
+	submit(connection.get(), 
+	       [query](Database &database, Database::AsyncCallback callback) {
+		       return database.executeAsync(query, callback);
+	       },
+	       callback);
+}
+
+void Reactor::commit(std::shared_ptr<Database> connection,
+                     Database::AsyncCallback callback)
+{
+	submit(connection.get(), 
+	       [](Database &database, Database::AsyncCallback callback) {
+		       return database.commitAsync(callback);
+	       },
+	       callback);
+}
+
+void Reactor::rollback(std::shared_ptr<Database> connection,
+                       Database::AsyncCallback callback)
+{
+	submit(connection.get(), 
+	       [](Database &database, Database::AsyncCallback callback) {
+		       return database.rollbackAsync(callback);
+	       },
+	       callback);
+}
+
+unsigned int Reactor::runOnce(const int timeout)
+{
+	_completed = 0;
+
+	dispatch();
+
+	std::vector<void*> ready;
+	_backend->wait(_completed > 0 ? 0 : timeout, ready);
+
+	for (void *data : ready) {
+		if (data == NULL) {
+			uint64_t value = 0;
+			while (read(_wakeUp, &value, sizeof(value)) > 0) {}
+			_backend->add(_wakeUp, true, NULL);
+			continue;
+		}
+
+		Connection *connection = static_cast<Connection*>(data);
+		connection->registered = false;
+
+		Database::AsyncStatus::Value status = connection->database->poll();
+		if (status != Database::AsyncStatus::COMPLETE) {
+			wait(*connection, status);
+		}
+	}
+
+	dispatch();
+
+	return _completed;
+}
+
+void Reactor::run()
+{
+	_running = true;
+	while (_running) {
+		runOnce();
+	}
+}
+
+void Reactor::stop()
+{
+	_running = false;
+	wakeUp();
+}
+
+unsigned int Reactor::pending() const
+{
+	return _pending;
+}
+
+void Reactor::submit(Database *connection, 
+                     Operation operation, 
+                     Database::AsyncCallback callback)
+{
+	Task task;
+	task.connection = connection;
+	task.operation = operation;
+	task.callback = callback;
+
+	{
+		std::lock_guard<std::mutex> lock(_submittedLock);
+		_submitted.push_back(task);
+	}
+
+	_pending++;
+	wakeUp();
+}
+
+void Reactor::dispatch()
+{
+	std::deque<Task> submitted;
+	{
+		std::lock_guard<std::mutex> lock(_submittedLock);
+		submitted.swap(_submitted);
+	}
+
+	for (Task &task : submitted) {
+		if (task.connection == NULL) {
+			_tasks.push_back(task);
+			continue;
+		}
+
+		bool found = false;
+		for (auto &connection : _connections) {
+			if (connection->database.get() == task.connection) {
+				connection->tasks.push_back(task);
+				found = true;
+				break;
+			}
+		}
+
+		if (found == false) {
+			_pending--;
+			_completed++;
+			task.callback(std::shared_ptr<Result>(),
+			              std::make_exception_ptr(
+				              DATABASE_EXCEPTION(DatabaseException::EXECUTION_ERROR,
+				                                 "Connection not found in reactor")));
+		}
+	}
+
+	// A callback can submit new queries to the same connection, so we
+	// keep starting queries until all idle connections are used
+	bool started = true;
+	while (started) {
+		started = false;
+
+		for (auto &connection : _connections) {
+			if (connection->busy) {
+				continue;
+			}
+
+			if (connection->tasks.empty() == false) {
+				Task task = connection->tasks.front();
+				connection->tasks.pop_front();
+				started = start(*connection, task) || started;
+
+			} else if (_tasks.empty() == false) {
+				Task task = _tasks.front();
+				_tasks.pop_front();
+				started = start(*connection, task) || started;
+			}
+		}
+	}
+}
+
+bool Reactor::start(Connection &connection, Task &task)
+{
+	Connection *current = &connection;
+	unsigned int &completed = _completed;
+	std::atomic<unsigned int> &pending = _pending;
+	Database::AsyncCallback callback = task.callback;
+
+	connection.busy = true;
+
+	try {
+		Database::AsyncStatus::Value status =
+			task.operation(*connection.database,
+			  [current, &completed, &pending, callback]
+			  (std::shared_ptr<Result> result, std::exception_ptr error) {
+				  current->busy = false;
+				  pending--;
+				  completed++;
+				  callback(result, error);
+			  });
+
+		if (status != Database::AsyncStatus::COMPLETE) {
+			wait(connection, status);
+		}
+
+	} catch (const DatabaseException &e) {
+		connection.busy = false;
+		_pending--;
+		_completed++;
+		callback(std::shared_ptr<Result>(), std::current_exception());
+	}
+
+	// The connection is idle again when the query finishes immediately
+	return connection.busy == false;
+}
+
+void Reactor::wait(Connection &connection,
+                   const Database::AsyncStatus::Value status)
+{
+	if (connection.registered) {
+		return;
+	}
+
+	connection.registered = true;
+	_backend->add(connection.database->getSocket(),
+	              status == Database::AsyncStatus::WAIT_READ,
+	              &connection);
+}
+
+void Reactor::wakeUp()
+{
+	uint64_t value = 1;
+	if (write(_wakeUp, &value, sizeof(value)) < 0) {
+		// The counter is full, so the loop is already awake
+	}
+}
+
+DBPLUS_NS_END
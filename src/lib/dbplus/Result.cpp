@@ -0,0 +1,173 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <dbplus/Binary.hpp>
+#include <dbplus/Result.hpp>
+
+DBPLUS_NS_BEGIN
+
+const std::vector<string>& Result::getColumnNames() const
+{
+	return _columnNames;
+}
+
+bool Result::hasText() const
+{
+	return false;
+}
+
+bool Result::isNumber(const unsigned int) const
+{
+	return false;
+}
+
+bool Result::fetchText(std::vector<const char*>&, std::vector<unsigned long>&)
+{
+	throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR,
+	                         "Result doesn't keep the values as text");
+}
+
+void Result::getText(const unsigned int, const char*&, unsigned long&) const
+{
+	throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR,
+	                         "Result doesn't keep the values as text");
+}
+
+void Result::forEachBatch(BatchCallback callback, const unsigned int batchSize)
+{
+	const unsigned int size = batchSize > 0 ? batchSize : 1;
+
+	RowBlock block;
+	block.reset(getColumnNames());
+
+	bool fetched = fetch();
+	while (fetched) {
+		block.clear();
+
+		// Results that don't know the columns in advance add them as
+		// they appear in the rows
+		while (fetched && block.size() < size) {
+			block.addRow();
+			for (const auto &value : getRow()) {
+				int column = block.getColumn(value.first);
+				if (column < 0) {
+					column = block.addColumn(value.first);
+				}
+				block.storeValue(column, value.second);
+			}
+
+			fetched = fetch();
+		}
+
+		callback(block);
+	}
+}
+
+void Result::setColumns(const std::vector<string> &names)
+{
+	clearRow();
+
+	_columnNames = names;
+	_columnValues.assign(names.size(), NULL);
+}
+
+void Result::storeString(const unsigned int column, 
+                         const char *data, 
+                         const unsigned long size)
+{
+	boost::any &slot = columnValue(column);
+
+	string *current = boost::any_cast<string>(&slot);
+	if (current != NULL) {
+		current->assign(data, size);
+	} else {
+		slot = string(data, size);
+	}
+}
+
+void Result::storeBinary(const unsigned int column, 
+                         const unsigned char *data, 
+                         const unsigned long size)
+{
+	boost::any &slot = columnValue(column);
+
+	Binary *current = boost::any_cast<Binary>(&slot);
+	if (current != NULL) {
+		current->assign(data, size);
+	} else {
+		slot = Binary(data, size);
+	}
+}
+
+void Result::storeNull(const unsigned int column)
+{
+	boost::any *value = _columnValues[column];
+	if (value == NULL) {
+		return;
+	}
+
+	// Columns with the same name share the value. When a previous
+	// column of the row has the same name, its value is kept
+	for (unsigned int i = 0; i < column; i++) {
+		if (_columnValues[i] == value) {
+			return;
+		}
+	}
+
+	for (auto &other : _columnValues) {
+		if (other == value) {
+			other = NULL;
+		}
+	}
+
+	_row.erase(_columnNames[column]);
+}
+
+void Result::clearRow()
+{
+	// The values are moved to the recycled row, so the memory of the
+	// strings is reused by the next rows with the same columns
+	if (_row.empty() == false) {
+		_recycled.swap(_row);
+		_row.clear();
+	}
+
+	_columnValues.assign(_columnValues.size(), NULL);
+}
+
+boost::any& Result::columnValue(const unsigned int column)
+{
+	boost::any *value = _columnValues[column];
+	if (value != NULL) {
+		return *value;
+	}
+
+	value = &_row[_columnNames[column]];
+
+	auto recycled = _recycled.find(_columnNames[column]);
+	if (recycled != _recycled.end()) {
+		value->swap(recycled->second);
+		_recycled.erase(recycled);
+	}
+
+	_columnValues[column] = value;
+	return *value;
+}
+
+DBPLUS_NS_END
@@ -0,0 +1,416 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+extern "C" {
+#include <limits.h>
+#include <sys/uio.h>
+}
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <boost/date_time/gregorian/gregorian.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <dbplus/Binary.hpp>
+#include <dbplus/DatabaseException.hpp>
+#include <dbplus/ResultExporter.hpp>
+#include <dbplus/SqlValue.hpp>
+#include <dbplus/TextScan.hpp>
+
+DBPLUS_NS_BEGIN
+
+namespace {
+
+#ifdef IOV_MAX
+const int MAX_PIECES = IOV_MAX;
+#else
+const int MAX_PIECES = 1024;
+#endif
+
+// JSON doesn't accept NaN and Infinity, that PostgreSQL can return in
+// numeric columns
+bool isJsonNumber(const char *value, const unsigned long size)
+{
+	unsigned long position = (size > 0 && value[0] == '-') ? 1 : 0;
+	return position < size && value[position] >= '0' && value[position] <= '9';
+}
+
+bool isNumberType(const std::type_info &type)
+{
+	return type != typeid(string) &&
+		type != typeid(Binary) &&
+		type != typeid(const char*) &&
+		type != typeid(boost::gregorian::date) &&
+		type != typeid(boost::posix_time::ptime);
+}
+
+void appendCsv(const char *value, 
+               const unsigned long size, 
+               unsigned long position, 
+               string &buffer)
+{
+	buffer.append(value, position);
+	while (position < size) {
+		if (value[position] == '"') {
+			buffer += "\"\"";
+		} else {
+			buffer += value[position];
+		}
+		position++;
+
+		unsigned long run = TextScan::find(value + position, size - position, "\"");
+		buffer.append(value + position, run);
+		position += run;
+	}
+}
+
+void appendJson(const char *value, 
+                const unsigned long size, 
+                unsigned long position, 
+                string &buffer)
+{
+	buffer.append(value, position);
+	while (position < size) {
+		unsigned char c = value[position];
+		switch (c) {
+		case '"':
+			buffer += "\\\"";
+			break;
+		case '\\':
+			buffer += "\\\\";
+			break;
+		case '\b':
+			buffer += "\\b";
+			break;
+		case '\f':
+			buffer += "\\f";
+			break;
+		case '\n':
+			buffer += "\\n";
+			break;
+		case '\r':
+			buffer += "\\r";
+			break;
+		case '\t':
+			buffer += "\\t";
+			break;
+		default:
+			char escaped[8];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+			buffer += escaped;
+			break;
+		}
+		position++;
+
+		unsigned long run = 
+			TextScan::find(value + position, size - position, "\"\\", false, true);
+		buffer.append(value + position, run);
+		position += run;
+	}
+}
+
+}
+
+const unsigned long ResultExporter::BUFFER_SIZE;
+const unsigned long ResultExporter::BORROW_SIZE;
+
+ResultExporter::ResultExporter(const int descriptor, const Format::Value format) :
+	_descriptor(descriptor),
+	_format(format),
+	_header(true),
+	_bufferStart(0)
+{
+}
+
+ResultExporter::ResultExporter(Sink sink, const Format::Value format) :
+	_descriptor(-1),
+	_sink(sink),
+	_format(format),
+	_header(true),
+	_bufferStart(0)
+{
+}
+
+void ResultExporter::setHeader(const bool header)
+{
+	_header = header;
+}
+
+unsigned long long ResultExporter::write(Result &result)
+{
+	_keys.clear();
+	_buffer.clear();
+	_buffer.reserve(BUFFER_SIZE + BORROW_SIZE);
+	_bufferStart = 0;
+	_pieces.clear();
+
+	const bool text = result.hasText();
+	std::vector<string> names = result.getColumnNames();
+
+	// Results without the columns in advance use the columns of the
+	// first row
+	bool fetched = false;
+	if (text == false) {
+		fetched = result.fetch();
+		if (names.empty() && fetched) {
+			for (const auto &column : result.getRow()) {
+				names.push_back(column.first);
+			}
+		}
+	}
+
+	std::vector<const char*> values(names.size(), NULL);
+	std::vector<unsigned long> sizes(names.size(), 0);
+	std::vector<bool> numbers(names.size(), false);
+	for (unsigned int i = 0; text && i < names.size(); i++) {
+		numbers[i] = result.isNumber(i);
+	}
+
+	if (_format == Format::CSV && _header && names.empty() == false) {
+		for (unsigned int i = 0; i < names.size(); i++) {
+			if (i > 0) {
+				_buffer += ',';
+			}
+			writeCsv(names[i].data(), names[i].size(), false);
+		}
+		endRow();
+
+	} else if (_format == Format::JSON_LINES) {
+		for (unsigned int i = 0; i < names.size(); i++) {
+			string key(i == 0 ? "{\"" : ",\"");
+			appendJson(names[i].data(), names[i].size(),
+			           TextScan::find(names[i].data(), names[i].size(), 
+			                          "\"\\", false, true), 
+			           key);
+			key += "\":";
+			_keys.push_back(key);
+		}
+	}
+
+	unsigned long long rows = 0;
+
+	if (text) {
+		while (result.fetchText(values, sizes)) {
+			writeRow(values, sizes, numbers, true);
+			rows++;
+		}
+	} else {
+		std::vector<string> plain(names.size());
+		while (fetched) {
+			const std::map<string, boost::any> &row = result.getRow();
+			for (unsigned int i = 0; i < names.size(); i++) {
+				auto column = row.find(names[i]);
+				if (column == row.end() || column->second.empty()) {
+					values[i] = NULL;
+					sizes[i] = 0;
+					continue;
+				}
+
+				plain[i].clear();
+				SqlValue::appendPlain(column->second, plain[i]);
+				values[i] = plain[i].data();
+				sizes[i] = plain[i].size();
+				numbers[i] = isNumberType(column->second.type());
+			}
+
+			// The text is overwritten by the next row, so it's copied
+			writeRow(values, sizes, numbers, false);
+			rows++;
+
+			fetched = result.fetch();
+		}
+	}
+
+	flush();
+	return rows;
+}
+
+void ResultExporter::writeRow(const std::vector<const char*> &values,
+                              const std::vector<unsigned long> &sizes,
+                              const std::vector<bool> &numbers,
+                              const bool borrow)
+{
+	if (_format == Format::CSV) {
+		for (unsigned int i = 0; i < values.size(); i++) {
+			if (i > 0) {
+				_buffer += ',';
+			}
+			writeCsv(values[i], sizes[i], borrow);
+		}
+
+	} else {
+		if (values.empty()) {
+			_buffer += '{';
+		}
+
+		for (unsigned int i = 0; i < values.size(); i++) {
+			_buffer += _keys[i];
+
+			if (values[i] == NULL) {
+				_buffer += "null";
+			} else if (numbers[i] && isJsonNumber(values[i], sizes[i])) {
+				appendValue(values[i], sizes[i], borrow);
+			} else {
+				writeJson(values[i], sizes[i], borrow);
+			}
+		}
+
+		_buffer += '}';
+	}
+
+	endRow();
+}
+
+void ResultExporter::writeCsv(const char *value, 
+                              const unsigned long size, 
+                              const bool borrow)
+{
+	if (value == NULL) {
+		return;
+	}
+
+	// Empty texts are quoted, to be different from NULL values
+	if (size == 0) {
+		_buffer += "\"\"";
+		return;
+	}
+
+	unsigned long position = TextScan::find(value, size, "\",\n\r");
+	if (position == size) {
+		appendValue(value, size, borrow);
+		return;
+	}
+
+	_buffer += '"';
+	appendCsv(value, size, position, _buffer);
+	_buffer += '"';
+}
+
+void ResultExporter::writeJson(const char *value, 
+                               const unsigned long size, 
+                               const bool borrow)
+{
+	_buffer += '"';
+
+	unsigned long position = TextScan::find(value, size, "\"\\", false, true);
+	if (position == size) {
+		appendValue(value, size, borrow);
+	} else {
+		appendJson(value, size, position, _buffer);
+	}
+
+	_buffer += '"';
+}
+
+void ResultExporter::appendValue(const char *value, 
+                                 const unsigned long size, 
+                                 const bool borrow)
+{
+	if (borrow == false || size < BORROW_SIZE) {
+		_buffer.append(value, size);
+		return;
+	}
+
+	if (_buffer.size() > _bufferStart) {
+		Piece piece = { NULL, _bufferStart, _buffer.size() - _bufferStart };
+		_pieces.push_back(piece);
+		_bufferStart = _buffer.size();
+	}
+
+	Piece piece = { value, 0, size };
+	_pieces.push_back(piece);
+}
+
+void ResultExporter::endRow()
+{
+	_buffer += '\n';
+
+	// Values of the driver are only valid until the next row
+	if (_pieces.empty() == false || _buffer.size() >= BUFFER_SIZE) {
+		flush();
+	}
+}
+
+void ResultExporter::flush()
+{
+	if (_buffer.size() > _bufferStart) {
+		Piece piece = { NULL, _bufferStart, _buffer.size() - _bufferStart };
+		_pieces.push_back(piece);
+	}
+
+	send(_pieces);
+
+	_pieces.clear();
+	_buffer.clear();
+	_bufferStart = 0;
+}
+
+void ResultExporter::send(const std::vector<Piece> &pieces)
+{
+	if (_sink) {
+		for (const Piece &piece : pieces) {
+			_sink(piece.data != NULL ? piece.data : _buffer.data() + piece.offset,
+			      piece.size);
+		}
+		return;
+	}
+
+	std::vector<struct iovec> vectors(pieces.size());
+	for (unsigned int i = 0; i < pieces.size(); i++) {
+		const char *data = pieces[i].data != NULL ? 
+			pieces[i].data : _buffer.data() + pieces[i].offset;
+		vectors[i].iov_base = const_cast<char*>(data);
+		vectors[i].iov_len = pieces[i].size;
+	}
+
+	unsigned int current = 0;
+	while (current < vectors.size()) {
+		int count = vectors.size() - current;
+		if (count > MAX_PIECES) {
+			count = MAX_PIECES;
+		}
+
+		ssize_t written = writev(_descriptor, &vectors[current], count);
+		if (written < 0 && errno == EINTR) {
+			continue;
+		}
+
+		if (written < 0) {
+			throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR,
+			                         strerror(errno));
+		}
+
+		// Skip what was written, that can end in the middle of a piece
+		while (current < vectors.size() && 
+		       static_cast<size_t>(written) >= vectors[current].iov_len) {
+			written -= vectors[current].iov_len;
+			current++;
+		}
+
+		if (written > 0) {
+			vectors[current].iov_base = 
+				static_cast<char*>(vectors[current].iov_base) + written;
+			vectors[current].iov_len -= written;
+		}
+	}
+}
+
+DBPLUS_NS_END
@@ -0,0 +1,378 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+extern "C" {
+#include <fcntl.h>
+#include <unistd.h>
+}
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include <boost/date_time/gregorian/gregorian.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <dbplus/Binary.hpp>
+#include <dbplus/DatabaseException.hpp>
+#include <dbplus/ResultSnapshot.hpp>
+
+DBPLUS_NS_BEGIN
+
+namespace {
+
+template<class T>
+void appendFixed(string &buffer, const T value)
+{
+	buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void align(string &buffer)
+{
+	buffer.resize((buffer.size() + 7) & ~static_cast<string::size_type>(7), '\0');
+}
+
+}
+
+const char ResultSnapshot::MAGIC[8] = {'D', 'B', 'P', 'L', 'U', 'S', 'S', 'N'};
+const uint32_t ResultSnapshot::VERSION;
+
+/*! Values of a column while the result is read
+ */
+struct ResultSnapshot::Column {
+	string name;
+	Type::Value type;
+	bool typed;
+	uint64_t rows;
+	string nulls;
+	string values;
+	string heap;
+};
+
+unsigned long long ResultSnapshot::write(Result &result, const string &path)
+{
+	std::vector<Column> columns;
+	std::map<string, unsigned int> indexes;
+	uint64_t rows = 0;
+
+	// Keep the columns of the query, in its order, even when they are
+	// NULL in every row or when there are no rows at all
+	for (const string &name : result.getColumnNames()) {
+		if (indexes.count(name) == 0) {
+			columns.push_back(newColumn(name));
+			indexes.insert(std::make_pair(name, columns.size() - 1));
+		}
+	}
+
+	while (result.fetch()) {
+		for (auto &entry : result.getRow()) {
+			if (entry.second.empty()) {
+				continue;
+			}
+
+			auto index = indexes.find(entry.first);
+			if (index == indexes.end()) {
+				columns.push_back(newColumn(entry.first));
+				index = indexes.insert(std::make_pair(entry.first, 
+				                                      columns.size() - 1)).first;
+			}
+
+			// The first value defines the type of the column
+			Column &column = columns[index->second];
+			if (column.typed == false) {
+				setType(column, getType(entry.second));
+			}
+
+			// Columns that were missing in the previous rows are NULL
+			while (column.rows < rows) {
+				appendNull(column);
+			}
+
+			append(column, entry.second);
+		}
+
+		rows++;
+	}
+
+	for (Column &column : columns) {
+		// Columns without any value are stored as NULL strings
+		if (column.typed == false) {
+			setType(column, Type::STRING);
+		}
+
+		while (column.rows < rows) {
+			appendNull(column);
+		}
+	}
+
+	FileHeader header;
+	memcpy(header.magic, MAGIC, sizeof(header.magic));
+	header.version = VERSION;
+	header.columns = columns.size();
+	header.rows = rows;
+
+	std::vector<ColumnHeader> columnHeaders(columns.size());
+
+	string file(sizeof(FileHeader) + columns.size() * sizeof(ColumnHeader), '\0');
+	for (unsigned int i = 0; i < columns.size(); i++) {
+		Column &column = columns[i];
+		ColumnHeader &columnHeader = columnHeaders[i];
+		columnHeader.type = column.type;
+		columnHeader.nameSize = column.name.size();
+
+		align(file);
+		columnHeader.nameOffset = file.size();
+		file += column.name;
+
+		align(file);
+		columnHeader.nullsOffset = file.size();
+		file += column.nulls;
+
+		align(file);
+		columnHeader.valuesOffset = file.size();
+		columnHeader.valuesSize = column.values.size();
+		file += column.values;
+
+		align(file);
+		columnHeader.heapOffset = file.size();
+		columnHeader.heapSize = column.heap.size();
+		file += column.heap;
+
+		// The values were copied to the file
+		string().swap(column.values);
+		string().swap(column.heap);
+	}
+
+	memcpy(&file[0], &header, sizeof(header));
+	if (columnHeaders.empty() == false) {
+		memcpy(&file[sizeof(header)], columnHeaders.data(), 
+		       columnHeaders.size() * sizeof(ColumnHeader));
+	}
+
+	string temporary = path + ".tmp";
+	int descriptor = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (descriptor < 0) {
+		throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR,
+		                         temporary + ": " + strerror(errno));
+	}
+
+	const char *data = file.data();
+	unsigned long remaining = file.size();
+	while (remaining > 0) {
+		ssize_t written = ::write(descriptor, data, remaining);
+		if (written < 0 && errno == EINTR) {
+			continue;
+		}
+
+		if (written < 0) {
+			string message = temporary + ": " + strerror(errno);
+			close(descriptor);
+			unlink(temporary.c_str());
+			throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR, message);
+		}
+
+		data += written;
+		remaining -= written;
+	}
+
+	if (fsync(descriptor) != 0 || close(descriptor) != 0 ||
+	    rename(temporary.c_str(), path.c_str()) != 0) {
+		string message = path + ": " + strerror(errno);
+		unlink(temporary.c_str());
+		throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR, message);
+	}
+
+	return rows;
+}
+
+unsigned int ResultSnapshot::getWidth(const Type::Value type)
+{
+	switch (type) {
+	case Type::UINT8:
+		return sizeof(uint8_t);
+	case Type::SHORT:
+		return sizeof(short);
+	case Type::INT:
+		return sizeof(int);
+	case Type::UNSIGNED_INT:
+		return sizeof(unsigned int);
+	case Type::LONG:
+		return sizeof(long);
+	case Type::LONG_LONG:
+		return sizeof(long long);
+	case Type::FLOAT:
+		return sizeof(float);
+	case Type::DOUBLE:
+		return sizeof(double);
+	case Type::BOOL:
+		return sizeof(uint8_t);
+	case Type::DATE:
+		return sizeof(uint32_t);
+	case Type::TIMESTAMP:
+		return sizeof(int64_t);
+	case Type::STRING:
+	case Type::BINARY:
+		break;
+	}
+
+	return 0;
+}
+
+ResultSnapshot::Type::Value ResultSnapshot::getType(const boost::any &value)
+{
+	const std::type_info &type = value.type();
+
+	if (type == typeid(uint8_t)) {
+		return Type::UINT8;
+	} else if (type == typeid(short)) {
+		return Type::SHORT;
+	} else if (type == typeid(int)) {
+		return Type::INT;
+	} else if (type == typeid(unsigned int)) {
+		return Type::UNSIGNED_INT;
+	} else if (type == typeid(long)) {
+		return Type::LONG;
+	} else if (type == typeid(long long)) {
+		return Type::LONG_LONG;
+	} else if (type == typeid(float)) {
+		return Type::FLOAT;
+	} else if (type == typeid(double)) {
+		return Type::DOUBLE;
+	} else if (type == typeid(bool)) {
+		return Type::BOOL;
+	} else if (type == typeid(string)) {
+		return Type::STRING;
+	} else if (type == typeid(Binary)) {
+		return Type::BINARY;
+	} else if (type == typeid(boost::gregorian::date)) {
+		return Type::DATE;
+	} else if (type == typeid(boost::posix_time::ptime)) {
+		return Type::TIMESTAMP;
+	}
+
+	throw DATABASE_EXCEPTION(DatabaseException::CONVERSION_ERROR,
+	                         string("Type not supported: ") + type.name());
+}
+
+void ResultSnapshot::append(Column &column, const boost::any &value)
+{
+	if (getType(value) != column.type) {
+		throw DATABASE_EXCEPTION(DatabaseException::CONVERSION_ERROR,
+		                         "Column " + column.name + 
+		                         " has values of different types");
+	}
+
+	if (column.rows % 8 == 0) {
+		column.nulls += '\0';
+	}
+
+	switch (column.type) {
+	case Type::UINT8:
+		appendFixed(column.values, boost::any_cast<uint8_t>(value));
+		break;
+	case Type::SHORT:
+		appendFixed(column.values, boost::any_cast<short>(value));
+		break;
+	case Type::INT:
+		appendFixed(column.values, boost::any_cast<int>(value));
+		break;
+	case Type::UNSIGNED_INT:
+		appendFixed(column.values, boost::any_cast<unsigned int>(value));
+		break;
+	case Type::LONG:
+		appendFixed(column.values, boost::any_cast<long>(value));
+		break;
+	case Type::LONG_LONG:
+		appendFixed(column.values, boost::any_cast<long long>(value));
+		break;
+	case Type::FLOAT:
+		appendFixed(column.values, boost::any_cast<float>(value));
+		break;
+	case Type::DOUBLE:
+		appendFixed(column.values, boost::any_cast<double>(value));
+		break;
+	case Type::BOOL:
+		appendFixed<uint8_t>(column.values, boost::any_cast<bool>(value));
+		break;
+	case Type::STRING:
+		column.heap += boost::any_cast<const string&>(value);
+		appendFixed<uint64_t>(column.values, column.heap.size());
+		break;
+	case Type::BINARY: {
+		const Binary &binary = boost::any_cast<const Binary&>(value);
+		column.heap.append(reinterpret_cast<const char*>(binary.getData()),
+		                   binary.getSize());
+		appendFixed<uint64_t>(column.values, column.heap.size());
+		break;
+	}
+	case Type::DATE:
+		appendFixed<uint32_t>(column.values, 
+		                      boost::any_cast<boost::gregorian::date>(value).day_number());
+		break;
+	case Type::TIMESTAMP: {
+		boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
+		boost::posix_time::ptime time = 
+			boost::any_cast<boost::posix_time::ptime>(value);
+		appendFixed<int64_t>(column.values, (time - epoch).total_microseconds());
+		break;
+	}
+	}
+
+	column.rows++;
+}
+
+ResultSnapshot::Column ResultSnapshot::newColumn(const string &name)
+{
+	Column column;
+	column.name = name;
+	column.type = Type::STRING;
+	column.typed = false;
+	column.rows = 0;
+	return column;
+}
+
+void ResultSnapshot::setType(Column &column, const Type::Value type)
+{
+	column.type = type;
+	column.typed = true;
+	if (getWidth(column.type) == 0) {
+		appendFixed<uint64_t>(column.values, 0);
+	}
+}
+
+void ResultSnapshot::appendNull(Column &column)
+{
+	if (column.rows % 8 == 0) {
+		column.nulls += '\0';
+	}
+	column.nulls[column.rows / 8] |= (1 << (column.rows % 8));
+
+	unsigned int width = getWidth(column.type);
+	if (width > 0) {
+		column.values.append(width, '\0');
+	} else {
+		appendFixed<uint64_t>(column.values, column.heap.size());
+	}
+
+	column.rows++;
+}
+
+DBPLUS_NS_END
@@ -0,0 +1,118 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <dbplus/Binary.hpp>
+#include <dbplus/RowBlock.hpp>
+
+DBPLUS_NS_BEGIN
+
+RowBlock::RowBlock() :
+	_size(0)
+{
+}
+
+const std::vector<string>& RowBlock::getColumnNames() const
+{
+	return _names;
+}
+
+int RowBlock::getColumn(const string &name) const
+{
+	for (unsigned int i = 0; i < _names.size(); i++) {
+		if (_names[i] == name) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+void RowBlock::reset(const std::vector<string> &names)
+{
+	_names = names;
+	_values.resize(names.size());
+	_nulls.resize(names.size());
+	_size = 0;
+}
+
+unsigned int RowBlock::addColumn(const string &name)
+{
+	_names.push_back(name);
+	_values.push_back(std::vector<boost::any>(_size));
+	_nulls.push_back(std::vector<char>(_size, 1));
+	return _names.size() - 1;
+}
+
+void RowBlock::clear()
+{
+	_size = 0;
+}
+
+void RowBlock::addRow()
+{
+	_size++;
+
+	for (unsigned int i = 0; i < _names.size(); i++) {
+		if (_values[i].size() < _size) {
+			_values[i].resize(_size);
+			_nulls[i].resize(_size);
+		}
+		_nulls[i][_size - 1] = 1;
+	}
+}
+
+void RowBlock::storeValue(const unsigned int column, const boost::any &value)
+{
+	_values[column][_size - 1] = value;
+	_nulls[column][_size - 1] = value.empty() ? 1 : 0;
+}
+
+void RowBlock::storeString(const unsigned int column, 
+                           const char *data, 
+                           const unsigned long size)
+{
+	boost::any &slot = _values[column][_size - 1];
+
+	string *current = boost::any_cast<string>(&slot);
+	if (current != NULL) {
+		current->assign(data, size);
+	} else {
+		slot = string(data, size);
+	}
+
+	_nulls[column][_size - 1] = 0;
+}
+
+void RowBlock::storeBinary(const unsigned int column, 
+                           const unsigned char *data, 
+                           const unsigned long size)
+{
+	boost::any &slot = _values[column][_size - 1];
+
+	Binary *current = boost::any_cast<Binary>(&slot);
+	if (current != NULL) {
+		current->assign(data, size);
+	} else {
+		slot = Binary(data, size);
+	}
+
+	_nulls[column][_size - 1] = 0;
+}
+
+DBPLUS_NS_END
@@ -0,0 +1,259 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+extern "C" {
+#include <sys/mman.h>
+#include <unistd.h>
+}
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <dbplus/DatabaseException.hpp>
+#include <dbplus/RowStore.hpp>
+
+DBPLUS_NS_BEGIN
+
+namespace {
+
+// Size written before each value, the biggest size means NULL. The
+// values are followed by a zero, like the values of the client
+// libraries
+const uint32_t NULL_SIZE = 0xffffffff;
+
+}
+
+std::atomic<unsigned long> RowStore::_globalLimit(0);
+std::atomic<unsigned long> RowStore::_globalMemory(0);
+
+const unsigned long RowStore::WRITE_BUFFER_SIZE;
+
+RowStore::RowStore(const unsigned long memoryLimit) :
+	_memoryLimit(memoryLimit),
+	_memory(0),
+	_columns(0),
+	_file(-1),
+	_fileSize(0),
+	_mapping(NULL),
+	_data(NULL)
+{
+}
+
+RowStore::~RowStore()
+{
+	if (_mapping != NULL) {
+		munmap(_mapping, _fileSize);
+	}
+
+	if (_file >= 0) {
+		close(_file);
+	}
+
+	release();
+}
+
+void RowStore::add(const char * const *values, 
+                   const unsigned long *sizes, 
+                   const unsigned int columns)
+{
+	_columns = columns;
+
+	unsigned long bytes = sizeof(unsigned long long);
+	for (unsigned int i = 0; i < columns; i++) {
+		bytes += sizeof(uint32_t) + (values[i] == NULL ? 0 : sizes[i] + 1);
+	}
+
+	if (_file < 0 && reserve(bytes) == false) {
+		spill();
+	}
+
+	if (_file >= 0) {
+		// Only the position of the row stays in memory
+		_memory += sizeof(unsigned long long);
+		_globalMemory += sizeof(unsigned long long);
+	}
+
+	_offsets.push_back(_fileSize + _buffer.size());
+
+	for (unsigned int i = 0; i < columns; i++) {
+		uint32_t size = (values[i] == NULL ? NULL_SIZE : sizes[i]);
+		_buffer.append(reinterpret_cast<const char*>(&size), sizeof(size));
+		if (values[i] != NULL) {
+			_buffer.append(values[i], sizes[i]);
+			_buffer += '\0';
+		}
+	}
+
+	if (_file >= 0 && _buffer.size() >= WRITE_BUFFER_SIZE) {
+		write();
+	}
+}
+
+void RowStore::finish()
+{
+	if (_file < 0) {
+		_data = _buffer.data();
+		return;
+	}
+
+	write();
+
+	if (_fileSize == 0) {
+		return;
+	}
+
+	_mapping = mmap(NULL, _fileSize, PROT_READ, MAP_PRIVATE, _file, 0);
+	if (_mapping == MAP_FAILED) {
+		_mapping = NULL;
+		throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR,
+		                         strerror(errno));
+	}
+
+	// Results are usually read from the first to the last row
+	madvise(_mapping, _fileSize, MADV_SEQUENTIAL);
+	_data = static_cast<const char*>(_mapping);
+}
+
+unsigned int RowStore::size() const
+{
+	return _offsets.size();
+}
+
+void RowStore::get(const unsigned int row, 
+                   std::vector<const char*> &values, 
+                   std::vector<unsigned long> &sizes) const
+{
+	values.resize(_columns);
+	sizes.resize(_columns);
+
+	const char *position = _data + _offsets[row];
+	for (unsigned int i = 0; i < _columns; i++) {
+		uint32_t size = 0;
+		memcpy(&size, position, sizeof(size));
+		position += sizeof(size);
+
+		if (size == NULL_SIZE) {
+			values[i] = NULL;
+			sizes[i] = 0;
+		} else {
+			values[i] = position;
+			sizes[i] = size;
+			position += size + 1;
+		}
+	}
+}
+
+bool RowStore::isSpilled() const
+{
+	return _file >= 0;
+}
+
+unsigned long RowStore::getMemory() const
+{
+	return _memory;
+}
+
+void RowStore::setGlobalLimit(const unsigned long limit)
+{
+	_globalLimit = limit;
+}
+
+unsigned long RowStore::getGlobalLimit()
+{
+	return _globalLimit;
+}
+
+unsigned long RowStore::getGlobalMemory()
+{
+	return _globalMemory;
+}
+
+bool RowStore::reserve(const unsigned long bytes)
+{
+	if (_memoryLimit > 0 && _memory + bytes > _memoryLimit) {
+		return false;
+	}
+
+	unsigned long limit = _globalLimit;
+	unsigned long used = _globalMemory.fetch_add(bytes) + bytes;
+	if (limit > 0 && used > limit) {
+		_globalMemory -= bytes;
+		return false;
+	}
+
+	_memory += bytes;
+	return true;
+}
+
+void RowStore::release()
+{
+	_globalMemory -= _memory;
+	_memory = 0;
+}
+
+void RowStore::spill()
+{
+	const char *directory = getenv("TMPDIR");
+	string path = string(directory == NULL ? "/tmp" : directory) + 
+		"/dbplusXXXXXX";
+
+	_file = mkstemp(&path[0]);
+	if (_file < 0) {
+		throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR,
+		                         strerror(errno));
+	}
+
+	// The file is removed when it's closed
+	unlink(path.c_str());
+
+	write();
+	string().swap(_buffer);
+
+	release();
+	_memory = _offsets.size() * sizeof(unsigned long long);
+	_globalMemory += _memory;
+}
+
+void RowStore::write()
+{
+	const char *data = _buffer.data();
+	unsigned long remaining = _buffer.size();
+
+	while (remaining > 0) {
+		ssize_t written = ::write(_file, data, remaining);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR,
+			                         strerror(errno));
+		}
+
+		data += written;
+		remaining -= written;
+	}
+
+	_fileSize += _buffer.size();
+	_buffer.clear();
+}
+
+DBPLUS_NS_END
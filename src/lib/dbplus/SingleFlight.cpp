@@ -0,0 +1,93 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <dbplus/Result.hpp>
+#include <dbplus/SingleFlight.hpp>
+
+DBPLUS_NS_BEGIN
+
+SingleFlight::SingleFlight() :
+	_joined(0)
+{
+}
+
+std::shared_ptr<const StoredResult::Data> SingleFlight::execute(Database &database, 
+                                                                const string &query)
+{
+	std::promise<std::shared_ptr<const StoredResult::Data> > promise;
+	Flight flight;
+	bool leader = false;
+
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+
+		auto running = _flights.find(query);
+		if (running != _flights.end()) {
+			flight = running->second;
+			_joined++;
+		} else {
+			flight = promise.get_future().share();
+			_flights[query] = flight;
+			leader = true;
+		}
+	}
+
+	if (leader == false) {
+		return flight.get();
+	}
+
+	std::shared_ptr<const StoredResult::Data> data;
+	try {
+		std::shared_ptr<Result> result = database.execute(query);
+		if (result) {
+			data.reset(new StoredResult::Data(*result));
+		}
+	} catch (...) {
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			_flights.erase(query);
+		}
+
+		promise.set_exception(std::current_exception());
+		throw;
+	}
+
+	// The query is forgotten before waking the other callers, so a
+	// caller that arrives now executes it again
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		_flights.erase(query);
+	}
+
+	promise.set_value(data);
+	return data;
+}
+
+unsigned int SingleFlight::running() const
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	return _flights.size();
+}
+
+unsigned long long SingleFlight::getJoined() const
+{
+	return _joined;
+}
+
+DBPLUS_NS_END
@@ -0,0 +1,302 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+extern "C" {
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+}
+
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#include <boost/date_time/gregorian/gregorian.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <dbplus/DatabaseException.hpp>
+#include <dbplus/SnapshotResult.hpp>
+
+DBPLUS_NS_BEGIN
+
+namespace {
+
+template<class T>
+T readValue(const char *values, const unsigned long long row)
+{
+	T value;
+	memcpy(&value, values + row * sizeof(T), sizeof(T));
+	return value;
+}
+
+}
+
+SnapshotResult::SnapshotResult(const string &path) :
+	_mapping(NULL),
+	_size(0),
+	_data(NULL),
+	_header(NULL),
+	_columns(NULL),
+	_currentRow(-1)
+{
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0) {
+		throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR,
+		                         path + ": " + strerror(errno));
+	}
+
+	struct stat status;
+	if (fstat(file, &status) != 0) {
+		string message = path + ": " + strerror(errno);
+		close(file);
+		throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR, message);
+	}
+
+	_size = status.st_size;
+	if (_size < sizeof(ResultSnapshot::FileHeader)) {
+		close(file);
+		throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR,
+		                         path + ": not a result snapshot");
+	}
+
+	_mapping = mmap(NULL, _size, PROT_READ, MAP_SHARED, file, 0);
+	close(file);
+
+	if (_mapping == MAP_FAILED) {
+		_mapping = NULL;
+		throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR,
+		                         path + ": " + strerror(errno));
+	}
+
+	_data = static_cast<const char*>(_mapping);
+	_header = reinterpret_cast<const ResultSnapshot::FileHeader*>(_data);
+	_columns = reinterpret_cast<const ResultSnapshot::ColumnHeader*>(
+		_data + sizeof(ResultSnapshot::FileHeader));
+
+	try {
+		validate(path);
+	} catch (const DatabaseException&) {
+		munmap(_mapping, _size);
+		throw;
+	}
+
+	std::vector<string> names;
+	for (unsigned int i = 0; i < _header->columns; i++) {
+		names.push_back(string(_data + _columns[i].nameOffset, 
+		                       _columns[i].nameSize));
+	}
+
+	setColumns(names);
+}
+
+SnapshotResult::~SnapshotResult()
+{
+	munmap(_mapping, _size);
+}
+
+unsigned int SnapshotResult::size() const
+{
+	return _header->rows;
+}
+
+bool SnapshotResult::fetch()
+{
+	if (_currentRow + 1 >= static_cast<long long>(_header->rows)) {
+		_currentRow = _header->rows;
+		clearRow();
+		return false;
+	}
+
+	_currentRow++;
+
+	for (unsigned int i = 0; i < _header->columns; i++) {
+		const ResultSnapshot::ColumnHeader &column = _columns[i];
+		const unsigned char *nulls = 
+			reinterpret_cast<const unsigned char*>(_data + column.nullsOffset);
+		if (nulls[_currentRow / 8] & (1 << (_currentRow % 8))) {
+			storeNull(i);
+			continue;
+		}
+
+		const char *values = _data + column.valuesOffset;
+
+		switch (column.type) {
+		case ResultSnapshot::Type::UINT8:
+			storeValue(i, readValue<uint8_t>(values, _currentRow));
+			break;
+		case ResultSnapshot::Type::SHORT:
+			storeValue(i, readValue<short>(values, _currentRow));
+			break;
+		case ResultSnapshot::Type::INT:
+			storeValue(i, readValue<int>(values, _currentRow));
+			break;
+		case ResultSnapshot::Type::UNSIGNED_INT:
+			storeValue(i, readValue<unsigned int>(values, _currentRow));
+			break;
+		case ResultSnapshot::Type::LONG:
+			storeValue(i, readValue<long>(values, _currentRow));
+			break;
+		case ResultSnapshot::Type::LONG_LONG:
+			storeValue(i, readValue<long long>(values, _currentRow));
+			break;
+		case ResultSnapshot::Type::FLOAT:
+			storeValue(i, readValue<float>(values, _currentRow));
+			break;
+		case ResultSnapshot::Type::DOUBLE:
+			storeValue(i, readValue<double>(values, _currentRow));
+			break;
+		case ResultSnapshot::Type::BOOL:
+			storeValue(i, readValue<uint8_t>(values, _currentRow) != 0);
+			break;
+		case ResultSnapshot::Type::DATE: {
+			uint32_t day = readValue<uint32_t>(values, _currentRow);
+			storeValue(i, boost::gregorian::date(
+				boost::gregorian::gregorian_calendar::from_day_number(day)));
+			break;
+		}
+		case ResultSnapshot::Type::TIMESTAMP: {
+			boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
+			int64_t time = readValue<int64_t>(values, _currentRow);
+			storeValue(i, epoch + boost::posix_time::microseconds(time));
+			break;
+		}
+		case ResultSnapshot::Type::STRING:
+		case ResultSnapshot::Type::BINARY: {
+			uint64_t begin = readValue<uint64_t>(values, _currentRow);
+			uint64_t end = readValue<uint64_t>(values, _currentRow + 1);
+			if (begin > end || end > column.heapSize) {
+				throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR,
+				                         "Invalid offset in result snapshot");
+			}
+
+			const char *heap = _data + column.heapOffset;
+			if (column.type == ResultSnapshot::Type::STRING) {
+				storeString(i, heap + begin, end - begin);
+			} else {
+				storeBinary(i, reinterpret_cast<const unsigned char*>(heap + begin),
+				            end - begin);
+			}
+			break;
+		}
+		}
+	}
+
+	return true;
+}
+
+void SnapshotResult::rewind()
+{
+	_currentRow = -1;
+	clearRow();
+}
+
+boost::any SnapshotResult::get(const string &key) const
+{
+	auto result = _row.find(key);
+	if (result == _row.end()) {
+		throw DATABASE_EXCEPTION(DatabaseException::UNKNOW_KEY_ERROR, 
+		                         "Column " + key + " not found in result set");
+	}
+
+	return result->second;
+}
+
+ResultSnapshot::Type::Value SnapshotResult::getType(const string &key) const
+{
+	return static_cast<ResultSnapshot::Type::Value>(findColumn(key).type);
+}
+
+const void* SnapshotResult::getValues(const string &key, 
+                                      const unsigned char *&nulls,
+                                      const char *&heap) const
+{
+	const ResultSnapshot::ColumnHeader &column = findColumn(key);
+
+	nulls = reinterpret_cast<const unsigned char*>(_data + column.nullsOffset);
+	heap = _data + column.heapOffset;
+	return _data + column.valuesOffset;
+}
+
+const ResultSnapshot::ColumnHeader& SnapshotResult::findColumn(const string &key) const
+{
+	for (unsigned int i = 0; i < _header->columns; i++) {
+		const ResultSnapshot::ColumnHeader &column = _columns[i];
+		if (key.size() == column.nameSize &&
+		    key.compare(0, key.size(), _data + column.nameOffset, column.nameSize) == 0) {
+			return column;
+		}
+	}
+
+	throw DATABASE_EXCEPTION(DatabaseException::UNKNOW_KEY_ERROR, 
+	                         "Column " + key + " not found in result set");
+}
+
+void SnapshotResult::validate(const string &path) const
+{
+	if (memcmp(_header->magic, ResultSnapshot::MAGIC, sizeof(_header->magic)) != 0) {
+		throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR,
+		                         path + ": not a result snapshot");
+	}
+
+	if (_header->version != ResultSnapshot::VERSION) {
+		throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR,
+		                         path + ": unsupported result snapshot version");
+	}
+
+	// Every section must be inside the file, so the values can be read
+	// without checking the bounds again
+	uint64_t rows = _header->rows;
+	uint64_t headers = sizeof(ResultSnapshot::FileHeader) + 
+		static_cast<uint64_t>(_header->columns) * sizeof(ResultSnapshot::ColumnHeader);
+	bool valid = (headers <= _size);
+
+	for (unsigned int i = 0; valid && i < _header->columns; i++) {
+		const ResultSnapshot::ColumnHeader &column = _columns[i];
+
+		if (column.type < ResultSnapshot::Type::UINT8 ||
+		    column.type > ResultSnapshot::Type::TIMESTAMP) {
+			valid = false;
+			break;
+		}
+
+		unsigned int width = ResultSnapshot::getWidth(
+			static_cast<ResultSnapshot::Type::Value>(column.type));
+		uint64_t valuesSize = (width > 0 ? rows * width : (rows + 1) * sizeof(uint64_t));
+
+		valid = rows <= _size &&
+			column.nameOffset <= _size && 
+			column.nameSize <= _size - column.nameOffset &&
+			column.nullsOffset <= _size &&
+			(rows + 7) / 8 <= _size - column.nullsOffset &&
+			column.valuesOffset % 8 == 0 &&
+			column.valuesOffset <= _size &&
+			column.valuesSize == valuesSize &&
+			column.valuesSize <= _size - column.valuesOffset &&
+			column.heapOffset <= _size &&
+			column.heapSize <= _size - column.heapOffset;
+	}
+
+	if (valid == false) {
+		throw DATABASE_EXCEPTION(DatabaseException::RESULT_ERROR,
+		                         path + ": corrupted result snapshot");
+	}
+}
+
+DBPLUS_NS_END
@@ -0,0 +1,252 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cctype>
+
+#include <dbplus/SqlInspector.hpp>
+
+DBPLUS_NS_BEGIN
+
+bool SqlInspector::isReadOnly(const string &query)
+{
+	std::vector<string> tokens = tokenize(query);
+
+	string::size_type position = 0;
+	while (position < tokens.size() && tokens[position] == "(") {
+		position++;
+	}
+
+	if (position == tokens.size()) {
+		return false;
+	}
+
+	const string &command = tokens[position];
+	if (command != "SELECT" && command != "SHOW" && command != "EXPLAIN" &&
+	    command != "DESCRIBE" && command != "DESC") {
+		return false;
+	}
+
+	for (string::size_type i = position; i < tokens.size(); i++) {
+		// Many statements in the same query are sent as writes
+		if (tokens[i] == ";" && i + 1 < tokens.size() && tokens[i + 1] != ";") {
+			return false;
+		}
+
+		if (tokens[i] == "INTO") {
+			return false;
+		}
+
+		// FOR UPDATE, FOR NO KEY UPDATE, FOR SHARE, FOR KEY SHARE
+		if (tokens[i] == "FOR" && i + 1 < tokens.size() &&
+		    (tokens[i + 1] == "UPDATE" || tokens[i + 1] == "SHARE" ||
+		     tokens[i + 1] == "NO" || tokens[i + 1] == "KEY")) {
+			return false;
+		}
+
+		// LOCK IN SHARE MODE
+		if (tokens[i] == "LOCK" && i + 1 < tokens.size() && tokens[i + 1] == "IN") {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+std::set<string> SqlInspector::tables(const string &query)
+{
+	std::vector<string> tokens = tokenize(query);
+	std::set<string> tables;
+
+	for (string::size_type i = 0; i < tokens.size(); i++) {
+		const string &token = tokens[i];
+		if (token != "FROM" && token != "JOIN" && token != "UPDATE" && 
+		    token != "INTO" && token != "TABLE" && token != "TRUNCATE") {
+			continue;
+		}
+
+		bool list = (token == "FROM" || token == "UPDATE");
+
+		string::size_type next = i + 1;
+		while (next < tokens.size()) {
+			// Modifiers between the keyword and the table name
+			while (next < tokens.size() &&
+			       (tokens[next] == "IF" || tokens[next] == "NOT" || 
+			        tokens[next] == "EXISTS" || tokens[next] == "ONLY" ||
+			        tokens[next] == "LOW_PRIORITY" || tokens[next] == "IGNORE" ||
+			        tokens[next] == "TABLE")) {
+				next++;
+			}
+
+			if (next == tokens.size()) {
+				break;
+			}
+
+			string table = normalize(tokens[next]);
+			if (table.empty()) {
+				// Subqueries are inspected by their own FROM
+				break;
+			}
+
+			tables.insert(table);
+			next++;
+
+			if (list == false) {
+				break;
+			}
+
+			// Optional alias before the next table of the list
+			if (next < tokens.size() && tokens[next] == "AS") {
+				next++;
+			}
+
+			if (next < tokens.size() && normalize(tokens[next]).empty() == false &&
+			    tokens[next] != "WHERE" && tokens[next] != "SET" && 
+			    tokens[next] != "JOIN" && tokens[next] != "INNER" &&
+			    tokens[next] != "LEFT" && tokens[next] != "RIGHT" && 
+			    tokens[next] != "CROSS" && tokens[next] != "NATURAL" &&
+			    tokens[next] != "FULL" && tokens[next] != "ORDER" &&
+			    tokens[next] != "GROUP" && tokens[next] != "LIMIT" &&
+			    tokens[next] != "HAVING" && tokens[next] != "USING") {
+				next++;
+			}
+
+			if (next < tokens.size() && tokens[next] == ",") {
+				next++;
+			} else {
+				break;
+			}
+		}
+	}
+
+	return tables;
+}
+
+std::vector<string> SqlInspector::tokenize(const string &query)
+{
+	std::vector<string> tokens;
+
+	string::size_type i = 0;
+	while (i < query.size()) {
+		unsigned char character = query[i];
+
+		if (std::isspace(character)) {
+			i++;
+
+		} else if (character == '-' && i + 1 < query.size() && query[i + 1] == '-') {
+			i = query.find('\n', i);
+
+		} else if (character == '/' && i + 1 < query.size() && query[i + 1] == '*') {
+			i = query.find("*/", i + 2);
+			if (i != string::npos) {
+				i += 2;
+			}
+
+		} else if (character == '\'') {
+			// String literals are skipped, with '' and backslash escapes
+			i++;
+			while (i < query.size()) {
+				if (query[i] == '\\') {
+					i += 2;
+				} else if (query[i] == '\'') {
+					i++;
+					if (i < query.size() && query[i] == '\'') {
+						i++;
+					} else {
+						break;
+					}
+				} else {
+					i++;
+				}
+			}
+
+		} else if (std::isalnum(character) || character == '_' || character == '$' ||
+		           character == '`' || character == '"' || character >= 0x80) {
+			// Identifiers and keywords, including quoted and schema
+			// qualified names
+			string token;
+			while (i < query.size()) {
+				unsigned char current = query[i];
+				if (current == '`' || current == '"') {
+					string::size_type end = query.find(current, i + 1);
+					if (end == string::npos) {
+						end = query.size() - 1;
+					}
+
+					token += query.substr(i, end - i + 1);
+					i = end + 1;
+
+				} else if (std::isalnum(current) || current == '_' || current == '$' ||
+				           current == '.' || current >= 0x80) {
+					token += std::toupper(current);
+					i++;
+
+				} else {
+					break;
+				}
+			}
+
+			tokens.push_back(token);
+
+		} else {
+			tokens.push_back(string(1, character));
+			i++;
+		}
+
+		if (i == string::npos) {
+			break;
+		}
+	}
+
+	return tokens;
+}
+
+string SqlInspector::normalize(const string &token)
+{
+	if (token.empty() || (std::isalpha(static_cast<unsigned char>(token[0])) == false &&
+	                      token[0] != '_' && token[0] != '`' && token[0] != '"' &&
+	                      static_cast<unsigned char>(token[0]) < 0x80)) {
+		return "";
+	}
+
+	// Only the last part of schema.table is used
+	string::size_type begin = 0;
+	char quote = 0;
+	for (string::size_type i = 0; i < token.size(); i++) {
+		if (quote != 0) {
+			if (token[i] == quote) {
+				quote = 0;
+			}
+		} else if (token[i] == '`' || token[i] == '"') {
+			quote = token[i];
+		} else if (token[i] == '.') {
+			begin = i + 1;
+		}
+	}
+
+	string table;
+	for (string::size_type i = begin; i < token.size(); i++) {
+		if (token[i] != '`' && token[i] != '"') {
+			table += std::tolower(static_cast<unsigned char>(token[i]));
+		}
+	}
+
+	return table;
+}
+
+DBPLUS_NS_END
@@ -0,0 +1,289 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+#include <cstring>
+
+#include <boost/date_time/gregorian/gregorian.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <dbplus/DatabaseException.hpp>
+#include <dbplus/SqlValue.hpp>
+#include <dbplus/TextScan.hpp>
+
+DBPLUS_NS_BEGIN
+
+void SqlValue::appendLiteral(Database &database, 
+                             const boost::any &value, 
+                             string &buffer)
+{
+	if (value.empty()) {
+		buffer += "NULL";
+
+	} else if (value.type() == typeid(string)) {
+		appendLiteral(database, boost::any_cast<const string&>(value), buffer);
+
+	} else if (value.type() == typeid(const char*)) {
+		appendLiteral(database, boost::any_cast<const char*>(value), buffer);
+
+	} else if (value.type() == typeid(bool)) {
+		appendLiteral(database, boost::any_cast<bool>(value), buffer);
+
+	} else if (value.type() == typeid(boost::gregorian::date) ||
+	           value.type() == typeid(boost::posix_time::ptime)) {
+		buffer += "'";
+		appendText(value, buffer);
+		buffer += "'";
+
+	} else if (appendText(value, buffer) == false) {
+		throw DATABASE_EXCEPTION(DatabaseException::CONVERSION_ERROR,
+		                         string("Type not supported: ") + value.type().name());
+	}
+}
+
+void SqlValue::appendLiteral(Database &database, 
+                             const string &value, 
+                             string &buffer)
+{
+	buffer += '\'';
+	database.escape(value, buffer);
+	buffer += '\'';
+}
+
+void SqlValue::appendLiteral(Database &database, 
+                             const char *value, 
+                             string &buffer)
+{
+	if (value == NULL) {
+		buffer += "NULL";
+		return;
+	}
+
+	buffer += '\'';
+	database.escape(value, buffer);
+	buffer += '\'';
+}
+
+void SqlValue::appendLiteral(Database &database, 
+                             const bool value, 
+                             string &buffer)
+{
+	buffer += value ? "TRUE" : "FALSE";
+}
+
+void SqlValue::appendLiteral(Database &database, 
+                             const boost::gregorian::date &value, 
+                             string &buffer)
+{
+	buffer += "'";
+	appendText(value, buffer);
+	buffer += "'";
+}
+
+void SqlValue::appendLiteral(Database &database, 
+                             const boost::posix_time::ptime &value, 
+                             string &buffer)
+{
+	buffer += "'";
+	appendText(value, buffer);
+	buffer += "'";
+}
+
+void SqlValue::appendCopy(const boost::any &value, string &buffer)
+{
+	if (value.empty()) {
+		buffer += "\\N";
+
+	} else if (value.type() == typeid(Binary)) {
+		appendCopy(boost::any_cast<const Binary&>(value), buffer);
+
+	} else if (value.type() == typeid(bool)) {
+		appendCopy(boost::any_cast<bool>(value), buffer);
+
+	} else if (value.type() == typeid(string)) {
+		appendCopy(boost::any_cast<const string&>(value), buffer);
+
+	} else if (value.type() == typeid(const char*)) {
+		appendCopy(boost::any_cast<const char*>(value), buffer);
+
+	} else if (appendText(value, buffer) == false) {
+		throw DATABASE_EXCEPTION(DatabaseException::CONVERSION_ERROR,
+		                         string("Type not supported: ") + value.type().name());
+	}
+}
+
+void SqlValue::appendCopy(const string &value, string &buffer)
+{
+	appendCopyText(value.data(), value.size(), buffer);
+}
+
+void SqlValue::appendCopy(const char *value, string &buffer)
+{
+	if (value == NULL) {
+		buffer += "\\N";
+	} else {
+		appendCopyText(value, strlen(value), buffer);
+	}
+}
+
+void SqlValue::appendCopy(const bool value, string &buffer)
+{
+	buffer += value ? "true" : "false";
+}
+
+void SqlValue::appendCopy(const Binary &value, string &buffer)
+{
+	// Backslash of the bytea hexadecimal format is escaped by COPY
+	buffer += "\\\\x";
+	appendHex(value, buffer);
+}
+
+void SqlValue::appendCopy(const boost::gregorian::date &value, 
+                          string &buffer)
+{
+	appendText(value, buffer);
+}
+
+void SqlValue::appendCopy(const boost::posix_time::ptime &value, 
+                          string &buffer)
+{
+	appendText(value, buffer);
+}
+
+void SqlValue::appendHex(const Binary &value, string &buffer)
+{
+	static const char digits[] = "0123456789abcdef";
+
+	const unsigned char *data = value.getData();
+	for (unsigned long i = 0; i < value.getSize(); i++) {
+		buffer += digits[data[i] >> 4];
+		buffer += digits[data[i] & 0x0f];
+	}
+}
+
+void SqlValue::appendPlain(const boost::any &value, string &buffer)
+{
+	if (value.type() == typeid(string)) {
+		buffer += boost::any_cast<const string&>(value);
+
+	} else if (value.type() == typeid(Binary)) {
+		const Binary &binary = boost::any_cast<const Binary&>(value);
+		buffer.append(reinterpret_cast<const char*>(binary.getData()), 
+		              binary.getSize());
+
+	} else if (value.type() == typeid(bool)) {
+		buffer += boost::any_cast<bool>(value) ? "true" : "false";
+
+	} else if (value.type() == typeid(const char*)) {
+		buffer += boost::any_cast<const char*>(value);
+
+	} else if (appendText(value, buffer) == false) {
+		throw DATABASE_EXCEPTION(DatabaseException::CONVERSION_ERROR,
+		                         string("Type not supported: ") + value.type().name());
+	}
+}
+
+bool SqlValue::appendText(const boost::any &value, string &buffer)
+{
+	const std::type_info &type = value.type();
+
+	if (type == typeid(long long)) {
+		appendNumber(boost::any_cast<long long>(value), buffer);
+	} else if (type == typeid(long)) {
+		appendNumber(boost::any_cast<long>(value), buffer);
+	} else if (type == typeid(int)) {
+		appendNumber(boost::any_cast<int>(value), buffer);
+	} else if (type == typeid(short)) {
+		appendNumber(boost::any_cast<short>(value), buffer);
+	} else if (type == typeid(uint8_t)) {
+		appendNumber(boost::any_cast<uint8_t>(value), buffer);
+	} else if (type == typeid(unsigned int)) {
+		appendNumber(boost::any_cast<unsigned int>(value), buffer);
+	} else if (type == typeid(unsigned long)) {
+		appendNumber(boost::any_cast<unsigned long>(value), buffer);
+	} else if (type == typeid(unsigned long long)) {
+		appendNumber(boost::any_cast<unsigned long long>(value), buffer);
+	} else if (type == typeid(double)) {
+		appendNumber(boost::any_cast<double>(value), buffer);
+	} else if (type == typeid(float)) {
+		appendNumber(boost::any_cast<float>(value), buffer);
+	} else if (type == typeid(boost::gregorian::date)) {
+		appendText(boost::any_cast<boost::gregorian::date>(value), buffer);
+	} else if (type == typeid(boost::posix_time::ptime)) {
+		appendText(boost::any_cast<boost::posix_time::ptime>(value), buffer);
+	} else {
+		return false;
+	}
+
+	return true;
+}
+
+void SqlValue::appendText(const boost::gregorian::date &value, 
+                          string &buffer)
+{
+	buffer += boost::gregorian::to_iso_extended_string(value);
+}
+
+void SqlValue::appendText(const boost::posix_time::ptime &value, 
+                          string &buffer)
+{
+	string time = boost::posix_time::to_iso_extended_string(value);
+	string::size_type separator = time.find('T');
+	if (separator != string::npos) {
+		time[separator] = ' ';
+	}
+	buffer += time;
+}
+
+void SqlValue::appendCopyText(const char *value, 
+                              const unsigned long size, 
+                              string &buffer)
+{
+	static const string special("\\\t\n\r", 4);
+
+	unsigned long position = 0;
+	while (position < size) {
+		unsigned long next = position + 
+			TextScan::find(value + position, size - position, special);
+		buffer.append(value + position, next - position);
+		if (next == size) {
+			break;
+		}
+
+		switch (value[next]) {
+		case '\\':
+			buffer += "\\\\";
+			break;
+		case '\t':
+			buffer += "\\t";
+			break;
+		case '\n':
+			buffer += "\\n";
+			break;
+		case '\r':
+			buffer += "\\r";
+			break;
+		}
+
+		position = next + 1;
+	}
+}
+
+DBPLUS_NS_END
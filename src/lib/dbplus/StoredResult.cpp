@@ -0,0 +1,209 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <dbplus/Binary.hpp>
+#include <dbplus/DatabaseException.hpp>
+#include <dbplus/StoredResult.hpp>
+
+DBPLUS_NS_BEGIN
+
+StoredResult::Data::Data(Result &result) :
+	_rows(0),
+	_memory(0)
+{
+	while (result.fetch()) {
+		const std::map<string, boost::any> &row = result.getRow();
+
+		// NULL values are not in the row, so a column can appear only
+		// after the first rows. The rows already stored get an empty
+		// value for it
+		for (const auto &column : row) {
+			if (getColumn(column.first) >= 0) {
+				continue;
+			}
+
+			unsigned int rows = _rows;
+			std::vector<boost::any> values;
+			values.reserve((rows + 1) * (_columns.size() + 1));
+
+			for (unsigned int i = 0; i < rows; i++) {
+				for (unsigned int j = 0; j < _columns.size(); j++) {
+					values.push_back(getValue(i, j));
+				}
+				values.push_back(boost::any());
+			}
+
+			_values.swap(values);
+			_columns.push_back(column.first);
+			_memory += sizeof(string) + column.first.size() + rows * sizeof(boost::any);
+		}
+
+		// Columns without value in the row are stored empty
+		for (const string &name : _columns) {
+			auto column = row.find(name);
+			if (column == row.end()) {
+				_values.push_back(boost::any());
+				_memory += sizeof(boost::any);
+				continue;
+			}
+
+			const boost::any &value = column->second;
+			_values.push_back(value);
+
+			_memory += sizeof(boost::any);
+			if (value.type() == typeid(string)) {
+				_memory += sizeof(string) + boost::any_cast<const string&>(value).size();
+			} else if (value.type() == typeid(Binary)) {
+				_memory += sizeof(Binary) + boost::any_cast<const Binary&>(value).getSize();
+			} else if (value.type() == typeid(boost::posix_time::ptime)) {
+				_memory += sizeof(boost::posix_time::ptime);
+			} else if (value.empty() == false) {
+				_memory += sizeof(long long);
+			}
+		}
+
+		_rows++;
+	}
+}
+
+const std::vector<string>& StoredResult::Data::getColumns() const
+{
+	return _columns;
+}
+
+unsigned int StoredResult::Data::getRows() const
+{
+	return _rows;
+}
+
+const boost::any& StoredResult::Data::getValue(const unsigned int row, 
+                                                const unsigned int column) const
+{
+	return _values[row * _columns.size() + column];
+}
+
+int StoredResult::Data::getColumn(const string &column) const
+{
+	for (unsigned int i = 0; i < _columns.size(); i++) {
+		if (_columns[i] == column) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+unsigned long StoredResult::Data::getMemory() const
+{
+	return _memory;
+}
+
+StoredResult::StoredResult(std::shared_ptr<const Data> data) :
+	_data(data),
+	_currentRow(-1),
+	_builtRow(-1)
+{
+}
+
+StoredResult::StoredResult(std::shared_ptr<const Data> data,
+                           std::shared_ptr<const std::vector<unsigned int> > rows) :
+	_data(data),
+	_rows(rows),
+	_currentRow(-1),
+	_builtRow(-1)
+{
+}
+
+std::shared_ptr<const StoredResult::Data> StoredResult::getData() const
+{
+	return _data;
+}
+
+unsigned int StoredResult::size() const
+{
+	if (_rows) {
+		return _rows->size();
+	}
+
+	return _data->getRows();
+}
+
+bool StoredResult::fetch()
+{
+	if (_currentRow + 1 >= static_cast<int>(size())) {
+		_currentRow = size();
+		return false;
+	}
+
+	_currentRow++;
+	return true;
+}
+
+boost::any StoredResult::get(const string &key) const
+{
+	// Empty values are NULL columns, that the drivers don't store in
+	// the row either
+	int column = _data->getColumn(key);
+	int row = dataRow();
+	if (column < 0 || row < 0 || _data->getValue(row, column).empty()) {
+		throw DATABASE_EXCEPTION(DatabaseException::UNKNOW_KEY_ERROR,
+		                         "Column " + key + " not found in result set");
+	}
+
+	return _data->getValue(row, column);
+}
+
+const std::map<string, boost::any>& StoredResult::getRow() const
+{
+	if (_builtRow != _currentRow) {
+		_currentValues.clear();
+
+		int row = dataRow();
+		if (row >= 0) {
+			const std::vector<string> &columns = _data->getColumns();
+			for (unsigned int i = 0; i < columns.size(); i++) {
+				const boost::any &value = _data->getValue(row, i);
+				if (value.empty() == false) {
+					_currentValues[columns[i]] = value;
+				}
+			}
+		}
+
+		_builtRow = _currentRow;
+	}
+
+	return _currentValues;
+}
+
+int StoredResult::dataRow() const
+{
+	if (_currentRow < 0 || _currentRow >= static_cast<int>(size())) {
+		return -1;
+	}
+
+	if (_rows) {
+		return (*_rows)[_currentRow];
+	}
+
+	return _currentRow;
+}
+
+DBPLUS_NS_END
@@ -0,0 +1,83 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <dbplus/TextScan.hpp>
+
+DBPLUS_NS_BEGIN
+
+unsigned long TextScan::find(const char *data, 
+                             const unsigned long size,
+                             const string &characters,
+                             const bool highBit,
+                             const bool control)
+{
+	unsigned long position = 0;
+
+#ifdef __SSE2__
+	__m128i searched[8];
+	unsigned int count = characters.size() < 8 ? characters.size() : 8;
+	for (unsigned int i = 0; i < count; i++) {
+		searched[i] = _mm_set1_epi8(characters[i]);
+	}
+
+	const __m128i lastControl = _mm_set1_epi8(0x1f);
+
+	for (; position + 16 <= size; position += 16) {
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position));
+
+		__m128i found = _mm_setzero_si128();
+		for (unsigned int i = 0; i < count; i++) {
+			found = _mm_or_si128(found, _mm_cmpeq_epi8(block, searched[i]));
+		}
+
+		// The mask of a block has the high bit of each byte
+		int mask = _mm_movemask_epi8(found);
+		if (highBit) {
+			mask |= _mm_movemask_epi8(block);
+		}
+
+		// Unsigned bytes up to 0x1f are the ones that don't change
+		// with the maximum
+		if (control) {
+			mask |= _mm_movemask_epi8(
+				_mm_cmpeq_epi8(_mm_max_epu8(block, lastControl), lastControl));
+		}
+
+		if (mask != 0) {
+			return position + __builtin_ctz(mask);
+		}
+	}
+#endif
+
+	for (; position < size; position++) {
+		unsigned char c = data[position];
+		if ((highBit && c >= 0x80) || (control && c < 0x20) ||
+		    characters.find(data[position]) != string::npos) {
+			return position;
+		}
+	}
+
+	return size;
+}
+
+DBPLUS_NS_END
@@ -0,0 +1,116 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+
+#include <dbplus/BatchLoader.hpp>
+#include <dbplus/ConnectionPool.hpp>
+#include <dbplus/DatabaseException.hpp>
+#include <dbplus/MySql.hpp>
+#include <dbplus/Result.hpp>
+
+using std::future;
+using std::shared_ptr;
+using std::string;
+
+using dbplus::BatchLoader;
+using dbplus::ConnectionPool;
+using dbplus::DatabaseException;
+using dbplus::MySql;
+using dbplus::Result;
+
+// When you need to run only one test, compile only this file with the
+// STAND_ALONE flag.
+#ifdef STAND_ALONE
+#define BOOST_TEST_MODULE DBplus
+#endif
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+typedef ConnectionPool<MySql> MySqlPool;
+
+shared_ptr<MySqlPool> createLoaderTable()
+{
+	shared_ptr<MySqlPool> pool(
+		new MySqlPool("dbplus", "root", "abc123", "127.0.0.1", 3306, 1, 2));
+
+	MySqlPool::Lease mysql = pool->acquire();
+	mysql->execute("DROP TABLE IF EXISTS loaded");
+	mysql->execute("CREATE TABLE loaded (id INT(11), name VARCHAR(50))");
+	mysql->execute("INSERT INTO loaded VALUES (1, 'first'), (2, 'second'), (2, 'again')");
+	return pool;
+}
+
+BOOST_AUTO_TEST_SUITE(dbplusBatchLoaderTests)
+
+BOOST_AUTO_TEST_CASE(mustLoadKeysInOneQuery)
+{
+	BatchLoader<MySql> loader(createLoaderTable(), "loaded", "id", "*", 100, 
+	                          std::chrono::milliseconds(50));
+
+	future<shared_ptr<Result> > first = loader.load("1");
+	future<shared_ptr<Result> > second = loader.load("2");
+	future<shared_ptr<Result> > unknown = loader.load("3");
+	future<shared_ptr<Result> > repeated = loader.load("1");
+
+	shared_ptr<Result> result = first.get();
+	BOOST_REQUIRE_EQUAL(result->size(), 1);
+	BOOST_REQUIRE(result->fetch());
+	BOOST_CHECK_EQUAL(result->get<string>("name"), "first");
+
+	BOOST_CHECK_EQUAL(second.get()->size(), 2);
+	BOOST_CHECK_EQUAL(unknown.get()->size(), 0);
+	BOOST_CHECK_EQUAL(repeated.get()->size(), 1);
+
+	BOOST_CHECK_EQUAL(loader.getQueries(), 1);
+	BOOST_CHECK_EQUAL(loader.getKeys(), 4);
+}
+
+BOOST_AUTO_TEST_CASE(mustSendFullBatches)
+{
+	// The window is long, so only a full batch is sent in time
+	BatchLoader<MySql> loader(createLoaderTable(), "loaded", "id", "*", 2, 
+	                          std::chrono::seconds(60));
+
+	future<shared_ptr<Result> > first = loader.load("1");
+	future<shared_ptr<Result> > second = loader.load("2");
+
+	BOOST_CHECK(first.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+	BOOST_CHECK_EQUAL(second.get()->size(), 2);
+
+	future<shared_ptr<Result> > last = loader.load("1");
+	loader.flush();
+	BOOST_CHECK_EQUAL(last.get()->size(), 1);
+	BOOST_CHECK_EQUAL(loader.getQueries(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(mustFailWithoutKeyColumn)
+{
+	// The key column is not loaded, so the rows can't be split
+	BatchLoader<MySql> loader(createLoaderTable(), "loaded", "id", "name", 100, 
+	                          std::chrono::milliseconds(1));
+
+	BOOST_CHECK_THROW(loader.get("1"), DatabaseException);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,177 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+
+#include <dbplus/CachedDatabase.hpp>
+#include <dbplus/MySql.hpp>
+#include <dbplus/QueryCache.hpp>
+#include <dbplus/Result.hpp>
+#include <dbplus/SqlInspector.hpp>
+#include <dbplus/StoredResult.hpp>
+
+using std::set;
+using std::shared_ptr;
+using std::string;
+
+using dbplus::CachedDatabase;
+using dbplus::MySql;
+using dbplus::QueryCache;
+using dbplus::Result;
+using dbplus::SqlInspector;
+using dbplus::StoredResult;
+
+// When you need to run only one test, compile only this file with the
+// STAND_ALONE flag.
+#ifdef STAND_ALONE
+#define BOOST_TEST_MODULE DBplus
+#endif
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+shared_ptr<MySql> createCachedTable()
+{
+	shared_ptr<MySql> mysql(new MySql());
+	mysql->connect("dbplus", "root", "abc123", "127.0.0.1");
+	mysql->execute("DROP TABLE IF EXISTS cached");
+	mysql->execute("CREATE TABLE cached (id INT(11) PRIMARY KEY, name VARCHAR(50))");
+	mysql->execute("INSERT INTO cached VALUES (1, 'first'), (2, NULL)");
+	return mysql;
+}
+
+BOOST_AUTO_TEST_SUITE(dbplusCachedDatabaseTests)
+
+BOOST_AUTO_TEST_CASE(mustFindTablesOfQueries)
+{
+	set<string> tables = 
+		SqlInspector::tables("SELECT * FROM Users u JOIN `shop`.`Orders` o ON u.id = o.user");
+	BOOST_CHECK_EQUAL(tables.size(), 2);
+	BOOST_CHECK(tables.count("users") == 1);
+	BOOST_CHECK(tables.count("orders") == 1);
+
+	tables = SqlInspector::tables("UPDATE items SET name = 'FROM other'");
+	BOOST_CHECK_EQUAL(tables.size(), 1);
+	BOOST_CHECK(tables.count("items") == 1);
+
+	BOOST_CHECK(SqlInspector::tables("SELECT NOW()").empty());
+}
+
+BOOST_AUTO_TEST_CASE(mustReplayStoredResults)
+{
+	shared_ptr<MySql> mysql = createCachedTable();
+
+	shared_ptr<Result> result = mysql->execute("SELECT * FROM cached ORDER BY id");
+	shared_ptr<const StoredResult::Data> data(new StoredResult::Data(*result));
+	BOOST_CHECK_EQUAL(data->getRows(), 2);
+
+	// Many results can replay the same rows
+	for (unsigned int i = 0; i < 2; i++) {
+		StoredResult stored(data);
+		BOOST_CHECK_EQUAL(stored.size(), 2);
+
+		BOOST_REQUIRE(stored.fetch());
+		BOOST_CHECK_EQUAL(stored.get<int>("id"), 1);
+		BOOST_CHECK_EQUAL(stored.get<string>("name"), "first");
+
+		BOOST_REQUIRE(stored.fetch());
+		BOOST_CHECK_EQUAL(stored.get<int>("id"), 2);
+		BOOST_CHECK_EQUAL(stored.getRow().count("name"), 0);
+
+		BOOST_CHECK(stored.fetch() == false);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(mustCacheReadQueries)
+{
+	shared_ptr<MySql> mysql = createCachedTable();
+	shared_ptr<QueryCache> cache(new QueryCache(1024 * 1024, std::chrono::seconds(60)));
+	CachedDatabase database(mysql, cache);
+
+	const string query = "SELECT COUNT(*) AS total FROM cached";
+
+	shared_ptr<Result> result = database.execute(query);
+	BOOST_REQUIRE(result->fetch());
+	BOOST_CHECK_EQUAL(result->get<long long>("total"), 2);
+
+	result = database.execute(query);
+	BOOST_REQUIRE(result->fetch());
+	BOOST_CHECK_EQUAL(result->get<long long>("total"), 2);
+	BOOST_CHECK_EQUAL(cache->getHits(), 1);
+	BOOST_CHECK_EQUAL(cache->size(), 1);
+
+	// A write in the table removes the result
+	database.execute("INSERT INTO cached VALUES (3, 'third')");
+	BOOST_CHECK_EQUAL(cache->size(), 0);
+
+	result = database.execute(query);
+	BOOST_REQUIRE(result->fetch());
+	BOOST_CHECK_EQUAL(result->get<long long>("total"), 3);
+
+	// Queries in transactions don't use the cache
+	database.setTransactionMode(MySql::TransactionMode::MANUAL_COMMIT);
+	database.execute("DELETE FROM cached WHERE id = 3");
+	result = database.execute(query);
+	BOOST_REQUIRE(result->fetch());
+	BOOST_CHECK_EQUAL(result->get<long long>("total"), 2);
+	database.rollback();
+	database.setTransactionMode(MySql::TransactionMode::AUTO_COMMIT);
+
+	result = database.execute(query);
+	BOOST_REQUIRE(result->fetch());
+	BOOST_CHECK_EQUAL(result->get<long long>("total"), 3);
+}
+
+BOOST_AUTO_TEST_CASE(mustExpireAndEvictResults)
+{
+	shared_ptr<MySql> mysql = createCachedTable();
+	shared_ptr<Result> result = mysql->execute("SELECT * FROM cached");
+	shared_ptr<const StoredResult::Data> data(new StoredResult::Data(*result));
+
+	set<string> tables;
+	tables.insert("cached");
+
+	QueryCache expiring(1024 * 1024, std::chrono::milliseconds(1));
+	BOOST_CHECK(expiring.put("a", data, tables, expiring.ticket()));
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	BOOST_CHECK(!expiring.get("a"));
+
+	// Only two results fit in the cache
+	unsigned long memory = data->getMemory() + 1 + string("cached").size();
+	QueryCache small(memory * 2, std::chrono::seconds(60));
+	BOOST_CHECK(small.put("a", data, tables, small.ticket()));
+	BOOST_CHECK(small.put("b", data, tables, small.ticket()));
+	BOOST_CHECK(small.get("a"));
+	BOOST_CHECK(small.put("c", data, tables, small.ticket()));
+	BOOST_CHECK(small.get("a"));
+	BOOST_CHECK(!small.get("b"));
+	BOOST_CHECK(small.get("c"));
+
+	// Results read before an invalidation are not stored
+	unsigned long long ticket = small.ticket();
+	small.invalidate("cached");
+	BOOST_CHECK_EQUAL(small.size(), 0);
+	BOOST_CHECK(small.put("a", data, tables, ticket) == false);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,92 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <dbplus/CoalescedDatabase.hpp>
+#include <dbplus/DatabaseException.hpp>
+#include <dbplus/MySql.hpp>
+#include <dbplus/Result.hpp>
+#include <dbplus/SingleFlight.hpp>
+
+using std::shared_ptr;
+using std::vector;
+
+using dbplus::CoalescedDatabase;
+using dbplus::DatabaseException;
+using dbplus::MySql;
+using dbplus::Result;
+using dbplus::SingleFlight;
+
+// When you need to run only one test, compile only this file with the
+// STAND_ALONE flag.
+#ifdef STAND_ALONE
+#define BOOST_TEST_MODULE DBplus
+#endif
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(dbplusCoalescedDatabaseTests)
+
+BOOST_AUTO_TEST_CASE(mustJoinIdenticalReads)
+{
+	const unsigned int threads = 4;
+	shared_ptr<SingleFlight> flights(new SingleFlight());
+
+	vector<shared_ptr<CoalescedDatabase> > databases;
+	for (unsigned int i = 0; i < threads; i++) {
+		shared_ptr<MySql> mysql(new MySql());
+		mysql->connect("dbplus", "root", "abc123", "127.0.0.1");
+		databases.push_back(shared_ptr<CoalescedDatabase>(
+			new CoalescedDatabase(mysql, flights)));
+	}
+
+	vector<long long> ids(threads, 0);
+	vector<std::thread> workers;
+	for (unsigned int i = 0; i < threads; i++) {
+		workers.push_back(std::thread([&databases, &ids, i]() {
+			shared_ptr<Result> result = 
+				databases[i]->execute("SELECT SLEEP(0.5) AS pause, 7 AS id");
+			if (result->fetch()) {
+				ids[i] = result->get<long long>("id");
+			}
+		}));
+	}
+
+	for (auto &worker : workers) {
+		worker.join();
+	}
+
+	for (unsigned int i = 0; i < threads; i++) {
+		BOOST_CHECK_EQUAL(ids[i], 7);
+	}
+
+	BOOST_CHECK(flights->getJoined() > 0);
+	BOOST_CHECK_EQUAL(flights->running(), 0);
+
+	// Errors are given to the callers and the query is forgotten
+	BOOST_CHECK_THROW(databases[0]->execute("SELECT * FROM unknownTable"), 
+	                  DatabaseException);
+	BOOST_CHECK_EQUAL(flights->running(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
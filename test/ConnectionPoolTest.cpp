@@ -0,0 +1,148 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <atomic>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <dbplus/ConnectionPool.hpp>
+#include <dbplus/DatabaseException.hpp>
+#include <dbplus/MySql.hpp>
+#include <dbplus/PostgresSql.hpp>
+#include <dbplus/Result.hpp>
+
+using std::string;
+using std::vector;
+
+using dbplus::ConnectionPool;
+using dbplus::Database;
+using dbplus::DatabaseException;
+using dbplus::MySql;
+using dbplus::PostgresSql;
+
+// When you need to run only one test, compile only this file with the
+// STAND_ALONE flag.
+#ifdef STAND_ALONE
+#define BOOST_TEST_MODULE DBplus
+#endif
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(dbplusConnectionPoolTests)
+
+BOOST_AUTO_TEST_CASE(mustOpenMinimumConnections)
+{
+	ConnectionPool<MySql> pool("dbplus", "root", "abc123", "127.0.0.1", 3306, 2, 4);
+
+	BOOST_CHECK_EQUAL(pool.size(), 2);
+	BOOST_CHECK_EQUAL(pool.idle(), 2);
+
+	{
+		ConnectionPool<MySql>::Lease first = pool.acquire();
+		ConnectionPool<MySql>::Lease second = pool.acquire();
+		ConnectionPool<MySql>::Lease third = pool.acquire();
+
+		BOOST_CHECK_EQUAL(pool.size(), 3);
+		BOOST_CHECK_EQUAL(pool.idle(), 0);
+		BOOST_CHECK_NO_THROW(first->execute("SELECT 1"));
+	}
+
+	BOOST_CHECK_EQUAL(pool.idle(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(mustWarmUpConnectionsInParallel)
+{
+	vector<string> statements;
+	statements.push_back("SET search_path TO public");
+	statements.push_back("SELECT COUNT(*) FROM pg_type");
+
+	ConnectionPool<PostgresSql> pool("dbplus", "root", "abc123", "127.0.0.1", 5432, 
+	                                 8, 10, Database::TransactionMode::AUTO_COMMIT,
+	                                 statements);
+
+	BOOST_CHECK_EQUAL(pool.size(), 8);
+	BOOST_CHECK_EQUAL(pool.idle(), 8);
+
+	// Only two connections left before reaching the maximum size
+	BOOST_CHECK_EQUAL(pool.warmUp(5), 2);
+	BOOST_CHECK_EQUAL(pool.size(), 10);
+
+	ConnectionPool<PostgresSql>::Lease lease = pool.acquire();
+	BOOST_CHECK_EQUAL(lease->execute("SELECT 1")->size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(mustTimeoutWhenPoolIsExhausted)
+{
+	ConnectionPool<PostgresSql> pool("dbplus", "root", "abc123", "127.0.0.1", 5432, 1, 1);
+
+	ConnectionPool<PostgresSql>::Lease lease = pool.acquire();
+	BOOST_CHECK_THROW(pool.acquire(std::chrono::milliseconds(10)), DatabaseException);
+
+	lease.release();
+	BOOST_CHECK_NO_THROW(pool.acquire(std::chrono::milliseconds(10)));
+}
+
+BOOST_AUTO_TEST_CASE(mustRestoreTransactionModeOnReturn)
+{
+	ConnectionPool<PostgresSql> pool("dbplus", "root", "abc123", "127.0.0.1", 5432, 1, 1);
+
+	{
+		ConnectionPool<PostgresSql>::Lease lease = pool.acquire();
+		lease->execute("DROP TABLE IF EXISTS test");
+		lease->execute("CREATE TABLE test (id SERIAL PRIMARY KEY, value VARCHAR(255))");
+
+		lease->setTransactionMode(Database::TransactionMode::MANUAL_COMMIT);
+		lease->execute("INSERT INTO test(value) VALUES ('Not committed')");
+	}
+
+	ConnectionPool<PostgresSql>::Lease lease = pool.acquire();
+	BOOST_CHECK_EQUAL(lease->getTransactionMode(), 
+	                  Database::TransactionMode::AUTO_COMMIT);
+	BOOST_CHECK_EQUAL(lease->execute("SELECT id FROM test")->size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(mustShareConnectionsBetweenThreads)
+{
+	ConnectionPool<MySql> pool("dbplus", "root", "abc123", "127.0.0.1", 3306, 0, 4);
+
+	std::atomic<unsigned int> executed(0);
+	vector<std::thread> threads;
+
+	for (int i = 0; i < 8; i++) {
+		threads.push_back(std::thread([&pool, &executed]() {
+			for (int j = 0; j < 10; j++) {
+				ConnectionPool<MySql>::Lease lease = pool.acquire();
+				lease->execute("SELECT 1");
+				executed++;
+			}
+		}));
+	}
+
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+
+	BOOST_CHECK_EQUAL(executed, 80);
+	BOOST_CHECK(pool.size() <= 4);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,105 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string>
+
+#include <dbplus/Connection.hpp>
+#include <dbplus/MySqlResult.hpp>
+#include <dbplus/PostgresSqlResult.hpp>
+#include <dbplus/RowBlock.hpp>
+
+using std::string;
+
+using dbplus::Connection;
+using dbplus::MySqlDriver;
+using dbplus::MySqlResult;
+using dbplus::PostgresDriver;
+using dbplus::PostgresSqlResult;
+using dbplus::RowBlock;
+
+// When you need to run only one test, compile only this file with the
+// STAND_ALONE flag.
+#ifdef STAND_ALONE
+#define BOOST_TEST_MODULE DBplus
+#endif
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(dbplusConnectionTests)
+
+BOOST_AUTO_TEST_CASE(mustExecuteWithMySqlDriver)
+{
+	Connection<MySqlDriver> mysql;
+	mysql.connect("dbplus", "root", "abc123", "127.0.0.1");
+	mysql.execute("DROP TABLE IF EXISTS typed");
+	mysql.execute("CREATE TABLE typed (id INT(11), name VARCHAR(50))");
+	mysql.execute("INSERT INTO typed VALUES (1, 'first'), (2, 'second')");
+
+	MySqlResult result = mysql.execute("SELECT * FROM typed ORDER BY id");
+	BOOST_CHECK_EQUAL(result.size(), 2);
+	BOOST_REQUIRE(result.fetch());
+	BOOST_CHECK_EQUAL(result.get<long>("id"), 1);
+	BOOST_CHECK_EQUAL(result.get<string>("name"), "first");
+
+	// The result is reused by the next query
+	BOOST_CHECK(mysql.execute("SELECT * FROM typed WHERE id = 2", result));
+	BOOST_REQUIRE(result.fetch());
+	BOOST_CHECK_EQUAL(result.get<string>("name"), "second");
+
+	BOOST_CHECK(mysql.execute("DELETE FROM typed WHERE id = 3", result) == false);
+	BOOST_CHECK(result.fetch() == false);
+
+	long total = 0;
+	BOOST_CHECK_EQUAL(mysql.forEach("SELECT * FROM typed", 
+	                                [&](const MySqlResult &row) {
+		                                total += row.get<long>("id");
+	                                }), 2);
+	BOOST_CHECK_EQUAL(total, 3);
+
+	unsigned int rows = 0;
+	mysql.forEachBatch("SELECT * FROM typed", [&](const RowBlock &block) {
+		rows += block.size();
+	});
+	BOOST_CHECK_EQUAL(rows, 2);
+}
+
+BOOST_AUTO_TEST_CASE(mustExecuteWithPostgresDriver)
+{
+	Connection<PostgresDriver> postgres;
+	postgres.connect("dbplus", "root", "abc123", "127.0.0.1", 5432);
+	postgres.execute("DROP TABLE IF EXISTS typed");
+	postgres.execute("CREATE TABLE typed (id INTEGER, name VARCHAR(50))");
+	postgres.execute("INSERT INTO typed VALUES (1, 'first'), (2, 'second')");
+
+	PostgresSqlResult result = postgres.execute("SELECT * FROM typed ORDER BY id");
+	BOOST_CHECK_EQUAL(result.size(), 2);
+	BOOST_REQUIRE(result.fetch());
+	BOOST_CHECK_EQUAL(result.get<long>("id"), 1);
+	BOOST_CHECK_EQUAL(result.get<string>("name"), "first");
+
+	long total = 0;
+	BOOST_CHECK_EQUAL(postgres.forEach("SELECT * FROM typed", 
+	                                   [&](const PostgresSqlResult &row) {
+		                                   total += row.get<long>("id");
+	                                   }), 2);
+	BOOST_CHECK_EQUAL(total, 3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
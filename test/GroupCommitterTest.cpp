@@ -0,0 +1,101 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+
+#include <dbplus/ConnectionPool.hpp>
+#include <dbplus/DatabaseException.hpp>
+#include <dbplus/GroupCommitter.hpp>
+#include <dbplus/MySql.hpp>
+#include <dbplus/Result.hpp>
+
+using std::future;
+using std::shared_ptr;
+using std::vector;
+
+using dbplus::ConnectionPool;
+using dbplus::DatabaseException;
+using dbplus::GroupCommitter;
+using dbplus::MySql;
+using dbplus::Result;
+
+// When you need to run only one test, compile only this file with the
+// STAND_ALONE flag.
+#ifdef STAND_ALONE
+#define BOOST_TEST_MODULE DBplus
+#endif
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+typedef ConnectionPool<MySql> MySqlPool;
+
+BOOST_AUTO_TEST_SUITE(dbplusGroupCommitterTests)
+
+BOOST_AUTO_TEST_CASE(mustCommitUnitsTogether)
+{
+	shared_ptr<MySqlPool> pool(
+		new MySqlPool("dbplus", "root", "abc123", "127.0.0.1", 3306, 1, 2));
+
+	{
+		MySqlPool::Lease mysql = pool->acquire();
+		mysql->execute("DROP TABLE IF EXISTS grouped");
+		mysql->execute("CREATE TABLE grouped (id INT(11) PRIMARY KEY) ENGINE=InnoDB");
+	}
+
+	vector<future<void> > units;
+
+	{
+		// The window joins all units in one transaction
+		GroupCommitter<MySql> committer(pool, 64, std::chrono::milliseconds(100));
+
+		for (int i = 0; i < 10; i++) {
+			units.push_back(committer.submit([i](MySql &database) {
+				database.execute("INSERT INTO grouped VALUES (" + 
+				                 boost::lexical_cast<std::string>(i) + ")");
+			}));
+		}
+
+		// Duplicated key fails alone without affecting the others
+		units.push_back(committer.submit([](MySql &database) {
+			database.execute("INSERT INTO grouped VALUES (1)");
+		}));
+
+		for (int i = 0; i < 10; i++) {
+			BOOST_CHECK_NO_THROW(units[i].get());
+		}
+		BOOST_CHECK_THROW(units[10].get(), DatabaseException);
+
+		BOOST_CHECK_EQUAL(committer.getUnits(), 11);
+		BOOST_CHECK_EQUAL(committer.getRetries(), 1);
+		BOOST_CHECK(committer.getCommits() < 10);
+	}
+
+	MySqlPool::Lease mysql = pool->acquire();
+	shared_ptr<Result> result = mysql->execute("SELECT COUNT(*) AS total FROM grouped");
+	BOOST_REQUIRE(result->fetch());
+	BOOST_CHECK_EQUAL(result->get<long long>("total"), 10);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,112 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/any.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <dbplus/InsertBuilder.hpp>
+#include <dbplus/MySql.hpp>
+#include <dbplus/PostgresSql.hpp>
+#include <dbplus/Result.hpp>
+
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+using dbplus::InsertBuilder;
+using dbplus::MySql;
+using dbplus::PostgresSql;
+using dbplus::Result;
+
+// When you need to run only one test, compile only this file with the
+// STAND_ALONE flag.
+#ifdef STAND_ALONE
+#define BOOST_TEST_MODULE DBplus
+#endif
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+template<class Driver>
+void insertRows(Driver &database, const string &suffix, const bool upsert)
+{
+	vector<string> columns;
+	columns.push_back("id");
+	columns.push_back("name");
+
+	vector<string> keys;
+	keys.push_back("id");
+
+	// Small statements, so the rows are split
+	InsertBuilder<Driver> insert(database, "built", columns, 200);
+	if (upsert) {
+		insert.setUpsert(keys);
+	}
+
+	for (int i = 0; i < 50; i++) {
+		typename InsertBuilder<Driver>::Row row;
+		row.push_back(i);
+		row.push_back(string("it's ") + boost::lexical_cast<string>(i) + suffix);
+		insert.add(row);
+	}
+
+	BOOST_CHECK(insert.execute() >= 50);
+	BOOST_CHECK(insert.getStatements() > 1);
+	BOOST_CHECK_EQUAL(insert.size(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE(dbplusInsertBuilderTests)
+
+BOOST_AUTO_TEST_CASE(mustInsertAndUpsertInMySql)
+{
+	MySql mysql;
+	mysql.connect("dbplus", "root", "abc123", "127.0.0.1");
+	mysql.execute("DROP TABLE IF EXISTS built");
+	mysql.execute("CREATE TABLE built (id INT(11) PRIMARY KEY, name VARCHAR(50))");
+
+	insertRows(mysql, "", false);
+	insertRows(mysql, " again", true);
+
+	shared_ptr<Result> result = 
+		mysql.execute("SELECT COUNT(*) AS total FROM built WHERE name LIKE '%again'");
+	BOOST_REQUIRE(result->fetch());
+	BOOST_CHECK_EQUAL(result->get<long long>("total"), 50);
+}
+
+BOOST_AUTO_TEST_CASE(mustInsertAndUpsertInPostgreSql)
+{
+	PostgresSql postgres;
+	postgres.connect("dbplus", "root", "abc123", "127.0.0.1", 5432);
+	postgres.execute("DROP TABLE IF EXISTS built");
+	postgres.execute("CREATE TABLE built (id INTEGER PRIMARY KEY, name VARCHAR(50))");
+
+	insertRows(postgres, "", false);
+	insertRows(postgres, " again", true);
+
+	shared_ptr<Result> result = 
+		postgres.execute("SELECT COUNT(*) AS total FROM built WHERE name LIKE '%again'");
+	BOOST_REQUIRE(result->fetch());
+	BOOST_CHECK_EQUAL(result->get<long long>("total"), 50);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
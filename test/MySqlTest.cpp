@@ -17,17 +17,26 @@
   along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <chrono>
+#include <future>
 #include <map>
 #include <memory>
 #include <vector>
 
+extern "C" {
+#include <poll.h>
+}
+
 #include <boost/any.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
 #include <dbplus/Binary.hpp>
 #include <dbplus/DatabaseException.hpp>
 #include <dbplus/MySql.hpp>
+#include <dbplus/ParameterColumn.hpp>
 #include <dbplus/Result.hpp>
+#include <dbplus/RowBlock.hpp>
+#include <dbplus/RowStore.hpp>
 
 using std::map;
 using std::shared_ptr;
@@ -41,7 +50,10 @@ using boost::posix_time::time_from_string;
 using dbplus::Binary;
 using dbplus::DatabaseException;
 using dbplus::MySql;
+using dbplus::ParameterColumn;
 using dbplus::Result;
+using dbplus::RowBlock;
+using dbplus::RowStore;
 
 // When you need to run only one test, compile only this file with the
 // STAND_ALONE flag.
@@ -204,6 +216,326 @@ BOOST_AUTO_TEST_CASE(mustSelectAndBuildAllObjects)
 	BOOST_CHECK_EQUAL(object2.date, time_from_string("2011-12-12 11:11:11"));
 }
 
+void waitAsync(MySql &mysql, MySql::AsyncStatus::Value status)
+{
+	while (status != MySql::AsyncStatus::COMPLETE) {
+		struct pollfd descriptor;
+		descriptor.fd = mysql.getSocket();
+		descriptor.events = (status == MySql::AsyncStatus::WAIT_READ ? 
+		                     POLLIN : POLLOUT);
+		descriptor.revents = 0;
+
+		::poll(&descriptor, 1, -1);
+		status = mysql.poll();
+	}
+}
+
+BOOST_AUTO_TEST_CASE(mustExecuteAsynchronously)
+{
+	MySql mysql;
+
+	BOOST_CHECK_NO_THROW(createDatabaseAndTable(mysql));
+
+	string sql = "INSERT INTO test(value, date) "
+		"VALUES ('This is a test', '2011-11-11 11:11:11')";
+	mysql.execute(sql);
+
+	bool called = false;
+	sql = "SELECT id, value, date FROM test";
+	MySql::AsyncStatus::Value status = 
+		mysql.executeAsync(sql, [&called](shared_ptr<Result> result, 
+		                                 std::exception_ptr error) {
+				called = true;
+				BOOST_CHECK(!error);
+				BOOST_CHECK_EQUAL(result->size(), 1);
+			});
+
+	waitAsync(mysql, status);
+	BOOST_CHECK(called);
+
+	std::future<shared_ptr<Result> > future = mysql.executeAsync(sql);
+	waitAsync(mysql, mysql.poll());
+
+	shared_ptr<Result> result = future.get();
+	BOOST_CHECK_EQUAL(result->size(), 1);
+
+	future = mysql.executeAsync("SELECT * FROM unknownTable");
+	waitAsync(mysql, mysql.poll());
+	BOOST_CHECK_THROW(future.get(), DatabaseException);
+}
+
+BOOST_AUTO_TEST_CASE(mustConnectAsynchronously)
+{
+	MySql mysql;
+	MySql::AsyncStatus::Value status;
+
+	bool connected = false;
+	status = mysql.connectAsync("dbplus", "root", "abc123", "127.0.0.1", 3306,
+	                            [&connected](shared_ptr<Result> result,
+	                                         std::exception_ptr error) {
+				connected = !error;
+			});
+	waitAsync(mysql, status);
+	BOOST_CHECK(connected);
+	BOOST_CHECK(mysql.ping());
+
+	bool failed = false;
+	status = mysql.connectAsync("dbplus", "root", "abc321", "127.0.0.1", 3306,
+	                            [&failed](shared_ptr<Result> result,
+	                                      std::exception_ptr error) {
+				failed = (error != NULL);
+			});
+	waitAsync(mysql, status);
+	BOOST_CHECK(failed);
+}
+
+BOOST_AUTO_TEST_CASE(mustCancelQueryAfterDeadline)
+{
+	MySql mysql;
+	mysql.connect("dbplus", "root", "abc123", "127.0.0.1");
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	BOOST_CHECK_THROW(mysql.execute("SELECT SLEEP(5)", std::chrono::milliseconds(100)),
+	                  DatabaseException);
+	BOOST_CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+
+	// The connection is still usable after the cancellation
+	shared_ptr<Result> result = mysql.execute("SELECT 1 AS value",
+	                                          std::chrono::milliseconds(1000));
+	BOOST_CHECK_EQUAL(result->size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(mustSendBigQueryAsynchronously)
+{
+	MySql mysql;
+	mysql.connect("dbplus", "root", "abc123", "127.0.0.1");
+
+	// Bigger than the send buffer of the socket, so the client waits
+	// to write before the server answers
+	string value(3 * 1024 * 1024, 'a');
+	shared_ptr<Result> result = mysql.execute("SELECT LENGTH('" + value + "') AS size",
+	                                          std::chrono::seconds(30));
+	BOOST_REQUIRE(result->fetch());
+	BOOST_CHECK_EQUAL(result->get<long long>("size"), value.size());
+}
+
+BOOST_AUTO_TEST_CASE(mustEscapeIntoBuffer)
+{
+	MySql mysql;
+	mysql.connect("dbplus", "root", "abc123", "127.0.0.1");
+
+	string buffer = "'";
+	mysql.escape("a long value without special characters, it's \"quoted\"\n", buffer);
+	buffer += "'";
+	BOOST_CHECK_EQUAL(buffer, "'a long value without special characters, "
+	                  "it\\'s \\\"quoted\\\"\\n'");
+
+	BOOST_CHECK_EQUAL(mysql.escape(string("\0x", 2)), "\\0x");
+	BOOST_CHECK_EQUAL(mysql.escape("ação"), "ação");
+
+	shared_ptr<Result> result = mysql.execute("SELECT " + buffer + " AS value");
+	BOOST_REQUIRE(result->fetch());
+	BOOST_CHECK_EQUAL(result->get<string>("value"), 
+	                  "a long value without special characters, it's \"quoted\"\n");
+}
+
+BOOST_AUTO_TEST_CASE(mustEscapeWithoutBackslashes)
+{
+	MySql mysql;
+	mysql.connect("dbplus", "root", "abc123", "127.0.0.1");
+	mysql.execute("SET SESSION sql_mode = 'NO_BACKSLASH_ESCAPES'");
+
+	string buffer = "'";
+	mysql.escape("it's a \\ value", buffer);
+	buffer += "'";
+	BOOST_CHECK_EQUAL(buffer, "'it''s a \\ value'");
+
+	shared_ptr<Result> result = mysql.execute("SELECT " + buffer + " AS value");
+	BOOST_REQUIRE(result->fetch());
+	BOOST_CHECK_EQUAL(result->get<string>("value"), "it's a \\ value");
+}
+
+BOOST_AUTO_TEST_CASE(mustExecuteBulk)
+{
+	MySql mysql;
+	mysql.connect("dbplus", "root", "abc123", "127.0.0.1");
+	mysql.execute("DROP TABLE IF EXISTS bulk");
+	mysql.execute("CREATE TABLE bulk (id INT, price DOUBLE, name VARCHAR(50))");
+
+	vector<long long> ids = {1, 2, 3};
+	vector<double> prices = {1.5, 2.5, 3.5};
+	vector<string> names = {"first", "second", "third"};
+	vector<bool> nulls = {false, true, false};
+
+	vector<ParameterColumn> inserted;
+	inserted.push_back(ParameterColumn(ids));
+	inserted.push_back(ParameterColumn(prices));
+	inserted.push_back(ParameterColumn(names));
+	inserted.back().setNulls(nulls);
+
+	BOOST_CHECK_EQUAL(mysql.executeBulk("INSERT INTO bulk VALUES (?, ?, ?)", 
+	                                    inserted), 3);
+
+	vector<double> newPrices = {10, 20, 30};
+	vector<ParameterColumn> updated;
+	updated.push_back(ParameterColumn(newPrices));
+	updated.push_back(ParameterColumn(ids));
+
+	BOOST_CHECK_EQUAL(mysql.executeBulk("UPDATE bulk SET price = ? WHERE id = ?", 
+	                                    updated), 3);
+
+	// Columns with different sizes
+	vector<long long> missing = {1};
+	updated.back() = ParameterColumn(missing);
+	BOOST_CHECK_THROW(mysql.executeBulk("UPDATE bulk SET price = ? WHERE id = ?", 
+	                                    updated), DatabaseException);
+
+	shared_ptr<Result> result = mysql.execute("SELECT * FROM bulk WHERE name IS NULL");
+	BOOST_REQUIRE(result->fetch());
+	BOOST_CHECK_EQUAL(result->get<long>("id"), 2);
+	BOOST_CHECK_EQUAL(result->get<double>("price"), 20);
+	result.reset();
+
+	// Statements without parameters run once, and the NULL flags are
+	// copied by the column
+	BOOST_CHECK_EQUAL(mysql.executeBulk("DELETE FROM bulk WHERE id = 3", 
+	                                    vector<ParameterColumn>()), 1);
+
+	vector<string> quoted = {"it's; a ? mark", "plain"};
+	vector<ParameterColumn> texts;
+	texts.push_back(ParameterColumn(quoted));
+	texts.back().setNulls(vector<bool>({false, true}));
+
+	BOOST_CHECK_EQUAL(mysql.executeBulk("UPDATE bulk SET name = ? WHERE id = 1", 
+	                                    texts), 2);
+
+	result = mysql.execute("SELECT id FROM bulk WHERE id = 1 AND name IS NULL");
+	BOOST_CHECK(result->fetch());
+
+	// Grouped executions write the escaped values in the statements.
+	// The first one doesn't change the NULL name
+	texts.back().setNulls(vector<bool>({true, false}));
+	BOOST_CHECK_EQUAL(mysql.executeBulk("UPDATE bulk SET name = ? WHERE id = 1", 
+	                                    texts, true), 1);
+
+	result = mysql.execute("SELECT name FROM bulk WHERE id = 1");
+	BOOST_REQUIRE(result->fetch());
+	BOOST_CHECK_EQUAL(result->get<string>("name"), "plain");
+
+	mysql.execute("SET SESSION sql_mode = 'NO_BACKSLASH_ESCAPES'");
+	BOOST_CHECK_THROW(mysql.executeBulk("UPDATE bulk SET name = ? WHERE id = 1", 
+	                                    texts, true), DatabaseException);
+}
+
+BOOST_AUTO_TEST_CASE(mustReuseResult)
+{
+	MySql mysql;
+	mysql.connect("dbplus", "root", "abc123", "127.0.0.1");
+	mysql.execute("DROP TABLE IF EXISTS reused");
+	mysql.execute("CREATE TABLE reused (id INTEGER, name VARCHAR(50))");
+	mysql.execute("INSERT INTO reused VALUES (1, 'first'), (2, NULL), (3, 'third')");
+
+	shared_ptr<Result> result = mysql.execute("SELECT * FROM reused ORDER BY id");
+	BOOST_REQUIRE(result->fetch());
+	BOOST_CHECK_EQUAL(result->get<string>("name"), "first");
+	BOOST_REQUIRE(result->fetch());
+	// NULL values are not in the row
+	BOOST_CHECK_THROW(result->get<string>("name"), DatabaseException);
+	BOOST_REQUIRE(result->fetch());
+	BOOST_CHECK_EQUAL(result->get<string>("name"), "third");
+	BOOST_CHECK(result->fetch() == false);
+	BOOST_CHECK(result->getRow().empty());
+
+	Result *previous = result.get();
+	result = mysql.execute("SELECT name FROM reused WHERE id = 3", result);
+	BOOST_CHECK_EQUAL(result.get(), previous);
+	BOOST_REQUIRE(result->fetch());
+	BOOST_CHECK_EQUAL(result->getRow().size(), 1);
+	BOOST_CHECK_EQUAL(result->get<string>("name"), "third");
+	BOOST_CHECK(result->fetch() == false);
+}
+
+BOOST_AUTO_TEST_CASE(mustSpillResultToFile)
+{
+	MySql mysql;
+	mysql.connect("dbplus", "root", "abc123", "127.0.0.1");
+	mysql.execute("DROP TABLE IF EXISTS spilled");
+	mysql.execute("CREATE TABLE spilled (id INTEGER, name VARCHAR(50))");
+
+	vector<long long> ids;
+	vector<string> names;
+	for (unsigned int i = 0; i < 1000; i++) {
+		ids.push_back(i);
+		names.push_back("name " + std::to_string(i));
+	}
+
+	vector<ParameterColumn> parameters;
+	parameters.push_back(ParameterColumn(ids));
+	parameters.push_back(ParameterColumn(names));
+	mysql.executeBulk("INSERT INTO spilled VALUES (?, ?)", parameters);
+
+	unsigned long memory = RowStore::getGlobalMemory();
+
+	mysql.setMemoryLimit(1024);
+	shared_ptr<Result> result = mysql.execute("SELECT * FROM spilled ORDER BY id");
+	BOOST_CHECK_EQUAL(result->size(), 1000);
+	BOOST_CHECK(RowStore::getGlobalMemory() > memory);
+
+	for (unsigned int i = 0; i < 1000; i++) {
+		BOOST_REQUIRE(result->fetch());
+		BOOST_CHECK_EQUAL(result->get<long>("id"), i);
+		BOOST_CHECK_EQUAL(result->get<string>("name"), "name " + std::to_string(i));
+	}
+	BOOST_CHECK(result->fetch() == false);
+
+	result.reset();
+	BOOST_CHECK_EQUAL(RowStore::getGlobalMemory(), memory);
+}
+
+BOOST_AUTO_TEST_CASE(mustReadRowsInBatches)
+{
+	MySql mysql;
+	mysql.connect("dbplus", "root", "abc123", "127.0.0.1");
+	mysql.execute("DROP TABLE IF EXISTS batches");
+	mysql.execute("CREATE TABLE batches (id INTEGER, name VARCHAR(50))");
+
+	vector<long long> ids;
+	vector<string> names;
+	for (unsigned int i = 0; i < 1000; i++) {
+		ids.push_back(i);
+		names.push_back("name " + std::to_string(i));
+	}
+
+	vector<ParameterColumn> parameters;
+	parameters.push_back(ParameterColumn(ids));
+	parameters.push_back(ParameterColumn(names));
+	mysql.executeBulk("INSERT INTO batches VALUES (?, ?)", parameters);
+
+	shared_ptr<Result> result = mysql.execute("SELECT * FROM batches ORDER BY id");
+
+	unsigned int batches = 0;
+	long expected = 0;
+	result->forEachBatch([&](const RowBlock &block) {
+		batches++;
+		BOOST_CHECK(block.size() <= 300);
+
+		int id = block.getColumn("id");
+		int name = block.getColumn("name");
+		BOOST_REQUIRE(id >= 0 && name >= 0);
+
+		for (unsigned int row = 0; row < block.size(); row++) {
+			BOOST_CHECK_EQUAL(block.get<long>(row, id), expected);
+			BOOST_CHECK_EQUAL(block.get<string>(row, name), 
+			                  "name " + std::to_string(expected));
+			expected++;
+		}
+	}, 300);
+
+	BOOST_CHECK_EQUAL(batches, 4);
+	BOOST_CHECK_EQUAL(expected, 1000);
+	BOOST_CHECK(result->fetch() == false);
+}
+
 BOOST_AUTO_TEST_CASE(mustRollbackData)
 {
 	MySql mysql;
@@ -247,6 +579,58 @@ BOOST_AUTO_TEST_CASE(mustCommitData)
 	BOOST_CHECK_EQUAL(result->size(), 1);
 }
 
+BOOST_AUTO_TEST_CASE(mustExecuteMultipleStatements)
+{
+	MySql mysql;
+	mysql.setMultiStatements(true);
+
+	BOOST_CHECK_NO_THROW(createDatabaseAndTable(mysql));
+
+	string sql = "INSERT INTO test(value, date) "
+		"VALUES ('This is a test', '2011-11-11 11:11:11'); "
+		"SELECT id, value FROM test; "
+		"SELECT COUNT(*) AS total FROM test";
+	vector<shared_ptr<Result> > results = mysql.executeMulti(sql);
+
+	BOOST_CHECK_EQUAL(results.size(), 3);
+	BOOST_CHECK(results[0].get() == NULL);
+	BOOST_CHECK_EQUAL(results[1]->size(), 1);
+	BOOST_CHECK_EQUAL(results[2]->size(), 1);
+
+	while (results[1]->fetch()) {
+		BOOST_CHECK_EQUAL(results[1]->get<string>("value"), "This is a test");
+	}
+
+	while (results[2]->fetch()) {
+		BOOST_CHECK_EQUAL(results[2]->get<long long>("total"), 1);
+	}
+
+	// Connection must still be synchronized after a batch in execute
+	sql = "SELECT id FROM test; SELECT value FROM test";
+	BOOST_CHECK_NO_THROW(mysql.execute(sql));
+	BOOST_CHECK_EQUAL(mysql.execute("SELECT id FROM test")->size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(mustRetrieveStoredProcedureResults)
+{
+	MySql mysql;
+	mysql.setMultiStatements(true);
+
+	BOOST_CHECK_NO_THROW(createDatabaseAndTable(mysql));
+
+	mysql.execute("DROP PROCEDURE IF EXISTS testProcedure");
+	mysql.execute("CREATE PROCEDURE testProcedure() "
+	              "BEGIN SELECT 1 AS first; SELECT 2 AS second; END");
+
+	vector<shared_ptr<Result> > results = mysql.executeMulti("CALL testProcedure()");
+
+	// Two result sets plus the status of the CALL statement
+	BOOST_CHECK_EQUAL(results.size(), 3);
+	BOOST_CHECK_EQUAL(results[0]->size(), 1);
+	BOOST_CHECK_EQUAL(results[1]->size(), 1);
+	BOOST_CHECK(results[2].get() == NULL);
+}
+
 BOOST_AUTO_TEST_CASE(mustRetrieveAllKindsOfData)
 {
 	MySql mysql;
@@ -17,17 +17,26 @@
   along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <chrono>
+#include <future>
 #include <map>
 #include <memory>
 #include <vector>
 
+extern "C" {
+#include <poll.h>
+}
+
 #include <boost/any.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/lexical_cast.hpp>
 
 #include <dbplus/DatabaseException.hpp>
+#include <dbplus/ParameterColumn.hpp>
 #include <dbplus/PostgresSql.hpp>
 #include <dbplus/Result.hpp>
+#include <dbplus/RowBlock.hpp>
+#include <dbplus/RowStore.hpp>
 
 using std::map;
 using std::shared_ptr;
@@ -40,8 +49,11 @@ using boost::posix_time::ptime;
 using boost::posix_time::time_from_string;
 
 using dbplus::DatabaseException;
+using dbplus::ParameterColumn;
 using dbplus::PostgresSql;
 using dbplus::Result;
+using dbplus::RowBlock;
+using dbplus::RowStore;
 
 // When you need to run only one test, compile only this file with the
 // STAND_ALONE flag.
@@ -205,6 +217,285 @@ BOOST_AUTO_TEST_CASE(mustSelectAndBuildAllObjects)
 	BOOST_CHECK_EQUAL(object2.date, time_from_string("2011-12-12 11:11:11"));
 }
 
+void waitAsync(PostgresSql &postgres, PostgresSql::AsyncStatus::Value status)
+{
+	while (status != PostgresSql::AsyncStatus::COMPLETE) {
+		struct pollfd descriptor;
+		descriptor.fd = postgres.getSocket();
+		descriptor.events = (status == PostgresSql::AsyncStatus::WAIT_READ ? 
+		                     POLLIN : POLLOUT);
+		descriptor.revents = 0;
+
+		::poll(&descriptor, 1, -1);
+		status = postgres.poll();
+	}
+}
+
+BOOST_AUTO_TEST_CASE(mustExecuteAsynchronously)
+{
+	PostgresSql postgres;
+
+	BOOST_CHECK_NO_THROW(createDatabaseAndTable(postgres));
+
+	string sql = "INSERT INTO test(value, date) "
+		"VALUES ('This is a test', '2011-11-11 11:11:11')";
+	postgres.execute(sql);
+
+	bool called = false;
+	sql = "SELECT id, value, date FROM test";
+	PostgresSql::AsyncStatus::Value status = 
+		postgres.executeAsync(sql, [&called](shared_ptr<Result> result, 
+		                                 std::exception_ptr error) {
+				called = true;
+				BOOST_CHECK(!error);
+				BOOST_CHECK_EQUAL(result->size(), 1);
+			});
+
+	waitAsync(postgres, status);
+	BOOST_CHECK(called);
+
+	std::future<shared_ptr<Result> > future = postgres.executeAsync(sql);
+	waitAsync(postgres, postgres.poll());
+
+	shared_ptr<Result> result = future.get();
+	BOOST_CHECK_EQUAL(result->size(), 1);
+
+	future = postgres.executeAsync("SELECT * FROM unknownTable");
+	waitAsync(postgres, postgres.poll());
+	BOOST_CHECK_THROW(future.get(), DatabaseException);
+}
+
+BOOST_AUTO_TEST_CASE(mustConnectAsynchronously)
+{
+	PostgresSql postgres;
+	PostgresSql::AsyncStatus::Value status;
+
+	bool connected = false;
+	status = postgres.connectAsync("dbplus", "root", "abc123", "127.0.0.1", 5432,
+	                               [&connected](shared_ptr<Result> result,
+	                                            std::exception_ptr error) {
+				connected = !error;
+			});
+	waitAsync(postgres, status);
+	BOOST_CHECK(connected);
+	BOOST_CHECK(postgres.ping());
+
+	bool failed = false;
+	status = postgres.connectAsync("dbplus", "root", "abc321", "127.0.0.1", 5432,
+	                               [&failed](shared_ptr<Result> result,
+	                                         std::exception_ptr error) {
+				failed = (error != NULL);
+			});
+	waitAsync(postgres, status);
+	BOOST_CHECK(failed);
+}
+
+BOOST_AUTO_TEST_CASE(mustCancelQueryAfterDeadline)
+{
+	PostgresSql postgres;
+	postgres.connect("dbplus", "root", "abc123", "127.0.0.1");
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	BOOST_CHECK_THROW(postgres.execute("SELECT pg_sleep(5)", std::chrono::milliseconds(100)),
+	                  DatabaseException);
+	BOOST_CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+
+	// The connection is still usable after the cancellation
+	shared_ptr<Result> result = postgres.execute("SELECT 1 AS value",
+	                                             std::chrono::milliseconds(1000));
+	BOOST_CHECK_EQUAL(result->size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(mustEscapeIntoBuffer)
+{
+	PostgresSql postgres;
+	postgres.connect("dbplus", "root", "abc123", "127.0.0.1");
+
+	string buffer = "'";
+	postgres.escape("a long value without special characters, it's ação", buffer);
+	buffer += "'";
+	BOOST_CHECK_EQUAL(buffer, "'a long value without special characters, it''s ação'");
+
+	shared_ptr<Result> result = postgres.execute("SELECT " + buffer + "::varchar AS value");
+	BOOST_REQUIRE(result->fetch());
+	BOOST_CHECK_EQUAL(result->get<string>("value"), 
+	                  "a long value without special characters, it's ação");
+}
+
+BOOST_AUTO_TEST_CASE(mustCopyRows)
+{
+	PostgresSql postgres;
+	postgres.connect("dbplus", "root", "abc123", "127.0.0.1");
+	postgres.execute("DROP TABLE IF EXISTS copied");
+	postgres.execute("CREATE TABLE copied (id INTEGER, name VARCHAR(50))");
+
+	vector<string> columns;
+	columns.push_back("id");
+	columns.push_back("name");
+
+	BOOST_CHECK_EQUAL(postgres.copy("copied", columns, "1\tfirst\n2\t\\N\n"), 2);
+	BOOST_CHECK_THROW(postgres.copy("copied", columns, "abc\tthird\n"), DatabaseException);
+
+	// The connection is still usable after an error
+	shared_ptr<Result> result = postgres.execute("SELECT * FROM copied WHERE name IS NULL");
+	BOOST_REQUIRE(result->fetch());
+	BOOST_CHECK_EQUAL(result->get<long>("id"), 2);
+}
+
+BOOST_AUTO_TEST_CASE(mustExecuteBulk)
+{
+	PostgresSql postgres;
+	postgres.connect("dbplus", "root", "abc123", "127.0.0.1");
+	postgres.execute("DROP TABLE IF EXISTS bulk");
+	postgres.execute("CREATE TABLE bulk (id INTEGER, amount INTEGER, name VARCHAR(50))");
+
+	vector<long long> ids;
+	vector<long long> amounts;
+	vector<string> names;
+	vector<bool> nulls;
+	for (unsigned int i = 0; i < 2500; i++) {
+		ids.push_back(i);
+		amounts.push_back(i * 10);
+		names.push_back("name's " + std::to_string(i));
+		nulls.push_back(i == 7);
+	}
+
+	vector<ParameterColumn> inserted;
+	inserted.push_back(ParameterColumn(ids));
+	inserted.push_back(ParameterColumn(amounts));
+	inserted.push_back(ParameterColumn(names));
+	inserted.back().setNulls(nulls);
+
+	BOOST_CHECK_EQUAL(postgres.executeBulk("INSERT INTO bulk VALUES ($1, $2, $3)", 
+	                                       inserted), 2500);
+
+	vector<ParameterColumn> updated;
+	updated.push_back(ParameterColumn(ids));
+	updated.push_back(ParameterColumn(ids));
+
+	BOOST_CHECK_EQUAL(postgres.executeBulk("UPDATE bulk SET amount = $1 WHERE id = $2", 
+	                                       updated), 2500);
+
+	vector<string> invalid = {"1", "abc"};
+	vector<ParameterColumn> failed;
+	failed.push_back(ParameterColumn(invalid));
+	BOOST_CHECK_THROW(postgres.executeBulk("DELETE FROM bulk WHERE id = $1", 
+	                                       failed), DatabaseException);
+
+	// The connection is still usable after an error
+	shared_ptr<Result> result = postgres.execute("SELECT * FROM bulk WHERE name IS NULL");
+	BOOST_REQUIRE(result->fetch());
+	BOOST_CHECK_EQUAL(result->get<long>("id"), 7);
+	BOOST_CHECK_EQUAL(result->get<long>("amount"), 7);
+}
+
+BOOST_AUTO_TEST_CASE(mustReuseResult)
+{
+	PostgresSql postgres;
+	postgres.connect("dbplus", "root", "abc123", "127.0.0.1");
+	postgres.execute("DROP TABLE IF EXISTS reused");
+	postgres.execute("CREATE TABLE reused (id INTEGER, name VARCHAR(50))");
+	postgres.execute("INSERT INTO reused VALUES (1, 'first'), (2, NULL), (3, 'third')");
+
+	shared_ptr<Result> result = postgres.execute("SELECT * FROM reused ORDER BY id");
+	BOOST_REQUIRE(result->fetch());
+	BOOST_CHECK_EQUAL(result->get<string>("name"), "first");
+	BOOST_REQUIRE(result->fetch());
+	BOOST_REQUIRE(result->fetch());
+	BOOST_CHECK_EQUAL(result->get<string>("name"), "third");
+	BOOST_CHECK(result->fetch() == false);
+	BOOST_CHECK(result->getRow().empty());
+
+	Result *previous = result.get();
+	result = postgres.execute("SELECT name FROM reused WHERE id = 3", result);
+	BOOST_CHECK_EQUAL(result.get(), previous);
+	BOOST_REQUIRE(result->fetch());
+	BOOST_CHECK_EQUAL(result->getRow().size(), 1);
+	BOOST_CHECK_EQUAL(result->get<string>("name"), "third");
+	BOOST_CHECK(result->fetch() == false);
+}
+
+BOOST_AUTO_TEST_CASE(mustSpillResultToFile)
+{
+	PostgresSql postgres;
+	postgres.connect("dbplus", "root", "abc123", "127.0.0.1");
+	postgres.execute("DROP TABLE IF EXISTS spilled");
+	postgres.execute("CREATE TABLE spilled (id INTEGER, name VARCHAR(50))");
+
+	vector<long long> ids;
+	vector<string> names;
+	for (unsigned int i = 0; i < 1000; i++) {
+		ids.push_back(i);
+		names.push_back("name " + std::to_string(i));
+	}
+
+	vector<ParameterColumn> parameters;
+	parameters.push_back(ParameterColumn(ids));
+	parameters.push_back(ParameterColumn(names));
+	postgres.executeBulk("INSERT INTO spilled VALUES ($1, $2)", parameters);
+
+	unsigned long memory = RowStore::getGlobalMemory();
+
+	postgres.setMemoryLimit(1024);
+	shared_ptr<Result> result = postgres.execute("SELECT * FROM spilled ORDER BY id");
+	BOOST_CHECK_EQUAL(result->size(), 1000);
+	BOOST_CHECK(RowStore::getGlobalMemory() > memory);
+
+	for (unsigned int i = 0; i < 1000; i++) {
+		BOOST_REQUIRE(result->fetch());
+		BOOST_CHECK_EQUAL(result->get<long>("id"), i);
+		BOOST_CHECK_EQUAL(result->get<string>("name"), "name " + std::to_string(i));
+	}
+	BOOST_CHECK(result->fetch() == false);
+
+	result.reset();
+	BOOST_CHECK_EQUAL(RowStore::getGlobalMemory(), memory);
+}
+
+BOOST_AUTO_TEST_CASE(mustReadRowsInBatches)
+{
+	PostgresSql postgres;
+	postgres.connect("dbplus", "root", "abc123", "127.0.0.1");
+	postgres.execute("DROP TABLE IF EXISTS batches");
+	postgres.execute("CREATE TABLE batches (id INTEGER, name VARCHAR(50))");
+
+	vector<long long> ids;
+	vector<string> names;
+	for (unsigned int i = 0; i < 1000; i++) {
+		ids.push_back(i);
+		names.push_back("name " + std::to_string(i));
+	}
+
+	vector<ParameterColumn> parameters;
+	parameters.push_back(ParameterColumn(ids));
+	parameters.push_back(ParameterColumn(names));
+	postgres.executeBulk("INSERT INTO batches VALUES ($1, $2)", parameters);
+
+	shared_ptr<Result> result = postgres.execute("SELECT * FROM batches ORDER BY id");
+
+	unsigned int batches = 0;
+	long expected = 0;
+	result->forEachBatch([&](const RowBlock &block) {
+		batches++;
+		BOOST_CHECK(block.size() <= 300);
+
+		int id = block.getColumn("id");
+		int name = block.getColumn("name");
+		BOOST_REQUIRE(id >= 0 && name >= 0);
+
+		for (unsigned int row = 0; row < block.size(); row++) {
+			BOOST_CHECK_EQUAL(block.get<long>(row, id), expected);
+			BOOST_CHECK_EQUAL(block.get<string>(row, name), 
+			                  "name " + std::to_string(expected));
+			expected++;
+		}
+	}, 300);
+
+	BOOST_CHECK_EQUAL(batches, 4);
+	BOOST_CHECK_EQUAL(expected, 1000);
+	BOOST_CHECK(result->fetch() == false);
+}
+
 BOOST_AUTO_TEST_CASE(mustRollbackData)
 {
 	PostgresSql postgres;
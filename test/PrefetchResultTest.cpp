@@ -0,0 +1,97 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <memory>
+#include <string>
+
+#include <boost/lexical_cast.hpp>
+
+#include <dbplus/Database.hpp>
+#include <dbplus/DatabaseException.hpp>
+#include <dbplus/MySql.hpp>
+#include <dbplus/PrefetchResult.hpp>
+#include <dbplus/Result.hpp>
+
+using std::shared_ptr;
+using std::string;
+
+using dbplus::Database;
+using dbplus::DatabaseException;
+using dbplus::MySql;
+using dbplus::PrefetchResult;
+using dbplus::Result;
+
+// When you need to run only one test, compile only this file with the
+// STAND_ALONE flag.
+#ifdef STAND_ALONE
+#define BOOST_TEST_MODULE DBplus
+#endif
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(dbplusPrefetchResultTests)
+
+BOOST_AUTO_TEST_CASE(mustPrefetchRowsInBackground)
+{
+	MySql mysql;
+	mysql.connect("dbplus", "root", "abc123", "127.0.0.1");
+	mysql.execute("DROP TABLE IF EXISTS prefetch");
+	mysql.execute("CREATE TABLE prefetch (id INT(11), name VARCHAR(50))");
+
+	string insert = "INSERT INTO prefetch VALUES ";
+	for (unsigned int i = 0; i < 1000; i++) {
+		string id = boost::lexical_cast<string>(i);
+		insert += (i > 0 ? ", (" : "(") + id + ", 'name " + id + "')";
+	}
+	mysql.execute(insert);
+
+	{
+		PrefetchResult result(mysql.execute("SELECT * FROM prefetch ORDER BY id",
+		                                    Database::ResultMode::USE_RESULT),
+		                      100, 2);
+
+		long expected = 0;
+		while (result.fetch()) {
+			BOOST_CHECK_EQUAL(result.get<long>("id"), expected);
+			BOOST_CHECK_EQUAL(result.get<string>("name"), 
+			                  "name " + boost::lexical_cast<string>(expected));
+			expected++;
+		}
+
+		BOOST_CHECK_EQUAL(expected, 1000);
+		BOOST_CHECK(result.fetch() == false);
+		BOOST_CHECK_THROW(result.get("id"), DatabaseException);
+	}
+
+	// Stopping in the middle of the result discards the other rows
+	{
+		PrefetchResult result(mysql.execute("SELECT * FROM prefetch ORDER BY id",
+		                                    Database::ResultMode::USE_RESULT),
+		                      10);
+		BOOST_REQUIRE(result.fetch());
+		BOOST_CHECK_EQUAL(result.get<long>("id"), 0);
+	}
+
+	shared_ptr<Result> count = mysql.execute("SELECT COUNT(*) AS total FROM prefetch");
+	BOOST_REQUIRE(count->fetch());
+	BOOST_CHECK_EQUAL(count->get<long long>("total"), 1000);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
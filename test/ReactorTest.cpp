@@ -0,0 +1,173 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <exception>
+#include <memory>
+
+#include <dbplus/AsyncConnection.hpp>
+#include <dbplus/DatabaseException.hpp>
+#include <dbplus/Executor.hpp>
+#include <dbplus/MySql.hpp>
+#include <dbplus/PostgresSql.hpp>
+#include <dbplus/Reactor.hpp>
+#include <dbplus/Result.hpp>
+
+using std::shared_ptr;
+
+using dbplus::AsyncConnection;
+using dbplus::Database;
+using dbplus::DatabaseException;
+using dbplus::InlineExecutor;
+using dbplus::MySql;
+using dbplus::PostgresSql;
+using dbplus::Reactor;
+using dbplus::Result;
+
+// When you need to run only one test, compile only this file with the
+// STAND_ALONE flag.
+#ifdef STAND_ALONE
+#define BOOST_TEST_MODULE DBplus
+#endif
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(dbplusReactorTests)
+
+BOOST_AUTO_TEST_CASE(mustRunManyQueriesInFewConnections)
+{
+	Reactor reactor;
+
+	for (int i = 0; i < 2; i++) {
+		shared_ptr<Database> mysql(new MySql());
+		mysql->connect("dbplus", "root", "abc123", "127.0.0.1");
+		reactor.addConnection(mysql);
+
+		shared_ptr<Database> postgres(new PostgresSql());
+		postgres->connect("dbplus", "root", "abc123", "127.0.0.1", 5432);
+		reactor.addConnection(postgres);
+	}
+
+	unsigned int finished = 0;
+	for (int i = 0; i < 20; i++) {
+		reactor.execute("SELECT 1 AS value", 
+		                [&finished](shared_ptr<Result> result, 
+		                            std::exception_ptr error) {
+			                BOOST_CHECK(!error);
+			                BOOST_CHECK_EQUAL(result->size(), 1);
+			                finished++;
+		                });
+	}
+
+	BOOST_CHECK_EQUAL(reactor.pending(), 20);
+
+	while (reactor.pending() > 0) {
+		reactor.runOnce(1000);
+	}
+
+	BOOST_CHECK_EQUAL(finished, 20);
+}
+
+BOOST_AUTO_TEST_CASE(mustRunQueriesInTheSameConnection)
+{
+	Reactor reactor;
+
+	shared_ptr<Database> postgres(new PostgresSql());
+	postgres->connect("dbplus", "root", "abc123", "127.0.0.1", 5432);
+	reactor.addConnection(postgres);
+
+	bool failed = false;
+	reactor.execute(postgres, "SELECT * FROM unknownTable",
+	                [&failed](shared_ptr<Result> result, 
+	                          std::exception_ptr error) {
+		                failed = static_cast<bool>(error);
+	                });
+
+	shared_ptr<Database> other(new PostgresSql());
+	reactor.execute(other, "SELECT 1",
+	                [](shared_ptr<Result> result, std::exception_ptr error) {
+		                BOOST_CHECK_THROW(std::rethrow_exception(error), 
+		                                  DatabaseException);
+	                });
+
+	while (reactor.pending() > 0) {
+		reactor.runOnce(1000);
+	}
+
+	BOOST_CHECK(failed);
+}
+
+// Behaves like a coroutine handle, so the awaitables can be tested
+// without a C++20 compiler
+class FakeHandle
+{
+public:
+	explicit FakeHandle(bool &resumed) : _resumed(&resumed) {}
+
+	void resume()
+	{
+		*_resumed = true;
+	}
+
+private:
+	bool *_resumed;
+};
+
+BOOST_AUTO_TEST_CASE(mustResumeAwaitingCoroutines)
+{
+	Reactor reactor;
+	InlineExecutor executor;
+
+	shared_ptr<Database> postgres(new PostgresSql());
+	postgres->connect("dbplus", "root", "abc123", "127.0.0.1", 5432);
+	reactor.addConnection(postgres);
+
+	AsyncConnection connection(reactor, postgres, executor);
+
+	bool resumed = false;
+	AsyncConnection::Awaitable execute = connection.execute("SELECT 1 AS value");
+	BOOST_CHECK(execute.await_ready() == false);
+	execute.await_suspend(FakeHandle(resumed));
+
+	while (reactor.pending() > 0) {
+		reactor.runOnce(1000);
+	}
+
+	BOOST_CHECK(resumed);
+
+	shared_ptr<Result> result = execute.await_resume();
+	BOOST_CHECK_EQUAL(result->size(), 1);
+
+	Result::FetchAwaitable fetch = result->fetchAsync();
+	BOOST_CHECK(fetch.await_ready());
+	BOOST_CHECK(fetch.await_resume());
+
+	resumed = false;
+	AsyncConnection::Awaitable commit = connection.commit();
+	commit.await_suspend(FakeHandle(resumed));
+
+	while (reactor.pending() > 0) {
+		reactor.runOnce(1000);
+	}
+
+	BOOST_CHECK(resumed);
+	BOOST_CHECK_NO_THROW(commit.await_resume());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
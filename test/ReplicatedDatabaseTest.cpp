@@ -0,0 +1,158 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include <dbplus/ConnectionPool.hpp>
+#include <dbplus/Database.hpp>
+#include <dbplus/DatabaseException.hpp>
+#include <dbplus/MySql.hpp>
+#include <dbplus/ReplicatedDatabase.hpp>
+#include <dbplus/Result.hpp>
+
+using std::shared_ptr;
+using std::vector;
+
+using dbplus::ConnectionPool;
+using dbplus::Database;
+using dbplus::MySql;
+using dbplus::ReplicatedDatabase;
+using dbplus::Result;
+
+// When you need to run only one test, compile only this file with the
+// STAND_ALONE flag.
+#ifdef STAND_ALONE
+#define BOOST_TEST_MODULE DBplus
+#endif
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+typedef ConnectionPool<MySql> MySqlPool;
+
+BOOST_AUTO_TEST_SUITE(dbplusReplicatedDatabaseTests)
+
+BOOST_AUTO_TEST_CASE(mustDetectReadOnlyQueries)
+{
+	typedef ReplicatedDatabase<MySql> Router;
+
+	BOOST_CHECK(Router::isReadOnly("SELECT * FROM test"));
+	BOOST_CHECK(Router::isReadOnly("  (select 1) UNION (select 2);"));
+	BOOST_CHECK(Router::isReadOnly("SHOW TABLES"));
+
+	BOOST_CHECK(Router::isReadOnly("INSERT INTO test VALUES (1)") == false);
+	BOOST_CHECK(Router::isReadOnly("SELECT * FROM test FOR UPDATE") == false);
+	BOOST_CHECK(Router::isReadOnly("SELECT id INTO @id FROM test") == false);
+	BOOST_CHECK(Router::isReadOnly("SELECT 1; DELETE FROM test") == false);
+}
+
+BOOST_AUTO_TEST_CASE(mustSendReadsToReplicas)
+{
+	shared_ptr<MySqlPool> primary(
+		new MySqlPool("dbplus", "root", "abc123", "127.0.0.1", 3306, 1, 2));
+
+	vector<shared_ptr<MySqlPool> > replicas;
+	replicas.push_back(shared_ptr<MySqlPool>(
+		new MySqlPool("dbplus", "root", "abc123", "127.0.0.1", 3306, 1, 2)));
+	replicas.push_back(shared_ptr<MySqlPool>(
+		new MySqlPool("dbplus", "root", "abc123", "127.0.0.1", 3306, 1, 2)));
+
+	ReplicatedDatabase<MySql> database(primary, replicas);
+
+	// While the result is alive the connection is borrowed, so the next
+	// read goes to the other replica
+	shared_ptr<Result> first = database.execute("SELECT 1");
+	shared_ptr<Result> second = database.execute("SELECT 1");
+	BOOST_CHECK_EQUAL(replicas[0]->leased(), 1);
+	BOOST_CHECK_EQUAL(replicas[1]->leased(), 1);
+	BOOST_CHECK_EQUAL(primary->leased(), 0);
+
+	first.reset();
+	second.reset();
+	BOOST_CHECK_EQUAL(replicas[0]->leased() + replicas[1]->leased(), 0);
+
+	database.execute("DROP TABLE IF EXISTS test");
+	database.execute("CREATE TABLE test (id INT AUTO_INCREMENT PRIMARY KEY, "
+	                 "value VARCHAR(255))");
+	database.execute("INSERT INTO test(value) VALUES ('This is a test')");
+	BOOST_CHECK_EQUAL(database.affectedRows(), 1);
+	BOOST_CHECK_EQUAL(database.lastInsertedId(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(mustKeepTransactionsInThePrimary)
+{
+	shared_ptr<MySqlPool> primary(
+		new MySqlPool("dbplus", "root", "abc123", "127.0.0.1", 3306, 1, 2));
+	shared_ptr<MySqlPool> replica(
+		new MySqlPool("dbplus", "root", "abc123", "127.0.0.1", 3306, 1, 2));
+
+	ReplicatedDatabase<MySql> database(primary);
+	database.addReplica(replica);
+
+	database.setTransactionMode(Database::TransactionMode::MANUAL_COMMIT);
+	BOOST_CHECK_EQUAL(primary->leased(), 1);
+
+	shared_ptr<Result> result = database.execute("SELECT 1");
+	BOOST_CHECK_EQUAL(replica->leased(), 0);
+	result.reset();
+
+	database.rollback();
+	database.setTransactionMode(Database::TransactionMode::AUTO_COMMIT);
+	BOOST_CHECK_EQUAL(primary->leased(), 0);
+
+	// Reads right after a write see the written data
+	database.setReadYourWrites(std::chrono::milliseconds(60000));
+	database.execute("DO 1");
+	result = database.execute("SELECT 1");
+	BOOST_CHECK_EQUAL(replica->leased(), 0);
+	BOOST_CHECK_EQUAL(primary->leased(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(mustHedgeSlowReads)
+{
+	shared_ptr<MySqlPool> primary(
+		new MySqlPool("dbplus", "root", "abc123", "127.0.0.1", 3306, 1, 2));
+
+	vector<shared_ptr<MySqlPool> > replicas;
+	replicas.push_back(shared_ptr<MySqlPool>(
+		new MySqlPool("dbplus", "root", "abc123", "127.0.0.1", 3306, 1, 4)));
+	replicas.push_back(shared_ptr<MySqlPool>(
+		new MySqlPool("dbplus", "root", "abc123", "127.0.0.1", 3306, 1, 4)));
+
+	{
+		ReplicatedDatabase<MySql> database(primary, replicas);
+		database.setHedging(50);
+
+		// Fast reads define the latency, so the slow read is sent to both
+		// replicas
+		for (int i = 0; i < 32; i++) {
+			BOOST_CHECK_EQUAL(database.execute("SELECT 1")->size(), 1);
+		}
+
+		BOOST_CHECK_EQUAL(database.execute("SELECT SLEEP(0.2)")->size(), 1);
+		BOOST_CHECK_THROW(database.execute("SELECT SLEEP(5)", std::chrono::milliseconds(100)),
+		                  dbplus::DatabaseException);
+	}
+
+	BOOST_CHECK_EQUAL(replicas[0]->leased() + replicas[1]->leased(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,119 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include <dbplus/MySql.hpp>
+#include <dbplus/PostgresSql.hpp>
+#include <dbplus/Result.hpp>
+#include <dbplus/ResultExporter.hpp>
+
+using std::shared_ptr;
+using std::string;
+
+using dbplus::Database;
+using dbplus::MySql;
+using dbplus::PostgresSql;
+using dbplus::Result;
+using dbplus::ResultExporter;
+
+// When you need to run only one test, compile only this file with the
+// STAND_ALONE flag.
+#ifdef STAND_ALONE
+#define BOOST_TEST_MODULE DBplus
+#endif
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+string exportToFile(Result &result, const ResultExporter::Format::Value format)
+{
+	FILE *file = tmpfile();
+	BOOST_REQUIRE(file != NULL);
+
+	ResultExporter exporter(fileno(file), format);
+	exporter.write(result);
+
+	string text;
+	char buffer[1024];
+	rewind(file);
+	while (size_t size = fread(buffer, 1, sizeof(buffer), file)) {
+		text.append(buffer, size);
+	}
+	fclose(file);
+
+	return text;
+}
+
+BOOST_AUTO_TEST_SUITE(dbplusResultExporterTests)
+
+BOOST_AUTO_TEST_CASE(mustExportMySqlResult)
+{
+	MySql mysql;
+	mysql.connect("dbplus", "root", "abc123", "127.0.0.1");
+	mysql.execute("DROP TABLE IF EXISTS exports");
+	mysql.execute("CREATE TABLE exports (id INT(11), name VARCHAR(50))");
+	mysql.execute("INSERT INTO exports VALUES "
+	              "(1, 'plain'), (2, 'with \"quotes\", comma'), (3, NULL), (4, '')");
+
+	shared_ptr<Result> result = 
+		mysql.execute("SELECT * FROM exports ORDER BY id", 
+		              Database::ResultMode::USE_RESULT);
+	BOOST_CHECK_EQUAL(exportToFile(*result, ResultExporter::Format::CSV),
+	                  "id,name\n"
+	                  "1,plain\n"
+	                  "2,\"with \"\"quotes\"\", comma\"\n"
+	                  "3,\n"
+	                  "4,\"\"\n");
+
+	result = mysql.execute("SELECT * FROM exports ORDER BY id");
+	BOOST_CHECK_EQUAL(exportToFile(*result, ResultExporter::Format::JSON_LINES),
+	                  "{\"id\":1,\"name\":\"plain\"}\n"
+	                  "{\"id\":2,\"name\":\"with \\\"quotes\\\", comma\"}\n"
+	                  "{\"id\":3,\"name\":null}\n"
+	                  "{\"id\":4,\"name\":\"\"}\n");
+}
+
+BOOST_AUTO_TEST_CASE(mustExportPostgreSqlResult)
+{
+	PostgresSql postgres;
+	postgres.connect("dbplus", "root", "abc123", "127.0.0.1", 5432);
+	postgres.execute("DROP TABLE IF EXISTS exports");
+	postgres.execute("CREATE TABLE exports (id INTEGER, name VARCHAR(50))");
+	postgres.execute("INSERT INTO exports VALUES "
+	                 "(1, E'line\\nbreak'), (2, NULL)");
+
+	shared_ptr<Result> result = 
+		postgres.execute("SELECT * FROM exports ORDER BY id");
+	BOOST_CHECK_EQUAL(exportToFile(*result, ResultExporter::Format::JSON_LINES),
+	                  "{\"id\":1,\"name\":\"line\\nbreak\"}\n"
+	                  "{\"id\":2,\"name\":null}\n");
+
+	// Rows spilled to a file keep the NULL values
+	postgres.setMemoryLimit(1);
+	result = postgres.execute("SELECT * FROM exports ORDER BY id");
+	BOOST_CHECK_EQUAL(exportToFile(*result, ResultExporter::Format::CSV),
+	                  "id,name\n"
+	                  "1,\"line\nbreak\"\n"
+	                  "2,\n");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
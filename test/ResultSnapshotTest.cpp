@@ -0,0 +1,158 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include <boost/date_time/gregorian/gregorian.hpp>
+
+#include <dbplus/DatabaseException.hpp>
+#include <dbplus/MySql.hpp>
+#include <dbplus/Result.hpp>
+#include <dbplus/ResultSnapshot.hpp>
+#include <dbplus/SnapshotResult.hpp>
+
+using std::shared_ptr;
+using std::string;
+
+using dbplus::DatabaseException;
+using dbplus::MySql;
+using dbplus::Result;
+using dbplus::ResultSnapshot;
+using dbplus::SnapshotResult;
+
+// When you need to run only one test, compile only this file with the
+// STAND_ALONE flag.
+#ifdef STAND_ALONE
+#define BOOST_TEST_MODULE DBplus
+#endif
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(dbplusResultSnapshotTests)
+
+BOOST_AUTO_TEST_CASE(mustReadResultFromSnapshot)
+{
+	MySql mysql;
+	mysql.connect("dbplus", "root", "abc123", "127.0.0.1");
+	mysql.execute("DROP TABLE IF EXISTS snapshots");
+	mysql.execute("CREATE TABLE snapshots (id INT(11), name VARCHAR(50), "
+	              "created DATE)");
+	mysql.execute("INSERT INTO snapshots VALUES "
+	              "(1, 'first', '2012-01-01'), (2, NULL, '2012-01-02'), "
+	              "(3, 'third', NULL)");
+
+	const string path = "/tmp/dbplus-snapshot.bin";
+
+	shared_ptr<Result> result = 
+		mysql.execute("SELECT * FROM snapshots ORDER BY id");
+	BOOST_CHECK_EQUAL(ResultSnapshot::write(*result, path), 3);
+
+	SnapshotResult snapshot(path);
+	BOOST_CHECK_EQUAL(snapshot.size(), 3);
+	BOOST_CHECK_EQUAL(snapshot.getType("id"), ResultSnapshot::Type::LONG);
+	BOOST_CHECK_EQUAL(snapshot.getType("name"), ResultSnapshot::Type::STRING);
+
+	BOOST_REQUIRE(snapshot.fetch());
+	BOOST_CHECK_EQUAL(snapshot.get<long>("id"), 1);
+	BOOST_CHECK_EQUAL(snapshot.get<string>("name"), "first");
+	BOOST_CHECK_EQUAL(snapshot.get<boost::gregorian::date>("created"),
+	                  boost::gregorian::date(2012, 1, 1));
+
+	BOOST_REQUIRE(snapshot.fetch());
+	BOOST_CHECK_EQUAL(snapshot.get<long>("id"), 2);
+	BOOST_CHECK_THROW(snapshot.get("name"), DatabaseException);
+
+	BOOST_REQUIRE(snapshot.fetch());
+	BOOST_CHECK_EQUAL(snapshot.get<string>("name"), "third");
+	BOOST_CHECK_THROW(snapshot.get("created"), DatabaseException);
+	BOOST_CHECK(snapshot.fetch() == false);
+
+	// The values of a column are read straight from the file
+	const unsigned char *nulls = NULL;
+	const char *heap = NULL;
+	const long *ids = static_cast<const long*>(snapshot.getValues("id", nulls, heap));
+	BOOST_CHECK_EQUAL(ids[2], 3);
+	snapshot.getValues("name", nulls, heap);
+	BOOST_CHECK_EQUAL(nulls[0], 2);
+	BOOST_CHECK_EQUAL(string(heap, 10), "firstthird");
+
+	snapshot.rewind();
+	BOOST_REQUIRE(snapshot.fetch());
+	BOOST_CHECK_EQUAL(snapshot.get<long>("id"), 1);
+
+	remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(mustKeepColumnsWithoutValues)
+{
+	MySql mysql;
+	mysql.connect("dbplus", "root", "abc123", "127.0.0.1");
+	mysql.execute("DROP TABLE IF EXISTS snapshots");
+	mysql.execute("CREATE TABLE snapshots (id INT(11), name VARCHAR(50), "
+	              "created DATE)");
+	mysql.execute("INSERT INTO snapshots VALUES (1, NULL, NULL)");
+
+	const string path = "/tmp/dbplus-snapshot.bin";
+
+	shared_ptr<Result> result = 
+		mysql.execute("SELECT name, id, created FROM snapshots");
+	BOOST_CHECK_EQUAL(ResultSnapshot::write(*result, path), 1);
+
+	SnapshotResult snapshot(path);
+	BOOST_REQUIRE_EQUAL(snapshot.getColumnNames().size(), 3);
+	BOOST_CHECK_EQUAL(snapshot.getColumnNames()[0], "name");
+	BOOST_CHECK_EQUAL(snapshot.getColumnNames()[1], "id");
+	BOOST_CHECK_EQUAL(snapshot.getColumnNames()[2], "created");
+	BOOST_CHECK_EQUAL(snapshot.getType("name"), ResultSnapshot::Type::STRING);
+
+	BOOST_REQUIRE(snapshot.fetch());
+	BOOST_CHECK_EQUAL(snapshot.get<long>("id"), 1);
+	BOOST_CHECK(snapshot.getRow().count("name") == 0);
+	BOOST_CHECK(snapshot.getRow().count("created") == 0);
+	BOOST_CHECK(snapshot.fetch() == false);
+
+	// An empty result keeps its columns
+	result = mysql.execute("SELECT * FROM snapshots WHERE id = 0");
+	BOOST_CHECK_EQUAL(ResultSnapshot::write(*result, path), 0);
+
+	SnapshotResult empty(path);
+	BOOST_CHECK_EQUAL(empty.getColumnNames().size(), 3);
+	BOOST_CHECK(empty.fetch() == false);
+
+	remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(mustRejectInvalidSnapshot)
+{
+	const string path = "/tmp/dbplus-invalid-snapshot.bin";
+
+	FILE *file = fopen(path.c_str(), "w");
+	BOOST_REQUIRE(file != NULL);
+	fputs("this is not a snapshot, but it is long enough", file);
+	fclose(file);
+
+	BOOST_CHECK_THROW(SnapshotResult snapshot(path), DatabaseException);
+
+	remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,141 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include <dbplus/ConnectionPool.hpp>
+#include <dbplus/DatabaseException.hpp>
+#include <dbplus/MergedResult.hpp>
+#include <dbplus/MySql.hpp>
+#include <dbplus/Result.hpp>
+#include <dbplus/ShardedDatabase.hpp>
+
+using std::shared_ptr;
+using std::vector;
+
+using dbplus::ConnectionPool;
+using dbplus::DatabaseException;
+using dbplus::MergedResult;
+using dbplus::MySql;
+using dbplus::Result;
+using dbplus::ShardedDatabase;
+
+// When you need to run only one test, compile only this file with the
+// STAND_ALONE flag.
+#ifdef STAND_ALONE
+#define BOOST_TEST_MODULE DBplus
+#endif
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+typedef ConnectionPool<MySql> MySqlPool;
+typedef ShardedDatabase<MySql> MySqlShards;
+
+vector<shared_ptr<MySqlPool> > createShards(const unsigned int number)
+{
+	vector<shared_ptr<MySqlPool> > shards;
+	for (unsigned int i = 0; i < number; i++) {
+		shards.push_back(shared_ptr<MySqlPool>(
+			new MySqlPool("dbplus", "root", "abc123", "127.0.0.1", 3306, 1, 2)));
+	}
+
+	return shards;
+}
+
+BOOST_AUTO_TEST_SUITE(dbplusShardedDatabaseTests)
+
+BOOST_AUTO_TEST_CASE(mustSelectShardOfKey)
+{
+	BOOST_CHECK_EQUAL(MySqlShards::hash("user-1", 16), MySqlShards::hash("user-1", 16));
+	BOOST_CHECK(MySqlShards::hash("user-1", 16) < 16);
+
+	vector<long long> bounds;
+	bounds.push_back(1000);
+	bounds.push_back(2000);
+
+	MySqlShards::ShardFunction range = MySqlShards::range(bounds);
+	BOOST_CHECK_EQUAL(range("5", 3), 0);
+	BOOST_CHECK_EQUAL(range("1000", 3), 1);
+	BOOST_CHECK_EQUAL(range("1999", 3), 1);
+	BOOST_CHECK_EQUAL(range("50000", 3), 2);
+	BOOST_CHECK_THROW(range("abc", 3), DatabaseException);
+}
+
+BOOST_AUTO_TEST_CASE(mustExecuteInAllShards)
+{
+	MySqlShards database(createShards(3));
+
+	shared_ptr<Result> result = database.execute("SELECT 1 AS id");
+	BOOST_CHECK_EQUAL(result->size(), 3);
+
+	unsigned int rows = 0;
+	while (result->fetch()) {
+		BOOST_CHECK_EQUAL(result->get<long long>("id"), 1);
+		rows++;
+	}
+
+	BOOST_CHECK_EQUAL(rows, 3);
+	BOOST_CHECK_THROW(database.execute("SELECT * FROM unknownTable"), DatabaseException);
+}
+
+BOOST_AUTO_TEST_CASE(mustMergeSortedResults)
+{
+	MySqlShards database(createShards(2));
+
+	shared_ptr<Result> result = 
+		database.executeAll("SELECT 1 AS id UNION SELECT 3 ORDER BY id",
+		                    MergedResult::byColumn<long long>("id"));
+
+	vector<long long> ids;
+	while (result->fetch()) {
+		ids.push_back(result->get<long long>("id"));
+	}
+
+	BOOST_REQUIRE_EQUAL(ids.size(), 4);
+	BOOST_CHECK_EQUAL(ids[0], 1);
+	BOOST_CHECK_EQUAL(ids[1], 1);
+	BOOST_CHECK_EQUAL(ids[2], 3);
+	BOOST_CHECK_EQUAL(ids[3], 3);
+
+	result = database.executeByKey("user-1", "SELECT 1 AS id");
+	BOOST_CHECK_EQUAL(result->size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(mustRollbackAfterTimeoutInTransaction)
+{
+	MySqlShards shards(createShards(2));
+	shards.setTransactionMode(MySqlShards::TransactionMode::MANUAL_COMMIT);
+
+	// Without time to finish after the cancel, the connections of the
+	// shards are closed with their transactions
+	BOOST_CHECK_THROW(shards.executeAll("SELECT SLEEP(1)", MergedResult::Less(),
+	                                    std::chrono::milliseconds(0)),
+	                  DatabaseException);
+
+	BOOST_CHECK_EQUAL(shards.getTransactionMode(), 
+	                  MySqlShards::TransactionMode::AUTO_COMMIT);
+	shards.rollback();
+
+	BOOST_CHECK(shards.execute("SELECT 1 AS value"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
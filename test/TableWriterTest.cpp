@@ -0,0 +1,135 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/optional.hpp>
+
+#include <dbplus/MySql.hpp>
+#include <dbplus/PostgresSql.hpp>
+#include <dbplus/Result.hpp>
+#include <dbplus/TableDescriptor.hpp>
+#include <dbplus/TableWriter.hpp>
+
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+using dbplus::MySql;
+using dbplus::PostgresSql;
+using dbplus::Result;
+using dbplus::TableWriter;
+using dbplus::describeTable;
+using dbplus::tableColumn;
+
+// When you need to run only one test, compile only this file with the
+// STAND_ALONE flag.
+#ifdef STAND_ALONE
+#define BOOST_TEST_MODULE DBplus
+#endif
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+struct Product {
+	long long id;
+	string name;
+	int stock;
+	boost::optional<string> note;
+};
+
+vector<Product> buildProducts(const unsigned int size, const string &suffix)
+{
+	vector<Product> products;
+	for (unsigned int i = 0; i < size; i++) {
+		Product product;
+		product.id = i;
+		product.name = "it's\tproduct " + boost::lexical_cast<string>(i) + suffix;
+		product.stock = i * 2;
+		if (i % 2 == 0) {
+			product.note = string("back\\slash\nand line");
+		}
+		products.push_back(product);
+	}
+
+	return products;
+}
+
+template<class Driver>
+void writeProducts(Driver &database)
+{
+	auto products = describeTable("products",
+	                              tableColumn("id", &Product::id),
+	                              tableColumn("name", &Product::name),
+	                              tableColumn("stock", &Product::stock),
+	                              tableColumn("note", &Product::note));
+
+	BOOST_CHECK_EQUAL(TableWriter::write(database, products, 
+	                                     buildProducts(1000, "")), 1000);
+
+	vector<string> keys;
+	keys.push_back("id");
+	BOOST_CHECK(TableWriter::upsert(database, products, keys, 
+	                                buildProducts(10, " again")) >= 10);
+
+	shared_ptr<Result> result = 
+		database.execute("SELECT COUNT(*) AS total FROM products "
+		                 "WHERE name LIKE '%again'");
+	BOOST_REQUIRE(result->fetch());
+	BOOST_CHECK_EQUAL(result->get<long long>("total"), 10);
+
+	result = database.execute("SELECT * FROM products WHERE id = 2");
+	BOOST_REQUIRE(result->fetch());
+	BOOST_CHECK_EQUAL(result->get<string>("name"), "it's\tproduct 2 again");
+	BOOST_CHECK_EQUAL(result->get<string>("note"), "back\\slash\nand line");
+
+	result = database.execute("SELECT COUNT(*) AS total FROM products "
+	                          "WHERE note IS NULL");
+	BOOST_REQUIRE(result->fetch());
+	BOOST_CHECK_EQUAL(result->get<long long>("total"), 500);
+}
+
+BOOST_AUTO_TEST_SUITE(dbplusTableWriterTests)
+
+BOOST_AUTO_TEST_CASE(mustWriteObjectsInMySql)
+{
+	MySql mysql;
+	mysql.connect("dbplus", "root", "abc123", "127.0.0.1");
+	mysql.execute("DROP TABLE IF EXISTS products");
+	mysql.execute("CREATE TABLE products (id BIGINT PRIMARY KEY, name VARCHAR(50), "
+	              "stock INT(11), note VARCHAR(50))");
+
+	writeProducts(mysql);
+}
+
+BOOST_AUTO_TEST_CASE(mustWriteObjectsInPostgreSql)
+{
+	PostgresSql postgres;
+	postgres.connect("dbplus", "root", "abc123", "127.0.0.1", 5432);
+	postgres.execute("DROP TABLE IF EXISTS products");
+	postgres.execute("CREATE TABLE products (id BIGINT PRIMARY KEY, name VARCHAR(50), "
+	                 "stock INTEGER, note VARCHAR(50))");
+
+	writeProducts(postgres);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
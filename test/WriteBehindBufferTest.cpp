@@ -0,0 +1,113 @@
+/*
+  DBplus Copyright (C) 2012 Rafael Dantas Justo
+
+  This file is part of DBplus.
+
+  DBplus is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DBplus is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DBplus.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/any.hpp>
+
+#include <dbplus/ConnectionPool.hpp>
+#include <dbplus/MySql.hpp>
+#include <dbplus/Result.hpp>
+#include <dbplus/WriteBehindBuffer.hpp>
+
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+using dbplus::ConnectionPool;
+using dbplus::MySql;
+using dbplus::Result;
+using dbplus::WriteBehindBuffer;
+
+// When you need to run only one test, compile only this file with the
+// STAND_ALONE flag.
+#ifdef STAND_ALONE
+#define BOOST_TEST_MODULE DBplus
+#endif
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+typedef ConnectionPool<MySql> MySqlPool;
+typedef WriteBehindBuffer<MySql> MySqlBuffer;
+
+long long countBuffered(shared_ptr<MySqlPool> pool)
+{
+	MySqlPool::Lease mysql = pool->acquire();
+	shared_ptr<Result> result = mysql->execute("SELECT COUNT(*) AS total FROM buffered");
+	result->fetch();
+	return result->get<long long>("total");
+}
+
+BOOST_AUTO_TEST_SUITE(dbplusWriteBehindBufferTests)
+
+BOOST_AUTO_TEST_CASE(mustWriteRowsInBackground)
+{
+	shared_ptr<MySqlPool> pool(
+		new MySqlPool("dbplus", "root", "abc123", "127.0.0.1", 3306, 1, 2));
+
+	{
+		MySqlPool::Lease mysql = pool->acquire();
+		mysql->execute("DROP TABLE IF EXISTS buffered");
+		mysql->execute("CREATE TABLE buffered (id INT(11), name VARCHAR(50))");
+	}
+
+	vector<string> columns;
+	columns.push_back("id");
+	columns.push_back("name");
+
+	{
+		MySqlBuffer buffer(pool, "buffered", columns, 500);
+
+		vector<std::thread> producers;
+		for (int i = 0; i < 4; i++) {
+			producers.push_back(std::thread([&buffer, i]() {
+				for (int j = 0; j < 1000; j++) {
+					MySqlBuffer::Row row;
+					row.push_back(i * 1000 + j);
+					row.push_back(j % 2 == 0 ? boost::any(string("it's")) : boost::any());
+					buffer.push(row);
+				}
+			}));
+		}
+
+		for (auto &producer : producers) {
+			producer.join();
+		}
+
+		buffer.flush();
+		BOOST_CHECK_EQUAL(buffer.size(), 0);
+		BOOST_CHECK_EQUAL(buffer.getWritten(), 4000);
+		BOOST_CHECK_EQUAL(countBuffered(pool), 4000);
+
+		// Rows still in the queue are written when the buffer is
+		// destroyed
+		MySqlBuffer::Row row;
+		row.push_back(-1);
+		row.push_back(string("last"));
+		BOOST_CHECK(buffer.tryPush(row));
+	}
+
+	BOOST_CHECK_EQUAL(countBuffered(pool), 4001);
+}
+
+BOOST_AUTO_TEST_SUITE_END()